@@ -0,0 +1,160 @@
+//
+// Block allocator benchmark: BitAllocator against the std::vector<bool>
+// scan FileSystem::allocateBlock() used before, on a map the size of the
+// FileSystem image (Layout::BLOCK_COUNT blocks), at several fill levels.
+//
+// Two layouts per fill level:
+//
+//   sequential  blocks taken in order from the start of the data area, the
+//               way a disk fills up; the old scan walks every used block
+//               before finding a free one
+//   random      the same number of used blocks scattered over the data area
+//
+// Each operation frees one used block and allocates one, so the fill level
+// stays put. Reports ns per allocation for both allocators and, for the
+// random layout, the average run allocateRun() returns when asked for 16
+// blocks (how contiguous multi-block appends stay on a fragmented disk).
+//
+// Build (from SafeSpace/server):
+//   cmake -S . -B build -DSERVER_BUILD_BENCHMARKS=ON && cmake --build build --target block_alloc_bench
+// or directly:
+//   g++ -std=c++17 -O2 -Isrc bench/block_alloc_bench.cpp src/model/filesystem/BitAllocator.cpp -o block_alloc_bench
+//
+// Usage: block_alloc_bench [operations] [old-scan operations]
+//
+
+#include "model/filesystem/BitAllocator.h"
+#include "model/filesystem/Layout.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// What FileSystem::allocateBlock() did before BitAllocator
+struct LinearBitmap {
+  std::vector<bool> bits;
+  uint64_t first;
+
+  int64_t allocate() {
+    for (uint64_t i = first; i < bits.size(); ++i) {
+      if (!bits[i]) {
+        bits[i] = true;
+        return static_cast<int64_t>(i);
+      }
+    }
+    return -1;
+  }
+  void release(uint64_t i) { bits[i] = false; }
+};
+
+// Used blocks for a fill level; sequential or scattered over the data area
+std::vector<uint64_t> layout(uint64_t first, uint64_t count, double fill, bool sequential, std::mt19937_64& rng) {
+  const uint64_t blocks = count - first;
+  const uint64_t used = static_cast<uint64_t>(blocks * fill);
+  std::vector<uint64_t> out;
+  out.reserve(used);
+  if (sequential) {
+    for (uint64_t i = 0; i < used; ++i) out.push_back(first + i);
+    return out;
+  }
+  std::vector<uint64_t> all(blocks);
+  for (uint64_t i = 0; i < blocks; ++i) all[i] = first + i;
+  std::shuffle(all.begin(), all.end(), rng);
+  out.assign(all.begin(), all.begin() + static_cast<std::ptrdiff_t>(used));
+  return out;
+}
+
+// Frees a random used block and allocates one, ops times; ns per operation
+template <typename Allocate, typename Release>
+double churn(std::vector<uint64_t> used, size_t ops, std::mt19937_64& rng, Allocate allocate, Release release,
+             bool& ok) {
+  const auto start = Clock::now();
+  for (size_t i = 0; i < ops; ++i) {
+    const size_t victim = rng() % used.size();
+    release(used[victim]);
+    const int64_t b = allocate();
+    if (b < 0) {
+      ok = false;
+      break;
+    }
+    used[victim] = static_cast<uint64_t>(b);
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t ops = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const size_t oldOps = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+
+  Layout::superBlock sb{};
+  Layout::registerOffsets(sb);
+  const uint64_t count = sb.block_count;
+  const uint64_t first = sb.data_area_offset / sb.block_size;
+
+  std::cout << "blocks=" << count << " data area from block " << first << std::endl;
+  std::cout << std::setw(6) << "fill" << std::setw(12) << "layout" << std::setw(12) << "old ns"
+            << std::setw(12) << "new ns" << std::setw(10) << "speedup" << std::setw(12) << "run/16"
+            << std::endl;
+
+  bool ok = true;
+  std::mt19937_64 rng(7);
+  for (double fill : {0.50, 0.90, 0.95, 0.99}) {
+    for (bool sequential : {true, false}) {
+      const std::vector<uint64_t> used = layout(first, count, fill, sequential, rng);
+
+      LinearBitmap old{std::vector<bool>(count, false), first};
+      for (uint64_t b : used) old.bits[b] = true;
+      std::mt19937_64 oldRng(11);
+      const double oldNs = churn(used, oldOps, oldRng, [&] { return old.allocate(); },
+                                 [&](uint64_t b) { old.release(b); }, ok);
+
+      BitAllocator map(count, first);
+      for (uint64_t b : used) map.set(b);
+      std::mt19937_64 newRng(11);
+      const double newNs = churn(used, ops, newRng, [&]() -> int64_t {
+        const uint64_t b = map.allocate();
+        return b == BitAllocator::NONE ? -1 : static_cast<int64_t>(b);
+      }, [&](uint64_t b) { map.release(b); }, ok);
+      ok &= map.used() == used.size();
+
+      // Runs of up to 16 blocks, released again so the fill level holds
+      double run = 0;
+      if (!sequential) {
+        const size_t runs = 10000;
+        uint64_t total = 0;
+        std::vector<std::pair<uint64_t, uint64_t>> taken;
+        for (size_t i = 0; i < runs; ++i) {
+          uint64_t start = 0;
+          const uint64_t got = map.allocateRun(16, start);
+          if (got == 0) break;
+          total += got;
+          taken.emplace_back(start, got);
+          if (taken.size() == 64) {
+            for (const auto& t : taken)
+              for (uint64_t b = 0; b < t.second; ++b) map.release(t.first + b);
+            taken.clear();
+          }
+        }
+        run = static_cast<double>(total) / runs;
+      }
+
+      std::cout << std::fixed << std::setprecision(0) << std::setw(5) << fill * 100 << "%"
+                << std::setw(12) << (sequential ? "sequential" : "random")
+                << std::setprecision(1) << std::setw(12) << oldNs << std::setw(12) << newNs
+                << std::setw(9) << oldNs / newNs << "x";
+      if (!sequential) std::cout << std::setw(12) << run;
+      std::cout << std::endl;
+    }
+  }
+  std::cout << (ok ? "both allocators kept the fill level" : "ALLOCATION FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
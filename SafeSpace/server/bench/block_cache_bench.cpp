@@ -0,0 +1,140 @@
+//
+// Block cache benchmark: FileSystem with and without the DiskManager
+// BlockCache on the same workload.
+//
+// For each mode it formats a fresh image and then times:
+//
+//   append      `files` files, each filled with `appends` 32-byte appends
+//               (the MemTable flush pattern), plus the final sync()
+//   cold read   every file with readShared() after reopening the image, so
+//               the cache starts empty and sequential readahead does the work
+//   warm read   the same pass again
+//
+// The OS page cache is warm in both modes, so the difference is the
+// syscalls and the per-block reads the cache saves. The cache counters
+// (hits, misses, pages read ahead, evictions, pages written back) are
+// printed for the cached run.
+//
+// Build (from SafeSpace/server):
+//   cmake -S . -B build -DSERVER_BUILD_BENCHMARKS=ON && cmake --build build --target block_cache_bench
+// or directly, as one command:
+//   g++ -std=c++17 -O2 -Isrc -Isrc/model/filesystem bench/block_cache_bench.cpp
+//       src/model/filesystem/BitAllocator.cpp src/model/filesystem/BlockCache.cpp
+//       src/model/filesystem/DirIndex.cpp src/model/filesystem/DiskManager.cpp
+//       src/model/filesystem/FileSystem.cpp -o block_cache_bench
+//
+// Usage: block_cache_bench [image path] [cache MiB] [files] [appends per file]
+//
+
+#include "model/filesystem/FileSystem.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// FileSystem logs to cout/cerr; keep it out of the measurement
+class Quiet {
+ public:
+  Quiet() : out_(std::cout.rdbuf(nullptr)), err_(std::cerr.rdbuf(nullptr)) {}
+  ~Quiet() {
+    std::cout.rdbuf(out_);
+    std::cerr.rdbuf(err_);
+    std::cout.clear();
+    std::cerr.clear();
+  }
+
+ private:
+  std::streambuf* out_;
+  std::streambuf* err_;
+};
+
+double millis(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Run {
+  double append = 0;
+  double cold = 0;
+  double warm = 0;
+  size_t bytes = 0;
+  BlockCache::Stats stats{};
+};
+
+Run measure(const std::string& image, size_t cacheBytes, size_t files, size_t appends, bool& ok) {
+  Run run;
+  std::remove(image.c_str());
+  char record[32];
+  for (size_t i = 0; i < sizeof(record); ++i) record[i] = static_cast<char>('a' + i % 26);
+
+  {
+    FileSystem fs(image, cacheBytes);
+    const auto start = Clock::now();
+    for (size_t f = 0; f < files; ++f) {
+      const std::string name = "f" + std::to_string(f);
+      ok &= fs.create(name) >= 0 && fs.openFile(name) == 0;
+      for (size_t a = 0; a < appends; ++a) ok &= fs.append(name, record, sizeof(record));
+      fs.closeFile(name);
+    }
+    ok &= fs.sync();
+    run.append = millis(start);
+  }
+
+  FileSystem fs(image, cacheBytes);
+  for (double* pass : {&run.cold, &run.warm}) {
+    size_t bytes = 0;
+    const auto start = Clock::now();
+    std::string out;
+    for (size_t f = 0; f < files; ++f) {
+      ok &= fs.readShared("f" + std::to_string(f), out);
+      bytes += out.size();
+      ok &= out.size() == appends * sizeof(record) && out.compare(0, sizeof(record), record, sizeof(record)) == 0;
+    }
+    *pass = millis(start);
+    run.bytes = bytes;
+  }
+  run.stats = fs.cacheStats();
+  return run;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string image = argc > 1 ? argv[1] : "/tmp/block_cache_bench.img";
+  const size_t cacheMiB = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+  const size_t files = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 2000;
+  const size_t appends = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 64;
+
+  bool ok = true;
+  auto quiet = std::make_unique<Quiet>();
+  const Run direct = measure(image, 0, files, appends, ok);
+  const Run cached = measure(image, cacheMiB * 1024 * 1024, files, appends, ok);
+  quiet.reset();
+
+  std::cout << "files=" << files << " appends=" << appends << " (" << direct.bytes / 1024
+            << " KiB) cache=" << cacheMiB << " MiB" << std::endl;
+  std::cout << std::setw(12) << "" << std::setw(12) << "append ms" << std::setw(12) << "cold ms"
+            << std::setw(12) << "warm ms" << std::endl;
+  for (const auto& row : {std::make_pair("no cache", &direct), std::make_pair("cache", &cached)}) {
+    std::cout << std::fixed << std::setprecision(1) << std::setw(12) << row.first
+              << std::setw(12) << row.second->append << std::setw(12) << row.second->cold
+              << std::setw(12) << row.second->warm << std::endl;
+  }
+  std::cout << std::setw(12) << "speedup" << std::setw(11) << direct.append / cached.append << "x"
+            << std::setw(11) << direct.cold / cached.cold << "x" << std::setw(11) << direct.warm / cached.warm
+            << "x" << std::endl;
+
+  const BlockCache::Stats& s = cached.stats;
+  std::cout << "read cache: " << s.hits << " hits, " << s.misses << " misses ("
+            << static_cast<int>(s.hitRatio() * 100) << "%), " << s.readahead << " pages read ahead, "
+            << s.evictions << " evicted, " << s.pages << "/" << s.capacity << " pages in use" << std::endl;
+  std::cout << (ok ? "every file read back intact" : "MISMATCH") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+//
+// Sensor history scan benchmark: CSV text vs row records vs column kernels.
+//
+// Builds the same N readings in three layouts and runs the same analytics
+// query over each: keep the readings whose timestamp falls in the middle
+// half of the series and compute min/max/sum of all six fields.
+//
+//   csv + stof      the StorageNode path before binary segments: one text
+//                   line per reading, split with getline and parsed with
+//                   std::stof (stringToSensorData without its logging)
+//   rows            32-byte records decoded one by one (TimeSeriesStore
+//                   row segments)
+//   columns/<isa>   a timestamp column plus one float column per field
+//                   (sealed .col segments), ColumnKernels::selectRange and
+//                   minMaxSum in the scalar, SSE2 and AVX2 variants
+//
+// Throughput is reported in readings/s and in GB/s over the size of the
+// data in that layout (text length, or 32 bytes per reading). The text
+// layout carries no timestamp per line (it used to live in the file name),
+// so that path filters nothing and only parses.
+//
+// Build (from SafeSpace/server):
+//   cmake -S . -B build -DSERVER_BUILD_BENCHMARKS=ON && cmake --build build --target column_scan_bench
+// or directly, as one command:
+//   g++ -std=c++17 -O2 -Isrc bench/column_scan_bench.cpp
+//       src/nodes/Storage/ColumnKernels.cpp src/nodes/Storage/SeriesCodec.cpp
+//       src/nodes/Storage/TimeSeriesStore.cpp src/nodes/Storage/SeriesIndex.cpp
+//       src/nodes/Storage/ScanPool.cpp
+//       src/model/filesystem/FileSystem.cpp src/model/filesystem/DiskManager.cpp
+//       src/model/filesystem/DirIndex.cpp src/model/filesystem/BitAllocator.cpp
+//       src/model/filesystem/BlockCache.cpp
+//       -pthread -o column_scan_bench
+//
+// Usage: column_scan_bench [readings] [repetitions]
+//
+
+#include "nodes/Storage/ColumnKernels.h"
+#include "nodes/Storage/TimeSeriesStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kBaseMs = 1700000000000ull;
+
+struct Summary {
+  size_t kept = 0;
+  float min[SENSOR_FIELDS];
+  float max[SENSOR_FIELDS];
+  double sum[SENSOR_FIELDS];
+
+  Summary() {
+    std::fill(min, min + SENSOR_FIELDS, std::numeric_limits<float>::infinity());
+    std::fill(max, max + SENSOR_FIELDS, -std::numeric_limits<float>::infinity());
+    std::fill(sum, sum + SENSOR_FIELDS, 0.0);
+  }
+
+  void add(const float* v) {
+    ++kept;
+    for (size_t f = 0; f < SENSOR_FIELDS; ++f) {
+      min[f] = v[f] < min[f] ? v[f] : min[f];
+      max[f] = v[f] > max[f] ? v[f] : max[f];
+      sum[f] += v[f];
+    }
+  }
+};
+
+struct Dataset {
+  std::string csv;
+  std::vector<uint8_t> rows;
+  ColumnBuffer columns;
+  uint64_t lo = 0;
+  uint64_t hi = 0;
+};
+
+Dataset build(size_t n) {
+  Dataset d;
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::ostringstream csv;
+  d.rows.resize(n * TimeSeriesStore::RECORD_SIZE);
+  for (size_t i = 0; i < n; ++i) {
+    SensorReading r;
+    r.sensorId = 1;
+    r.timestampMs = kBaseMs + i * 1000 + rng() % 50;
+    r.distance = 120.0f + noise(rng);
+    r.temperature = 22.5f + noise(rng);
+    r.pressure = 101325.0f + 10.0f * noise(rng);
+    r.altitude = 1150.0f + noise(rng);
+    r.sealevelPressure = 101300.0f + 10.0f * noise(rng);
+    r.realAltitude = 1148.0f + noise(rng);
+
+    csv << r.distance << "," << r.temperature << "," << r.pressure << "," << r.altitude << ","
+        << r.sealevelPressure << "," << r.realAltitude << "\n";
+    TimeSeriesStore::encode(r, d.rows.data() + i * TimeSeriesStore::RECORD_SIZE);
+    d.columns.push(r);
+  }
+  d.csv = csv.str();
+  d.lo = kBaseMs + n / 4 * 1000;
+  d.hi = kBaseMs + 3 * n / 4 * 1000;
+  return d;
+}
+
+Summary scanCsv(const Dataset& d) {
+  Summary s;
+  std::istringstream stream(d.csv);
+  std::string line;
+  while (std::getline(stream, line)) {
+    std::istringstream iss(line);
+    std::string token;
+    float values[SENSOR_FIELDS];
+    size_t parsed = 0;
+    while (parsed < SENSOR_FIELDS && std::getline(iss, token, ',')) {
+      values[parsed++] = std::stof(token);
+    }
+    if (parsed == SENSOR_FIELDS) s.add(values);
+  }
+  return s;
+}
+
+Summary scanRows(const Dataset& d) {
+  Summary s;
+  const size_t n = d.rows.size() / TimeSeriesStore::RECORD_SIZE;
+  for (size_t i = 0; i < n; ++i) {
+    const SensorReading r = TimeSeriesStore::decode(d.rows.data() + i * TimeSeriesStore::RECORD_SIZE);
+    if (r.timestampMs < d.lo || r.timestampMs > d.hi) continue;
+    const float values[SENSOR_FIELDS] = {r.distance, r.temperature, r.pressure,
+                                         r.altitude, r.sealevelPressure, r.realAltitude};
+    s.add(values);
+  }
+  return s;
+}
+
+// Selection, then each field reduced over the contiguous selected run
+Summary scanColumns(const Dataset& d, const ColumnKernels& kernels, std::vector<uint32_t>& selection) {
+  Summary s;
+  const ColumnBlock block = d.columns.block(1);
+  selection.resize(block.count);
+  const size_t kept = kernels.selectRange(block.timestampMs, block.count, d.lo, d.hi, selection.data());
+  s.kept = kept;
+  if (kept == 0) return s;
+  // Timestamps are increasing, so the selection is one run
+  const size_t first = selection[0];
+  for (size_t f = 0; f < SENSOR_FIELDS; ++f) {
+    kernels.minMaxSum(block.fields[f] + first, kept, s.min[f], s.max[f], s.sum[f]);
+  }
+  return s;
+}
+
+template <typename Run>
+double best(size_t repetitions, Run run, Summary& out) {
+  double bestSeconds = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < repetitions; ++i) {
+    const auto start = Clock::now();
+    out = run();
+    bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(Clock::now() - start).count());
+  }
+  return bestSeconds;
+}
+
+void report(const char* name, size_t readings, size_t bytes, double seconds, const Summary& s) {
+  std::cout << std::left << std::setw(16) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(14) << readings / seconds / 1e6
+            << std::setprecision(2) << std::setw(10) << bytes / seconds / 1e9
+            << std::setw(12) << s.kept
+            << std::setprecision(3) << std::setw(12) << s.sum[1] / std::max<size_t>(s.kept, 1)
+            << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const size_t repetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+
+  const Dataset d = build(n);
+  std::cout << "readings=" << n << " best of " << repetitions << ", kernels chosen: "
+            << ColumnKernels::best().name << std::endl;
+  std::cout << std::left << std::setw(16) << "path" << std::right << std::setw(14) << "Mreadings/s"
+            << std::setw(10) << "GB/s" << std::setw(12) << "kept" << std::setw(12) << "avg temp"
+            << std::endl;
+
+  Summary s;
+  double seconds = best(std::min<size_t>(repetitions, 2), [&] { return scanCsv(d); }, s);
+  report("csv + stof", n, d.csv.size(), seconds, s);
+
+  seconds = best(repetitions, [&] { return scanRows(d); }, s);
+  report("rows", n, d.rows.size(), seconds, s);
+
+  std::vector<uint32_t> selection;
+  const ColumnKernels::Isa isas[] = {ColumnKernels::Isa::Scalar, ColumnKernels::Isa::Sse2,
+                                     ColumnKernels::Isa::Avx2};
+  for (const auto isa : isas) {
+    const ColumnKernels* kernels = ColumnKernels::get(isa);
+    if (!kernels) continue;
+    seconds = best(repetitions, [&] { return scanColumns(d, *kernels, selection); }, s);
+    const std::string name = std::string("columns/") + kernels->name;
+    report(name.c_str(), n, n * TimeSeriesStore::RECORD_SIZE, seconds, s);
+  }
+  return 0;
+}
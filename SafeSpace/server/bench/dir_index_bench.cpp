@@ -0,0 +1,147 @@
+//
+// Directory index benchmark: FileSystem create/find throughput as the root
+// directory fills up.
+//
+// Starts from an empty image and creates files up to 1k, 10k and the full
+// DIR_ENTRY_COUNT entries. At each level it reports:
+//
+//   create     FileSystem::create() per second for the files added since
+//              the previous level (each create also persists its inode and
+//              the directory blocks its entry touches)
+//   find hit   FileSystem::find() per second on existing names (DirIndex)
+//   find miss  FileSystem::find() per second on names that do not exist
+//   linear     the same hits with the strncmp scan over every DirEntry that
+//              dirFind() used before the index, for comparison
+//
+// Build (from SafeSpace/server):
+//   cmake -S . -B build -DSERVER_BUILD_BENCHMARKS=ON && cmake --build build --target dir_index_bench
+// or directly, as one command:
+//   g++ -std=c++17 -O2 -Isrc -Isrc/model/filesystem bench/dir_index_bench.cpp
+//       src/model/filesystem/DirIndex.cpp src/model/filesystem/DiskManager.cpp
+//       src/model/filesystem/FileSystem.cpp src/model/filesystem/BitAllocator.cpp
+//       src/model/filesystem/BlockCache.cpp -o dir_index_bench
+//
+// Usage: dir_index_bench [image path] [finds per level]
+//
+
+#include "model/filesystem/FileSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// FileSystem logs to cout/cerr; keep it out of the measurement
+class Quiet {
+ public:
+  Quiet() : out_(std::cout.rdbuf(nullptr)), err_(std::cerr.rdbuf(nullptr)) {}
+  ~Quiet() {
+    std::cout.rdbuf(out_);
+    std::cerr.rdbuf(err_);
+    std::cout.clear();
+    std::cerr.clear();
+  }
+
+ private:
+  std::streambuf* out_;
+  std::streambuf* err_;
+};
+
+// Names shaped like the store's segment files
+std::string fileName(size_t i) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "s%zu_%05zu.seg", i % 64, i);
+  return name;
+}
+
+// What dirFind() did before DirIndex
+int linearFind(const std::vector<DirEntry>& directory, const std::string& name) {
+  for (size_t i = 0; i < directory.size(); ++i) {
+    if (directory[i].inode_id != 0 &&
+        std::strncmp(directory[i].name, name.c_str(), Layout::DIR_NAME_LEN) == 0)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+
+double seconds(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string image = argc > 1 ? argv[1] : "/tmp/dir_index_bench.img";
+  const size_t finds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+
+  std::remove(image.c_str());
+  auto quiet = std::make_unique<Quiet>();
+  FileSystem fs(image);
+
+  struct Level {
+    size_t files = 0;
+    double create = 0;
+    double hit = 0;
+    double miss = 0;
+    double linear = 0;
+  };
+  std::vector<Level> levels{{1000}, {10000}, {Layout::DIR_ENTRY_COUNT}};
+  std::mt19937 rng(42);
+  size_t created = 0;
+  bool ok = true;
+  for (auto& level : levels) {
+    const size_t from = created;
+    auto start = Clock::now();
+    for (; created < level.files; ++created) {
+      if (fs.create(fileName(created)) < 0) {
+        ok = false;
+        break;
+      }
+    }
+    level.create = (created - from) / seconds(start);
+
+    std::uniform_int_distribution<size_t> pick(0, created - 1);
+    std::vector<std::string> hits, misses;
+    for (size_t i = 0; i < finds; ++i) {
+      hits.push_back(fileName(pick(rng)));
+      misses.push_back(fileName(pick(rng) + Layout::DIR_ENTRY_COUNT));
+    }
+
+    start = Clock::now();
+    for (const auto& name : hits) ok &= fs.find(name) > 0;
+    level.hit = finds / seconds(start);
+
+    start = Clock::now();
+    for (const auto& name : misses) ok &= fs.find(name) < 0;
+    level.miss = finds / seconds(start);
+
+    // The scan is slow enough that a sample is plenty
+    const size_t sample = std::min<size_t>(finds, 2000);
+    start = Clock::now();
+    for (size_t i = 0; i < sample; ++i) ok &= linearFind(fs.getDirectory(), hits[i]) >= 0;
+    level.linear = sample / seconds(start);
+  }
+  quiet.reset();
+
+  std::cout << std::setw(8) << "files" << std::setw(14) << "create/s" << std::setw(14) << "find hit/s"
+            << std::setw(14) << "find miss/s" << std::setw(14) << "linear/s" << std::setw(10) << "speedup"
+            << std::endl;
+  for (const auto& level : levels) {
+    std::cout << std::fixed << std::setprecision(0) << std::setw(8) << level.files
+              << std::setw(14) << level.create << std::setw(14) << level.hit << std::setw(14) << level.miss
+              << std::setw(14) << level.linear << std::setprecision(1) << std::setw(9)
+              << level.hit / level.linear << "x" << std::endl;
+  }
+  std::cout << (ok ? "every lookup returned the expected result" : "LOOKUP MISMATCH") << std::endl;
+  return ok ? 0 : 1;
+}
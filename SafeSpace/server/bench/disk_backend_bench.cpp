@@ -0,0 +1,233 @@
+//
+// Disk backend benchmark: raw DiskManager I/O with each backend, against
+// the std::fstream access DiskManager used before (seek + read/write on a
+// single stream, reproduced here as the baseline).
+//
+// For each backend it times, on the same 1 GiB image:
+//
+//   random read     `reads` 256-byte blocks at random block offsets, from
+//                   one thread and then split across `threads` threads
+//                   (fstream has a single stream position, so it has no
+//                   threaded run)
+//   seq write       `write MiB` of consecutive 256-byte blocks from the
+//                   start of the data area, then sync() timed separately
+//
+// The image is zero-filled first, so the OS page cache is warm and the
+// numbers are the per-call cost (syscalls and iostream vs memcpy from the
+// mapping) rather than the device. The cache is off in every run.
+//
+// Build (from SafeSpace/server):
+//   cmake -S . -B build -DSERVER_BUILD_BENCHMARKS=ON && cmake --build build --target disk_backend_bench
+// or directly, as one command:
+//   g++ -std=c++17 -O2 -Isrc -Isrc/model/filesystem bench/disk_backend_bench.cpp
+//       src/model/filesystem/BlockCache.cpp src/model/filesystem/DiskManager.cpp
+//       -pthread -o disk_backend_bench
+//
+// Usage: disk_backend_bench [image path] [reads] [write MiB] [threads]
+//
+
+#include "model/filesystem/DiskManager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// DiskManager logs to cout/cerr; keep it out of the measurement
+class Quiet {
+ public:
+  Quiet() : out_(std::cout.rdbuf(nullptr)), err_(std::cerr.rdbuf(nullptr)) {}
+  ~Quiet() {
+    std::cout.rdbuf(out_);
+    std::cerr.rdbuf(err_);
+    std::cout.clear();
+    std::cerr.clear();
+  }
+
+ private:
+  std::streambuf* out_;
+  std::streambuf* err_;
+};
+
+double nanos(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// The previous DiskManager access path: one fstream, seek then read, and
+// seek + write + flush for every write, fdatasync through a second descriptor
+class StreamDisk {
+ public:
+  explicit StreamDisk(const std::string& path)
+      : path_(path), disk_(path, std::ios::in | std::ios::out | std::ios::binary) {}
+
+  bool readBytes(uint64_t offset, void* buffer, size_t bytes) {
+    disk_.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+    disk_.read(static_cast<char*>(buffer), static_cast<std::streamsize>(bytes));
+    return disk_.good();
+  }
+  bool writeBytes(uint64_t offset, const void* buffer, size_t bytes) {
+    disk_.seekp(static_cast<std::streamoff>(offset), std::ios::beg);
+    disk_.write(static_cast<const char*>(buffer), static_cast<std::streamsize>(bytes));
+    disk_.flush();
+    return disk_.good();
+  }
+  bool sync() {
+    disk_.flush();
+    const int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    const bool ok = ::fdatasync(fd) == 0;
+    ::close(fd);
+    return ok && disk_.good();
+  }
+
+ private:
+  std::string path_;
+  std::fstream disk_;
+};
+
+struct Run {
+  double read = 0;          // ns per read, one thread
+  double readThreads = 0;   // wall ns per read, all threads
+  double write = 0;         // ns per write
+  double sync = 0;          // ms
+};
+
+template <typename Disk>
+double readPass(Disk& disk, const std::vector<uint64_t>& offsets, size_t begin, size_t end, bool& ok) {
+  char block[Layout::BLOCK_SIZE];
+  uint64_t sum = 0;
+  const auto start = Clock::now();
+  for (size_t i = begin; i < end; ++i) {
+    ok &= disk.readBytes(offsets[i], block, sizeof(block));
+    sum += static_cast<unsigned char>(block[0]);
+  }
+  const double elapsed = nanos(start);
+  ok &= sum == 0;   // the image is all zeros where we read
+  return elapsed;
+}
+
+template <typename Disk>
+Run measure(Disk& disk, const std::vector<uint64_t>& offsets, size_t threads, uint64_t writeBase,
+            size_t writes, bool& ok) {
+  Run run;
+  run.read = readPass(disk, offsets, 0, offsets.size(), ok) / static_cast<double>(offsets.size());
+
+  if (threads > 0) {
+    std::vector<std::thread> pool;
+    std::atomic<bool> threadOk{true};
+    const size_t share = (offsets.size() + threads - 1) / threads;
+    const auto start = Clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+      pool.emplace_back([&, t] {
+        bool mine = true;
+        readPass(disk, offsets, std::min(offsets.size(), t * share),
+                 std::min(offsets.size(), (t + 1) * share), mine);
+        if (!mine) threadOk = false;
+      });
+    }
+    for (auto& th : pool) th.join();
+    run.readThreads = nanos(start) / static_cast<double>(offsets.size());
+    ok &= threadOk;
+  }
+
+  char block[Layout::BLOCK_SIZE];
+  for (size_t i = 0; i < sizeof(block); ++i) block[i] = static_cast<char>('a' + i % 26);
+  auto start = Clock::now();
+  for (size_t i = 0; i < writes; ++i) {
+    block[0] = static_cast<char>(i);
+    ok &= disk.writeBytes(writeBase + i * sizeof(block), block, sizeof(block));
+  }
+  run.write = nanos(start) / static_cast<double>(writes);
+  start = Clock::now();
+  ok &= disk.sync();
+  run.sync = nanos(start) / 1e6;
+
+  // Spot-check what was written, then put the zeros back for the next backend
+  char back[Layout::BLOCK_SIZE];
+  for (size_t i = 0; i < writes; i += std::max<size_t>(1, writes / 64)) {
+    block[0] = static_cast<char>(i);
+    ok &= disk.readBytes(writeBase + i * sizeof(block), back, sizeof(back)) &&
+          std::memcmp(block, back, sizeof(block)) == 0;
+  }
+  std::vector<char> zeros(writes * sizeof(block), 0);
+  ok &= disk.writeBytes(writeBase, zeros.data(), zeros.size()) && disk.sync();
+  return run;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string image = argc > 1 ? argv[1] : "/tmp/disk_backend_bench.img";
+  const size_t reads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+  const size_t writeMiB = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 64;
+  const size_t threads = argc > 4 ? std::strtoul(argv[4], nullptr, 10)
+                                  : std::max(1u, std::thread::hardware_concurrency());
+
+  Layout::superBlock sb{};
+  Layout::registerOffsets(sb);
+  const size_t writes = writeMiB * 1024 * 1024 / Layout::BLOCK_SIZE;
+
+  std::mt19937_64 rng(42);
+  std::vector<uint64_t> offsets(reads);
+  for (uint64_t& o : offsets) o = (rng() % (Layout::DISK_SIZE / Layout::BLOCK_SIZE)) * Layout::BLOCK_SIZE;
+
+  bool ok = true;
+  Run streamRun, preadRun, mmapRun;
+  {
+    auto quiet = std::make_unique<Quiet>();
+    std::remove(image.c_str());
+    {
+      DiskManager format(image);
+      ok &= format.openDisk(std::ios::out | std::ios::binary | std::ios::trunc);
+      format.resetUnity();
+    }
+    {
+      StreamDisk disk(image);
+      streamRun = measure(disk, offsets, 0, sb.data_area_offset, writes, ok);
+    }
+    {
+      DiskManager disk(image, DiskManager::Backend::PREAD);
+      ok &= disk.openDisk();
+      preadRun = measure(disk, offsets, threads, sb.data_area_offset, writes, ok);
+    }
+    {
+      DiskManager disk(image, DiskManager::Backend::MMAP);
+      ok &= disk.openDisk();
+      mmapRun = measure(disk, offsets, threads, sb.data_area_offset, writes, ok);
+    }
+  }
+
+  std::cout << "reads=" << reads << " writes=" << writes << " (" << writeMiB << " MiB) threads=" << threads
+            << std::endl;
+  std::cout << std::setw(10) << "" << std::setw(14) << "read ns" << std::setw(14)
+            << ("read ns x" + std::to_string(threads)) << std::setw(14) << "write ns" << std::setw(14)
+            << "sync ms" << std::endl;
+  for (const auto& row : {std::make_pair("fstream", &streamRun), std::make_pair("pread", &preadRun),
+                          std::make_pair("mmap", &mmapRun)}) {
+    std::cout << std::fixed << std::setprecision(1) << std::setw(10) << row.first << std::setw(14)
+              << row.second->read << std::setw(14);
+    if (row.second->readThreads > 0) {
+      std::cout << row.second->readThreads;
+    } else {
+      std::cout << "-";
+    }
+    std::cout << std::setw(14) << row.second->write << std::setw(14) << row.second->sync << std::endl;
+  }
+  std::cout << (ok ? "every block read back intact" : "MISMATCH") << std::endl;
+  return ok ? 0 : 1;
+}
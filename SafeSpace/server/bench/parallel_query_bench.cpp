@@ -0,0 +1,187 @@
+//
+// Parallel query benchmark: month-long queries with 1..N scan threads.
+//
+// Fills a FileSystem image with `sensors` sensors reporting every `period`
+// seconds for `days` days (sealed, compressed segments, the way the
+// StorageNode leaves them), then times the two wide query paths with a
+// ScanPool of each size:
+//
+//   rows        every sensor over the whole span, files read per task and
+//               k-way merged in timestamp order (TimeSeriesStore::readSegments,
+//               what QueryCursor and MemTable::scan use)
+//   aggregate   one sensor over the whole span, columns decoded per task and
+//               folded into hourly buckets (scanSensorColumns + SeriesAggregator,
+//               what QUERY_AGGREGATE uses)
+//
+// Reports the best of `repeats` runs and the speedup over one thread; every
+// thread count must return the same records and checksum. The image is
+// reused between runs; the first fill takes a while.
+//
+// Build (from SafeSpace/server):
+//   cmake -S . -B build -DSERVER_BUILD_BENCHMARKS=ON && cmake --build build --target parallel_query_bench
+// or directly, as one command:
+//   g++ -std=c++17 -O2 -Isrc bench/parallel_query_bench.cpp src/nodes/Storage/ColumnKernels.cpp
+//       src/nodes/Storage/ScanPool.cpp src/nodes/Storage/SeriesAggregator.cpp
+//       src/nodes/Storage/SeriesCodec.cpp src/nodes/Storage/SeriesIndex.cpp
+//       src/nodes/Storage/TimeSeriesStore.cpp src/model/filesystem/FileSystem.cpp
+//       src/model/filesystem/DiskManager.cpp src/model/filesystem/DirIndex.cpp
+//       src/model/filesystem/BitAllocator.cpp src/model/filesystem/BlockCache.cpp -pthread -o parallel_query_bench
+//
+// Usage: parallel_query_bench [image path] [sensors] [days] [period s] [repeats] [max threads]
+//
+
+#include "nodes/Storage/ScanPool.h"
+#include "nodes/Storage/SeriesAggregator.h"
+#include "nodes/Storage/TimeSeriesStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kBaseMs = 1700000000000ull;
+constexpr uint64_t kDayMs = 24ull * 3600 * 1000;
+
+// FileSystem logs to cout/cerr; keep it out of the measurement
+class Quiet {
+ public:
+  Quiet() : out_(std::cout.rdbuf(nullptr)), err_(std::cerr.rdbuf(nullptr)) {}
+  ~Quiet() {
+    std::cout.rdbuf(out_);
+    std::cerr.rdbuf(err_);
+    std::cout.clear();
+    std::cerr.clear();
+  }
+
+ private:
+  std::streambuf* out_;
+  std::streambuf* err_;
+};
+
+// Appends a day at a time so the store seals full segments as it goes
+void populate(TimeSeriesStore& store, size_t sensors, uint64_t days, uint64_t periodMs) {
+  std::vector<SensorReading> batch;
+  for (size_t s = 0; s < sensors; ++s) {
+    for (uint64_t day = 0; day < days; ++day) {
+      batch.clear();
+      for (uint64_t t = day * kDayMs; t < (day + 1) * kDayMs; t += periodMs) {
+        SensorReading r;
+        r.sensorId = static_cast<uint16_t>(s);
+        r.timestampMs = kBaseMs + t + s;
+        r.distance = static_cast<float>(100 + (t / periodMs) % 50);
+        r.temperature = static_cast<float>(20 + (t / 60000) % 10) / 2.0f;
+        r.pressure = 88500.0f;
+        r.altitude = 1150.0f;
+        r.sealevelPressure = r.pressure;
+        r.realAltitude = r.altitude;
+        batch.push_back(r);
+      }
+      store.append(batch.data(), batch.size());
+    }
+  }
+}
+
+struct Run {
+  double seconds = 0;
+  size_t records = 0;
+  double checksum = 0;
+};
+
+template <typename Query>
+Run best(size_t repeats, Query query) {
+  Run result;
+  for (size_t i = 0; i < repeats; ++i) {
+    Run run;
+    const auto start = Clock::now();
+    query(run);
+    run.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (i == 0 || run.seconds < result.seconds) result = run;
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string image = argc > 1 ? argv[1] : "/tmp/parallel_query_bench.img";
+  const size_t sensors = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+  const uint64_t days = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 30;
+  const uint64_t periodMs = (argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 10) * 1000;
+  const size_t repeats = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 3;
+  const size_t cores = argc > 6 ? std::strtoul(argv[6], nullptr, 10)
+                                : std::max(1u, std::thread::hardware_concurrency());
+
+  auto quiet = std::make_unique<Quiet>();
+  FileSystem fs(image);
+  TimeSeriesStore store(fs);
+  double fillSeconds = 0;
+  if (store.fileCount() == 0) {
+    const auto start = Clock::now();
+    populate(store, sensors, days, periodMs);
+    store.sync();
+    fillSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  const uint64_t startMs = kBaseMs;
+  const uint64_t endMs = kBaseMs + days * kDayMs - 1;
+  const auto files = store.segments(startMs, endMs);
+
+  std::vector<size_t> threads{1};
+  for (size_t t = 2; t <= cores; t *= 2) threads.push_back(t);
+  if (threads.back() != cores) threads.push_back(cores);
+
+  std::vector<std::pair<Run, Run>> results;
+  for (size_t t : threads) {
+    std::unique_ptr<ScanPool> pool;
+    if (t > 1) pool.reset(new ScanPool(t - 1));
+
+    const Run rows = best(repeats, [&](Run& run) {
+      std::vector<SensorReading> out;
+      store.readSegments(files, startMs, endMs, pool.get(), out);
+      run.records = out.size();
+      for (size_t i = 0; i < out.size(); i += 997) run.checksum += out[i].distance;
+    });
+    const Run aggregate = best(repeats, [&](Run& run) {
+      SeriesAggregator aggregator(startMs, endMs, 3600 * 1000, SeriesAggregator::ALL_FIELDS);
+      store.scanSensorColumns(0, startMs, endMs, [&](const ColumnBlock& block) {
+        aggregator.add(block);
+      }, pool.get());
+      run.records = aggregator.readings();
+      for (const auto& bucket : aggregator.finish()) run.checksum += bucket.sum[1];
+    });
+    results.emplace_back(rows, aggregate);
+  }
+
+  quiet.reset();
+  if (fillSeconds > 0) {
+    std::cout << "filled " << store.fileCount() << " files in " << fillSeconds << " s" << std::endl;
+  }
+  std::cout << "files=" << files.size() << " sensors=" << sensors << " days=" << days
+            << " hardware threads=" << std::thread::hardware_concurrency() << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(12) << "rows ms" << std::setw(10) << "speedup"
+            << std::setw(14) << "aggregate ms" << std::setw(10) << "speedup" << std::endl;
+  bool same = true;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    const Run& rows = results[i].first;
+    const Run& aggregate = results[i].second;
+    same &= rows.records == results[0].first.records && rows.checksum == results[0].first.checksum &&
+            aggregate.records == results[0].second.records &&
+            aggregate.checksum == results[0].second.checksum;
+    std::cout << std::fixed << std::setprecision(1) << std::setw(8) << threads[i]
+              << std::setw(12) << rows.seconds * 1000
+              << std::setw(9) << results[0].first.seconds / rows.seconds << "x"
+              << std::setw(14) << aggregate.seconds * 1000
+              << std::setw(9) << results[0].second.seconds / aggregate.seconds << "x" << std::endl;
+  }
+  std::cout << results[0].first.records << " rows, " << results[0].second.records << " aggregated"
+            << (same ? ", same results on every thread count" : ", RESULTS DIFFER") << std::endl;
+  return same ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+//
+// Sealed segment compression benchmark: CSV text vs row records vs SeriesCodec.
+//
+// Encodes the same readings, one sealed segment (RECORDS_PER_SEGMENT
+// readings) at a time, and reports bytes per reading and the ratio to the
+// CSV text the StorageNode used to write. Two series:
+//
+//   arduino   what IntermediaryNode forwards today: fixed-point values
+//             (x100, pressure in whole Pa) that drift slowly, with
+//             sealevelPressure/realAltitude copied from pressure/altitude,
+//             one reading per second with a few ms of jitter
+//   noisy     every field with fresh gaussian noise on every reading; the
+//             worst case for XOR encoding
+//
+// It also times encoding and both decoders (per reading and per column),
+// and checks that decoding gives back exactly the same readings.
+//
+// Build (from SafeSpace/server):
+//   cmake -S . -B build -DSERVER_BUILD_BENCHMARKS=ON && cmake --build build --target series_codec_bench
+// or directly, as one command:
+//   g++ -std=c++17 -O2 -Isrc bench/series_codec_bench.cpp src/nodes/Storage/SeriesCodec.cpp
+//       -o series_codec_bench
+//
+// Usage: series_codec_bench [readings]
+//
+
+#include "nodes/Storage/SeriesCodec.h"
+#include "nodes/Storage/TimeSeriesStore.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kBaseMs = 1700000000000ull;
+constexpr size_t kSegment = TimeSeriesStore::RECORDS_PER_SEGMENT;
+
+std::vector<SensorReading> arduinoSeries(size_t n) {
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<int> step(-1, 1);
+  std::uniform_int_distribution<int> jitter(0, 20);
+  std::uniform_int_distribution<int> percent(0, 99);
+  int tempX100 = 2250, distanceX100 = 12000, pressurePa = 88500;
+  std::vector<SensorReading> out(n);
+  for (size_t i = 0; i < n; ++i) {
+    if (percent(rng) < 20) tempX100 += step(rng);
+    if (percent(rng) < 5) distanceX100 += step(rng);
+    if (percent(rng) < 30) pressurePa += step(rng);
+    const int altitudeX100 =
+        static_cast<int>(std::lround(4433000.0 * (1.0 - std::pow(pressurePa / 101325.0, 0.1903))));
+
+    SensorReading& r = out[i];
+    r.sensorId = 1;
+    r.timestampMs = kBaseMs + i * 1000 + static_cast<uint64_t>(jitter(rng));
+    r.distance = static_cast<float>(distanceX100 / 100.0);
+    r.temperature = static_cast<float>(tempX100 / 100.0);
+    r.pressure = static_cast<float>(pressurePa);
+    r.altitude = static_cast<float>(altitudeX100 / 100.0);
+    r.sealevelPressure = r.pressure;
+    r.realAltitude = r.altitude;
+  }
+  return out;
+}
+
+std::vector<SensorReading> noisySeries(size_t n) {
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::vector<SensorReading> out(n);
+  for (size_t i = 0; i < n; ++i) {
+    SensorReading& r = out[i];
+    r.sensorId = 1;
+    r.timestampMs = kBaseMs + i * 1000 + rng() % 50;
+    r.distance = 120.0f + noise(rng);
+    r.temperature = 22.5f + noise(rng);
+    r.pressure = 101325.0f + 10.0f * noise(rng);
+    r.altitude = 1150.0f + noise(rng);
+    r.sealevelPressure = 101300.0f + 10.0f * noise(rng);
+    r.realAltitude = 1148.0f + noise(rng);
+  }
+  return out;
+}
+
+// Tamaño del formato CSV anterior ("d,t,p,a,sp,ra" por línea, ostream por defecto)
+size_t csvBytes(const std::vector<SensorReading>& readings) {
+  std::ostringstream csv;
+  for (const auto& r : readings) {
+    csv << r.distance << "," << r.temperature << "," << r.pressure << "," << r.altitude << ","
+        << r.sealevelPressure << "," << r.realAltitude << "\n";
+  }
+  return csv.str().size();
+}
+
+bool sameReading(const SensorReading& a, const SensorReading& b) {
+  return a.timestampMs == b.timestampMs && a.sensorId == b.sensorId &&
+         std::memcmp(&a.distance, &b.distance, sizeof(float)) == 0 &&
+         std::memcmp(&a.temperature, &b.temperature, sizeof(float)) == 0 &&
+         std::memcmp(&a.pressure, &b.pressure, sizeof(float)) == 0 &&
+         std::memcmp(&a.altitude, &b.altitude, sizeof(float)) == 0 &&
+         std::memcmp(&a.sealevelPressure, &b.sealevelPressure, sizeof(float)) == 0 &&
+         std::memcmp(&a.realAltitude, &b.realAltitude, sizeof(float)) == 0;
+}
+
+double seconds(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void run(const char* name, const std::vector<SensorReading>& readings) {
+  const size_t n = readings.size();
+
+  auto start = Clock::now();
+  std::vector<std::string> segments;
+  for (size_t first = 0; first < n; first += kSegment) {
+    SegmentEncoder encoder;
+    for (size_t i = first; i < n && i < first + kSegment; ++i) encoder.add(readings[i]);
+    segments.push_back(encoder.finish());
+  }
+  const double encodeSeconds = seconds(start);
+
+  size_t compressed = 0;
+  for (const auto& segment : segments) compressed += segment.size();
+
+  start = Clock::now();
+  size_t checked = 0;
+  bool exact = true;
+  for (const auto& segment : segments) {
+    SegmentDecoder decoder;
+    decoder.open(reinterpret_cast<const uint8_t*>(segment.data()), segment.size(), 1);
+    SensorReading r;
+    while (decoder.next(r)) exact &= sameReading(r, readings[checked++]);
+  }
+  const double rowSeconds = seconds(start);
+  exact &= checked == n;
+
+  start = Clock::now();
+  ColumnBuffer columns;
+  double checksum = 0;
+  for (const auto& segment : segments) {
+    SegmentDecoder decoder;
+    decoder.open(reinterpret_cast<const uint8_t*>(segment.data()), segment.size(), 1);
+    decoder.readColumns(decoder.size(), columns);
+    checksum += columns.field(1)[0];
+  }
+  const double columnSeconds = seconds(start);
+
+  const size_t csv = csvBytes(readings);
+  std::cout << name << ": " << n << " readings in " << segments.size() << " segments"
+            << (exact ? ", round trip exact" : ", ROUND TRIP MISMATCH") << std::endl;
+  std::cout << std::fixed << std::setprecision(2)
+            << "  csv text     " << std::setw(8) << static_cast<double>(csv) / n << " B/reading" << std::endl
+            << "  rows         " << std::setw(8) << static_cast<double>(TimeSeriesStore::RECORD_SIZE)
+            << " B/reading  " << static_cast<double>(csv) / (n * TimeSeriesStore::RECORD_SIZE)
+            << "x vs csv" << std::endl
+            << "  compressed   " << std::setw(8) << static_cast<double>(compressed) / n << " B/reading  "
+            << static_cast<double>(csv) / compressed << "x vs csv, "
+            << static_cast<double>(n * TimeSeriesStore::RECORD_SIZE) / compressed << "x vs rows" << std::endl
+            << std::setprecision(1)
+            << "  encode       " << std::setw(8) << n / encodeSeconds / 1e6 << " Mreadings/s" << std::endl
+            << "  decode rows  " << std::setw(8) << n / rowSeconds / 1e6 << " Mreadings/s" << std::endl
+            << "  decode cols  " << std::setw(8) << n / columnSeconds / 1e6 << " Mreadings/s"
+            << "  (checksum " << checksum << ")" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 592000;
+  run("arduino", arduinoSeries(n));
+  run("noisy", noisySeries(n));
+  return 0;
+}
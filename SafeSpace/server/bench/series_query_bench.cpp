@@ -0,0 +1,217 @@
+//
+// StorageNode query benchmark: directory walk + regex vs SeriesIndex.
+//
+// Fills a FileSystem image with sensors x segments segment files (12000 by
+// default), then runs the same random queries twice: the way StorageNode
+// used to (walk all 16384 directory entries, build a std::regex per entry,
+// open every file whose name matches) and through TimeSeriesStore, which
+// goes straight to the candidate segments via SeriesIndex. Reports query
+// latency percentiles; both paths must return the same number of records.
+//
+// The image is 1 GiB and is reused between runs; filling it the first time
+// takes a while because every create() rewrites the whole directory.
+//
+// Build (from SafeSpace/server):
+//   cmake -S . -B build -DSERVER_BUILD_BENCHMARKS=ON && cmake --build build --target series_query_bench
+// or directly, as one command:
+//   g++ -std=c++17 -O2 -Isrc bench/series_query_bench.cpp src/nodes/Storage/ColumnKernels.cpp
+//       src/nodes/Storage/SeriesCodec.cpp src/nodes/Storage/TimeSeriesStore.cpp src/nodes/Storage/SeriesIndex.cpp
+//       src/nodes/Storage/ScanPool.cpp
+//       src/model/filesystem/FileSystem.cpp src/model/filesystem/DiskManager.cpp
+//       src/model/filesystem/DirIndex.cpp src/model/filesystem/BitAllocator.cpp
+//       src/model/filesystem/BlockCache.cpp
+//       -pthread -o series_query_bench
+//
+// Usage: series_query_bench [image path] [sensors] [segments per sensor] [queries]
+//
+
+#include "nodes/Storage/TimeSeriesStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kBaseMs = 1700000000000ull;
+constexpr uint64_t kSegmentSpanMs = 60000;       // one segment per sensor-minute
+constexpr size_t kRecordsPerSegment = 8;
+
+struct Query {
+  bool oneSensor;
+  uint16_t sensorId;
+  uint64_t startMs;
+  uint64_t endMs;
+};
+
+struct Result {
+  std::vector<double> latencyUs;
+  size_t records = 0;
+};
+
+// FileSystem logs to cout/cerr; keep it out of the measurement
+class Quiet {
+ public:
+  Quiet() : out_(std::cout.rdbuf(nullptr)), err_(std::cerr.rdbuf(nullptr)) {}
+  ~Quiet() {
+    std::cout.rdbuf(out_);
+    std::cerr.rdbuf(err_);
+    std::cout.clear();
+    std::cerr.clear();
+  }
+
+ private:
+  std::streambuf* out_;
+  std::streambuf* err_;
+};
+
+// Returns how many files were created
+size_t populate(FileSystem& fs, size_t sensors, size_t segments) {
+  std::vector<uint8_t> records(kRecordsPerSegment * TimeSeriesStore::RECORD_SIZE);
+  size_t created = 0;
+  for (size_t s = 0; s < sensors; ++s) {
+    for (size_t k = 0; k < segments; ++k) {
+      const uint64_t segStart = kBaseMs + k * kSegmentSpanMs;
+      const std::string name = "ts_" + std::to_string(s) + "_" + std::to_string(segStart) + ".seg";
+      if (fs.find(name) >= 0) continue;
+
+      for (size_t i = 0; i < kRecordsPerSegment; ++i) {
+        SensorReading r;
+        r.sensorId = static_cast<uint16_t>(s);
+        r.timestampMs = segStart + i * (kSegmentSpanMs / kRecordsPerSegment);
+        r.temperature = static_cast<float>(i);
+        TimeSeriesStore::encode(r, records.data() + i * TimeSeriesStore::RECORD_SIZE);
+      }
+      fs.create(name);
+      fs.openFile(name);
+      fs.append(name, records.data(), records.size());
+      fs.closeFile(name);
+      ++created;
+    }
+  }
+  return created;
+}
+
+// StorageNode's query path before the index
+size_t directoryScan(FileSystem& fs, const Query& q) {
+  size_t found = 0;
+  for (const auto& entry : fs.getDirectory()) {
+    if (entry.inode_id == 0) continue;
+
+    std::string filename(entry.name);
+    std::smatch match;
+    std::regex pattern(R"(ts_(\d+)_(\d+)\.seg)");
+    if (!std::regex_match(filename, match, pattern)) continue;
+
+    const auto fileId = static_cast<uint16_t>(std::stoi(match[1].str()));
+    const uint64_t fileStart = std::stoull(match[2].str());
+    if ((q.oneSensor && fileId != q.sensorId) || fileStart > q.endMs) continue;
+
+    if (fs.openFile(filename) != 0) continue;
+    const std::string raw = fs.read(filename);
+    fs.closeFile(filename);
+
+    const auto* data = reinterpret_cast<const uint8_t*>(raw.data());
+    for (size_t i = 0; i + TimeSeriesStore::RECORD_SIZE <= raw.size(); i += TimeSeriesStore::RECORD_SIZE) {
+      const SensorReading r = TimeSeriesStore::decode(data + i);
+      if (r.timestampMs >= q.startMs && r.timestampMs <= q.endMs) ++found;
+    }
+  }
+  return found;
+}
+
+template <typename Run>
+Result measure(const std::vector<Query>& queries, Run run) {
+  Result r;
+  r.latencyUs.reserve(queries.size());
+  for (const auto& q : queries) {
+    const auto start = Clock::now();
+    r.records += run(q);
+    r.latencyUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+  }
+  return r;
+}
+
+double percentile(std::vector<double>& v, double p) {
+  if (v.empty()) return 0;
+  const size_t idx = std::min(v.size() - 1, static_cast<size_t>(p * static_cast<double>(v.size())));
+  std::nth_element(v.begin(), v.begin() + static_cast<long>(idx), v.end());
+  return v[idx];
+}
+
+void report(const char* name, Result& r) {
+  std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << percentile(r.latencyUs, 0.50)
+            << std::setw(12) << percentile(r.latencyUs, 0.99)
+            << std::setw(12) << r.records << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string image = argc > 1 ? argv[1] : "/tmp/series_query_bench.img";
+  const size_t sensors = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 250;
+  const size_t segments = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 48;
+  const size_t queryCount = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 50;
+
+  if (sensors * segments > Layout::DIR_ENTRY_COUNT) {
+    std::cerr << "sensors x segments must fit the " << Layout::DIR_ENTRY_COUNT
+              << "-entry directory" << std::endl;
+    return 1;
+  }
+
+  std::mt19937_64 rng(42);
+  std::vector<Query> sensorQueries(queryCount), rangeQueries(queryCount);
+  const uint64_t spanMs = segments * kSegmentSpanMs;
+  for (size_t i = 0; i < queryCount; ++i) {
+    // a couple of minutes of one sensor, and a few seconds of every sensor
+    const uint64_t start = kBaseMs + rng() % spanMs;
+    sensorQueries[i] = {true, static_cast<uint16_t>(rng() % sensors), start, start + 2 * kSegmentSpanMs};
+    rangeQueries[i] = {false, 0, start, start + 5000};
+  }
+
+  Result scanSensor, indexSensor, scanRange, indexRange;
+  size_t files, created;
+  double populateSeconds;
+  {
+    Quiet quiet;
+    FileSystem fs(image);
+    const auto start = Clock::now();
+    created = populate(fs, sensors, segments);
+    populateSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    TimeSeriesStore store(fs);
+    files = store.fileCount();
+
+    scanSensor = measure(sensorQueries, [&](const Query& q) { return directoryScan(fs, q); });
+    indexSensor = measure(sensorQueries, [&](const Query& q) {
+      size_t n = 0;
+      store.scanSensor(q.sensorId, q.startMs, q.endMs, [&n](const SensorReading&) { ++n; });
+      return n;
+    });
+    scanRange = measure(rangeQueries, [&](const Query& q) { return directoryScan(fs, q); });
+    indexRange = measure(rangeQueries, [&](const Query& q) {
+      size_t n = 0;
+      store.scan(q.startMs, q.endMs, [&n](const SensorReading&) { ++n; });
+      return n;
+    });
+  }
+
+  if (created > 0) {
+    std::cout << "created " << created << " files in " << populateSeconds << " s" << std::endl;
+  }
+  std::cout << "files=" << files << " sensors=" << sensors << " queries=" << queryCount << std::endl;
+  std::cout << std::left << std::setw(28) << "query" << std::right << std::setw(12) << "p50 us"
+            << std::setw(12) << "p99 us" << std::setw(12) << "records" << std::endl;
+  report("by sensor, directory+regex", scanSensor);
+  report("by sensor, SeriesIndex", indexSensor);
+  report("by date, directory+regex", scanRange);
+  report("by date, SeriesIndex", indexRange);
+  return 0;
+}
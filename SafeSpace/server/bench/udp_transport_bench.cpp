@@ -0,0 +1,167 @@
+//
+// Loopback benchmark: UDPServer classic transport vs io_uring transport.
+//
+// An echo UDPServer is started per transport and a single client keeps a
+// window of datagrams in flight, each stamped with its send time. Reports
+// packets/sec and round-trip latency percentiles.
+//
+// Build (from SafeSpace/server):
+//   cmake -S . -B build -DSERVER_BUILD_BENCHMARKS=ON && cmake --build build --target udp_transport_bench
+// or directly, as one command:
+//   g++ -std=c++17 -O2 -Isrc bench/udp_transport_bench.cpp
+//       src/nodes/interfaces/UDPServer.cpp src/nodes/interfaces/EventLoop.cpp
+//       src/nodes/interfaces/IoUringTransport.cpp ../common/LogManager.cpp
+//       -pthread -o udp_transport_bench
+//
+// Usage: udp_transport_bench [count] [window] [payload bytes] [batch size]
+//
+
+#include "nodes/interfaces/UDPServer.h"
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  size_t sent = 0;
+  size_t received = 0;
+  double seconds = 0;
+  std::vector<double> rttUs;
+};
+
+uint64_t nowNs() {
+  return static_cast<uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+Result runClient(uint16_t port, size_t count, size_t window, size_t payload) {
+  Result r;
+  int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+  ::connect(fd, reinterpret_cast<sockaddr*>(&server), sizeof(server));
+
+  int rcvbuf = 4 << 20;
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  std::vector<uint8_t> out(std::max<size_t>(payload, sizeof(uint64_t) + 1), 'x');
+  std::vector<uint8_t> in(out.size() + 64);
+  r.rttUs.reserve(count);
+
+  size_t inFlight = 0;
+  const auto start = Clock::now();
+  while (r.received + (r.sent - r.received - inFlight) < count) {
+    // refill the window; the first byte must never be the '#' shutdown marker
+    while (inFlight < window && r.sent < count) {
+      const uint64_t ts = nowNs();
+      std::memcpy(out.data() + 1, &ts, sizeof(ts));
+      if (::send(fd, out.data(), out.size(), 0) < 0) break;
+      ++r.sent;
+      ++inFlight;
+    }
+
+    pollfd pfd{fd, POLLIN, 0};
+    if (::poll(&pfd, 1, 500) <= 0) {
+      // anything still outstanding after 500 ms is counted as lost
+      inFlight = 0;
+      continue;
+    }
+    while (inFlight > 0) {
+      ssize_t n = ::recv(fd, in.data(), in.size(), MSG_DONTWAIT);
+      if (n < static_cast<ssize_t>(sizeof(uint64_t) + 1)) break;
+      uint64_t ts;
+      std::memcpy(&ts, in.data() + 1, sizeof(ts));
+      r.rttUs.push_back(static_cast<double>(nowNs() - ts) / 1000.0);
+      ++r.received;
+      --inFlight;
+    }
+  }
+  r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  ::close(fd);
+  return r;
+}
+
+void stopServer(uint16_t port) {
+  int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+  ::sendto(fd, "#", 1, 0, reinterpret_cast<sockaddr*>(&server), sizeof(server));
+  ::close(fd);
+}
+
+double percentile(std::vector<double>& v, double p) {
+  if (v.empty()) return 0;
+  const size_t idx = std::min(v.size() - 1, static_cast<size_t>(p * static_cast<double>(v.size())));
+  std::nth_element(v.begin(), v.begin() + static_cast<long>(idx), v.end());
+  return v[idx];
+}
+
+void report(const char* name, Result& r) {
+  std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(0)
+            << std::setw(12) << (static_cast<double>(r.received) / r.seconds)
+            << std::setw(10) << (r.sent - r.received)
+            << std::setprecision(1)
+            << std::setw(10) << percentile(r.rttUs, 0.50)
+            << std::setw(10) << percentile(r.rttUs, 0.99)
+            << std::setw(10) << percentile(r.rttUs, 0.999) << std::endl;
+}
+
+Result bench(UDPServer::Transport transport, uint16_t port, size_t batch,
+             size_t count, size_t window, size_t payload) {
+  // the serve loop logs per datagram/batch; keep it out of the measurement
+  std::streambuf* saved = std::cout.rdbuf(nullptr);
+  Result r;
+  {
+    UDPServer server("127.0.0.1", port, 2048, batch, 1, transport);
+    std::thread serving([&server] { server.serveBlocking(); });
+
+    runClient(port, std::min<size_t>(count / 10 + 1, 10000), window, payload);  // warm-up
+    r = runClient(port, count, window, payload);
+
+    stopServer(port);
+    serving.join();
+  }
+  std::cout.rdbuf(saved);
+  std::cout.clear();
+  return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  const size_t window = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+  const size_t payload = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 64;
+  const size_t batch = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : UDPServer::kDefaultBatchSize;
+
+  std::cout << "count=" << count << " window=" << window << " payload=" << payload
+            << "B batch=" << batch << std::endl;
+  std::cout << std::left << std::setw(22) << "transport" << std::right
+            << std::setw(12) << "pkts/s" << std::setw(10) << "lost"
+            << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+            << std::setw(10) << "p99.9 us" << std::endl;
+
+  Result classicSingle = bench(UDPServer::Transport::Classic, 17311, 1, count, window, payload);
+  report("classic (recvfrom)", classicSingle);
+  Result classicBatched = bench(UDPServer::Transport::Classic, 17312, batch, count, window, payload);
+  report("classic (recvmmsg)", classicBatched);
+  Result uring = bench(UDPServer::Transport::IoUring, 17313, batch, count, window, payload);
+  report("io_uring", uring);
+  return 0;
+}
@@ -51,12 +51,13 @@ int main(const int argc, char* argv[]) {
     uint16_t localPort = parsePort(argv[3]);
 
     if (type == "server") {
-      if (argc != 10) {
-        throw std::runtime_error("Master mode requires 8 arguments:"
+      if (argc < 10) {
+        throw std::runtime_error("Master mode requires at least 8 arguments:"
         " server <local_ip> <local_port>"
         " <storageNode_ip> <storageNode_Port>"
         " <eventsNode_ip> <eventsNode_Port>"
         " <ProxyNode_ip> <ProxyNode_Port>"
+        " [storageReplica_ip:port ...]"
         );
       }
 
@@ -67,7 +68,18 @@ int main(const int argc, char* argv[]) {
       std::string proxyIp = argv[8];
       uint16_t proxyPort = parsePort(argv[9]);
 
-      SafeSpaceServer server(localIp, localPort, storageIp, storagePort, eventsIp, eventsPort, proxyIp, proxyPort);
+      // Réplicas de storage adicionales: cada escritura va a todas
+      std::vector<StorageReplicas::Endpoint> storage{{storageIp, storagePort}};
+      for (int i = 10; i < argc; ++i) {
+        const std::string replica = argv[i];
+        const size_t colon = replica.rfind(':');
+        if (colon == std::string::npos) {
+          throw std::runtime_error("Storage replica must be ip:port: " + replica);
+        }
+        storage.push_back({replica.substr(0, colon), parsePort(replica.substr(colon + 1))});
+      }
+
+      SafeSpaceServer server(localIp, localPort, storage, eventsIp, eventsPort, proxyIp, proxyPort);
       std::cout << "[Main] Running SafeSpaceServer on port " << localPort << std::endl;
 
       // // Ejemplo: registrar un destino de descubrimiento local (opcional)
@@ -126,21 +138,36 @@ int main(const int argc, char* argv[]) {
 
     } else if (type == "storage") {
 
-      if (argc != 7) {
-        throw std::runtime_error("Proxy mode requires 5 arguments:"
+      if (argc < 7) {
+        throw std::runtime_error("Storage mode requires at least 5 arguments:"
         " storage <local_ip> <local_port>"
         " <masterNode_ip> <masterNode_port>"
-        " <diskPath>"
+        " [--disk-cache-mb=N] <diskPath> [diskPath ...]"
         );
       }
 
       const std::string masterIp = argv[4];
       const uint16_t masterPort = parsePort(argv[5]);
       const std::string nodeId = "storage1";
-      const std::string diskPath = argv[6]; // Usar el archivo proporcionado
-          
+      // Un disco por shard; los sensores se reparten entre todos
+      std::vector<std::string> diskPaths;
+      size_t diskCacheBytes = StorageNode::DISK_CACHE_BYTES;
+      const std::string cacheFlag = "--disk-cache-mb=";
+      for (int i = 6; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.compare(0, cacheFlag.size(), cacheFlag) == 0) {
+          diskCacheBytes = std::stoul(arg.substr(cacheFlag.size())) * 1024 * 1024;
+        } else {
+          diskPaths.push_back(arg);
+        }
+      }
+      if (diskPaths.empty()) {
+        throw std::runtime_error("Storage mode requires at least one <diskPath>");
+      }
+
       // Crear instancia de StorageNode
-      StorageNode storage(localPort, masterIp, masterPort, nodeId, diskPath);
+      StorageNode storage(localPort, masterIp, masterPort, nodeId, diskPaths, 65536,
+                          SeriesCompactor::Options(), diskCacheBytes);
       storage.start();
     } else if (type ==  "auth") {
       AuthUDPServer server(localIp, localPort);
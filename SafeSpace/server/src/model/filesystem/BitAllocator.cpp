@@ -0,0 +1,124 @@
+#include "BitAllocator.h"
+#include <algorithm>
+
+BitAllocator::BitAllocator(uint64_t count, uint64_t first)
+    : count_(0), first_(0), cursor_(0), used_(0) {
+    reset(count, first);
+}
+
+void BitAllocator::reset(uint64_t count, uint64_t first) {
+    count_ = count;
+    first_ = std::min(first, count);
+    cursor_ = first_;
+    used_ = 0;
+    levels_.clear();
+    dirty_.clear();
+
+    // Cada nivel cubre las palabras del de abajo hasta que cabe en una.
+    // Los bits de relleno al final de cada nivel van en 1 (ocupados), así
+    // una búsqueda nunca se sale del rango.
+    uint64_t bits = count;
+    do {
+        const uint64_t words = std::max<uint64_t>(1, (bits + 63) / 64);
+        std::vector<uint64_t> level(words, 0);
+        for (uint64_t i = bits; i < words * 64; ++i) {
+            level[i / 64] |= uint64_t{1} << (i % 64);
+        }
+        levels_.push_back(std::move(level));
+        bits = words;
+    } while (bits > 1);
+    dirtyMark_.assign((levels_[0].size() + 63) / 64, 0);
+}
+
+uint64_t BitAllocator::findClear(size_t level, uint64_t pos) const {
+    const std::vector<uint64_t>& bits = levels_[level];
+    uint64_t w = pos / 64;
+    if (w >= bits.size()) return NONE;
+
+    uint64_t free = ~bits[w] & (~uint64_t{0} << (pos % 64));
+    if (free == 0) {
+        // Palabra llena: el nivel de arriba dice cuál es la próxima con espacio
+        if (level + 1 == levels_.size()) return NONE;
+        w = findClear(level + 1, w + 1);
+        if (w == NONE) return NONE;
+        free = ~bits[w];
+    }
+    return w * 64 + static_cast<uint64_t>(__builtin_ctzll(free));
+}
+
+void BitAllocator::mark(size_t level, uint64_t i) {
+    uint64_t& word = levels_[level][i / 64];
+    word |= uint64_t{1} << (i % 64);
+    if (word == ~uint64_t{0} && level + 1 < levels_.size()) {
+        mark(level + 1, i / 64);
+    }
+}
+
+void BitAllocator::unmark(size_t level, uint64_t i) {
+    uint64_t& word = levels_[level][i / 64];
+    const bool wasFull = word == ~uint64_t{0};
+    word &= ~(uint64_t{1} << (i % 64));
+    if (wasFull && level + 1 < levels_.size()) {
+        unmark(level + 1, i / 64);
+    }
+}
+
+void BitAllocator::touch(uint64_t word) {
+    uint64_t& m = dirtyMark_[word / 64];
+    const uint64_t bit = uint64_t{1} << (word % 64);
+    if (m & bit) return;
+    m |= bit;
+    dirty_.push_back(word);
+}
+
+std::vector<uint64_t> BitAllocator::takeDirty() {
+    std::vector<uint64_t> out;
+    out.swap(dirty_);
+    for (uint64_t w : out) dirtyMark_[w / 64] &= ~(uint64_t{1} << (w % 64));
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+void BitAllocator::set(uint64_t i) {
+    if (i >= count_ || test(i)) return;
+    mark(0, i);
+    touch(i / 64);
+    used_++;
+}
+
+void BitAllocator::release(uint64_t i) {
+    if (!test(i)) return;
+    unmark(0, i);
+    touch(i / 64);
+    used_--;
+}
+
+uint64_t BitAllocator::allocate() {
+    uint64_t start = NONE;
+    return allocateRun(1, start) == 1 ? start : NONE;
+}
+
+uint64_t BitAllocator::allocateRun(uint64_t want, uint64_t& start) {
+    if (want == 0) return 0;
+
+    uint64_t i = findClear(0, cursor_);
+    if (i == NONE && cursor_ > first_) i = findClear(0, first_);
+    if (i == NONE) return 0;
+
+    // Extender el tramo palabra por palabra mientras siga libre
+    const std::vector<uint64_t>& leaf = levels_[0];
+    uint64_t end = i;
+    while (end - i < want && end / 64 < leaf.size()) {
+        const uint64_t busy = leaf[end / 64] >> (end % 64);
+        const uint64_t free = busy == 0 ? 64 - end % 64 : static_cast<uint64_t>(__builtin_ctzll(busy));
+        end += std::min(free, want - (end - i));
+        if (busy != 0) break;
+    }
+
+    for (uint64_t b = i; b < end; ++b) mark(0, b);
+    for (uint64_t w = i / 64; w <= (end - 1) / 64; ++w) touch(w);
+    used_ += end - i;
+    cursor_ = end;
+    start = i;
+    return end - i;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Mapa de bits jerárquico para asignar bloques e i-nodos de FileSystem.
+ *
+ * El nivel 0 tiene un bit por elemento (1 = ocupado) en palabras de 64
+ * bits; cada nivel de arriba tiene un bit por palabra del de abajo, que
+ * vale 1 cuando esa palabra está llena. Para buscar un libre se mira la
+ * palabra actual con count-trailing-zeros y, si está llena, se sube a
+ * buscar la siguiente palabra con espacio en vez de recorrerlas una a una:
+ * con 4M bloques son cuatro niveles, así que una asignación cuesta lo mismo
+ * con el disco vacío que al 95%.
+ *
+ * Las búsquedas arrancan donde terminó la última asignación (next-fit) y
+ * vuelven a first() al llegar al final, así que los archivos que crecen a
+ * la vez quedan en bloques consecutivos. allocateRun() toma un tramo de
+ * bloques libres contiguos para las escrituras de varios bloques.
+ *
+ * También anota qué palabras del nivel 0 cambiaron (takeDirty), para que
+ * FileSystem guarde solo esas en vez del mapa entero.
+ *
+ * No es thread-safe; lo protege lo que proteja al FileSystem.
+ */
+class BitAllocator {
+public:
+    static constexpr uint64_t NONE = ~uint64_t{0};
+
+    // count elementos, todos libres; nunca entrega los menores que first
+    explicit BitAllocator(uint64_t count = 0, uint64_t first = 0);
+
+    // Rehace el mapa, con los ocupados que dé isUsed(i)
+    template <typename IsUsed>
+    void assign(uint64_t count, uint64_t first, IsUsed isUsed) {
+        reset(count, first);
+        for (uint64_t i = 0; i < count; ++i) {
+            if (isUsed(i)) set(i);
+        }
+        takeDirty();   // lo cargado ya está en disco
+    }
+
+    // Primer libre desde el cursor, que queda ocupado; NONE si no hay
+    uint64_t allocate();
+    // Hasta want libres contiguos desde el primero que encuentre; devuelve
+    // cuántos tomó (0 si no hay ninguno) y el primero en start
+    uint64_t allocateRun(uint64_t want, uint64_t& start);
+    void set(uint64_t i);
+    void release(uint64_t i);
+
+    bool test(uint64_t i) const {
+        return i < count_ && (levels_[0][i / 64] >> (i % 64)) & 1;
+    }
+    uint64_t size() const { return count_; }
+    uint64_t first() const { return first_; }
+    uint64_t used() const { return used_; }
+    bool empty() const { return count_ == 0; }
+
+    // Palabras del nivel 0: bit i en la palabra i / 64, posición i % 64
+    const std::vector<uint64_t>& words() const { return levels_[0]; }
+
+    // Palabras del nivel 0 cambiadas desde la última llamada, de menor a
+    // mayor y sin repetir; después de assign() no hay ninguna
+    std::vector<uint64_t> takeDirty();
+
+private:
+    std::vector<std::vector<uint64_t>> levels_;   // [0] = un bit por elemento
+    uint64_t count_;
+    uint64_t first_;
+    uint64_t cursor_;
+    uint64_t used_;
+    std::vector<uint64_t> dirty_;        // palabras cambiadas, en el orden en que cambiaron
+    std::vector<uint64_t> dirtyMark_;    // un bit por palabra: ya está en dirty_
+
+    void reset(uint64_t count, uint64_t first);
+    // Primer bit en 0 desde pos en el nivel dado; NONE si no hay
+    uint64_t findClear(size_t level, uint64_t pos) const;
+    void mark(size_t level, uint64_t i);
+    void unmark(size_t level, uint64_t i);
+    void touch(uint64_t word);
+};
@@ -0,0 +1,195 @@
+#include "BlockCache.h"
+#include <algorithm>
+#include <cstring>
+
+BlockCache::BlockCache(size_t bytes, ReadFn read, WriteFn write)
+    : read_(std::move(read)), write_(std::move(write)), hand_(0), lastMiss_(NO_PAGE), window_(1), stats_{} {
+    const size_t pages = std::max(bytes / PAGE_SIZE, MAX_READAHEAD);
+    frames_.resize(pages);
+    data_.resize(pages * PAGE_SIZE);
+    index_.reserve(pages);
+    stats_.capacity = pages;
+}
+
+bool BlockCache::read(uint64_t offset, void* buffer, size_t bytes) {
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    while (bytes > 0) {
+        const uint64_t page = offset / PAGE_SIZE;
+        const size_t in = static_cast<size_t>(offset % PAGE_SIZE);
+        const size_t demand = (in + bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+        size_t span;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = index_.find(page);
+            if (it != index_.end()) {
+                const size_t n = std::min(bytes, PAGE_SIZE - in);
+                frames_[it->second].referenced = true;
+                std::memcpy(out, frameData(it->second) + in, n);
+                stats_.hits++;
+                out += n;
+                offset += n;
+                bytes -= n;
+                continue;
+            }
+
+            // Fallo: lo pedido (hasta MAX_SPAN) o la ventana, lo que sea más,
+            // sin pasar por encima de una página que ya esté
+            stats_.misses++;
+            window_ = page == lastMiss_ + 1 ? std::min(window_ * 2, MAX_READAHEAD) : 1;
+            span = std::max(window_, std::min(demand, MAX_SPAN));
+            for (size_t k = 1; k < span; ++k) {
+                if (index_.count(page + k)) {
+                    span = k;
+                    break;
+                }
+            }
+            lastMiss_ = page + span - 1;
+        }
+
+        std::vector<uint8_t> loaded(span * PAGE_SIZE);
+        if (!readPages(page, span, loaded.data())) return false;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t k = 0; k < span; ++k) {
+                if (index_.count(page + k)) continue;   // la trajo otro hilo mientras tanto
+                const int64_t frame = takeFrame(page + k);
+                if (frame < 0) return false;
+                std::memcpy(frameData(static_cast<uint32_t>(frame)), loaded.data() + k * PAGE_SIZE, PAGE_SIZE);
+                // Lo anticipado entra sin referencia: si nadie lo usa sale primero
+                frames_[frame].referenced = k < demand;
+                if (k >= demand) stats_.readahead++;
+            }
+        }
+
+        const size_t n = std::min(bytes, span * PAGE_SIZE - in);
+        std::memcpy(out, loaded.data() + in, n);
+        out += n;
+        offset += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+bool BlockCache::write(uint64_t offset, const void* buffer, size_t bytes) {
+    const uint8_t* src = static_cast<const uint8_t*>(buffer);
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (bytes > 0) {
+        const uint64_t page = offset / PAGE_SIZE;
+        const size_t in = static_cast<size_t>(offset % PAGE_SIZE);
+        const size_t n = std::min(bytes, PAGE_SIZE - in);
+
+        uint32_t frame;
+        const auto it = index_.find(page);
+        if (it != index_.end()) {
+            frame = it->second;
+            stats_.hits++;
+        } else {
+            stats_.misses++;
+            const int64_t taken = takeFrame(page);
+            if (taken < 0) return false;
+            frame = static_cast<uint32_t>(taken);
+            // Una página escrita a medias necesita el resto desde el disco
+            if (n < PAGE_SIZE && !readPages(page, 1, frameData(frame))) {
+                index_.erase(page);
+                frames_[frame] = Frame{};
+                return false;
+            }
+        }
+
+        std::memcpy(frameData(frame) + in, src, n);
+        frames_[frame].dirty = true;
+        frames_[frame].referenced = true;
+        src += n;
+        offset += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+bool BlockCache::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<uint32_t> dirty;
+    for (uint32_t i = 0; i < frames_.size(); ++i) {
+        if (frames_[i].dirty) dirty.push_back(i);
+    }
+    std::sort(dirty.begin(), dirty.end(), [this](uint32_t a, uint32_t b) {
+        return frames_[a].page < frames_[b].page;
+    });
+    return writeBack(dirty);
+}
+
+void BlockCache::discard() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::fill(frames_.begin(), frames_.end(), Frame{});
+    index_.clear();
+    hand_ = 0;
+    lastMiss_ = NO_PAGE;
+    window_ = 1;
+}
+
+BlockCache::Stats BlockCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.pages = index_.size();
+    stats.dirty = static_cast<size_t>(std::count_if(frames_.begin(), frames_.end(),
+                                                    [](const Frame& f) { return f.dirty; }));
+    return stats;
+}
+
+int64_t BlockCache::takeFrame(uint64_t page) {
+    // Con todos referenciados, la primera vuelta los apaga y la segunda encuentra uno
+    for (size_t step = 0; step <= 2 * frames_.size(); ++step) {
+        const uint32_t i = static_cast<uint32_t>(hand_);
+        Frame& f = frames_[i];
+        hand_ = (hand_ + 1) % frames_.size();
+
+        if (f.page != NO_PAGE) {
+            if (f.referenced) {
+                f.referenced = false;
+                continue;
+            }
+            // Primero al disco y recién después fuera del índice: un lector
+            // que no la encuentre ya lee la versión nueva
+            if (f.dirty) {
+                if (!write_(f.page * PAGE_SIZE, frameData(i), PAGE_SIZE)) return -1;
+                stats_.writebacks++;
+            }
+            index_.erase(f.page);
+            stats_.evictions++;
+        }
+        f = Frame{};
+        f.page = page;
+        index_[page] = i;
+        return i;
+    }
+    return -1;
+}
+
+bool BlockCache::readPages(uint64_t page, size_t count, uint8_t* out) {
+    const size_t bytes = count * PAGE_SIZE;
+    const int64_t got = read_(page * PAGE_SIZE, out, bytes);
+    if (got < 0) return false;
+    std::memset(out + got, 0, bytes - static_cast<size_t>(got));
+    return true;
+}
+
+bool BlockCache::writeBack(const std::vector<uint32_t>& frames) {
+    // Las páginas seguidas van en una sola escritura
+    std::vector<uint8_t> run;
+    size_t i = 0;
+    while (i < frames.size()) {
+        const uint64_t first = frames_[frames[i]].page;
+        size_t j = i;
+        run.clear();
+        while (j < frames.size() && frames_[frames[j]].page == first + (j - i) && j - i < MAX_SPAN) {
+            run.insert(run.end(), frameData(frames[j]), frameData(frames[j]) + PAGE_SIZE);
+            ++j;
+        }
+        if (!write_(first * PAGE_SIZE, run.data(), run.size())) return false;
+        for (size_t k = i; k < j; ++k) frames_[frames[k]].dirty = false;
+        stats_.writebacks += j - i;
+        i = j;
+    }
+    return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Caché de páginas del disco entre FileSystem y el archivo de imagen.
+ *
+ * Guarda páginas de PAGE_SIZE bytes (16 bloques del FileSystem) en un
+ * arreglo fijo de marcos y desaloja con CLOCK: cada acceso prende el bit de
+ * referencia y la aguja lo apaga al pasar; sale el primer marco que
+ * encuentra apagado. Las escrituras quedan en la página (write-back) y
+ * llegan al disco al desalojarla o en flush(), que las escribe en orden de
+ * offset juntando las páginas seguidas.
+ *
+ * Un fallo de lectura justo después del anterior duplica la ventana de
+ * lectura anticipada (hasta MAX_READAHEAD páginas), así una lectura
+ * secuencial de un archivo trae varias páginas por pread en vez de una.
+ *
+ * Varios hilos pueden leer a la vez (la E/S de un fallo se hace sin el
+ * lock) mientras nadie escriba, que es lo que garantiza el lock del
+ * StorageShard; las escrituras toman el lock entero.
+ */
+class BlockCache {
+public:
+    static constexpr size_t PAGE_SIZE = 4096;
+    static constexpr size_t MAX_READAHEAD = 16;   // páginas (64 KiB)
+    static constexpr size_t MAX_SPAN = 64;        // páginas por pread en lecturas grandes
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t readahead;     // páginas traídas sin que se las pidieran
+        uint64_t evictions;
+        uint64_t writebacks;    // páginas sucias escritas al disco
+        size_t pages;           // marcos en uso
+        size_t capacity;        // marcos en total
+        size_t dirty;
+
+        double hitRatio() const {
+            return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses);
+        }
+    };
+
+    // Lee hasta bytes desde offset; devuelve cuántos leyó (menos al final
+    // del archivo) o -1 si falla
+    using ReadFn = std::function<int64_t(uint64_t offset, void* buffer, size_t bytes)>;
+    using WriteFn = std::function<bool(uint64_t offset, const void* buffer, size_t bytes)>;
+
+    // bytes se redondea hacia abajo a páginas, con al menos MAX_READAHEAD
+    BlockCache(size_t bytes, ReadFn read, WriteFn write);
+
+    bool read(uint64_t offset, void* buffer, size_t bytes);
+    bool write(uint64_t offset, const void* buffer, size_t bytes);
+
+    // Escribe todas las páginas sucias; quedan en la caché, limpias
+    bool flush();
+    // Olvida todo sin escribir nada (el disco se reinició por fuera)
+    void discard();
+
+    Stats stats() const;
+
+private:
+    static constexpr uint64_t NO_PAGE = ~uint64_t{0};
+
+    struct Frame {
+        uint64_t page = NO_PAGE;
+        bool referenced = false;
+        bool dirty = false;
+    };
+
+    ReadFn read_;
+    WriteFn write_;
+
+    mutable std::mutex mutex_;  // protege todo lo de abajo
+    std::vector<Frame> frames_;
+    std::vector<uint8_t> data_;                      // marco i en [i * PAGE_SIZE, (i + 1) * PAGE_SIZE)
+    std::unordered_map<uint64_t, uint32_t> index_;   // página -> marco
+    size_t hand_;
+    uint64_t lastMiss_;        // última página traída, para detectar lecturas secuenciales
+    size_t window_;            // ventana de lectura anticipada actual
+    Stats stats_;
+
+    uint8_t* frameData(uint32_t frame) { return data_.data() + static_cast<size_t>(frame) * PAGE_SIZE; }
+    // Marco libre o desalojado para page; -1 si no pudo escribir una víctima sucia. mutex_ tomado
+    int64_t takeFrame(uint64_t page);
+    // Lee count páginas desde page; lo que pase del final del archivo queda en cero
+    bool readPages(uint64_t page, size_t count, uint8_t* out);
+    // Escribe las páginas sucias de frames (ordenados por página); mutex_ tomado
+    bool writeBack(const std::vector<uint32_t>& frames);
+};
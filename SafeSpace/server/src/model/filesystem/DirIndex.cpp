@@ -0,0 +1,115 @@
+#include "DirIndex.h"
+#include <cstring>
+
+DirIndex::DirIndex(const std::vector<DirEntry>& directory)
+    : directory_(directory), mask_(0) {}
+
+void DirIndex::rebuild() {
+    // Potencia de dos con al menos el doble de casillas que entradas
+    size_t capacity = 16;
+    while (capacity < directory_.size() * 2) capacity <<= 1;
+    byName_.assign(capacity, EMPTY);
+    byInode_.assign(capacity, EMPTY);
+    mask_ = capacity - 1;
+
+    std::vector<int> freeSlots;
+    for (size_t i = 0; i < directory_.size(); ++i) {
+        if (directory_[i].inode_id != 0) {
+            insert(static_cast<int>(i));
+        } else {
+            freeSlots.push_back(static_cast<int>(i));
+        }
+    }
+    free_ = decltype(free_)(std::greater<int>(), std::move(freeSlots));
+}
+
+uint64_t DirIndex::hashName(const char* name, size_t len) {
+    // FNV-1a con mezcla final: los nombres se parecen mucho ("s12_00042.seg")
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<uint8_t>(name[i]);
+        h *= 0x100000001b3ull;
+    }
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t DirIndex::hashInode(uint64_t inodeId) {
+    // Mezcla de splitmix64; los i-nodos son consecutivos
+    inodeId ^= inodeId >> 30;
+    inodeId *= 0xbf58476d1ce4e5b9ull;
+    inodeId ^= inodeId >> 27;
+    return inodeId;
+}
+
+size_t DirIndex::nameHome(int idx) const {
+    const char* name = directory_[idx].name;
+    return hashName(name, strnlen(name, Layout::DIR_NAME_LEN)) & mask_;
+}
+
+size_t DirIndex::inodeHome(int idx) const {
+    return hashInode(directory_[idx].inode_id) & mask_;
+}
+
+int DirIndex::findName(const char* name) const {
+    if (byName_.empty()) return -1;
+    const size_t len = strnlen(name, Layout::DIR_NAME_LEN);
+    for (size_t pos = hashName(name, len) & mask_; byName_[pos] != EMPTY; pos = (pos + 1) & mask_) {
+        const int idx = byName_[pos];
+        if (std::strncmp(directory_[idx].name, name, Layout::DIR_NAME_LEN) == 0) return idx;
+    }
+    return -1;
+}
+
+int DirIndex::findInode(uint64_t inodeId) const {
+    if (byInode_.empty()) return -1;
+    for (size_t pos = hashInode(inodeId) & mask_; byInode_[pos] != EMPTY; pos = (pos + 1) & mask_) {
+        const int idx = byInode_[pos];
+        if (directory_[idx].inode_id == inodeId) return idx;
+    }
+    return -1;
+}
+
+int DirIndex::takeFree() {
+    if (free_.empty()) return -1;
+    const int idx = free_.top();
+    free_.pop();
+    return idx;
+}
+
+void DirIndex::insert(int idx) {
+    place(byName_, nameHome(idx), idx);
+    place(byInode_, inodeHome(idx), idx);
+}
+
+void DirIndex::erase(int idx) {
+    remove(byName_, idx, &DirIndex::nameHome);
+    remove(byInode_, idx, &DirIndex::inodeHome);
+    free_.push(idx);
+}
+
+void DirIndex::place(std::vector<int32_t>& table, size_t home, int idx) {
+    size_t pos = home;
+    while (table[pos] != EMPTY) pos = (pos + 1) & mask_;
+    table[pos] = idx;
+}
+
+void DirIndex::remove(std::vector<int32_t>& table, int idx, size_t (DirIndex::*home)(int) const) {
+    size_t pos = (this->*home)(idx);
+    while (table[pos] != idx) {
+        if (table[pos] == EMPTY) return;    // no estaba
+        pos = (pos + 1) & mask_;
+    }
+
+    // Backward shift: cada casilla siguiente del grupo que pueda ocupar el
+    // hueco (su casa no está entre el hueco y ella) se corre a él
+    size_t hole = pos;
+    for (size_t next = (hole + 1) & mask_; table[next] != EMPTY; next = (next + 1) & mask_) {
+        const size_t want = (this->*home)(table[next]);
+        if (((next - want) & mask_) >= ((next - hole) & mask_)) {
+            table[hole] = table[next];
+            hole = next;
+        }
+    }
+    table[hole] = EMPTY;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "DirEntry.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+/**
+ * Índice en memoria del directorio raíz de FileSystem.
+ *
+ * Dos tablas hash de direccionamiento abierto con sondeo lineal, nombre ->
+ * entrada e i-nodo -> entrada, sobre el mismo std::vector<DirEntry> que se
+ * guarda en disco: las tablas solo tienen índices de ese vector y cada
+ * búsqueda confirma contra la entrada. Con el doble de casillas que
+ * entradas, una búsqueda mira en promedio una o dos casillas en vez de las
+ * 16384 entradas. Las bajas corren hacia atrás las casillas siguientes
+ * (backward shift), así que no quedan lápidas y la tabla no se degrada.
+ *
+ * También lleva las entradas libres de menor a mayor, para que un alta use
+ * la primera libre como antes sin recorrer el directorio.
+ *
+ * Se reconstruye al montar (rebuild) y FileSystem lo mantiene en cada alta
+ * y baja. No es thread-safe por sí solo: lo protege lo que proteja al
+ * FileSystem.
+ */
+class DirIndex {
+public:
+    explicit DirIndex(const std::vector<DirEntry>& directory);
+
+    // Rehace todo a partir del directorio actual
+    void rebuild();
+
+    // Índice en el directorio o -1; name como lo compara strncmp
+    int findName(const char* name) const;
+    int findInode(uint64_t inodeId) const;
+
+    // Entrada libre más baja, que queda tomada; -1 si el directorio está lleno
+    int takeFree();
+
+    // La entrada idx ya tiene nombre e i-nodo
+    void insert(int idx);
+    // La entrada idx se va a borrar; se llama antes de vaciarla
+    void erase(int idx);
+
+private:
+    static constexpr int32_t EMPTY = -1;
+
+    const std::vector<DirEntry>& directory_;
+    std::vector<int32_t> byName_;       // casilla -> índice en directory_
+    std::vector<int32_t> byInode_;
+    size_t mask_;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> free_;
+
+    static uint64_t hashName(const char* name, size_t len);
+    static uint64_t hashInode(uint64_t inodeId);
+    size_t nameHome(int idx) const;
+    size_t inodeHome(int idx) const;
+
+    void place(std::vector<int32_t>& table, size_t home, int idx);
+    void remove(std::vector<int32_t>& table, int idx, size_t (DirIndex::*home)(int) const);
+};
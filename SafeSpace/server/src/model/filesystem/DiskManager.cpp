@@ -1,141 +1,279 @@
 #include "DiskManager.h"
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 //DiskManager::DiskManager() {}
 
-DiskManager::DiskManager(const std::string& path) : diskPath(path) {}
+DiskManager::DiskManager(const std::string& path, Backend backend) : diskPath(path), backend(backend) {}
 
 DiskManager::~DiskManager() {
     closeDisk();
 }
 
 bool DiskManager::openDisk(std::ios::openmode mode){
-    // Cierra cualquier archivo anterior
-    if (this->disk.is_open())
-        this->disk.close();
-
-    // Abre el archivo binario con el modo indicado
-    this->disk.open(diskPath, mode);
+    // Cierra cualquier archivo anterior, con lo que quedara en la caché
+    if (fd >= 0)
+        closeDisk();
+
+    // Siempre lectura y escritura; se crea como lo haría fstream: con trunc,
+    // o con out sin in
+    int flags = O_RDWR | O_CLOEXEC;
+    if (mode & std::ios::trunc) {
+        flags |= O_CREAT | O_TRUNC;
+    } else if ((mode & std::ios::out) && !(mode & std::ios::in)) {
+        flags |= O_CREAT;
+    }
+    fd = ::open(diskPath.c_str(), flags, 0666);
 
     // Verifica si se abrió correctamente
-    if (!this->disk.is_open()) {
+    if (fd < 0) {
         std::cerr << "[DiskManager] Error: No se pudo abrir el disco en la ruta: "
                   << diskPath << std::endl;
         return false;
     }
 
-    // Coloca punteros al inicio por seguridad
-    this->disk.seekg(0, std::ios::beg);
-    this->disk.seekp(0, std::ios::beg);
+    if (backend == Backend::MMAP && !mapImage()) {
+        std::cerr << "[DiskManager] Aviso: no se pudo mapear el disco, se usa pread/pwrite.\n";
+    }
+    return true;
+}
+
+bool DiskManager::mapImage(){
+    // Se mapea la imagen completa: el área de datos termina un poco después
+    // de DISK_SIZE, así que el archivo se agranda (sin ocupar espacio) hasta
+    // ahí para que ninguna página del mapa quede pasado el final
+    Layout::superBlock sb{};
+    Layout::registerOffsets(sb);
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) return false;
+    const uint64_t bytes = std::max<uint64_t>(static_cast<uint64_t>(st.st_size),
+                                              sb.data_area_offset + sb.block_count * sb.block_size);
+    if (static_cast<uint64_t>(st.st_size) < bytes && ::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        return false;
+    }
 
+    void* addr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) return false;
+    map = static_cast<uint8_t*>(addr);
+    mapBytes = bytes;
     return true;
 }
 
+void DiskManager::unmapImage(){
+    if (map) {
+        ::munmap(map, mapBytes);
+        map = nullptr;
+        mapBytes = 0;
+    }
+}
+
 void DiskManager::closeDisk(){
-    if (this->disk.is_open()) {
-        this->disk.close();
+    if (cache) {
+        if (fd >= 0 && !cache->flush()) {
+            std::cerr << "[DiskManager] Error: no se pudieron escribir las páginas pendientes de la caché.\n";
+        }
+        cache->discard();
+    }
+    unmapImage();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
     }
 }
 
 bool DiskManager::isOpen() const {
-    return disk.is_open();
+    return fd >= 0;
 }
 
 bool DiskManager::writeBytes(uint64_t offset, const void* buffer, size_t bytes){
-    if (!disk.is_open()) {
+    if (fd < 0) {
         std::cerr << "[DiskManager] Error: el disco no está abierto para escritura.\n";
         return false;
     }
+    if (cache) {
+        return cache->write(offset, buffer, bytes);
+    }
+    return writeDirect(offset, buffer, bytes);
+}
 
-    disk.seekp(offset, std::ios::beg);
-    if (!disk.good()) {
-        std::cerr << "[DiskManager] Error: fallo al posicionar el puntero de escritura.\n";
+bool DiskManager::writeDirect(uint64_t offset, const void* buffer, size_t bytes){
+    if (fd < 0) {
+        std::cerr << "[DiskManager] Error: el disco no está abierto para escritura.\n";
         return false;
     }
 
-    disk.write(reinterpret_cast<const char*>(buffer), bytes);
-    if (!disk.good()) {
-        std::cerr << "[DiskManager] Error: fallo al escribir en el disco.\n";
-        return false;
+    if (map && offset + bytes <= mapBytes) {
+        std::memcpy(map + offset, buffer, bytes);
+        return true;
     }
 
-    disk.flush(); // fuerza la escritura al archivo
+    // Fuera del mapa (o sin él) se escribe con pwrite, que tampoco mueve
+    // ningún puntero compartido
+    const char* in = reinterpret_cast<const char*>(buffer);
+    size_t done = 0;
+    while (done < bytes) {
+        const ssize_t n = ::pwrite(fd, in + done, bytes - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            std::cerr << "[DiskManager] Error: fallo al escribir en el disco.\n";
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
     return true;
 }
 
-bool DiskManager::readBytes(uint64_t offset, void* buffer, size_t bytes){
-    if (!disk.is_open()) {
-        std::cerr << "[DiskManager] Error: el disco no está abierto para escritura.\n";
+bool DiskManager::sync(){
+    if (fd < 0) {
+        std::cerr << "[DiskManager] Error: el disco no está abierto.\n";
         return false;
     }
 
-    disk.seekg(offset, std::ios::beg);
-    if (!disk.good()) {
-        std::cerr << "[DiskManager] Error: fallo al posicionar el puntero de lectura.\n";
+    // Lo que la caché tiene sin escribir va primero al archivo
+    if (cache && !cache->flush()) {
+        std::cerr << "[DiskManager] Error: no se pudieron escribir las páginas de la caché.\n";
         return false;
     }
+    if (map && ::msync(map, mapBytes, MS_SYNC) != 0) {
+        std::cerr << "[DiskManager] Error: no se pudo sincronizar el mapa del disco.\n";
+        return false;
+    }
+    return ::fdatasync(fd) == 0;
+}
 
-    disk.read(reinterpret_cast<char*>(buffer), bytes);
-    if (!disk.good()) {
-        std::cerr << "[DiskManager] Error: fallo al leer en el disco.\n";
+bool DiskManager::readBytes(uint64_t offset, void* buffer, size_t bytes){
+    if (fd < 0) {
+        std::cerr << "[DiskManager] Error: el disco no está abierto para lectura.\n";
         return false;
     }
+    if (cache) {
+        if (!cache->read(offset, buffer, bytes)) {
+            std::cerr << "[DiskManager] Error: fallo al leer en el disco.\n";
+            return false;
+        }
+        return true;
+    }
 
+    if (readUpTo(offset, buffer, bytes) != static_cast<int64_t>(bytes)) {
+        std::cerr << "[DiskManager] Error: fallo al leer en el disco.\n";
+        return false;
+    }
     return true;
 }
 
+int64_t DiskManager::readUpTo(uint64_t offset, void* buffer, size_t bytes){
+    // El final del archivo no es error: la caché pide páginas enteras y la
+    // última puede quedar a medias. Ni el mapa ni pread mueven un puntero
+    // compartido, así que es seguro entre hilos
+    if (map && offset + bytes <= mapBytes) {
+        std::memcpy(buffer, map + offset, bytes);
+        return static_cast<int64_t>(bytes);
+    }
+
+    char* out = reinterpret_cast<char*>(buffer);
+    size_t done = 0;
+    while (done < bytes) {
+        const ssize_t n = ::pread(fd, out + done, bytes - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        done += static_cast<size_t>(n);
+    }
+    return static_cast<int64_t>(done);
+}
+
+void DiskManager::enableCache(size_t bytes){
+    if (cache) {
+        if (fd >= 0 && !cache->flush()) {
+            std::cerr << "[DiskManager] Error: no se pudieron escribir las páginas de la caché anterior.\n";
+        }
+        cache.reset();
+    }
+    if (bytes == 0) return;
+
+    cache = std::make_unique<BlockCache>(bytes,
+        [this](uint64_t offset, void* buffer, size_t count) { return readUpTo(offset, buffer, count); },
+        [this](uint64_t offset, const void* buffer, size_t count) { return writeDirect(offset, buffer, count); });
+}
+
+BlockCache::Stats DiskManager::cacheStats() const{
+    return cache ? cache->stats() : BlockCache::Stats{};
+}
+
 
 void DiskManager::resetUnity() {
-    std::ofstream newDisk(diskPath, std::ios::binary | std::ios::trunc);
-    if (!newDisk.is_open()) {
+    // El archivo se rehace entero por fuera de la caché y del mapa: al
+    // truncarlo, las páginas mapeadas quedarían pasado el final
+    if (cache) {
+        cache->discard();
+    }
+    const bool remap = map != nullptr;
+    unmapImage();
+    if (fd < 0 || ::ftruncate(fd, 0) != 0) {
         std::cerr << "[DiskManager] Error: no se pudo crear el disco: " << diskPath << "\n";
         return;
     }
 
     // 1 GB = 1'073'741'824 bytes
-    constexpr uint64_t DISK_SIZE = 1024ull * 1024ull * 1024ull;
-    constexpr size_t BUFFER_SIZE = 4096;
-    char buffer[BUFFER_SIZE];
-    std::memset(buffer, 0, BUFFER_SIZE);
+    constexpr size_t BUFFER_SIZE = 1024 * 1024;
+    std::vector<char> buffer(BUFFER_SIZE, 0);
 
     uint64_t written = 0;
-    while (written < DISK_SIZE) {
-        newDisk.write(buffer, BUFFER_SIZE);
-        written += BUFFER_SIZE;
+    while (written < Layout::DISK_SIZE) {
+        const ssize_t n = ::pwrite(fd, buffer.data(), BUFFER_SIZE, static_cast<off_t>(written));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            std::cerr << "[DiskManager] Error: fallo al llenar el disco de ceros.\n";
+            return;
+        }
+        written += static_cast<uint64_t>(n);
     }
 
-    newDisk.close();
-    std::cout << "[DiskManager] Disco reiniciado con éxito (" << DISK_SIZE / (1024*1024)
+    if (remap && !mapImage()) {
+        std::cerr << "[DiskManager] Aviso: no se pudo volver a mapear el disco, se usa pread/pwrite.\n";
+    }
+    std::cout << "[DiskManager] Disco reiniciado con éxito (" << Layout::DISK_SIZE / (1024*1024)
               << " MB llenos de ceros)\n";
 }
 
 
-bool DiskManager::saveBitMap(const std::vector<bool>& bitMap, const Layout::superBlock& superBlock) {
-    if (!disk.is_open()) {
+bool DiskManager::saveBitMap(const std::vector<uint64_t>& words, const Layout::superBlock& superBlock) {
+    return saveBitMapWords(words, 0, words.size(), superBlock);
+}
+
+bool DiskManager::saveBitMapWords(const std::vector<uint64_t>& words, uint64_t firstWord, uint64_t wordCount,
+                                  const Layout::superBlock& superBlock) {
+    if (fd < 0) {
         std::cerr << "[DiskManager] Error: disco no abierto para escribir bitmap.\n";
         return false;
     }
 
-    const uint64_t offset     = superBlock.bitmap_offset;
     const uint64_t bytesCount = Layout::bitmapBytes(superBlock.block_count);
-
-    std::vector<uint8_t> buffer(bytesCount, 0);
-
-    for (uint64_t i = 0; i < bitMap.size(); ++i) {
-        if (bitMap[i]) {
-            const uint64_t byteIndex = i / 8;
-            const uint8_t  bitIndex  = static_cast<uint8_t>(i % 8);
-            if (byteIndex < buffer.size()) {
-                buffer[byteIndex] |= (1u << bitIndex);
-            }
-        }
+    const uint64_t begin = firstWord * 8;
+    const uint64_t end = std::min({(firstWord + wordCount) * 8, bytesCount,
+                                   static_cast<uint64_t>(words.size()) * 8});
+    if (begin >= end) return true;
+
+    // Bloque i en el byte i / 8, bit i % 8: los bytes de cada palabra en
+    // orden little-endian, sin depender del orden de la máquina
+    std::vector<uint8_t> buffer(end - begin, 0);
+    for (uint64_t i = begin; i < end; ++i) {
+        buffer[i - begin] = static_cast<uint8_t>(words[i / 8] >> (8 * (i % 8)));
+    }
+    if (end == bytesCount && superBlock.block_count % 8 != 0) {
+        buffer.back() &= static_cast<uint8_t>((1u << (superBlock.block_count % 8)) - 1);
     }
 
-    return writeBytes(offset, buffer.data(), buffer.size());
+    return writeBytes(superBlock.bitmap_offset + begin, buffer.data(), buffer.size());
 }
 
-int DiskManager::loadBitMap(std::vector<bool>& outBitmap, const Layout::superBlock& superBlock){
-    if (!disk.is_open()) {
+int DiskManager::loadBitMap(std::vector<uint64_t>& words, const Layout::superBlock& superBlock){
+    if (fd < 0) {
         std::cerr << "[DiskManager] Error: disco no abierto para leer bitmap.\n";
         return -1;
     }
@@ -143,16 +281,17 @@ int DiskManager::loadBitMap(std::vector<bool>& outBitmap, const Layout::superBlo
     const uint64_t bitmapOffset = superBlock.bitmap_offset;
     const uint64_t bitmapBytes = Layout::bitmapBytes(superBlock.block_count);
 
-    std::vector<char> buffer(bitmapBytes);
+    std::vector<uint8_t> buffer(bitmapBytes);
 
     if (!readBytes(bitmapOffset, buffer.data(), bitmapBytes))
         return -1;
 
-    outBitmap.resize(superBlock.block_count);
-    for (size_t i = 0; i < superBlock.block_count; ++i) {
-        size_t byteIndex = i / 8;
-        size_t bitIndex  = i % 8;
-        outBitmap[i] = (buffer[byteIndex] >> bitIndex) & 1;
+    words.assign((superBlock.block_count + 63) / 64, 0);
+    for (uint64_t i = 0; i < bitmapBytes; ++i) {
+        words[i / 8] |= static_cast<uint64_t>(buffer[i]) << (8 * (i % 8));
+    }
+    if (superBlock.block_count % 64 != 0) {
+        words.back() &= (uint64_t{1} << (superBlock.block_count % 64)) - 1;
     }
 
     return 0;
@@ -6,30 +6,56 @@
 #include <vector>
 #include <cstdint>
 #include <ctime>
-#include <fstream>
+#include <ios>
+#include <memory>
+#include "BlockCache.h"
 #include "Layout.h"
 #include "iNode.h"
 
 class DiskManager
 {
+public:
+    /**
+     * @brief How the image file is accessed.
+     */
+    enum class Backend {
+        PREAD,  ///< pread/pwrite on a file descriptor
+        MMAP    ///< the whole image mapped with MAP_SHARED; reads and writes are memcpy
+    };
+
 private:
     std::string diskPath;
-    std::fstream disk;
+    Backend backend;
+    int fd = -1;                  // lecturas y escrituras posicionales: no hay puntero compartido
+    uint8_t* map = nullptr;       // solo con Backend::MMAP
+    uint64_t mapBytes = 0;
+    std::unique_ptr<BlockCache> cache;   // nula: cada lectura y escritura va al archivo
+
+    bool writeDirect(uint64_t offset, const void* buffer, size_t bytes);
+    int64_t readUpTo(uint64_t offset, void* buffer, size_t bytes);
+    bool mapImage();
+    void unmapImage();
 
 public:
     DiskManager();
-    explicit DiskManager(const std::string& path);
+    explicit DiskManager(const std::string& path, Backend backend = Backend::PREAD);
     ~DiskManager();
     /**
      * @brief Opens the disk for reading and writing.
      *
+     * The descriptor is always read-write. ios::trunc truncates (and
+     * creates) the file; ios::out without ios::in creates it if missing,
+     * as std::fstream would. With Backend::MMAP the file is grown to the
+     * full image extent and mapped; if the mapping fails the disk falls
+     * back to pread/pwrite.
+     *
      * @param mode
      * @return true
      * @return false
      */
     bool openDisk(std::ios::openmode mode = std::ios::in | std::ios::out | std::ios::binary);
     /**
-     * @brief Closes the disk.
+     * @brief Closes the disk, writing back whatever the cache still holds.
      *
      */
     void closeDisk();
@@ -43,6 +69,9 @@ public:
     /**
      * @brief Writes bytes to the disk at the specified offset.
      *
+     * With the cache enabled the bytes stay in its pages until they are
+     * evicted, sync() or closeDisk().
+     *
      * @param offset Offset in bytes where the data will be written.
      * @param buffer Pointer to the data to be written.
      * @param bytes Number of bytes to write.
@@ -52,31 +81,65 @@ public:
     /**
      * @brief Reads bytes from the disk at the specified offset.
      *
+     * Uses pread or the mapping (or the cache pages), so several threads
+     * may read at once as long as nobody writes meanwhile; earlier
+     * writeBytes calls are always visible here.
+     *
      * @param offset Offset in bytes where the data will be read.
      * @param buffer Pointer to the buffer where the read data will be stored.
      * @param bytes Number of bytes to read.
      * @return true if the read was successful, false otherwise.
      */
     bool readBytes(uint64_t offset, void* buffer, size_t bytes);
+    /**
+     * @brief Flushes buffered writes (cache pages included) and waits until
+     * they reach stable storage (msync of the mapping, then fdatasync).
+     *
+     * @return true if the data was synced, false otherwise.
+     */
+    bool sync();
 
     /**
-   * @brief Resets the disk, filling it with zeros.
+     * @brief Puts a BlockCache of the given size in front of the disk file.
+     *
+     * Writes become write-back and reads go through its pages, with
+     * sequential readahead. 0 removes the cache (after writing it back).
+     *
+     * @param bytes Cache size in bytes.
+     */
+    void enableCache(size_t bytes);
+    /**
+     * @brief Counters of the cache; all zero when it is disabled.
+     */
+    BlockCache::Stats cacheStats() const;
+
+    /**
+   * @brief Resets the disk, filling it with zeros (Layout::DISK_SIZE bytes).
    */
     void resetUnity();
 
     /**
    * @brief Loads the bitmap from disk to memory.
+   * @param words Receives one bit per block, 64 blocks per word (block i is bit i % 64 of word i / 64).
    * @param superBlock Superblock containing bitmap offset information.
    * @return 0 on success, -1 on error.
    */
-    int loadBitMap(std::vector<bool>& bitMap, const Layout::superBlock& superBlock);
+    int loadBitMap(std::vector<uint64_t>& words, const Layout::superBlock& superBlock);
     /**
    * @brief Saves the bitmap to disk.
-   * @param bitMap The bitmap to save.
+   * @param words The bitmap to save, in the layout loadBitMap() returns.
    * @param superBlock Superblock containing bitmap offset information.
    * @return true on success, false on error.
    */
-    bool saveBitMap(const std::vector<bool>& bitMap, const Layout::superBlock& superBlock);
+    bool saveBitMap(const std::vector<uint64_t>& words, const Layout::superBlock& superBlock);
+    /**
+   * @brief Saves only words [firstWord, firstWord + wordCount) of the bitmap.
+   * @param words The whole bitmap, in the layout loadBitMap() returns.
+   * @param superBlock Superblock containing bitmap offset information.
+   * @return true on success (or if the range is empty), false on error.
+   */
+    bool saveBitMapWords(const std::vector<uint64_t>& words, uint64_t firstWord, uint64_t wordCount,
+                         const Layout::superBlock& superBlock);
     /**
    * @brief Saves an iNode to disk at the specified offset.
    * @param disk File stream for the disk.
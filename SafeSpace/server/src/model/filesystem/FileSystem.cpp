@@ -1,8 +1,9 @@
 #include "FileSystem.h"
+#include <algorithm>
 #include <iostream>
 #include <cstring>
-FileSystem::FileSystem(const std::string& diskPath)
-    : disk(diskPath), superBlock{} {
+FileSystem::FileSystem(const std::string& diskPath, size_t cacheBytes, DiskManager::Backend backend)
+    : disk(diskPath, backend), dirIndex(directory), superBlock{} {
     if (!disk.openDisk()) {
         std::cerr << "[FS] No se pudo abrir el disco, se intentará crear uno nuevo.\n";
         if (!disk.openDisk(std::ios::out | std::ios::binary | std::ios::trunc)) {
@@ -16,6 +17,7 @@ FileSystem::FileSystem(const std::string& diskPath)
         }
     }
 
+    disk.enableCache(cacheBytes);
     computeSuperAndOffsets();
 
 
@@ -54,11 +56,9 @@ FileSystem::FileSystem(const std::string& diskPath)
 
 FileSystem::~FileSystem() {
     if (disk.isOpen()) {
-        // Guardar bitmap actualizado
-        disk.saveBitMap(bitMap, superBlock);
-
-        // Guardar directorio actualizado
-        saveDirectoryToDisk();
+        // Guardar lo que quede pendiente del bitmap y del directorio
+        flushBitMap();
+        flushDirectory();
 
         // Cerrar el archivo de disco
         disk.closeDisk();
@@ -90,11 +90,14 @@ bool FileSystem::format() {
     std::cout << "[FS] Formateando disco...\n";
     disk.resetUnity();
 
-    bitMap.assign(superBlock.block_count, false);
+    // Los bloques de metadatos nunca se asignan: los datos empiezan en data_area_offset
+    bitMap = BitAllocator(superBlock.block_count, superBlock.data_area_offset / superBlock.block_size);
     inodeTable.assign(superBlock.inode_count, {});
+    inodeMap = BitAllocator(superBlock.inode_count, 1);
 
     // Escribir bitmap en disco
-    disk.saveBitMap(bitMap, superBlock);
+    disk.saveBitMap(bitMap.words(), superBlock);
+    bitMapStale = false;
 
     // Escribir inodos vacíos
     for (uint64_t i = 0; i < superBlock.inode_count; ++i) {
@@ -109,6 +112,9 @@ bool FileSystem::format() {
     }
 
     directory.clear();
+    dirIndex.rebuild();
+    dirDirty.clear();
+    directoryStale = false;
     std::cout << "[FS] Formato completado.\n";
     return true;
 }
@@ -128,9 +134,13 @@ bool FileSystem::mount() {
     }
 
     // Cargar bitmap a memoria
-    if (disk.loadBitMap(bitMap, superBlock) != 0) {
-        bitMap.assign(superBlock.block_count, false);
+    std::vector<uint64_t> words;
+    if (disk.loadBitMap(words, superBlock) != 0) {
+        words.assign((superBlock.block_count + 63) / 64, 0);
     }
+    bitMap.assign(superBlock.block_count, superBlock.data_area_offset / superBlock.block_size,
+                  [&words](uint64_t i) { return (words[i / 64] >> (i % 64)) & 1; });
+    bitMapStale = false;
 
     // Cargar i-nodos a memoria
     inodeTable.resize(superBlock.inode_count);
@@ -143,43 +153,48 @@ bool FileSystem::mount() {
             inodeTable[i].flags = 0; // cerrado
         }
     }
+    // Empezar desde 1, reservar inode 0 como "vacío/inválido"
+    inodeMap.assign(superBlock.inode_count, 1,
+                    [this](uint64_t i) { return inodeTable[i].inode_id != 0; });
 
     // Cargar directorio
     if (!loadDirectoryFromDisk()) {
         directory.assign(superBlock.dir_entry_count, DirEntry{});
     }
+    dirIndex.rebuild();
+    dirDirty.clear();
+    directoryStale = false;
 
     std::cout << "[FS] Montado.\n";
     return true;
 }
 
 int FileSystem::dirFind(const std::string& name) const {
-    for (size_t i = 0; i < directory.size(); ++i) {
-        if (directory[i].inode_id != 0 && std::strncmp(directory[i].name, name.c_str(), Layout::DIR_NAME_LEN) == 0)
-            return static_cast<int>(i);
-    }
-    return -1;
+    return dirIndex.findName(name.c_str());
 }
 
 bool FileSystem::dirAdd(const std::string& name, uint64_t inodeId) {
     if (name.empty()) return false;
     if (dirFind(name) >= 0) return false; // ya existe
 
-    for (auto& e : directory) {
-        if (e.inode_id == 0) {
-            copyNameFixed(e.name, name);
-            e.inode_id = inodeId;
-            return saveDirectoryToDisk();
-        }
-    }
-    return false; // sin espacio en directorio raíz
+    const int idx = dirIndex.takeFree();
+    if (idx < 0) return false; // sin espacio en directorio raíz
+
+    DirEntry& e = directory[idx];
+    copyNameFixed(e.name, name);
+    e.inode_id = inodeId;
+    dirIndex.insert(idx);
+    dirDirty.push_back(static_cast<uint32_t>(idx));
+    return flushDirectory();
 }
 
 bool FileSystem::dirRemoveByIndex(int idx) {
 
     if (idx < 0 || static_cast<size_t>(idx) >= directory.size()) return false;
+    dirIndex.erase(idx);
     directory[idx] = DirEntry{}; // borrar
-    return saveDirectoryToDisk();
+    dirDirty.push_back(static_cast<uint32_t>(idx));
+    return flushDirectory();
 
 }
 
@@ -208,6 +223,61 @@ bool FileSystem::saveDirectoryToDisk() {
     return disk.writeBytes(superBlock.directory_offset, buf.data(), buf.size());
 }
 
+bool FileSystem::flushBitMap() {
+    if (bitMapStale) {
+        bitMap.takeDirty();
+        bitMapStale = !disk.saveBitMap(bitMap.words(), superBlock);
+        return !bitMapStale;
+    }
+
+    // Palabras a menos de un bloque de distancia van en la misma escritura
+    const std::vector<uint64_t> dirty = bitMap.takeDirty();
+    const uint64_t wordsPerBlock = superBlock.block_size / sizeof(uint64_t);
+    bool ok = true;
+    for (size_t i = 0; i < dirty.size();) {
+        size_t j = i + 1;
+        while (j < dirty.size() && dirty[j] - dirty[j - 1] <= wordsPerBlock) ++j;
+        ok &= disk.saveBitMapWords(bitMap.words(), dirty[i], dirty[j - 1] - dirty[i] + 1, superBlock);
+        i = j;
+    }
+    bitMapStale = !ok;
+    return ok;
+}
+
+bool FileSystem::flushDirectory() {
+    if (directoryStale) {
+        dirDirty.clear();
+        directoryStale = !saveDirectoryToDisk();
+        return !directoryStale;
+    }
+    if (dirDirty.empty()) return true;
+
+    std::sort(dirDirty.begin(), dirDirty.end());
+    const uint64_t entrySize = sizeof(DirEntry);
+    const uint64_t blockSize = superBlock.block_size;
+    const uint64_t total = directory.size() * entrySize;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(directory.data());
+
+    // Cada entrada se lleva los bloques que pisa; los bloques seguidos se
+    // escriben juntos
+    bool ok = true;
+    size_t i = 0;
+    while (i < dirDirty.size()) {
+        const uint64_t first = dirDirty[i] * entrySize / blockSize;
+        uint64_t last = ((dirDirty[i] + 1) * entrySize - 1) / blockSize;
+        for (++i; i < dirDirty.size(); ++i) {
+            if (dirDirty[i] * entrySize / blockSize > last + 1) break;
+            last = std::max(last, ((dirDirty[i] + 1) * entrySize - 1) / blockSize);
+        }
+        const uint64_t from = first * blockSize;
+        const uint64_t to = std::min(total, (last + 1) * blockSize);
+        ok &= disk.writeBytes(superBlock.directory_offset + from, bytes + from, to - from);
+    }
+    dirDirty.clear();
+    directoryStale = !ok;
+    return ok;
+}
+
 int FileSystem::create(const std::string& name) {
     if (name.empty()) return -1;
     if (dirFind(name) >= 0) {
@@ -231,6 +301,7 @@ int FileSystem::create(const std::string& name) {
 
     if (!disk.writeInode(inodeOffset(inodeId), n)) {
         std::cerr << "[FS] Error al persistir i-nodo.\n";
+        inodeMap.release(inodeId);
         return -1;
     }
     inodeTable[inodeId] = n;
@@ -250,11 +321,18 @@ int FileSystem::find(const std::string& name) const {
     return static_cast<int>(directory[didx].inode_id);
 }
 
+bool FileSystem::sync() {
+    return disk.sync();
+}
+
+int64_t FileSystem::fileSize(const std::string& name) const {
+    int inodeId = find(name);
+    if (inodeId < 0) return -1;
+    return static_cast<int64_t>(inodeTable[inodeId].size_bytes);
+}
+
 int FileSystem::dirFindByInode(uint64_t inodeId) const {
-    for (size_t i = 0; i < directory.size(); ++i) {
-        if (directory[i].inode_id == inodeId) return static_cast<int>(i);
-    }
-    return -1;
+    return dirIndex.findInode(inodeId);
 }
 bool FileSystem::write(const std::string& name, const std::string& data) {
     int inodeId = find(name);
@@ -349,10 +427,115 @@ bool FileSystem::write(const std::string& name, const std::string& data) {
     }
 
     if (!disk.writeInode(inodeOffset(inodeId), n)) return false;
-    if (!disk.saveBitMap(bitMap, superBlock)) return false;
+    if (!flushBitMap()) return false;
     return true;
 }
 
+bool FileSystem::append(const std::string& name, const void* data, size_t len) {
+    int inodeId = find(name);
+    if (inodeId < 0) {
+        std::cerr << "[FS] No existe: " << name << "\n";
+        return false;
+    }
+
+    iNode& n = inodeTable[inodeId];
+    if (n.flags == 0){
+        std::cerr << "[FS] No se puede escribir en un archivo cerrado: " << name << "\n";
+        std::cerr << "[FS] Abra el archivo antes de escribir.\n";
+        return false;
+    }
+    if (len == 0) return true;
+    if (n.size_bytes + len > Layout::MAX_FILE_SIZE) {
+        std::cerr << "[FS] Archivo lleno: " << name << "\n";
+        return false;
+    }
+
+    const size_t blockSize = superBlock.block_size;
+    const size_t idxCount = blockSize / sizeof(uint32_t);
+    std::vector<uint32_t> idx;      // tabla indirecta, se carga solo si se llega a ella
+    bool idxDirty = false;
+    bool allocated = false;
+    bool ok = true;
+
+    // Los bloques nuevos (y el de índices, si se llega a él) se piden de una
+    // vez para que queden contiguos mientras haya espacio
+    const uint64_t haveBlocks = (n.size_bytes + blockSize - 1) / blockSize;
+    const uint64_t needBlocks = (n.size_bytes + len + blockSize - 1) / blockSize;
+    size_t reserve = static_cast<size_t>(needBlocks - haveBlocks);
+    if (needBlocks > Layout::DIRECT_BLOCKS && n.indirect1 == 0) reserve++;
+    std::vector<uint32_t> reserved;
+    if (!allocateBlocks(reserve, reserved)) {
+        std::cerr << "[FS] Sin bloques libres.\n";
+        return false;
+    }
+    size_t nextReserved = 0;
+    auto takeBlock = [&]() -> int {
+        if (nextReserved < reserved.size()) return static_cast<int>(reserved[nextReserved++]);
+        return allocateBlock();
+    };
+
+    const char* src = static_cast<const char*>(data);
+    uint64_t pos = n.size_bytes;
+    size_t remaining = len;
+    while (remaining > 0) {
+        const size_t blockIndex = static_cast<size_t>(pos / blockSize);
+        const size_t inBlock = static_cast<size_t>(pos % blockSize);
+
+        uint32_t* slot;
+        if (blockIndex < Layout::DIRECT_BLOCKS) {
+            slot = &n.direct[blockIndex];
+        } else {
+            if (idx.empty()) {
+                idx.assign(idxCount, 0);
+                if (n.indirect1 == 0) {
+                    int ib = takeBlock();
+                    if (ib < 0) { std::cerr << "[FS] Sin bloques para índice.\n"; ok = false; break; }
+                    n.indirect1 = static_cast<uint32_t>(ib);
+                    n.blocks_used++;
+                    allocated = true;
+                    idxDirty = true;
+                } else {
+                    disk.readBytes(dataBlockOffset(n.indirect1), idx.data(), blockSize);
+                }
+            }
+            slot = &idx[blockIndex - Layout::DIRECT_BLOCKS];
+        }
+
+        if (*slot == 0) {
+            int b = takeBlock();
+            if (b < 0) { std::cerr << "[FS] Sin bloques libres.\n"; ok = false; break; }
+            *slot = static_cast<uint32_t>(b);
+            n.blocks_used++;
+            allocated = true;
+            if (blockIndex >= Layout::DIRECT_BLOCKS) idxDirty = true;
+        }
+
+        const size_t portion = std::min(remaining, blockSize - inBlock);
+        if (!disk.writeBytes(dataBlockOffset(*slot) + inBlock, src, portion)) {
+            ok = false;
+            break;
+        }
+        src += portion;
+        pos += portion;
+        remaining -= portion;
+    }
+
+    // Lo reservado que no se usó (escritura fallida) vuelve al mapa
+    for (; nextReserved < reserved.size(); ++nextReserved) freeBlock(reserved[nextReserved]);
+
+    // Los bloques ya asignados quedan en el i-nodo aunque la escritura falle;
+    // el tamaño solo avanza si se escribió todo
+    if (idxDirty) {
+        disk.writeBytes(dataBlockOffset(n.indirect1), idx.data(), blockSize);
+    }
+    if (ok) {
+        n.size_bytes += len;
+    }
+    if (!disk.writeInode(inodeOffset(inodeId), n)) return false;
+    if (allocated && !flushBitMap()) return false;
+    return ok;
+}
+
 std::string FileSystem::read(const std::string& name) {
     int inodeId = find(name);
     if (inodeId < 0) return {};
@@ -366,36 +549,49 @@ std::string FileSystem::read(const std::string& name) {
         return {};
     }
 
-    std::string out;
-    out.reserve(n.size_bytes);
+    return readData(n);
+}
 
-    // directos
-    std::vector<char> buf(superBlock.block_size);
-    size_t remaining = n.size_bytes;
+bool FileSystem::readShared(const std::string& name, std::string& out) {
+    int inodeId = find(name);
+    if (inodeId < 0) return false;
 
-    for (int i = 0; i < 10 && remaining > 0; ++i) {
+    out = readData(inodeTable[inodeId]);
+    return true;
+}
+
+std::string FileSystem::readData(const iNode& n) {
+    const size_t blockSize = superBlock.block_size;
+    const size_t needed = static_cast<size_t>((n.size_bytes + blockSize - 1) / blockSize);
+
+    // Bloques del archivo en orden: directos hasta el primer 0, después los del indirecto
+    std::vector<uint32_t> blocks;
+    blocks.reserve(needed);
+    for (int i = 0; i < 10 && blocks.size() < needed; ++i) {
         if (n.direct[i] == 0) break;
-        disk.readBytes(dataBlockOffset(n.direct[i]), buf.data(), superBlock.block_size);
-        size_t chunk = std::min(remaining, static_cast<size_t>(superBlock.block_size));
-        out.append(buf.data(), chunk);
-        remaining -= chunk;
+        blocks.push_back(n.direct[i]);
     }
-
-    // indirectos
-    if (remaining > 0 && n.indirect1 != 0) {
-        const size_t idxCount = superBlock.block_size / sizeof(uint32_t);
+    if (blocks.size() < needed && n.indirect1 != 0) {
+        const size_t idxCount = blockSize / sizeof(uint32_t);
         std::vector<uint32_t> idx(idxCount, 0);
-        disk.readBytes(dataBlockOffset(n.indirect1), idx.data(), superBlock.block_size);
-
-        for (size_t k = 0; k < idxCount && remaining > 0; ++k) {
+        disk.readBytes(dataBlockOffset(n.indirect1), idx.data(), blockSize);
+        for (size_t k = 0; k < idxCount && blocks.size() < needed; ++k) {
             if (idx[k] == 0) break;
-            disk.readBytes(dataBlockOffset(idx[k]), buf.data(), superBlock.block_size);
-            size_t chunk = std::min(remaining, static_cast<size_t>(superBlock.block_size));
-            out.append(buf.data(), chunk);
-            remaining -= chunk;
+            blocks.push_back(idx[k]);
         }
     }
 
+    // Los bloques seguidos en disco se leen de una vez
+    std::string out(std::min<uint64_t>(n.size_bytes, blocks.size() * blockSize), '\0');
+    size_t i = 0;
+    while (i < blocks.size()) {
+        size_t j = i + 1;
+        while (j < blocks.size() && blocks[j] == blocks[j - 1] + 1) ++j;
+        const size_t from = i * blockSize;
+        const size_t bytes = std::min(out.size(), j * blockSize) - from;
+        disk.readBytes(dataBlockOffset(blocks[i]), &out[from], bytes);
+        i = j;
+    }
     return out;
 }
 
@@ -436,7 +632,7 @@ bool FileSystem::remove(const std::string& name) {
     freeInode(inodeId);
 
     // persistir cambios
-    disk.saveBitMap(bitMap, superBlock);
+    flushBitMap();
     disk.writeInode(inodeOffset(inodeId), n);
 
     std::cout << "[FS] Eliminado: " << name << "\n";
@@ -444,32 +640,41 @@ bool FileSystem::remove(const std::string& name) {
 }
 
 int FileSystem::allocateBlock() {
-    // Empezar desde el área de datos, no desde 0 (metadatos)
-    uint64_t startBlock = superBlock.data_area_offset / superBlock.block_size;
+    // Nunca entrega bloques de metadatos: el mapa arranca en el área de datos
+    const uint64_t b = bitMap.allocate();
+    return b == BitAllocator::NONE ? -1 : static_cast<int>(b);
+}
 
-    for (uint64_t i = startBlock; i < bitMap.size(); ++i) {
-        if (!bitMap[i]) {
-            bitMap[i] = true;
-            return static_cast<int>(i);
+bool FileSystem::allocateBlocks(size_t count, std::vector<uint32_t>& out) {
+    out.clear();
+    while (out.size() < count) {
+        uint64_t start = 0;
+        const uint64_t got = bitMap.allocateRun(count - out.size(), start);
+        if (got == 0) {
+            // Todo o nada: devolver lo que se alcanzó a tomar
+            for (uint32_t b : out) freeBlock(b);
+            out.clear();
+            return false;
         }
+        for (uint64_t k = 0; k < got; ++k) out.push_back(static_cast<uint32_t>(start + k));
     }
-    return -1;
+    return true;
 }
 
 void FileSystem::freeBlock(uint32_t blockId) {
-    if (blockId < bitMap.size()) bitMap[blockId] = false;
+    bitMap.release(blockId);
 }
 
 int FileSystem::allocateInode() {
-    // Empezar desde 1, reservar inode 0 como "vacío/inválido"
-    for (size_t i = 1; i < inodeTable.size(); ++i) {
-        if (inodeTable[i].flags == 0) return static_cast<int>(i);
-    }
-    return -1;
+    // Libre = inode_id 0; flags solo indica abierto/cerrado. Queda marcado
+    // hasta freeInode().
+    const uint64_t id = inodeMap.allocate();
+    return id == BitAllocator::NONE ? -1 : static_cast<int>(id);
 }
 
 void FileSystem::freeInode(uint32_t inodeId) {
     if (inodeId < inodeTable.size()) {
+        inodeMap.release(inodeId);
         inodeTable[inodeId] = {};
         disk.writeInode(inodeOffset(inodeId), inodeTable[inodeId]);
     }
@@ -3,15 +3,22 @@
 #include "iNode.h"
 #include "Layout.h"
 #include "DirEntry.h"
+#include "DirIndex.h"
+#include "BitAllocator.h"
 #include <string>
 #include <vector>
 
 class FileSystem {
 private:
     DiskManager disk;
-    std::vector<bool> bitMap;           // mapa de bloques
+    BitAllocator bitMap;                // mapa de bloques (1 = ocupado)
     std::vector<iNode> inodeTable;      // tabla de i-nodos
+    BitAllocator inodeMap;              // i-nodos en uso; se rehace al montar
     std::vector<DirEntry> directory;    // entradas de directorio
+    DirIndex dirIndex;                  // nombre/i-nodo -> entrada; se rehace al montar
+    std::vector<uint32_t> dirDirty;     // entradas cambiadas que falta guardar
+    bool bitMapStale = false;           // falló un guardado parcial: el próximo va entero
+    bool directoryStale = false;
     Layout::superBlock superBlock;
 
     void computeSuperAndOffsets();     // rellena superBlock con Layout::registerOffsets
@@ -19,10 +26,12 @@ private:
     bool readSuperFromDisk();          // lee superbloque desde disco
     // Funciones auxiliares
     int allocateBlock();               // busca un bloque libre
+    bool allocateBlocks(size_t count, std::vector<uint32_t>& out); // count bloques, contiguos si se puede
     void freeBlock(uint32_t blockID);  // libera un bloque
     int allocateInode();               // busca un inode libre
     void freeInode(uint32_t inodeID);  // libera un inode
     uint64_t inodeOffset(uint64_t inodeId);
+    std::string readData(const iNode& n); // contenido de un i-nodo
 
 
 
@@ -33,6 +42,10 @@ private:
     bool dirRemoveByIndex(int idx);
     bool loadDirectoryFromDisk();
     bool saveDirectoryToDisk();
+    // Guardan solo lo que cambió desde el último guardado: las palabras del
+    // bitmap y los bloques del directorio tocados, juntando los cercanos
+    bool flushBitMap();
+    bool flushDirectory();
 
     // datos
     uint64_t dataBlockOffset(uint32_t blockId) const {
@@ -40,16 +53,33 @@ private:
     }
 
 public:
-    FileSystem(const std::string& diskPath);
+    // cacheBytes > 0 pone una BlockCache de ese tamaño delante del disco:
+    // las escrituras quedan en memoria hasta sync() o el cierre.
+    // backend elige cómo se accede a la imagen (pread/pwrite o mmap)
+    FileSystem(const std::string& diskPath, size_t cacheBytes = 0,
+               DiskManager::Backend backend = DiskManager::Backend::PREAD);
     ~FileSystem();
     // Operaciones principales
     bool format();                     // formatea el disco (superblock + bitmap + inodes vacíos)
     bool mount();                      // carga estructuras desde el disco
     int  create(const std::string& name); // crea un nuevo archivo
     bool write(const std::string& name, const std::string& data);
+    // Agrega len bytes al final sin reescribir lo existente; solo toca el
+    // último bloque y los que haya que asignar. Falla si pasa de MAX_FILE_SIZE.
+    bool append(const std::string& name, const void* data, size_t len);
+    bool append(const std::string& name, const std::string& data) {
+        return append(name, data.data(), data.size());
+    }
     std::string read(const std::string& name);
+    // Lee el archivo entero sin abrirlo: no cambia nada, así que varios hilos
+    // pueden leer a la vez mientras nadie modifique el sistema de archivos.
+    // false si no existe.
+    bool readShared(const std::string& name, std::string& out);
     bool remove(const std::string& name);
     int  find(const std::string& name) const; // retorna el id del i-nodo
+    int64_t fileSize(const std::string& name) const; // bytes, -1 si no existe
+    bool sync();                       // espera a que lo escrito llegue al disco
+    BlockCache::Stats cacheStats() const { return disk.cacheStats(); }
     int openFile(const std::string& name);
     int closeFile(const std::string& name);
     const std::vector<DirEntry>& getDirectory() const;
@@ -18,6 +18,10 @@ inline constexpr uint32_t DIR_ENTRY_COUNT = 16384;
 
 inline constexpr uint64_t SUPER_SIZE    = BLOCK_SIZE;                   // reservamos 1 bloque
 
+inline constexpr uint32_t DIRECT_BLOCKS = 10;                           // punteros directos por i-nodo
+inline constexpr uint64_t MAX_FILE_SIZE =                               // directos + un indirecto
+    (DIRECT_BLOCKS + BLOCK_SIZE / sizeof(uint32_t)) * static_cast<uint64_t>(BLOCK_SIZE);
+
 
 inline constexpr uint64_t reservBlocks(uint64_t a, uint64_t b) {        // reservar cuantos bloques
     return (a + b - 1) / b;                                             // necesito para almacenar
@@ -0,0 +1,199 @@
+#ifndef SERVER_MESSAGEHEADER_H
+#define SERVER_MESSAGEHEADER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Message kinds carried in MessageHeader::type.
+ *
+ * Storage codes keep the values of StorageNode's MessageType; CONNECT keeps
+ * ConnectRequest::IDENTIFIER. New kinds only need a free code here, never a
+ * free datagram size.
+ */
+enum class MessageKind : uint8_t {
+  NONE = 0x00,
+
+  QUERY_BY_DATE = 0x01,
+  QUERY_BY_SENSOR = 0x02,
+  QUERY_NEXT = 0x03,      ///< Next page of a paginated query (StorageNode cursors).
+  QUERY_CANCEL = 0x04,
+  QUERY_AGGREGATE = 0x05, ///< Bucketed min/max/avg/count of one sensor; framed only.
+  STORE_SENSOR_DATA = 0x10,
+  STORE_BITACORA = 0x11,
+  RESPONSE_SENSOR_DATA = 0x20,
+  RESPONSE_SENSOR_HISTORY = 0x21,
+  RESPONSE_ACK = 0x22,
+  RESPONSE_ERROR = 0x23,
+  RESPONSE_AGGREGATE = 0x24,
+  REGISTER_NODE = 0x30,
+  HEARTBEAT = 0x31,
+
+  DISCOVER = 0x40,
+  DISCOVER_RESPONSE = 0x41,
+  SENSOR_DATA = 0x42,
+  CONNECT = 0x43,
+  AUTH_REQUEST = 0x44,
+  AUTH_RESPONSE = 0x45,
+  SENSOR_BATCH = 0x46,    ///< Many readings per datagram, see SensorBatch.h; framed only.
+  LOG = 0x4C
+};
+
+/**
+ * @brief Versioned fixed header that prefixes every framed datagram.
+ *
+ * Wire layout (12 bytes, big endian):
+ *   magic(2) 'SS' | version(1) | type(1) | flags(1) | reserved(1) | length(2) | seq(4)
+ *
+ * length is the payload size and must match the datagram exactly. The
+ * payload is the legacy message body unchanged, so migrating a sender means
+ * prepending a header. Replies echo type and seq and set FLAG_REPLY.
+ */
+struct MessageHeader {
+  static constexpr size_t SIZE = 12;
+  static constexpr uint16_t MAGIC = 0x5353;
+  static constexpr uint8_t VERSION = 1;
+  static constexpr uint8_t FLAG_REPLY = 0x01;
+  /// seq is a replication sequence number: retransmissions reuse it and
+  /// the receiver applies each one once (StorageReplicas -> StorageNode).
+  static constexpr uint8_t FLAG_REPLICATED = 0x02;
+
+  MessageKind type = MessageKind::NONE;
+  uint8_t flags = 0;
+  uint16_t length = 0;
+  uint32_t seq = 0;
+
+  /**
+   * @brief Parses a framed datagram.
+   * @return false if data is not a well-formed header of this version for a len-byte datagram.
+   */
+  static bool decode(const uint8_t* data, size_t len, MessageHeader& out) noexcept {
+    if (len < SIZE) return false;
+    if (((data[0] << 8) | data[1]) != MAGIC || data[2] != VERSION) return false;
+    const uint16_t length = static_cast<uint16_t>((data[6] << 8) | data[7]);
+    if (length != len - SIZE) return false;
+    out.type = static_cast<MessageKind>(data[3]);
+    out.flags = data[4];
+    out.length = length;
+    out.seq = (static_cast<uint32_t>(data[8]) << 24) | (static_cast<uint32_t>(data[9]) << 16) |
+              (static_cast<uint32_t>(data[10]) << 8) | data[11];
+    return true;
+  }
+
+  /** @brief Writes the SIZE header bytes to out. */
+  void encode(uint8_t* out) const noexcept {
+    out[0] = static_cast<uint8_t>(MAGIC >> 8);
+    out[1] = static_cast<uint8_t>(MAGIC);
+    out[2] = VERSION;
+    out[3] = static_cast<uint8_t>(type);
+    out[4] = flags;
+    out[5] = 0;
+    out[6] = static_cast<uint8_t>(length >> 8);
+    out[7] = static_cast<uint8_t>(length);
+    out[8] = static_cast<uint8_t>(seq >> 24);
+    out[9] = static_cast<uint8_t>(seq >> 16);
+    out[10] = static_cast<uint8_t>(seq >> 8);
+    out[11] = static_cast<uint8_t>(seq);
+  }
+};
+
+/**
+ * @brief A classified datagram: its kind and where its payload is.
+ *
+ * Produced either from a MessageHeader (framed) or by legacy length
+ * detection, so handlers see the same payload bytes in both cases.
+ */
+struct MessageView {
+  MessageKind kind = MessageKind::NONE;
+  bool framed = false;
+  uint8_t flags = 0;
+  uint32_t seq = 0;
+  const uint8_t* payload = nullptr;
+  size_t length = 0;
+  const uint8_t* datagram = nullptr;   ///< Whole datagram, header included, for relaying as-is.
+  size_t datagramLength = 0;
+
+  /** @brief Classifies a framed datagram; false if it carries no valid header. */
+  static bool fromFramed(const uint8_t* data, size_t len, MessageView& out) noexcept {
+    MessageHeader header;
+    if (!MessageHeader::decode(data, len, header)) return false;
+    out.kind = header.type;
+    out.framed = true;
+    out.flags = header.flags;
+    out.seq = header.seq;
+    out.payload = data + MessageHeader::SIZE;
+    out.length = header.length;
+    out.datagram = data;
+    out.datagramLength = len;
+    return true;
+  }
+
+  /**
+   * @brief Legacy detection by datagram size, as the nodes did before framing.
+   *
+   * Covers the messages shared by every node (DISCOVER 2, DISCOVER_RESPONSE 4,
+   * CONNECT 6, SENSOR_DATA 24, AUTH_REQUEST 50, AUTH_RESPONSE 51, "LOG" prefix).
+   * @return false if the size matches none of them.
+   */
+  static bool fromLegacy(const uint8_t* data, size_t len, MessageView& out) noexcept {
+    MessageKind kind;
+    if (len >= 5 && data[0] == 'L' && data[1] == 'O' && data[2] == 'G') {
+      kind = MessageKind::LOG;
+    } else {
+      switch (len) {
+        case 2: kind = MessageKind::DISCOVER; break;
+        case 4: kind = MessageKind::DISCOVER_RESPONSE; break;
+        case 6: kind = MessageKind::CONNECT; break;
+        case 24: kind = MessageKind::SENSOR_DATA; break;
+        case 50: kind = MessageKind::AUTH_REQUEST; break;
+        case 51: kind = MessageKind::AUTH_RESPONSE; break;
+        default: return false;
+      }
+    }
+    out = legacy(kind, data, len);
+    return true;
+  }
+
+  /** @brief Wraps an unframed datagram already classified as kind. */
+  static MessageView legacy(MessageKind kind, const uint8_t* data, size_t len) noexcept {
+    MessageView view;
+    view.kind = kind;
+    view.payload = data;
+    view.length = len;
+    view.datagram = data;
+    view.datagramLength = len;
+    return view;
+  }
+};
+
+/**
+ * @brief 256-slot table from message kind to handler, built at compile time.
+ *
+ * Routing is one indexed load; unused kinds hold a null handler.
+ * @tparam Handler any default-constructible callable, typically a pointer to member.
+ */
+template <typename Handler>
+class DispatchTable {
+ public:
+  struct Route {
+    MessageKind kind;
+    Handler handler;
+  };
+
+  template <size_t N>
+  constexpr explicit DispatchTable(const Route (&routes)[N]) : slots_{} {
+    for (size_t i = 0; i < N; ++i) {
+      slots_[static_cast<uint8_t>(routes[i].kind)] = routes[i].handler;
+    }
+  }
+
+  constexpr Handler find(MessageKind kind) const noexcept {
+    return slots_[static_cast<uint8_t>(kind)];
+  }
+
+ private:
+  std::array<Handler, 256> slots_;
+};
+
+#endif //SERVER_MESSAGEHEADER_H
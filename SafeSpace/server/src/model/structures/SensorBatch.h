@@ -0,0 +1,180 @@
+#ifndef SERVER_SENSORBATCH_H
+#define SERVER_SENSORBATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "MessageHeader.h"
+#include "sensordata.h"
+
+/**
+ * @brief One sensor reading as carried in a SENSOR_BATCH message.
+ */
+struct SensorReading {
+  uint16_t sensorId = 0;
+  uint64_t timestampMs = 0;   ///< Unix epoch, milliseconds.
+  float distance = 0;
+  float temperature = 0;
+  float pressure = 0;
+  float altitude = 0;
+  float sealevelPressure = 0;
+  float realAltitude = 0;
+
+  SensorData toSensorData() const {
+    return SensorData(distance, temperature, pressure, altitude, sealevelPressure, realAltitude);
+  }
+};
+
+/**
+ * @brief Wire format of the SENSOR_BATCH payload (MessageKind::SENSOR_BATCH).
+ *
+ * Always framed, there is no legacy form. Layout, big endian:
+ *   baseTimestampMs(8) | count(1) | count * record
+ *   record = sensorId(2) | offsetMs(4, signed, from base) | 6 * float(4)
+ *
+ * A full batch is sized so header, payload and IPv4/UDP headers fit one
+ * 1500-byte Ethernet frame: MAX_RECORDS readings per datagram.
+ */
+struct SensorBatch {
+  static constexpr size_t HEADER_SIZE = 9;
+  static constexpr size_t RECORD_SIZE = 30;
+  /// Largest UDP payload that is not fragmented on a 1500-byte MTU.
+  static constexpr size_t MAX_DATAGRAM = 1472;
+  static constexpr size_t MAX_RECORDS =
+    (MAX_DATAGRAM - MessageHeader::SIZE - HEADER_SIZE) / RECORD_SIZE;
+
+  /// Payload bytes of a batch holding count readings.
+  static constexpr size_t payloadSize(size_t count) noexcept {
+    return HEADER_SIZE + count * RECORD_SIZE;
+  }
+};
+
+/**
+ * @brief Appends readings to a SENSOR_BATCH payload in a caller-owned buffer.
+ *
+ * The first reading fixes the base timestamp; a reading more than ~24 days
+ * away from it, or one that does not fit, is refused so the caller can
+ * flush and start a new batch.
+ */
+class SensorBatchWriter {
+ public:
+  /**
+   * @param out payload buffer (not including the MessageHeader).
+   * @param capacity bytes available at out.
+   */
+  SensorBatchWriter(uint8_t* out, size_t capacity) noexcept
+    : out_(out), capacity_(capacity), count_(0), base_(0) {}
+
+  /** @return false if the batch is full or reading is out of offset range. */
+  bool add(const SensorReading& reading) noexcept {
+    const size_t limit = capacity_ < SensorBatch::HEADER_SIZE ? 0
+                         : (capacity_ - SensorBatch::HEADER_SIZE) / SensorBatch::RECORD_SIZE;
+    if (count_ >= limit || count_ >= 255) return false;
+    if (count_ == 0) base_ = reading.timestampMs;
+
+    const int64_t offset = static_cast<int64_t>(reading.timestampMs - base_);
+    if (offset < INT32_MIN || offset > INT32_MAX) return false;
+
+    uint8_t* p = out_ + SensorBatch::payloadSize(count_);
+    putBE16(p, reading.sensorId);
+    putBE32(p + 2, static_cast<uint32_t>(static_cast<int32_t>(offset)));
+    const float fields[6] = {reading.distance, reading.temperature, reading.pressure,
+                             reading.altitude, reading.sealevelPressure, reading.realAltitude};
+    for (size_t i = 0; i < 6; ++i) {
+      uint32_t bits;
+      std::memcpy(&bits, &fields[i], 4);
+      putBE32(p + 6 + i * 4, bits);
+    }
+    ++count_;
+    return true;
+  }
+
+  size_t count() const noexcept { return count_; }
+  bool empty() const noexcept { return count_ == 0; }
+
+  /**
+   * @brief Writes the batch header and returns the payload size; 0 if empty.
+   */
+  size_t finish() noexcept {
+    if (count_ == 0) return 0;
+    for (int i = 0; i < 8; ++i) {
+      out_[i] = static_cast<uint8_t>(base_ >> (56 - 8 * i));
+    }
+    out_[8] = static_cast<uint8_t>(count_);
+    return SensorBatch::payloadSize(count_);
+  }
+
+  /// Starts a new, empty batch in the same buffer.
+  void reset() noexcept { count_ = 0; }
+
+ private:
+  uint8_t* out_;
+  size_t capacity_;
+  size_t count_;
+  uint64_t base_;
+
+  static void putBE16(uint8_t* p, uint16_t v) noexcept {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+  }
+  static void putBE32(uint8_t* p, uint32_t v) noexcept {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+  }
+};
+
+/**
+ * @brief Read-only view over a SENSOR_BATCH payload.
+ */
+class SensorBatchReader {
+ public:
+  /**
+   * @brief Validates the payload; count() is 0 when it is malformed.
+   */
+  SensorBatchReader(const uint8_t* payload, size_t len) noexcept
+    : data_(payload), count_(0), base_(0) {
+    if (len < SensorBatch::HEADER_SIZE) return;
+    for (int i = 0; i < 8; ++i) {
+      base_ = (base_ << 8) | payload[i];
+    }
+    const size_t count = payload[8];
+    if (len != SensorBatch::payloadSize(count)) return;
+    count_ = count;
+  }
+
+  bool valid() const noexcept { return count_ > 0; }
+  size_t count() const noexcept { return count_; }
+
+  SensorReading at(size_t i) const noexcept {
+    const uint8_t* p = data_ + SensorBatch::payloadSize(i);
+    SensorReading r;
+    r.sensorId = static_cast<uint16_t>((p[0] << 8) | p[1]);
+    r.timestampMs = base_ + static_cast<int64_t>(static_cast<int32_t>(getBE32(p + 2)));
+    float fields[6];
+    for (size_t k = 0; k < 6; ++k) {
+      const uint32_t bits = getBE32(p + 6 + k * 4);
+      std::memcpy(&fields[k], &bits, 4);
+    }
+    r.distance = fields[0];
+    r.temperature = fields[1];
+    r.pressure = fields[2];
+    r.altitude = fields[3];
+    r.sealevelPressure = fields[4];
+    r.realAltitude = fields[5];
+    return r;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t count_;
+  uint64_t base_;
+
+  static uint32_t getBE32(const uint8_t* p) noexcept {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+  }
+};
+
+#endif //SERVER_SENSORBATCH_H
@@ -7,6 +7,7 @@
 #include <cstring>
 #include <openssl/sha.h>
 #include <arpa/inet.h>
+#include "../interfaces/ReplyFrame.h"
 
 // Estructuras para mensajes DISCOVER 
 #pragma pack(push, 1)
@@ -61,8 +62,13 @@ bool AuthUDPServer::addUser(const std::string& username, const std::string& pass
     return true;
 }
 
-void AuthUDPServer::onReceive(const sockaddr_in& peer, const uint8_t* data, ssize_t len,
-                             std::string& out_response) {
+const DispatchTable<AuthUDPServer::MessageHandler> AuthUDPServer::routes({
+    {MessageKind::DISCOVER, &AuthUDPServer::handleDiscover},
+    {MessageKind::AUTH_REQUEST, &AuthUDPServer::handleAuthRequest},
+});
+
+void AuthUDPServer::onDatagram(const sockaddr_in& peer, const uint8_t* data, size_t len,
+                              ResponseBuffer& response) {
     char ipStr[INET_ADDRSTRLEN];
     inet_ntop(AF_INET, &peer.sin_addr, ipStr, sizeof(ipStr));
     uint16_t peerPort = ntohs(peer.sin_port);
@@ -70,17 +76,24 @@ void AuthUDPServer::onReceive(const sockaddr_in& peer, const uint8_t* data, ssiz
     std::cout << " AuthUDPServer: " << len << " bytes de " 
               << ipStr << ":" << peerPort << std::endl;
     
-    if (len == sizeof(DiscoverRequest)) {
-        handleDiscover(peer, data, len, out_response);
-    } else if (len == 50) { // Tamaño de AuthRequest
-        handleAuthRequest(peer, data, len, out_response);
-    } else {
-        std::cout << " Longitud no soportada: " << len << " bytes" << std::endl;
+    MessageView msg;
+    const MessageHandler handler = classify(data, len, msg) ? routes.find(msg.kind) : nullptr;
+    if (!handler) {
+        std::cout << " Mensaje no soportado: " << len << " bytes" << std::endl;
+        return;
     }
+
+    ReplyFrame frame(response, msg);
+    (this->*handler)(peer, msg.payload, msg.length, response);
 }
 
-void AuthUDPServer::handleDiscover(const sockaddr_in& peer, const uint8_t* data, ssize_t len, 
-                                  std::string& out_response) {
+void AuthUDPServer::handleDiscover(const sockaddr_in& peer, const uint8_t* data, size_t len,
+                                  ResponseBuffer& out_response) {
+    if (len != sizeof(DiscoverRequest)) {
+        std::cout << " DISCOVER con longitud inválida: " << len << " bytes" << std::endl;
+        return;
+    }
+
     const DiscoverRequest* discover = reinterpret_cast<const DiscoverRequest*>(data);
     char ipStr[INET_ADDRSTRLEN];
     inet_ntop(AF_INET, &peer.sin_addr, ipStr, sizeof(ipStr));
@@ -94,13 +107,18 @@ void AuthUDPServer::handleDiscover(const sockaddr_in& peer, const uint8_t* data,
     response.type = 1;
     response.status = 1;
 
-    out_response.assign(reinterpret_cast<const char*>(&response), sizeof(response));
+    out_response.append(&response, sizeof(response));
     
     std::cout << " DISCOVER_RESP enviado" << std::endl;
 }
 
-void AuthUDPServer::handleAuthRequest(const sockaddr_in& peer, const uint8_t* data, ssize_t len,
-                                     std::string& out_response) {
+void AuthUDPServer::handleAuthRequest(const sockaddr_in& peer, const uint8_t* data, size_t len,
+                                     ResponseBuffer& out_response) {
+    if (len != 50) { // Tamaño de AuthRequest
+        std::cout << " AUTH_REQUEST con longitud inválida: " << len << " bytes" << std::endl;
+        return;
+    }
+
     // Crear AuthRequest desde el buffer recibido
     std::array<uint8_t, 50> buffer;
     std::memcpy(buffer.data(), data, 50);
@@ -162,7 +180,7 @@ void AuthUDPServer::handleAuthRequest(const sockaddr_in& peer, const uint8_t* da
 
     // Serializar AuthResponse a buffer
     auto response_buffer = response.toBuffer();
-    out_response.assign(response_buffer.begin(), response_buffer.end());
+    out_response.append(response_buffer.data(), response_buffer.size());
     sendTo(peer, reinterpret_cast<const uint8_t*>(response_buffer.data()), response_buffer.size());
 
     
@@ -35,17 +35,22 @@ public:
                  const std::string& group, int permissions);
 
 protected:
-    void onReceive(const sockaddr_in& peer, const uint8_t* data, ssize_t len,
-                   std::string& out_response) override;
+    void onDatagram(const sockaddr_in& peer, const uint8_t* data, size_t len,
+                    ResponseBuffer& response) override;
 
 private:
+    // Manejador de un tipo de mensaje; data/len es el payload del mensaje
+    using MessageHandler = void (AuthUDPServer::*)(const sockaddr_in& peer, const uint8_t* data,
+                                                   size_t len, ResponseBuffer& out_response);
+    static const DispatchTable<MessageHandler> routes;
+
     void loadDefaultUsers();
     std::string hashPassword(const std::string& password);
     std::string generateSessionID();
-    void handleDiscover(const sockaddr_in& peer, const uint8_t* data, ssize_t len, 
-                       std::string& out_response);
-    void handleAuthRequest(const sockaddr_in& peer, const uint8_t* data, ssize_t len, 
-                          std::string& out_response);
+    void handleDiscover(const sockaddr_in& peer, const uint8_t* data, size_t len,
+                       ResponseBuffer& out_response);
+    void handleAuthRequest(const sockaddr_in& peer, const uint8_t* data, size_t len,
+                          ResponseBuffer& out_response);
 };
 
 #endif
\ No newline at end of file
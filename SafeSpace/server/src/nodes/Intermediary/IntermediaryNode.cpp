@@ -1,5 +1,6 @@
 #include "IntermediaryNode.h"
 #include "../../../common/LogManager.h"
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
@@ -9,10 +10,22 @@
 #include <netinet/in.h>
 #include <errno.h>
 #include <chrono>
+#include <random>
+
+namespace {
+// Espera por defecto antes de enviar un lote incompleto
+constexpr std::chrono::milliseconds DEFAULT_BATCH_LINGER{20};
+// Reenvío de un lote sin ACK_SENSOR: primera espera y tope del backoff
+constexpr std::chrono::milliseconds RETRY_AFTER{500};
+constexpr std::chrono::milliseconds MAX_RETRY_BACKOFF{8000};
+}
 
 IntermediaryNode::IntermediaryNode(int listen_port, const std::string& master_ip, int master_port)
     : listen_port_(listen_port), master_ip_(master_ip), master_port_(master_port),
-      listen_sock_(-1), running_(false) {
+      master_sock_(-1), listen_sock_(-1), running_(false),
+      batch_linger_(DEFAULT_BATCH_LINGER),
+      batch_writer_(batch_buffer_ + MessageHeader::SIZE, sizeof(batch_buffer_) - MessageHeader::SIZE),
+      batch_seq_(std::random_device{}()), batch_timer_(-1), retry_timer_(-1) {
     
     std::cout << "[IntermediaryNode] Configurado - Puerto: " << listen_port 
               << ", Master: " << master_ip << ":" << master_port << std::endl;
@@ -73,37 +86,19 @@ void IntermediaryNode::setupMasterConnection() {
               << master_ip_ << ":" << master_port_ << std::endl;
 }
 
-void IntermediaryNode::processSensorPacket(const SensorPacket& packet) {
+void IntermediaryNode::processSensorPacket(const SensorPacket& packet, const sockaddr_in& client_addr) {
     // Convertir de network byte order a host byte order
     int16_t temp_raw = ntohs(static_cast<uint16_t>(packet.temp_x100));
-    int16_t hum_raw = ntohs(static_cast<uint16_t>(packet.hum_x100));
     int16_t distance_raw = ntohs(static_cast<uint16_t>(packet.distance_x100));
     int32_t pressure_raw = ntohl(static_cast<uint32_t>(packet.pressure_pa));
     int16_t altitude_raw = ntohs(static_cast<uint16_t>(packet.altitude_x100));
     
     // Convertir a valores reales
     double temperature = static_cast<double>(temp_raw) / 100.0;
-    double humidity = static_cast<double>(hum_raw) / 100.0;
     double distance = static_cast<double>(distance_raw) / 100.0;
     double pressure = static_cast<double>(pressure_raw);
     double altitude = static_cast<double>(altitude_raw) / 100.0;
 
-    try {
-        auto& logger = LogManager::instance();
-        std::ostringstream logMsg;
-        logMsg << "IntermediaryNode received sensor data from ArduinoNode";
-        logger.info(logMsg.str());
-    } catch (const std::exception& ex) {
-        std::cerr << "[IntermediaryNode] Warning: Could not log data reception: " << ex.what() << std::endl;
-    }
-
-    std::cout << "[IntermediaryNode] Datos recibidos:" << std::endl;
-    std::cout << "  - Temperatura: " << temperature << " °C" << std::endl;
-    std::cout << "  - Humedad: " << humidity << " %" << std::endl;
-    std::cout << "  - Distancia: " << distance << " m" << std::endl;
-    std::cout << "  - Presión: " << pressure << " Pa" << std::endl;
-    std::cout << "  - Altitud: " << altitude << " m" << std::endl;
-
     // Crear objeto SensorData (usando los campos disponibles)
     // Nota: El paquete actual no incluye sealevelPressure ni realAltitude
     // Por ahora usamos los mismos valores o valores por defecto
@@ -116,16 +111,151 @@ void IntermediaryNode::processSensorPacket(const SensorPacket& packet) {
         altitude       // realAltitude (usamos altitude como placeholder)
     );
 
-    std::cout << "[IntermediaryNode] Preparado para enviar SensorData al Master_node:" << std::endl;
-    std::cout << "[IntermediaryNode] - Distancia: " << sensorData.distance << " m" << std::endl;
-    std::cout << "[IntermediaryNode] - Temperatura: " << sensorData.temperature << " °C" << std::endl;
-    std::cout << "[IntermediaryNode] - Presión: " << sensorData.pressure << " Pa" << std::endl;
-    std::cout << "[IntermediaryNode] - Altitud: " << sensorData.altitude << " m" << std::endl;
-    
+    // Sin lotes cada lectura es su propio datagrama; con lotes no se
+    // registra nada por lectura, solo por lote en flushBatch()
+    if (batch_linger_.count() == 0) {
+        if (sendToMaster(&sensorData, sizeof(SensorData))) {
+            std::cout << "[IntermediaryNode] SensorData enviado exitosamente al Master "
+                      << master_ip_ << ":" << master_port_ << std::endl;
+            logForwarded(1);
+        }
+        return;
+    }
+
+    // El id del sensor son los 16 bits bajos de la IP del ArduinoNode
+    SensorReading reading;
+    reading.sensorId = static_cast<uint16_t>(ntohl(client_addr.sin_addr.s_addr) & 0xFFFF);
+    reading.timestampMs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    reading.distance = sensorData.distance;
+    reading.temperature = sensorData.temperature;
+    reading.pressure = sensorData.pressure;
+    reading.altitude = sensorData.altitude;
+    reading.sealevelPressure = sensorData.sealevelPressure;
+    reading.realAltitude = sensorData.realAltitude;
+    queueReading(reading);
+}
+
+void IntermediaryNode::queueReading(const SensorReading& reading) {
+    if (!batch_writer_.add(reading)) {
+        // Lote lleno (o lectura fuera del rango de offsets): enviar y empezar otro
+        flushBatch();
+        batch_writer_.add(reading);
+    }
+
+    if (batch_writer_.count() >= SensorBatch::MAX_RECORDS) {
+        flushBatch();
+    } else if (batch_timer_ < 0) {
+        try {
+            batch_timer_ = loop_.addTimer(batch_linger_, [this] {
+                batch_timer_ = -1;
+                flushBatch();
+            }, false);
+        } catch (const std::exception& ex) {
+            // Sin timer no hay plazo garantizado: enviar ya
+            std::cerr << "[IntermediaryNode] " << ex.what() << std::endl;
+            flushBatch();
+        }
+    }
+}
+
+void IntermediaryNode::flushBatch() {
+    if (batch_timer_ >= 0) {
+        loop_.cancelTimer(batch_timer_);
+        batch_timer_ = -1;
+    }
+
+    const size_t readings = batch_writer_.count();
+    const size_t payload = batch_writer_.finish();
+    if (payload == 0) return;
+
+    MessageHeader header;
+    header.type = MessageKind::SENSOR_BATCH;
+    header.length = static_cast<uint16_t>(payload);
+    header.seq = ++batch_seq_;
+    header.encode(batch_buffer_);
+    batch_writer_.reset();
+
+    // Se guarda hasta el ACK_SENSOR aunque el envío falle: lo cubre el reenvío
+    if (unacked_.size() >= MAX_UNACKED) {
+        std::cerr << "[IntermediaryNode] " << unacked_.size() << " lotes sin ACK del Master; se descarta el lote "
+                  << unacked_.begin()->first << std::endl;
+        unacked_.erase(unacked_.begin());
+    }
+    UnackedBatch& pending = unacked_[header.seq];
+    pending.datagram.assign(batch_buffer_, batch_buffer_ + MessageHeader::SIZE + payload);
+    pending.backoff = RETRY_AFTER;
+    pending.due = std::chrono::steady_clock::now() + pending.backoff;
+
+    if (sendToMaster(batch_buffer_, MessageHeader::SIZE + payload)) {
+        std::cout << "[IntermediaryNode] Lote de " << readings << " lecturas enviado al Master "
+                  << master_ip_ << ":" << master_port_ << std::endl;
+        logForwarded(readings);
+    }
+}
+
+void IntermediaryNode::onMasterReadable() {
+    static const char ACK[] = "ACK_SENSOR";
+    for (;;) {
+        uint8_t buffer[BUFFER_SIZE];
+        sockaddr_in from{};
+        socklen_t from_len = sizeof(from);
+        const ssize_t n = recvfrom(master_sock_, buffer, sizeof(buffer), MSG_DONTWAIT,
+                                   reinterpret_cast<sockaddr*>(&from), &from_len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("recvfrom");
+            }
+            return;
+        }
+
+        // Solo los ACK enmarcados de un lote llevan el seq que hay que dar por confirmado
+        MessageHeader header;
+        if (from.sin_addr.s_addr != master_addr_.sin_addr.s_addr || from.sin_port != master_addr_.sin_port ||
+            !MessageHeader::decode(buffer, static_cast<size_t>(n), header) ||
+            !(header.flags & MessageHeader::FLAG_REPLY) || header.type != MessageKind::SENSOR_BATCH ||
+            header.length != sizeof(ACK) - 1 ||
+            std::memcmp(buffer + MessageHeader::SIZE, ACK, sizeof(ACK) - 1) != 0) {
+            continue;
+        }
+        unacked_.erase(header.seq);
+    }
+}
+
+void IntermediaryNode::retransmitBatches() {
+    const auto now = std::chrono::steady_clock::now();
+    size_t resent = 0;
+    for (auto& entry : unacked_) {
+        UnackedBatch& pending = entry.second;
+        if (pending.due > now) continue;
+        sendToMaster(pending.datagram.data(), pending.datagram.size());
+        pending.backoff = std::min(pending.backoff * 2, MAX_RETRY_BACKOFF);
+        pending.due = now + pending.backoff;
+        resent++;
+    }
+    if (resent > 0) {
+        std::cout << "[IntermediaryNode] " << resent << " lotes reenviados al Master ("
+                  << unacked_.size() << " sin ACK)" << std::endl;
+    }
+}
+
+void IntermediaryNode::logForwarded(size_t readings) {
+    try {
+        auto& logger = LogManager::instance();
+        logger.info("IntermediaryNode forwarded " + std::to_string(readings) +
+                    " sensor reading(s) to SafeSpaceServer at " + master_ip_ + ":" + std::to_string(master_port_));
+    } catch (const std::exception& ex) {
+        std::cerr << "[IntermediaryNode] Warning: Could not log forward success: " << ex.what() << std::endl;
+    }
+}
+
+bool IntermediaryNode::sendToMaster(const void* data, size_t len) {
     ssize_t sent = sendto(
       master_sock_,
-      reinterpret_cast<const void*>(&sensorData),
-      sizeof(SensorData),
+      data,
+      len,
       0,
       reinterpret_cast<const sockaddr*>(&master_addr_),
       sizeof(master_addr_)
@@ -140,74 +270,62 @@ void IntermediaryNode::processSensorPacket(const SensorPacket& packet) {
         } catch (const std::exception& ex) {
             std::cerr << "[IntermediaryNode] Warning: Could not log forward error: " << ex.what() << std::endl;
         }
-    } else {
-        std::cout << "[IntermediaryNode] SensorData enviado exitosamente al Master "
-                  << master_ip_ << ":" << master_port_ << std::endl;
-        try {
-            auto& logger = LogManager::instance();
-            logger.info("IntermediaryNode successfully forwarded sensor data to SafeSpaceServer at " + 
-                    master_ip_ + ":" + std::to_string(master_port_));
-        } catch (const std::exception& ex) {
-            std::cerr << "[IntermediaryNode] Warning: Could not log forward success: " << ex.what() << std::endl;
-        }
+        return false;
     }
+    return true;
 }
 
 void IntermediaryNode::workerThread() {
     std::cout << "[IntermediaryNode] Hilo de trabajo iniciado" << std::endl;
-    
+
+    // El socket se vigila con epoll: sin timeouts de sondeo, stop() despierta el loop
+    loop_.addReader(listen_sock_, [this](uint32_t) { onListenReadable(); });
+    loop_.addReader(master_sock_, [this](uint32_t) { onMasterReadable(); });
+    retry_timer_ = loop_.addTimer(RETRY_AFTER / 2, [this] { retransmitBatches(); });
+    loop_.run();
+    loop_.cancelTimer(retry_timer_);
+    retry_timer_ = -1;
+    loop_.removeFd(master_sock_);
+    loop_.removeFd(listen_sock_);
+
+    std::cout << "[IntermediaryNode] Hilo de trabajo terminado" << std::endl;
+}
+
+void IntermediaryNode::onListenReadable() {
+    // Vaciar lo que haya en cola; el loop vuelve a llamar si llega más
     while (running_) {
         char buffer[BUFFER_SIZE];
         sockaddr_in client_addr{};
         socklen_t client_len = sizeof(client_addr);
 
-        // Usar select para timeout y poder verificar running_
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(listen_sock_, &readfds);
-        
-        struct timeval timeout;
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
-
-        int activity = select(listen_sock_ + 1, &readfds, nullptr, nullptr, &timeout);
-        
-        if (activity < 0 && errno != EINTR) {
-            perror("select error");
-            break;
-        }
-        
-        if (!running_) break;
-        
-        if (activity > 0 && FD_ISSET(listen_sock_, &readfds)) {
-            // Recibir datos de Arduino_node
-            ssize_t n = recvfrom(listen_sock_, buffer, sizeof(buffer), 0,
-                               reinterpret_cast<sockaddr*>(&client_addr), &client_len);
-            
-            if (n < 0) {
+        // Recibir datos de Arduino_node
+        ssize_t n = recvfrom(listen_sock_, buffer, sizeof(buffer), MSG_DONTWAIT,
+                           reinterpret_cast<sockaddr*>(&client_addr), &client_len);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
                 perror("recvfrom");
-                continue;
             }
+            return;
+        }
+
+        // Verificar que tenemos un paquete completo (nuevo tamaño: 13 bytes)
+        if (n == sizeof(SensorPacket)) {
+            SensorPacket* packet = reinterpret_cast<SensorPacket*>(buffer);
 
-            // Verificar que tenemos un paquete completo (nuevo tamaño: 13 bytes)
-            if (n == sizeof(SensorPacket)) {
-                SensorPacket* packet = reinterpret_cast<SensorPacket*>(buffer);
-                
-                if (packet->msgId == 0x42) {  // SENSOR_DATA
-                    processSensorPacket(*packet);
-                } else {
-                    std::cerr << "[IntermediaryNode] ID de mensaje desconocido: 0x" 
-                              << std::hex << static_cast<int>(packet->msgId) << std::dec << std::endl;
-                }
+            if (packet->msgId == 0x42) {  // SENSOR_DATA
+                processSensorPacket(*packet, client_addr);
             } else {
-                std::cerr << "[IntermediaryNode] Paquete de tamaño incorrecto: " << n 
-                          << " bytes (esperaba " << sizeof(SensorPacket) << ")" << std::endl;
-                std::cerr << "[IntermediaryNode] ¿Está el ArduinoNode configurado en modo binary?" << std::endl;
+                std::cerr << "[IntermediaryNode] ID de mensaje desconocido: 0x"
+                          << std::hex << static_cast<int>(packet->msgId) << std::dec << std::endl;
             }
+        } else {
+            std::cerr << "[IntermediaryNode] Paquete de tamaño incorrecto: " << n
+                      << " bytes (esperaba " << sizeof(SensorPacket) << ")" << std::endl;
+            std::cerr << "[IntermediaryNode] ¿Está el ArduinoNode configurado en modo binary?" << std::endl;
         }
     }
-    
-    std::cout << "[IntermediaryNode] Hilo de trabajo terminado" << std::endl;
 }
 
 bool IntermediaryNode::start() {
@@ -258,10 +376,18 @@ void IntermediaryNode::stop() {
     
     std::cout << "[IntermediaryNode] Deteniendo..." << std::endl;
     running_ = false;
+    loop_.stop();
     
     if (worker_thread_.joinable()) {
         worker_thread_.join();
     }
+
+    // Lo que quedó en el lote sale antes de cerrar el socket
+    flushBatch();
+    if (!unacked_.empty()) {
+        std::cerr << "[IntermediaryNode] " << unacked_.size()
+                  << " lotes sin ACK del Master al detener" << std::endl;
+    }
     
     if (listen_sock_ != -1) {
         close(listen_sock_);
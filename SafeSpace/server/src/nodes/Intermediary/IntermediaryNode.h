@@ -4,11 +4,16 @@
 #include <string>
 #include <atomic>
 #include <thread>
+#include <chrono>
+#include <map>
+#include <vector>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "SensorPacket.h"
+#include "../interfaces/EventLoop.h"
 
 #include "../../model/structures/sensordata.h"
+#include "../../model/structures/SensorBatch.h"
 
 class IntermediaryNode {
 private:
@@ -20,14 +25,41 @@ private:
     int listen_sock_;
     std::atomic<bool> running_;
     std::thread worker_thread_;
+    EventLoop loop_;           ///< Reactor del hilo de trabajo; stop() lo despierta al instante
     
     static const int BUFFER_SIZE = 1024;
 
+    // Lote SENSOR_BATCH en curso (solo lo toca el hilo de trabajo, y stop() tras el join)
+    std::chrono::milliseconds batch_linger_;
+    uint8_t batch_buffer_[SensorBatch::MAX_DATAGRAM];
+    SensorBatchWriter batch_writer_;
+    uint32_t batch_seq_;       ///< Arranca al azar: el Master filtra reenvíos por ip:puerto y seq
+    int batch_timer_;          ///< Timer de linger pendiente, -1 si no hay
+
+    // Lotes enviados que el Master todavía no confirmó con ACK_SENSOR, por seq
+    struct UnackedBatch {
+        std::vector<uint8_t> datagram;
+        std::chrono::steady_clock::time_point due;   ///< Próximo reenvío
+        std::chrono::milliseconds backoff;
+    };
+    std::map<uint32_t, UnackedBatch> unacked_;
+    int retry_timer_;          ///< Timer de reenvíos, -1 si no está armado
+    static const size_t MAX_UNACKED = 1024;   ///< Tope de lotes guardados (~1,5 MB)
+
     // Métodos privados
     bool createUdpSocket();
     void setupMasterConnection();
-    void processSensorPacket(const SensorPacket& packet);
+    void processSensorPacket(const SensorPacket& packet, const sockaddr_in& client_addr);
+    void queueReading(const SensorReading& reading);
+    void flushBatch();
+    // Una entrada de bitácora por datagrama enviado, no por lectura
+    void logForwarded(size_t readings);
+    bool sendToMaster(const void* data, size_t len);
+    // ACK_SENSOR del Master: el lote de ese seq ya tiene quórum
+    void onMasterReadable();
+    void retransmitBatches();
     void workerThread();
+    void onListenReadable();
 
 public:
     IntermediaryNode(int listen_port, const std::string& master_ip, int master_port);
@@ -35,6 +67,16 @@ public:
     
     bool start();
     void stop();
+
+    /**
+     * @brief Tiempo máximo que una lectura espera en el lote antes de enviarse.
+     *
+     * Las lecturas se agrupan en un datagrama SENSOR_BATCH que sale al llenarse
+     * o al vencer este plazo. 0 desactiva el agrupado y envía cada lectura
+     * como SensorData suelto (formato anterior), que al no llevar seq
+     * tampoco se reenvía si el Master no lo confirma. Llamar antes de start().
+     */
+    void setBatchLinger(std::chrono::milliseconds linger) { batch_linger_ = linger; }
     bool isRunning() const { return running_; }
 };
 
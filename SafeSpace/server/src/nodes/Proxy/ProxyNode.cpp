@@ -1,4 +1,5 @@
 #include "ProxyNode.h"
+#include "../interfaces/ReplyFrame.h"
 #include "../../common/LogManager.h"
 #include "../../model/structures/DiscoverRequest.h"
 #include "../../model/structures/DiscoverResponse.h"
@@ -12,6 +13,7 @@
 #include "authenticationresponse.h"
 #include "connectrequest.h"
 #include "sensordata.h"
+#include "SensorBatch.h"
 
 const size_t BUFFER_SIZE = 2048;
 
@@ -22,7 +24,7 @@ ProxyNode::ProxyNode(
 ) : UDPServer(ip, proxyPort, BUFFER_SIZE),
     authNode(nullptr, authServerIp, authServerPort),
     masterNode(nullptr, masterServerIp, masterServerPort),
-    listening(false) {
+    authBuffer(BUFFER_SIZE) {
   try {
     this->logger.configureRemote(masterNode.ip, masterNode.port, "ProxyNode");
     this->logger.info("ProxyNode configured to forward logs to SafeSpaceServer at " +
@@ -50,10 +52,8 @@ ProxyNode::ProxyNode(
 
 ProxyNode::~ProxyNode() {
   this->logger.info("ProxyNode shutting down...");
-  listening.store(false);
-
-  if (listenerThread.joinable()) {
-    listenerThread.join();
+  if (this->authNode.client) {
+    this->eventLoop().removeFd(this->authNode.client->getSocketFd());
   }
 
   delete this->authNode.client;
@@ -68,40 +68,40 @@ void ProxyNode::start() {
     this->logger.error("Cannot start ProxyNode: auth client not initialized");
     throw std::runtime_error("Auth client not initialized");
   }
-  // Starts the listener
-  listening.store(true);
-  listenerThread = std::thread(&ProxyNode::listenAuthServerResponses, this);
+  // Auth responses are serviced by the same loop as client datagrams
+  this->eventLoop().addReader(this->authNode.client->getSocketFd(),
+                              [this](uint32_t) { this->onAuthServerReadable(); });
 
   // Logs that the proxy has been initialized.
-  this->logger.info("ProxyNode authentication listener started");
+  this->logger.info("ProxyNode authentication listener registered");
   this->serveBlocking();
-
-  listening.store(false);
 }
 
-void ProxyNode::onReceive(const sockaddr_in &peer, const uint8_t *data,
-                          ssize_t len, std::string &out_response) {
-  try {
-    if (len == sizeof(ConnectRequest))
-      return this->handleConnectRequest(peer, data, len, out_response);
-
-    if (len == 50)
-      return this->handleAuthRequest(peer, data, len, out_response);
-
-    if (len == sizeof(SensorData))
-      return this->handleSensorData(peer, data, len, out_response);
+const DispatchTable<ProxyNode::MessageHandler> ProxyNode::routes({
+  {MessageKind::CONNECT, &ProxyNode::handleConnectRequest},
+  {MessageKind::AUTH_REQUEST, &ProxyNode::handleAuthRequest},
+  {MessageKind::SENSOR_DATA, &ProxyNode::handleSensorData},
+  {MessageKind::SENSOR_BATCH, &ProxyNode::handleSensorBatch},
+  {MessageKind::LOG, &ProxyNode::handleLogMessage},
+});
 
-    if (len >= 5 && data[0] == 'L' && data[1] == 'O' && data[2] == 'G')
-      return this->handleLogMessage(peer, data, len);
+void ProxyNode::onDatagram(const sockaddr_in &peer, const uint8_t *data,
+                           size_t size, ResponseBuffer &response) {
+  try {
+    MessageView msg;
+    const MessageHandler handler = this->classify(data, size, msg) ? routes.find(msg.kind) : nullptr;
+    if (!handler)
+      return this->handleUnknownMessage(peer, data, static_cast<ssize_t>(size), response);
 
-    this->handleUnknownMessage(peer, data, len, out_response);
+    ReplyFrame frame(response, msg);
+    (this->*handler)(peer, msg.payload, static_cast<ssize_t>(msg.length), response);
   } catch (const std::exception &ex) {
     this->logger.error(std::string("Error handling packet: ") + ex.what());
   }
 }
 
 void ProxyNode::handleConnectRequest(const sockaddr_in &peer, const uint8_t *data,
-                                     ssize_t len, std::string &out_response) {
+                                     ssize_t len, ResponseBuffer &response) {
   if (len < 6) {
     this->logger.warning("CONNECT_REQUEST too short (" + std::to_string(len) + " bytes)");
     return;
@@ -124,26 +124,24 @@ void ProxyNode::handleConnectRequest(const sockaddr_in &peer, const uint8_t *dat
 
   if (!this->isClientAuthenticated(sessionId)) {
     this->logger.warning("Unauthorized CONNECT_REQUEST (sessionId=" + std::to_string(sessionId) + ")");
-    out_response = "UNAUTHORIZED";
+    response.append("UNAUTHORIZED");
     return;
   }
 
   this->registerSubscriber(peer, sessionId);
 
-  out_response = "SUBSCRIBED_OK";
+  response.append("SUBSCRIBED_OK");
 }
 
 void ProxyNode::handleAuthRequest(const sockaddr_in &peer, const uint8_t *data,
-                                  ssize_t len, std::string &out_response) {
-  std::array<uint8_t, 50> payload{};
-  std::memcpy(payload.data(), data, 50);
-
-  AuthRequest req;
-  req.setSessionId((payload[0] << 8) | payload[1]);
-  req.setUsername(std::string(reinterpret_cast<const char *>(payload.data() + 2), AuthRequest::USERNAME_SIZE));
-  req.setPassword(std::string(reinterpret_cast<const char *>(payload.data() + 18), AuthRequest::PASSWORD_SIZE));
+                                  ssize_t len, ResponseBuffer &response) {
+  if (len != 50) {
+    this->logger.warning("AUTH_REQUEST invalid length (" + std::to_string(len) + " bytes)");
+    return;
+  }
 
-  const uint16_t sessionId = req.getSessionId();
+  // The request is forwarded verbatim; only the session id is needed here.
+  const uint16_t sessionId = static_cast<uint16_t>((data[0] << 8) | data[1]);
   if (this->isClientAuthenticated(sessionId)) {
     this->logger.info("AUTH_REQUEST ignored: session already authenticated (sessionId=" +
                   std::to_string(sessionId) + ")");
@@ -167,17 +165,44 @@ void ProxyNode::handleAuthRequest(const sockaddr_in &peer, const uint8_t *data,
 }
 
 void ProxyNode::handleSensorData(const sockaddr_in &peer, const uint8_t *data,
-                                 ssize_t len, std::string &out_response) {
+                                 ssize_t len, ResponseBuffer &response) {
+  if (len != sizeof(SensorData)) {
+    this->logger.warning("SENSOR_DATA invalid length (" + std::to_string(len) + " bytes)");
+    return;
+  }
+
   const auto *pkt = reinterpret_cast<const SensorData *>(data);
   this->logger.info(
     "Received SENSOR_DATA: Temp=" + std::to_string(pkt->temperature) +
     " Dist=" + std::to_string(pkt->distance)
     );
   this->broadcastToSubscribers(data, len);
-  out_response = "ACK_SENSOR";
+  response.append("ACK_SENSOR");
 }
 
-void ProxyNode::handleLogMessage(const sockaddr_in &peer, const uint8_t *data, ssize_t len) {
+void ProxyNode::handleSensorBatch(const sockaddr_in &, const uint8_t *data,
+                                  ssize_t len, ResponseBuffer &response) {
+  const SensorBatchReader batch(data, static_cast<size_t>(len));
+  if (!batch.valid()) {
+    this->logger.warning("SENSOR_BATCH malformed (" + std::to_string(len) + " bytes)");
+    return;
+  }
+
+  this->logger.info("Received SENSOR_BATCH with " + std::to_string(batch.count()) + " readings");
+  // Subscribers still speak the single-reading format
+  for (size_t i = 0; i < batch.count(); ++i) {
+    const SensorData reading = batch.at(i).toSensorData();
+    this->broadcastToSubscribers(reinterpret_cast<const uint8_t *>(&reading), sizeof(reading));
+  }
+  response.append("ACK_SENSOR");
+}
+
+void ProxyNode::handleLogMessage(const sockaddr_in &peer, const uint8_t *data, ssize_t len,
+                                 ResponseBuffer &) {
+  if (len < 5) {
+    return;
+  }
+
   uint8_t level = data[3];
   uint8_t nodeLen = data[4];
 
@@ -192,9 +217,9 @@ void ProxyNode::handleLogMessage(const sockaddr_in &peer, const uint8_t *data, s
 }
 
 void ProxyNode::handleUnknownMessage(const sockaddr_in &peer, const uint8_t *data,
-                                     ssize_t len, std::string &out_response) {
+                                     ssize_t len, ResponseBuffer &response) {
   this->logger.warning("Unknown message type (" + std::to_string(len) + " bytes)");
-  UDPServer::onReceive(peer, data, len, out_response);
+  UDPServer::onDatagram(peer, data, static_cast<size_t>(len), response);
 }
 
 void ProxyNode::registerSubscriber(const sockaddr_in &addr, uint16_t sessionId) {
@@ -253,33 +278,26 @@ void ProxyNode::forwardToMasterServer(const uint8_t *data, size_t len) {
   }
 }
 
-void ProxyNode::listenAuthServerResponses() {
-  this->logger.info("Auth server listener thread started (ID=" +
-                    std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ")");
-  std::vector<uint8_t> buffer(BUFFER_SIZE);
-
-  while (listening.load()) {
+void ProxyNode::onAuthServerReadable() {
+  // level-triggered: drain what is queued now, the loop calls back for the rest
+  for (;;) {
     sockaddr_in authAddr{};
     socklen_t addrLen = sizeof(authAddr);
 
-    ssize_t received = this->receiveFromAuthServer(buffer, authAddr, addrLen);
-    if (received <= 0) continue;
+    ssize_t received = this->receiveFromAuthServer(authBuffer, authAddr, addrLen);
+    if (received < 0) break;
+    if (received == 0) continue;
 
-    this->processAuthServerResponse(buffer, static_cast<size_t>(received), authAddr);
+    this->processAuthServerResponse(authBuffer, static_cast<size_t>(received), authAddr);
   }
-
-  this->logger.info("Auth server response listener stopped.");
 }
 
 ssize_t ProxyNode::receiveFromAuthServer(std::vector<uint8_t>& buffer, sockaddr_in& authAddr, socklen_t& addrLen) {
-  struct timeval tv {1, 0};
-  setsockopt(this->authNode.client->getSocketFd(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-
   ssize_t received = ::recvfrom(
     this->authNode.client->getSocketFd(),
     buffer.data(),
     buffer.size(),
-    0,
+    MSG_DONTWAIT,
     reinterpret_cast<sockaddr*>(&authAddr),
     &addrLen
   );
@@ -6,8 +6,8 @@
 #include <mutex>
 #include <unordered_map>
 #include <arpa/inet.h>
-#include <thread>
 #include <utility>
+#include <vector>
 
 #include "SensorPacket.h"
 
@@ -60,8 +60,12 @@ private:
     uint8_t msgId;
   };
 
-  std::atomic<bool> listening;               ///< Flag controlling listener thread state.
-  std::thread listenerThread;                ///< Thread handling incoming auth server responses.
+  /// Handler of one message kind; data/len is the message payload.
+  using MessageHandler = void (ProxyNode::*)(const sockaddr_in &peer, const uint8_t *data,
+                                             ssize_t len, ResponseBuffer &response);
+  static const DispatchTable<MessageHandler> routes; ///< Message kind -> handler, see ProxyNode.cpp.
+
+  std::vector<uint8_t> authBuffer;           ///< Receive buffer for auth server responses (event loop thread only).
 
   std::mutex clientsMutex;                   ///< Synchronization for pending clients map.
   std::unordered_map<uint16_t, ClientInfo> pendingClients; ///< Map of sessionId to client info.
@@ -96,8 +100,9 @@ public:
   /**
    * @brief Starts the proxy node operation.
    *
-   * Launches the listener thread for authentication server responses and
-   * begins the blocking UDP server loop.
+   * Registers the authentication server socket on the server's event loop and
+   * begins the blocking UDP server loop; auth responses are handled on the
+   * same thread as client datagrams.
    */
   void start();
 
@@ -107,10 +112,10 @@ protected:
    * @param peer Sender socket address.
    * @param data Raw datagram data.
    * @param len Length of the datagram.
-   * @param out_response Output string for optional immediate response.
+   * @param response Send buffer view for an optional immediate response.
    */
-  void onReceive(const sockaddr_in &peer, const uint8_t *data, ssize_t len,
-                 std::string &out_response) override;
+  void onDatagram(const sockaddr_in &peer, const uint8_t *data, size_t len,
+                  ResponseBuffer &response) override;
 
 private:
   /**
@@ -118,48 +123,60 @@ private:
    * @param peer Sender address.
    * @param data Raw packet data.
    * @param len Packet length.
-   * @param out_response Response string (e.g., "SUBSCRIBED_OK").
+   * @param response Response buffer (e.g., "SUBSCRIBED_OK").
    */
   void handleConnectRequest(const sockaddr_in &peer, const uint8_t *data,
-                            ssize_t len, std::string &out_response);
+                            ssize_t len, ResponseBuffer &response);
 
   /**
    * @brief Handles incoming authentication requests and forwards them to AuthNode.
    * @param peer Sender address.
    * @param data Raw packet data.
    * @param len Packet length.
-   * @param out_response Output response (empty, as forwarding is asynchronous).
+   * @param response Output response (empty, as forwarding is asynchronous).
    */
   void handleAuthRequest(const sockaddr_in &peer, const uint8_t *data,
-                         ssize_t len, std::string &out_response);
+                         ssize_t len, ResponseBuffer &response);
 
   /**
    * @brief Handles sensor data packets and broadcasts to all subscribers.
    * @param peer Sender address.
    * @param data Raw sensor packet.
    * @param len Packet length.
-   * @param out_response ACK response to sender.
+   * @param response ACK response to sender.
    */
   void handleSensorData(const sockaddr_in &peer, const uint8_t *data,
-                        ssize_t len, std::string &out_response);
+                        ssize_t len, ResponseBuffer &response);
+
+  /**
+   * @brief Handles a SENSOR_BATCH relayed by the master; broadcasts each reading.
+   * @param peer Sender address (unused).
+   * @param data Batch payload (see SensorBatch.h).
+   * @param len Payload length.
+   * @param response ACK response to sender.
+   */
+  void handleSensorBatch(const sockaddr_in &peer, const uint8_t *data,
+                         ssize_t len, ResponseBuffer &response);
 
   /**
    * @brief Handles log messages received from AuthNode and forwards to master.
    * @param peer Sender address (unused).
    * @param data Raw log packet data.
    * @param len Packet length.
+   * @param response Left empty; logs are not acknowledged.
    */
-  void handleLogMessage(const sockaddr_in &peer, const uint8_t *data, ssize_t len);
+  void handleLogMessage(const sockaddr_in &peer, const uint8_t *data, ssize_t len,
+                        ResponseBuffer &response);
 
   /**
    * @brief Fallback handler for unknown message formats.
    * @param peer Sender address.
    * @param data Raw packet data.
    * @param len Packet length.
-   * @param out_response Default echo or warning message.
+   * @param response Default echo or warning message.
    */
   void handleUnknownMessage(const sockaddr_in &peer, const uint8_t *data,
-                            ssize_t len, std::string &out_response);
+                            ssize_t len, ResponseBuffer &response);
 
   /**
    * @brief Forwards a datagram to the authentication server.
@@ -176,18 +193,18 @@ private:
   void forwardToMasterServer(const uint8_t *data, size_t len);
 
   /**
-   * @brief Listens continuously for authentication server responses.
+   * @brief Event loop callback for the authentication server socket.
    *
-   * Runs in a dedicated thread, dispatching valid responses for processing.
+   * Drains every queued response without blocking and dispatches each one.
    */
-  void listenAuthServerResponses();
+  void onAuthServerReadable();
 
   /**
-   * @brief Receives data from the authentication server socket.
+   * @brief Receives one datagram from the authentication server socket without blocking.
    * @param buffer Destination buffer.
    * @param authAddr Output address of the sender.
    * @param addrLen Size of the sockaddr_in structure.
-   * @return ssize_t Number of bytes received, or -1 on timeout/error.
+   * @return ssize_t Number of bytes received, or -1 when nothing is queued or on error.
    */
   ssize_t receiveFromAuthServer(std::vector<uint8_t>& buffer, sockaddr_in& authAddr, socklen_t& addrLen);
 
@@ -8,6 +8,8 @@
 #include "sensordata.h"
 #include "../../../common/LogManager.h"
 #include "SensorPacket.h"
+#include "interfaces/ReplyFrame.h"
+#include "../model/structures/SensorBatch.h"
 
 enum class LogLevel;
 
@@ -15,11 +17,19 @@ SafeSpaceServer::SafeSpaceServer(const std::string& ip, const uint16_t port,
                                  const std::string& storageIp, const uint16_t storagePort,
                                  const std::string& eventsIp, const uint16_t eventsPort,
                                  const std::string& proxyIp, const uint16_t proxyPort)
+  : SafeSpaceServer(ip, port, std::vector<StorageReplicas::Endpoint>{{storageIp, storagePort}},
+                    eventsIp, eventsPort, proxyIp, proxyPort) {}
+
+SafeSpaceServer::SafeSpaceServer(const std::string& ip, const uint16_t port,
+                                 const std::vector<StorageReplicas::Endpoint>& storage,
+                                 const std::string& eventsIp, const uint16_t eventsPort,
+                                 const std::string& proxyIp, const uint16_t proxyPort)
   : UDPServer(ip, port, 2048)
-  , storageNode(nullptr, storageIp, storagePort)
+  , storage_(std::make_unique<StorageReplicas>(eventLoop(), storage))
   , eventsNode(nullptr, eventsIp, eventsPort)
   , proxyNode(nullptr, proxyIp, proxyPort) {
   std::cout << "SafeSpaceServer: initialized on port " << port << std::endl;
+  storage_->setCommitHandler([this](uint32_t seq) { onStorageCommit(seq); });
   
   // Configurar LogManager para enviar logs a CriticalEventsNode
   auto& logger = LogManager::instance();
@@ -32,10 +42,8 @@ SafeSpaceServer::SafeSpaceServer(const std::string& ip, const uint16_t port,
     // criticalThread_ = std::thread([this]() {
     //   if (criticalEventsNode_) criticalEventsNode_->serveBlocking();
     // });
-    if (!storageNode.client) {
-      storageNode.client = new UDPClient(storageNode.ip, storageNode.port);
-      std::cout << "[SafeSpaceServer] Created Storage UDP client to "
-                << storageNode.ip << ":" << storageNode.port << std::endl;
+    for (const auto& replica : storage) {
+      std::cout << "[SafeSpaceServer] Storage replica " << replica.ip << ":" << replica.port << std::endl;
     }
 
     if (!proxyNode.client) {
@@ -82,143 +90,261 @@ void SafeSpaceServer::clearDiscoverTargets() {
   discoverTargets_.clear();
 }
 
-void SafeSpaceServer::onReceive(
+const DispatchTable<SafeSpaceServer::MessageHandler> SafeSpaceServer::routes({
+  {MessageKind::LOG, &SafeSpaceServer::handleLog},
+  {MessageKind::DISCOVER, &SafeSpaceServer::handleDiscover},
+  {MessageKind::DISCOVER_RESPONSE, &SafeSpaceServer::handleDiscoverResponse},
+  {MessageKind::SENSOR_DATA, &SafeSpaceServer::handleSensorData},
+  {MessageKind::SENSOR_BATCH, &SafeSpaceServer::handleSensorBatch},
+});
+
+void SafeSpaceServer::onDatagram(
   const sockaddr_in& peer, const uint8_t* data,
-  ssize_t len, std::string& out_response) {
-  // Verificar si es un log del LogManager (empieza con "LOG")
-  if (len >= 5 && data[0] == 'L' && data[1] == 'O' && data[2] == 'G') {
-    // Es un log del AuthNode, reenviarlo al master
-    auto& logger = LogManager::instance();
+  size_t size, ResponseBuffer& response) {
+  MessageView msg;
+  const MessageHandler handler = classify(data, size, msg) ? routes.find(msg.kind) : nullptr;
+  if (!handler) {
+    // Fallback: let base class behavior handle it (echo)
+    UDPServer::onDatagram(peer, data, size, response);
+    return;
+  }
 
-    // Parsear el nivel de log
-    uint8_t level = data[3];
-    uint8_t nodeNameLen = data[4];
+  ReplyFrame frame(response, msg);
+  (this->*handler)(peer, msg, response);
+}
 
-    if (len >= 5 + nodeNameLen) {
-      std::string nodeName(reinterpret_cast<const char*>(data + 5), nodeNameLen);
-      std::string message(reinterpret_cast<const char*>(data + 5 + nodeNameLen), len - 5 - nodeNameLen);
+void SafeSpaceServer::handleLog(
+  const sockaddr_in&, const MessageView& msg, ResponseBuffer&) {
+  // Log del LogManager: "LOG" + nivel + largo del nodo + nodo + mensaje
+  const uint8_t* data = msg.payload;
+  const size_t len = msg.length;
+  if (len < 5) {
+    return;
+  }
 
-      // Reenviar log al master con prefijo [FROM_AUTH]
-      LogLevel logLevel = static_cast<LogLevel>(level);
-      logger.log(logLevel, "[FROM_" + nodeName + "] " + message);
+  // Es un log del AuthNode, reenviarlo al master
+  auto& logger = LogManager::instance();
 
-      std::cout << "[SafeSpaceServer] Forwarded log from " << nodeName << " to CriticalEventsNode" << std::endl;
-    }
-    return; // No generar respuesta para logs
+  // Parsear el nivel de log
+  uint8_t level = data[3];
+  uint8_t nodeNameLen = data[4];
+
+  if (len >= 5u + nodeNameLen) {
+    std::string nodeName(reinterpret_cast<const char*>(data + 5), nodeNameLen);
+    std::string message(reinterpret_cast<const char*>(data + 5 + nodeNameLen), len - 5 - nodeNameLen);
+
+    // Reenviar log al master con prefijo [FROM_AUTH]
+    LogLevel logLevel = static_cast<LogLevel>(level);
+    logger.log(logLevel, "[FROM_" + nodeName + "] " + message);
+
+    std::cout << "[SafeSpaceServer] Forwarded log from " << nodeName << " to CriticalEventsNode" << std::endl;
   }
+  // No generar respuesta para logs
+}
 
-  // DISCOVER (2 bytes)
-  if (len == 2) {
-    std::array<uint8_t, 2> a = { data[0], data[1] };
-    DiscoverRequest d = DiscoverRequest::fromBytes(a);
-    std::cout << "SafeSpaceServer: DISCOVER from msg_id=" << static_cast<int>(d.msgId()) << std::endl;
+void SafeSpaceServer::handleDiscover(
+  const sockaddr_in& peer, const MessageView& msg, ResponseBuffer&) {
+  const uint8_t* data = msg.payload;
+  const size_t len = msg.length;
+  if (len != 2) {
+    std::cerr << "SafeSpaceServer: DISCOVER with invalid length " << len << std::endl;
+    return;
+  }
 
-    // Remember original requester to forward future responses for this msg_id
-    {
-      std::lock_guard<std::mutex> lg(pendingMutex_);
-      pendingRequesters_[d.msgId()] = peer;
-    }
+  std::array<uint8_t, 2> a = { data[0], data[1] };
+  DiscoverRequest d = DiscoverRequest::fromBytes(a);
+  std::cout << "SafeSpaceServer: DISCOVER from msg_id=" << static_cast<int>(d.msgId()) << std::endl;
 
-    // Forward raw bytes to all registered discover targets
-    std::lock_guard<std::mutex> lg(targetsMutex_);
-    for (const auto& target : discoverTargets_) {
-      ssize_t sent = ::sendto(sockfd_,
-                              reinterpret_cast<const void*>(data),
-                              static_cast<socklen_t>(len),
-                              0,
-                              reinterpret_cast<const sockaddr*>(&target),
-                              sizeof(target));
-      if (sent < 0) {
-        std::cerr << "SafeSpaceServer: forward to target failed: " << std::strerror(errno) << std::endl;
-      } else {
-        char ipbuf[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &target.sin_addr, ipbuf, sizeof(ipbuf));
-        std::cout << "SafeSpaceServer: forwarded DISCOVER msg_id=" << static_cast<int>(d.msgId())
-                  << " to " << ipbuf << ":" << ntohs(target.sin_port) << std::endl;
-      }
+  // Remember original requester to forward future responses for this msg_id
+  {
+    std::lock_guard<std::mutex> lg(pendingMutex_);
+    pendingRequesters_[d.msgId()] = peer;
+  }
+
+  // Forward raw bytes to all registered discover targets
+  std::lock_guard<std::mutex> lg(targetsMutex_);
+  for (const auto& target : discoverTargets_) {
+    ssize_t sent = ::sendto(sockfd_,
+                            reinterpret_cast<const void*>(data),
+                            static_cast<socklen_t>(len),
+                            0,
+                            reinterpret_cast<const sockaddr*>(&target),
+                            sizeof(target));
+    if (sent < 0) {
+      std::cerr << "SafeSpaceServer: forward to target failed: " << std::strerror(errno) << std::endl;
+    } else {
+      char ipbuf[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &target.sin_addr, ipbuf, sizeof(ipbuf));
+      std::cout << "SafeSpaceServer: forwarded DISCOVER msg_id=" << static_cast<int>(d.msgId())
+                << " to " << ipbuf << ":" << ntohs(target.sin_port) << std::endl;
     }
+  }
+
+  // No immediate response to the original requester from this server; leave the response empty.
+}
 
-    // No immediate response to the original requester from this server; leave out_response empty.
-    out_response.clear();
+void SafeSpaceServer::handleDiscoverResponse(
+  const sockaddr_in&, const MessageView& msg, ResponseBuffer&) {
+  const uint8_t* data = msg.payload;
+  const size_t len = msg.length;
+  if (len != 4) {
+    std::cerr << "SafeSpaceServer: DISCOVER_RESP with invalid length " << len << std::endl;
     return;
   }
 
-  // DISCOVER_RESP (4 bytes)
-  if (len == 4) {
-    std::array<uint8_t, 4> a = { data[0], data[1], data[2], data[3] };
-    DiscoverResponse resp = DiscoverResponse::fromBytes(a);
-    uint8_t mid = resp.msgId();
-    std::cout << "SafeSpaceServer: DISCOVER_RESP msg_id=" << static_cast<int>(mid) << std::endl;
-
-    sockaddr_in requester{};
-    bool found = false;
-    {
-      std::lock_guard<std::mutex> lg(pendingMutex_);
-      auto it = pendingRequesters_.find(mid);
-      if (it != pendingRequesters_.end()) {
-        requester = it->second;
-        // Optionally remove mapping (one-shot)
-        pendingRequesters_.erase(it);
-        found = true;
-      }
+  std::array<uint8_t, 4> a = { data[0], data[1], data[2], data[3] };
+  DiscoverResponse resp = DiscoverResponse::fromBytes(a);
+  uint8_t mid = resp.msgId();
+  std::cout << "SafeSpaceServer: DISCOVER_RESP msg_id=" << static_cast<int>(mid) << std::endl;
+
+  sockaddr_in requester{};
+  bool found = false;
+  {
+    std::lock_guard<std::mutex> lg(pendingMutex_);
+    auto it = pendingRequesters_.find(mid);
+    if (it != pendingRequesters_.end()) {
+      requester = it->second;
+      // Optionally remove mapping (one-shot)
+      pendingRequesters_.erase(it);
+      found = true;
     }
+  }
 
-    if (found) {
-      // forward raw response bytes back to original requester
-      ssize_t sent = ::sendto(sockfd_,
-                              reinterpret_cast<const void*>(data),
-                              static_cast<socklen_t>(len),
-                              0,
-                              reinterpret_cast<const sockaddr*>(&requester),
-                              sizeof(requester));
-      if (sent < 0) {
-        std::cerr << "SafeSpaceServer: forward response to requester failed: " << std::strerror(errno) << std::endl;
-      } else {
-        char ipbuf[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &requester.sin_addr, ipbuf, sizeof(ipbuf));
-        std::cout << "SafeSpaceServer: forwarded DISCOVER_RESP msg_id=" << static_cast<int>(mid)
-                  << " to original requester " << ipbuf << ":" << ntohs(requester.sin_port) << std::endl;
-      }
+  if (found) {
+    // forward raw response bytes back to original requester
+    ssize_t sent = ::sendto(sockfd_,
+                            reinterpret_cast<const void*>(data),
+                            static_cast<socklen_t>(len),
+                            0,
+                            reinterpret_cast<const sockaddr*>(&requester),
+                            sizeof(requester));
+    if (sent < 0) {
+      std::cerr << "SafeSpaceServer: forward response to requester failed: " << std::strerror(errno) << std::endl;
     } else {
-      std::cout << "SafeSpaceServer: no pending requester for msg_id=" << static_cast<int>(mid) << std::endl;
+      char ipbuf[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &requester.sin_addr, ipbuf, sizeof(ipbuf));
+      std::cout << "SafeSpaceServer: forwarded DISCOVER_RESP msg_id=" << static_cast<int>(mid)
+                << " to original requester " << ipbuf << ":" << ntohs(requester.sin_port) << std::endl;
     }
+  } else {
+    std::cout << "SafeSpaceServer: no pending requester for msg_id=" << static_cast<int>(mid) << std::endl;
+  }
 
-    // no further response from server itself
-    out_response.clear();
+  // no further response from server itself
+}
+
+void SafeSpaceServer::handleSensorData(
+  const sockaddr_in& peer, const MessageView& msg, ResponseBuffer& response) {
+  const uint8_t* data = msg.payload;
+  const size_t len = msg.length;
+  if (len != sizeof(SensorData)) {
+    std::cerr << "[SafeSpaceServer] SENSOR_PACKET with invalid length " << len << std::endl;
     return;
   }
 
-  if (len == sizeof(SensorData)) {
-    const auto* pkt = reinterpret_cast<const SensorData*>(data);
-
-    // Obtener IP y puerto del remitente
-    char ipbuf[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &peer.sin_addr, ipbuf, sizeof(ipbuf));
-
-    std::cout << "[SafeSpaceServer] SENSOR_PACKET recibido desde "
-              << ipbuf << ":" << ntohs(peer.sin_port) << std::endl;
-    std::cout << "  ▸ Temperatura: " << pkt->temperature << " °C" << std::endl;
-    std::cout << "  ▸ Distancia: " << pkt->distance << " cm" << std::endl;
-    std::cout << "  ▸ Presión: " << pkt->pressure<< " Pa" << std::endl;
-    std::cout << "  ▸ Presión a nivel de mar: " << pkt->sealevelPressure << " cm" << std::endl;
-    std::cout << "  ▸ Altitud: " << pkt->altitude << " m" << std::endl;
-    std::cout << "  ▸ Altitud Real: " << pkt->realAltitude << " cm" << std::endl;
-
-    try {
-      storageNode.client->sendRaw(pkt, sizeof(SensorData));
-      proxyNode.client->sendRaw(pkt, sizeof(SensorData));
-    } catch (const std::exception& ex) {
-      std::cerr << "[SafeSpaceServer] Exception al reenviar SENSOR_PACKET: "
-                << ex.what() << std::endl;
-    }
+  const auto* pkt = reinterpret_cast<const SensorData*>(data);
+
+  // Obtener IP y puerto del remitente
+  char ipbuf[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &peer.sin_addr, ipbuf, sizeof(ipbuf));
+
+  std::cout << "[SafeSpaceServer] SENSOR_PACKET recibido desde "
+            << ipbuf << ":" << ntohs(peer.sin_port) << std::endl;
+  std::cout << "  ▸ Temperatura: " << pkt->temperature << " °C" << std::endl;
+  std::cout << "  ▸ Distancia: " << pkt->distance << " cm" << std::endl;
+  std::cout << "  ▸ Presión: " << pkt->pressure<< " Pa" << std::endl;
+  std::cout << "  ▸ Presión a nivel de mar: " << pkt->sealevelPressure << " cm" << std::endl;
+  std::cout << "  ▸ Altitud: " << pkt->altitude << " m" << std::endl;
+  std::cout << "  ▸ Altitud Real: " << pkt->realAltitude << " cm" << std::endl;
+
+  // Sin ACK si las réplicas no aceptan más: el emisor reintenta
+  const Replication stored = replicate(peer, msg, response);
+  if (stored == Replication::REFUSED) {
+    std::cerr << "[SafeSpaceServer] Storage replicas window full, SENSOR_PACKET not acknowledged" << std::endl;
+  }
+  if (stored == Replication::DUPLICATE) return;
+  try {
+    proxyNode.client->sendRaw(pkt, sizeof(SensorData));
+  } catch (const std::exception& ex) {
+    std::cerr << "[SafeSpaceServer] Exception al reenviar SENSOR_PACKET: "
+              << ex.what() << std::endl;
+  }
+}
 
-    // Generar respuesta ACK simple al emisor original (Arduino / Intermediario)
-    std::string ack = "ACK_SENSOR";
-    out_response.assign(ack.begin(), ack.end());
+void SafeSpaceServer::handleSensorBatch(
+  const sockaddr_in& peer, const MessageView& msg, ResponseBuffer& response) {
+  const SensorBatchReader batch(msg.payload, msg.length);
+  if (!batch.valid()) {
+    std::cerr << "[SafeSpaceServer] SENSOR_BATCH malformed (" << msg.length << " bytes)" << std::endl;
     return;
   }
 
+  char ipbuf[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &peer.sin_addr, ipbuf, sizeof(ipbuf));
+  std::cout << "[SafeSpaceServer] SENSOR_BATCH de " << batch.count() << " lecturas desde "
+            << ipbuf << ":" << ntohs(peer.sin_port) << std::endl;
+
+  // Un envío por réplica para todo el lote (un solo sendmmsg); al proxy tal cual
+  const Replication stored = replicate(peer, msg, response);
+  if (stored == Replication::REFUSED) {
+    std::cerr << "[SafeSpaceServer] Storage replicas window full, SENSOR_BATCH not acknowledged" << std::endl;
+  }
+  if (stored == Replication::DUPLICATE) return;
+  try {
+    proxyNode.client->sendRaw(msg.datagram, msg.datagramLength);
+  } catch (const std::exception& ex) {
+    std::cerr << "[SafeSpaceServer] Exception al reenviar SENSOR_BATCH: "
+              << ex.what() << std::endl;
+  }
+}
+
+SafeSpaceServer::Replication SafeSpaceServer::replicate(
+  const sockaddr_in& peer, const MessageView& msg, ResponseBuffer& response) {
+  const uint64_t sender = (uint64_t{peer.sin_addr.s_addr} << 16) | peer.sin_port;
+
+  // ACK_SENSOR armado ahora, con el encabezado del pedido; sale cuando haya quórum
+  std::vector<uint8_t> reply(MessageHeader::SIZE + 16);
+  ResponseBuffer ack(reply.data(), reply.size());
+  {
+    ReplyFrame frame(ack, msg);
+    ack.append("ACK_SENSOR");
+  }
+  reply.resize(ack.size());
+
+  std::lock_guard<std::mutex> lock(acksMutex_);
+  if (msg.framed) {
+    // Reintento del emisor: ya guardado (se perdió el ACK) o todavía esperando quórum
+    if (acknowledged_.seen(sender, msg.seq)) {
+      response.append("ACK_SENSOR");
+      return Replication::DUPLICATE;
+    }
+    if (awaitingQuorum_.count({sender, msg.seq}) != 0) return Replication::DUPLICATE;
+  }
+
+  uint32_t seq;
+  if (!storage_->send(msg.kind, msg.payload, msg.length, &seq)) return Replication::REFUSED;
+  pendingAcks_[seq] = PendingAck{peer, sender, msg.framed, msg.seq, std::move(reply)};
+  if (msg.framed) awaitingQuorum_[{sender, msg.seq}] = seq;
+  return Replication::SENT;
+}
 
-  // Fallback: let base class behavior handle it (echo)
-  UDPServer::onReceive(peer, data, len, out_response);
+void SafeSpaceServer::onStorageCommit(uint32_t seq) {
+  PendingAck ack;
+  {
+    std::lock_guard<std::mutex> lock(acksMutex_);
+    const auto it = pendingAcks_.find(seq);
+    if (it == pendingAcks_.end()) return;
+    ack = std::move(it->second);
+    pendingAcks_.erase(it);
+    if (ack.framed) {
+      awaitingQuorum_.erase({ack.sender, ack.requestSeq});
+      acknowledged_.applied(ack.sender, ack.requestSeq);
+    }
+  }
+
+  try {
+    sendTo(ack.peer, ack.reply.data(), ack.reply.size());
+  } catch (const std::exception& ex) {
+    std::cerr << "[SafeSpaceServer] Exception al enviar ACK_SENSOR: " << ex.what() << std::endl;
+  }
 }
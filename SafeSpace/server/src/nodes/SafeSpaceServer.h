@@ -2,11 +2,16 @@
 #define SERVER_SAFESPACESERVER_H
 
 #include "interfaces/UDPServer.h"
+#include "StorageReplicas.h"
+#include "Storage/ReplayFilter.h"
 #include <vector>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 
 // Critical events node
 #include "CriticalEvents/CriticalEventsNode.h"
@@ -26,6 +31,17 @@ public:
     const std::string &proxyIp, uint16_t proxyPort
     );
 
+  /**
+   * Construct with several storage replicas: every sensor write goes to all
+   * of them and is retransmitted until each one ACKs (see StorageReplicas).
+   */
+  SafeSpaceServer(
+    const std::string &ip, uint16_t port,
+    const std::vector<StorageReplicas::Endpoint> &storage,
+    const std::string &eventsIp, uint16_t eventsPort,
+    const std::string &proxyIp, uint16_t proxyPort
+    );
+
   /** Virtual destructor. */
   ~SafeSpaceServer() override;
 
@@ -36,24 +52,61 @@ public:
   void clearDiscoverTargets();
 
 protected:
-  /** Override onReceive to implement retransmission logic. */
-  void onReceive(const sockaddr_in& peer,
-                 const uint8_t* data,
-                 ssize_t len,
-                 std::string& out_response) override;
+  /** Override onDatagram to implement retransmission logic. */
+  void onDatagram(const sockaddr_in& peer,
+                  const uint8_t* data,
+                  size_t len,
+                  ResponseBuffer& response) override;
 
 private:
+  /// Handler of one message kind.
+  using MessageHandler = void (SafeSpaceServer::*)(const sockaddr_in& peer, const MessageView& msg,
+                                                   ResponseBuffer& response);
+  static const DispatchTable<MessageHandler> routes; ///< Message kind -> handler.
+
+  /** LOG from another node: re-emit it through LogManager. */
+  void handleLog(const sockaddr_in& peer, const MessageView& msg, ResponseBuffer& response);
+  /** DISCOVER: remember the requester and forward to every discover target. */
+  void handleDiscover(const sockaddr_in& peer, const MessageView& msg, ResponseBuffer& response);
+  /** DISCOVER_RESP: forward back to the requester of that msg_id. */
+  void handleDiscoverResponse(const sockaddr_in& peer, const MessageView& msg, ResponseBuffer& response);
+  /** SENSOR_DATA: replicate to storage, forward to proxy, ACK the sender once a quorum stored it. */
+  void handleSensorData(const sockaddr_in& peer, const MessageView& msg, ResponseBuffer& response);
+  /** SENSOR_BATCH: replicate the batch to storage, relay it as-is to proxy, ACK like SENSOR_DATA. */
+  void handleSensorBatch(const sockaddr_in& peer, const MessageView& msg, ResponseBuffer& response);
+
+  /// What replicate() did with a sensor write.
+  enum class Replication { SENT, DUPLICATE, REFUSED };
+
+  /**
+   * Sends a sensor write to the storage replicas and parks its ACK_SENSOR
+   * until StorageReplicas reports quorum. A framed write the sender
+   * retransmits is not stored twice: if it already committed the ACK is
+   * written to response right away, if it is still in flight it keeps
+   * waiting for the first copy's ACK.
+   */
+  Replication replicate(const sockaddr_in& peer, const MessageView& msg, ResponseBuffer& response);
+  /** StorageReplicas commit handler: sends the ACK parked under seq. */
+  void onStorageCommit(uint32_t seq);
+
   /** Helper: create sockaddr_in from ip/port */
   static sockaddr_in makeSockaddr(const std::string& ip, uint16_t port);
 
-  struct StorageServerInfo{
-    UDPClient* client;  //< Client to communicate with the Authentication node.
-    std::string ip;     //< Authentication node ip address.
-    uint16_t port;      //< Authentication node ipd address port.
-
-    StorageServerInfo(const std::nullptr_t null, std::string  string, uint16_t uint16)
-    : client(null), ip(std::move(string)), port(uint16) {};
-  } storageNode;
+  /// Storage replicas; sensor writes go to all of them with ACK tracking.
+  std::unique_ptr<StorageReplicas> storage_;
+
+  /// ACK_SENSOR owed to a sender once its write reaches quorum.
+  struct PendingAck {
+    sockaddr_in peer;
+    uint64_t sender;             ///< ip:port of peer, the ReplayFilter key.
+    bool framed;
+    uint32_t requestSeq;         ///< Sender's seq; only meaningful when framed.
+    std::vector<uint8_t> reply;  ///< ACK_SENSOR, framed like the request.
+  };
+  std::unordered_map<uint32_t, PendingAck> pendingAcks_;             ///< By replication seq.
+  std::map<std::pair<uint64_t, uint32_t>, uint32_t> awaitingQuorum_; ///< (sender, request seq) -> replication seq.
+  ReplayFilter acknowledged_;   ///< Framed writes already committed, per sender.
+  std::mutex acksMutex_;        ///< Guards pendingAcks_ and awaitingQuorum_.
 
   struct EventsServerInfo{
     UDPClient* client;  //< Client to communicate with the Authentication node.
@@ -0,0 +1,157 @@
+#include "ColumnKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLUMN_KERNELS_X86 1
+#endif
+
+namespace {
+
+void minMaxSumScalar(const float* values, size_t n, float& min, float& max, double& sum) {
+    float lo = min;
+    float hi = max;
+    double total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const float v = values[i];
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+        total += v;
+    }
+    min = lo;
+    max = hi;
+    sum += total;
+}
+
+size_t selectRangeScalar(const uint64_t* ts, size_t n, uint64_t lo, uint64_t hi, uint32_t* out) {
+    // Sin ramas: se escribe siempre y solo avanza si cumple
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        out[k] = static_cast<uint32_t>(i);
+        k += (ts[i] >= lo) & (ts[i] <= hi);
+    }
+    return k;
+}
+
+#ifdef COLUMN_KERNELS_X86
+
+// Reducción final de los carriles; mismo criterio que el escalar
+void foldLanes(const float* lo, const float* hi, size_t lanes, float& min, float& max) {
+    for (size_t i = 0; i < lanes; ++i) {
+        min = lo[i] < min ? lo[i] : min;
+        max = hi[i] > max ? hi[i] : max;
+    }
+}
+
+// _mm_min_ps(x, acc) es "x < acc ? x : acc", igual que el escalar también con NaN
+__attribute__((target("sse2")))
+void minMaxSumSse2(const float* values, size_t n, float& min, float& max, double& sum) {
+    __m128 lo = _mm_set1_ps(min);
+    __m128 hi = _mm_set1_ps(max);
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 x = _mm_loadu_ps(values + i);
+        lo = _mm_min_ps(x, lo);
+        hi = _mm_max_ps(x, hi);
+        s0 = _mm_add_pd(s0, _mm_cvtps_pd(x));
+        s1 = _mm_add_pd(s1, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+    }
+
+    float l[4], h[4];
+    double s[2];
+    _mm_storeu_ps(l, lo);
+    _mm_storeu_ps(h, hi);
+    _mm_storeu_pd(s, _mm_add_pd(s0, s1));
+    foldLanes(l, h, 4, min, max);
+    sum += s[0] + s[1];
+    minMaxSumScalar(values + i, n - i, min, max, sum);
+}
+
+__attribute__((target("avx2")))
+void minMaxSumAvx2(const float* values, size_t n, float& min, float& max, double& sum) {
+    __m256 lo = _mm256_set1_ps(min);
+    __m256 hi = _mm256_set1_ps(max);
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 x = _mm256_loadu_ps(values + i);
+        lo = _mm256_min_ps(x, lo);
+        hi = _mm256_max_ps(x, hi);
+        s0 = _mm256_add_pd(s0, _mm256_cvtps_pd(_mm256_castps256_ps128(x)));
+        s1 = _mm256_add_pd(s1, _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)));
+    }
+
+    float l[8], h[8];
+    double s[4];
+    _mm256_storeu_ps(l, lo);
+    _mm256_storeu_ps(h, hi);
+    _mm256_storeu_pd(s, _mm256_add_pd(s0, s1));
+    foldLanes(l, h, 8, min, max);
+    sum += (s[0] + s[1]) + (s[2] + s[3]);
+    minMaxSumScalar(values + i, n - i, min, max, sum);
+}
+
+__attribute__((target("avx2")))
+size_t selectRangeAvx2(const uint64_t* ts, size_t n, uint64_t lo, uint64_t hi, uint32_t* out) {
+    // Comparación con signo de 64 bits: vale porque ts < 2^63
+    const __m256i below = _mm256_set1_epi64x(static_cast<long long>(lo));
+    const __m256i above = _mm256_set1_epi64x(static_cast<long long>(hi));
+    size_t k = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ts + i));
+        const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(below, x), _mm256_cmpgt_epi64(x, above));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(outside))) & 0xFu;
+        if (mask == 0xFu) {
+            out[k] = static_cast<uint32_t>(i);
+            out[k + 1] = static_cast<uint32_t>(i + 1);
+            out[k + 2] = static_cast<uint32_t>(i + 2);
+            out[k + 3] = static_cast<uint32_t>(i + 3);
+            k += 4;
+            continue;
+        }
+        while (mask) {
+            out[k++] = static_cast<uint32_t>(i + static_cast<size_t>(__builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+    for (; i < n; ++i) {
+        out[k] = static_cast<uint32_t>(i);
+        k += (ts[i] >= lo) & (ts[i] <= hi);
+    }
+    return k;
+}
+
+#endif // COLUMN_KERNELS_X86
+
+const ColumnKernels SCALAR = {minMaxSumScalar, selectRangeScalar, ColumnKernels::Isa::Scalar, "scalar"};
+#ifdef COLUMN_KERNELS_X86
+// SSE2 no tiene comparación de 64 bits (llega con SSE4.2): la selección queda escalar
+const ColumnKernels SSE2 = {minMaxSumSse2, selectRangeScalar, ColumnKernels::Isa::Sse2, "sse2"};
+const ColumnKernels AVX2 = {minMaxSumAvx2, selectRangeAvx2, ColumnKernels::Isa::Avx2, "avx2"};
+#endif
+}
+
+const ColumnKernels* ColumnKernels::get(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar:
+            return &SCALAR;
+#ifdef COLUMN_KERNELS_X86
+        case Isa::Sse2:
+            return __builtin_cpu_supports("sse2") ? &SSE2 : nullptr;
+        case Isa::Avx2:
+            return __builtin_cpu_supports("avx2") ? &AVX2 : nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+const ColumnKernels& ColumnKernels::best() {
+    static const ColumnKernels* chosen = get(Isa::Avx2) ? get(Isa::Avx2)
+                                       : get(Isa::Sse2) ? get(Isa::Sse2)
+                                       : &SCALAR;
+    return *chosen;
+}
@@ -0,0 +1,42 @@
+#ifndef COLUMNKERNELS_H
+#define COLUMNKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Núcleos de recorrido sobre columnas contiguas de lecturas.
+ *
+ * Cada núcleo existe en versión escalar, SSE2 y AVX2; best() elige al
+ * arrancar la mejor que soporte la CPU, así el binario no necesita
+ * compilarse con -mavx2. Todas las versiones dan el mismo min/max y la
+ * misma selección; la suma puede diferir en el redondeo por el orden en
+ * que se acumula.
+ */
+struct ColumnKernels {
+    enum class Isa { Scalar, Sse2, Avx2 };
+
+    /**
+     * Acumula min, max y suma de n floats. min y max entran con lo ya
+     * acumulado (±infinito al empezar); un NaN no los modifica.
+     */
+    void (*minMaxSum)(const float* values, size_t n, float& min, float& max, double& sum);
+
+    /**
+     * Escribe en out los índices i (en orden) con lo <= ts[i] <= hi.
+     * Los timestamps deben ser menores que 2^63.
+     * @return cuántos índices escribió.
+     */
+    size_t (*selectRange)(const uint64_t* ts, size_t n, uint64_t lo, uint64_t hi, uint32_t* out);
+
+    Isa isa;
+    const char* name;
+
+    /// La mejor variante para esta CPU.
+    static const ColumnKernels& best();
+
+    /// La variante pedida, o nullptr si la CPU no la soporta.
+    static const ColumnKernels* get(Isa isa);
+};
+
+#endif // COLUMNKERNELS_H
@@ -0,0 +1,389 @@
+#include "MemTable.h"
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <unistd.h>
+#include <unordered_map>
+
+MemTable::MemTable(TimeSeriesStore& store, std::shared_mutex& storeMutex, const std::string& walPath,
+                   Options options)
+    : store_(store),
+      storeMutex_(storeMutex),
+      options_(options),
+      recovered_(recover(store, walPath)),
+      wal_(walPath),
+      retry_(false),
+      stopping_(false),
+      flushes_(0),
+      flushedRecords_(0)
+{
+    flusher_ = std::thread(&MemTable::run, this);
+}
+
+MemTable::MemTable(TimeSeriesStore& store, std::shared_mutex& storeMutex, const std::string& walPath)
+    : MemTable(store, storeMutex, walPath, Options()) {}
+
+MemTable::~MemTable() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+
+    // Lo que no se pueda volcar queda en el WAL para el próximo arranque
+    flush();
+    const Stats s = stats();
+    std::cout << "[MemTable] Volcados: " << s.flushes << " (" << s.flushedRecords
+              << " lecturas), WAL: " << s.wal.appends << " escrituras en "
+              << s.wal.syncs << " fdatasync" << std::endl;
+}
+
+bool MemTable::append(const SensorReading* readings, size_t count) {
+    if (count == 0) return true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!admit(count)) return false;
+    }
+    const std::vector<uint8_t> record = encode(readings, count);
+
+    // Compartido con otros append(): una rotación no puede separar el registro
+    // del WAL de su copia en memoria
+    std::shared_lock<std::shared_mutex> rotate(rotateMutex_);
+    if (!wal_.append(record.data(), record.size())) {
+        return false;
+    }
+
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_.insert(active_.end(), readings, readings + count);
+        full = active_.size() >= options_.flushRecords;
+    }
+    if (full) {
+        wake_.notify_one();
+    }
+    return true;
+}
+
+bool MemTable::stage(const SensorReading* readings, size_t count, uint64_t& ticket) {
+    ticket = 0;
+    if (count == 0) return true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!admit(count)) return false;
+    }
+    const std::vector<uint8_t> record = encode(readings, count);
+
+    std::shared_lock<std::shared_mutex> rotate(rotateMutex_);
+    if (!wal_.enqueue(record.data(), record.size(), ticket)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    staged_.insert(staged_.end(), readings, readings + count);
+    stagedWrites_.push_back(StagedWrite{ticket, count});
+    return true;
+}
+
+bool MemTable::commit() {
+    const bool ok = wal_.sync();
+    const uint64_t durable = wal_.durable();
+
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stagedWrites_.empty()) return ok;
+        // Con el WAL caído lo que no llegó a disco ya no va a llegar
+        const size_t dropped = publish(durable, !ok);
+        if (dropped > 0) {
+            std::cerr << "[MemTable] Se descartan " << dropped
+                      << " lecturas que no llegaron al WAL" << std::endl;
+        }
+        full = active_.size() >= options_.flushRecords;
+    }
+    if (full) {
+        wake_.notify_one();
+    }
+    return ok;
+}
+
+uint64_t MemTable::durableUpTo() const {
+    return wal_.durable();
+}
+
+bool MemTable::admit(size_t count) const {
+    // Solo se llena si los volcados vienen fallando: no crecer sin límite
+    const size_t buffered = active_.size() + staged_.size();
+    if (buffered + count > options_.maxBuffered) {
+        std::cerr << "[MemTable] " << buffered << " lecturas sin volcar; se rechazan "
+                  << count << " hasta que el volcado vuelva a funcionar" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint8_t> MemTable::encode(const SensorReading* readings, size_t count) {
+    std::vector<uint8_t> record(count * TimeSeriesStore::RECORD_SIZE);
+    for (size_t i = 0; i < count; ++i) {
+        TimeSeriesStore::encode(readings[i], record.data() + i * TimeSeriesStore::RECORD_SIZE);
+    }
+    return record;
+}
+
+size_t MemTable::publish(uint64_t durable, bool discard) {
+    // Los hilos encolan en el WAL y anotan aquí en cualquier orden: se mira cada ticket
+    size_t from = 0;
+    size_t kept = 0;
+    size_t keptRecords = 0;
+    size_t dropped = 0;
+    for (const StagedWrite& write : stagedWrites_) {
+        const auto first = staged_.begin() + from;
+        if (write.ticket <= durable) {
+            active_.insert(active_.end(), first, first + write.count);
+        } else if (discard) {
+            dropped += write.count;
+        } else {
+            if (keptRecords != from) {
+                std::copy(first, first + write.count, staged_.begin() + keptRecords);
+            }
+            stagedWrites_[kept++] = write;
+            keptRecords += write.count;
+        }
+        from += write.count;
+    }
+    staged_.resize(keptRecords);
+    stagedWrites_.resize(kept);
+    return dropped;
+}
+
+void MemTable::scan(uint64_t startMs, uint64_t endMs, const TimeSeriesStore::Visitor& visit) {
+    scanMerged(false, 0, startMs, endMs, visit);
+}
+
+void MemTable::scanSensor(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                          const TimeSeriesStore::Visitor& visit) {
+    scanMerged(true, sensorId, startMs, endMs, visit);
+}
+
+void MemTable::scanMerged(bool oneSensor, uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                          const TimeSeriesStore::Visitor& visit) {
+    const auto older = [](const SensorReading& a, const SensorReading& b) {
+        return a.timestampMs < b.timestampMs;
+    };
+    std::vector<SensorReading> stored;
+    std::vector<SensorReading> buffered;
+    {
+        // Con storeMutex tomado un volcado no puede estar a medias: cada lectura
+        // está en el store o en memoria, nunca en los dos
+        std::shared_lock<std::shared_mutex> store(storeMutex_);
+        const auto files = oneSensor ? store_.sensorSegments(sensorId, startMs, endMs)
+                                     : store_.segments(startMs, endMs);
+        store_.readSegments(files, startMs, endMs, options_.scanPool, stored);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto keep = [&buffered](const SensorReading& r) { buffered.push_back(r); };
+        visitBuffered(immutable_, oneSensor, sensorId, startMs, endMs, keep);
+        visitBuffered(active_, oneSensor, sensorId, startMs, endMs, keep);
+    }
+    std::stable_sort(buffered.begin(), buffered.end(), older);
+
+    // Lo guardado y lo de memoria, mezclados por timestamp
+    auto a = stored.begin();
+    auto b = buffered.begin();
+    while (a != stored.end() || b != buffered.end()) {
+        if (b == buffered.end() || (a != stored.end() && !older(*b, *a))) {
+            visit(*a++);
+        } else {
+            visit(*b++);
+        }
+    }
+}
+
+void MemTable::scanSensorColumns(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                                 const TimeSeriesStore::ColumnVisitor& visit) {
+    scanSensorColumns(sensorId, startMs, endMs, visit, nullptr);
+}
+
+void MemTable::scanSensorColumns(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                                 const TimeSeriesStore::ColumnVisitor& visit,
+                                 const TimeSeriesStore::RollupVisitor& rollups) {
+    std::shared_lock<std::shared_mutex> store(storeMutex_);
+    if (rollups) {
+        store_.scanSensorRollups(sensorId, startMs, endMs, rollups);
+    }
+    store_.scanSensorColumns(sensorId, startMs, endMs, visit, options_.scanPool);
+
+    ColumnBuffer buffered;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto keep = [&buffered](const SensorReading& r) { buffered.push(r); };
+        visitBuffered(immutable_, true, sensorId, startMs, endMs, keep);
+        visitBuffered(active_, true, sensorId, startMs, endMs, keep);
+    }
+    if (buffered.size() > 0) {
+        visit(buffered.block(sensorId));
+    }
+}
+
+std::unique_ptr<QueryCursor> MemTable::openCursor(bool oneSensor, uint16_t sensorId,
+                                                  uint64_t startMs, uint64_t endMs) {
+    // Igual que scan(): con storeMutex tomado la foto del índice y la copia
+    // de memoria no se pisan ni dejan huecos
+    std::shared_lock<std::shared_mutex> store(storeMutex_);
+    auto files = oneSensor ? store_.sensorSegments(sensorId, startMs, endMs)
+                           : store_.segments(startMs, endMs);
+
+    std::vector<SensorReading> buffered;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto keep = [&buffered](const SensorReading& r) { buffered.push_back(r); };
+        visitBuffered(immutable_, oneSensor, sensorId, startMs, endMs, keep);
+        visitBuffered(active_, oneSensor, sensorId, startMs, endMs, keep);
+    }
+    return std::make_unique<QueryCursor>(store_, storeMutex_, std::move(files), std::move(buffered),
+                                         startMs, endMs, options_.scanPool);
+}
+
+void MemTable::visitBuffered(const std::vector<SensorReading>& readings, bool oneSensor,
+                             uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                             const TimeSeriesStore::Visitor& visit) {
+    for (const auto& r : readings) {
+        if ((!oneSensor || r.sensorId == sensorId) && r.timestampMs >= startMs && r.timestampMs <= endMs) {
+            visit(r);
+        }
+    }
+}
+
+bool MemTable::flush() {
+    std::lock_guard<std::mutex> flushing(flushMutex_);
+
+    {
+        std::unique_lock<std::shared_mutex> rotate(rotateMutex_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Si immutable_ no está vacío es el reintento de un volcado fallido:
+        // su WAL rotado sigue en disco y no se puede pisar
+        if (immutable_.empty()) {
+            if (active_.empty()) return true;
+            if (!wal_.rotate()) return false;
+            // rotate() sincronizó todo lo encolado: lo de stage() va con este lote
+            publish(wal_.durable(), false);
+            immutable_.swap(active_);
+        }
+    }
+
+    // Solo este hilo modifica immutable_, así que se lee sin mutex_
+    bool ok;
+    {
+        std::unique_lock<std::shared_mutex> store(storeMutex_);
+        const size_t stored = retry_ ? persistMissing(store_, immutable_)
+                                     : store_.append(immutable_.data(), immutable_.size());
+        ok = stored == immutable_.size() && store_.sync();
+        if (ok) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flushes_++;
+            flushedRecords_ += immutable_.size();
+            immutable_.clear();
+        }
+    }
+
+    retry_ = !ok;
+    if (!ok) {
+        std::cerr << "[MemTable] No se pudo volcar el lote al FileSystem; queda en "
+                  << wal_.rotatedPath() << " y se reintenta" << std::endl;
+        return false;
+    }
+    wal_.dropRotated();
+    return true;
+}
+
+void MemTable::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        // Por tamaño (append() despierta) o por tiempo
+        wake_.wait_for(lock, options_.flushInterval, [this] {
+            return stopping_ || active_.size() >= options_.flushRecords;
+        });
+        if (stopping_) break;
+
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+MemTable::Stats MemTable::stats() const {
+    Stats s{};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.buffered = active_.size() + staged_.size() + immutable_.size();
+        s.flushes = flushes_;
+        s.flushedRecords = flushedRecords_;
+    }
+    s.recoveredRecords = recovered_;
+    s.wal = wal_.stats();
+    return s;
+}
+
+size_t MemTable::recover(TimeSeriesStore& store, const std::string& walPath) {
+    // Primero el rotado (más viejo), después el actual
+    std::vector<SensorReading> readings;
+    const auto collect = [&readings](const uint8_t* data, size_t len) {
+        for (size_t i = 0; i + TimeSeriesStore::RECORD_SIZE <= len; i += TimeSeriesStore::RECORD_SIZE) {
+            readings.push_back(TimeSeriesStore::decode(data + i));
+        }
+    };
+    const std::string rotated = WriteAheadLog::rotatedPath(walPath);
+    bool found = WriteAheadLog::replay(rotated, collect);
+    found = WriteAheadLog::replay(walPath, collect) || found;
+    if (!found) return 0;
+
+    // Un volcado pudo completarse antes de la caída: no duplicar
+    if (persistMissing(store, readings) != readings.size() || !store.sync()) {
+        throw std::runtime_error("No se pudo reaplicar el WAL " + walPath);
+    }
+    ::unlink(rotated.c_str());
+    ::unlink(walPath.c_str());
+
+    std::cout << "[MemTable] " << readings.size() << " lecturas recuperadas del WAL" << std::endl;
+    return readings.size();
+}
+
+size_t MemTable::persistMissing(TimeSeriesStore& store, const std::vector<SensorReading>& readings) {
+    // Rango de tiempo por sensor y lo que el store ya tiene en él
+    std::unordered_map<uint16_t, std::pair<uint64_t, uint64_t>> ranges;
+    for (const auto& r : readings) {
+        auto it = ranges.find(r.sensorId);
+        if (it == ranges.end()) {
+            ranges.emplace(r.sensorId, std::make_pair(r.timestampMs, r.timestampMs));
+        } else {
+            it->second.first = std::min(it->second.first, r.timestampMs);
+            it->second.second = std::max(it->second.second, r.timestampMs);
+        }
+    }
+
+    std::multiset<std::string> present;
+    std::string encoded(TimeSeriesStore::RECORD_SIZE, '\0');
+    for (const auto& range : ranges) {
+        store.scanSensor(range.first, range.second.first, range.second.second,
+            [&](const SensorReading& r) {
+                TimeSeriesStore::encode(r, reinterpret_cast<uint8_t*>(&encoded[0]));
+                present.insert(encoded);
+            });
+    }
+
+    std::vector<SensorReading> missing;
+    for (const auto& r : readings) {
+        TimeSeriesStore::encode(r, reinterpret_cast<uint8_t*>(&encoded[0]));
+        auto it = present.find(encoded);
+        if (it != present.end()) {
+            present.erase(it);    // cada copia guardada cubre una sola lectura
+        } else {
+            missing.push_back(r);
+        }
+    }
+
+    return readings.size() - missing.size() + store.append(missing.data(), missing.size());
+}
@@ -0,0 +1,152 @@
+#ifndef MEMTABLE_H
+#define MEMTABLE_H
+
+#include "QueryCursor.h"
+#include "TimeSeriesStore.h"
+#include "WriteAheadLog.h"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Buffer de ingesta del StorageNode delante de TimeSeriesStore.
+ *
+ * append() deja las lecturas en el WriteAheadLog (durables, con group
+ * commit) y en memoria, y vuelve: el ACK ya no espera al FileSystem. Un
+ * hilo de fondo las vuelca al store en lotes grandes cuando se juntan
+ * flushRecords lecturas o pasa flushInterval. stage() + commit() separan
+ * las dos mitades para que quien recibe varias escrituras seguidas las
+ * cubra con un solo fdatasync; lo de stage() no se ve en las consultas
+ * hasta que commit() lo deja en disco, y se descarta si el WAL falla.
+ *
+ * Si los volcados fallan y se juntan maxBuffered lecturas en memoria,
+ * append() y stage() rechazan las nuevas hasta que un volcado salga bien.
+ *
+ * Las consultas pasan por aquí para ver también lo que aún no se volcó.
+ * Al arrancar se reaplican los WAL que hayan quedado de una caída, sin
+ * duplicar lo que ya había llegado al store.
+ */
+class MemTable {
+ public:
+    struct Options {
+        size_t flushRecords = 4096;                       // volcar al juntar tantas lecturas
+        std::chrono::milliseconds flushInterval{1000};    // o al pasar este tiempo
+        ScanPool* scanPool = nullptr;                     // hilos para leer los archivos de una consulta
+        size_t maxBuffered = 64 * 4096;                   // tope de lecturas sin volcar
+    };
+
+    struct Stats {
+        size_t buffered;              // lecturas en memoria sin volcar
+        uint64_t flushes;
+        uint64_t flushedRecords;
+        size_t recoveredRecords;      // reaplicadas desde el WAL al arrancar
+        WriteAheadLog::Stats wal;
+    };
+
+    /**
+     * @param storeMutex protege store; MemTable lo toma exclusivo al volcar y
+     *                   compartido al consultar.
+     * @param walPath archivo del WAL en el sistema de archivos del host.
+     * @throws std::runtime_error si no se puede abrir o recuperar el WAL.
+     */
+    MemTable(TimeSeriesStore& store, std::shared_mutex& storeMutex, const std::string& walPath,
+             Options options);
+    MemTable(TimeSeriesStore& store, std::shared_mutex& storeMutex, const std::string& walPath);
+    /// Detiene el hilo de volcado y vuelca lo pendiente.
+    ~MemTable();
+
+    /**
+     * Agrega lecturas; al volver están en el WAL y visibles en las consultas.
+     * @return false si el WAL no pudo escribirlas (no se deben confirmar).
+     */
+    bool append(const SensorReading* readings, size_t count);
+    /**
+     * Como append() pero sin esperar al fdatasync: quedan en disco, y se ven
+     * en las consultas, con el próximo commit(). No se deben confirmar antes
+     * de que durableUpTo() alcance ticket.
+     */
+    bool stage(const SensorReading* readings, size_t count, uint64_t& ticket);
+    /**
+     * Espera a que todo lo de stage() esté en el WAL y lo hace visible; si no
+     * se pudo escribir devuelve false y descarta lo que no llegó a disco.
+     */
+    bool commit();
+    /// Hasta qué ticket de stage() está todo en disco.
+    uint64_t durableUpTo() const;
+
+    /// TimeSeriesStore::scan() más lo que está en memoria, en orden de timestamp.
+    void scan(uint64_t startMs, uint64_t endMs, const TimeSeriesStore::Visitor& visit);
+    void scanSensor(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                    const TimeSeriesStore::Visitor& visit);
+    /// TimeSeriesStore::scanSensorColumns(); lo que está en memoria llega en un último bloque.
+    void scanSensorColumns(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                           const TimeSeriesStore::ColumnVisitor& visit);
+    /// Igual, y con el mismo lock los resúmenes del store (una compactación no se cruza).
+    void scanSensorColumns(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                           const TimeSeriesStore::ColumnVisitor& visit,
+                           const TimeSeriesStore::RollupVisitor& rollups);
+
+    /**
+     * Abre una consulta paginada sobre el store y lo que está en memoria,
+     * fijando lo que verá. oneSensor=false consulta todos los sensores.
+     */
+    std::unique_ptr<QueryCursor> openCursor(bool oneSensor, uint16_t sensorId,
+                                            uint64_t startMs, uint64_t endMs);
+
+    /// Vuelca ya lo pendiente; false si el store no pudo guardarlo todo.
+    bool flush();
+
+    Stats stats() const;
+
+ private:
+    TimeSeriesStore& store_;
+    std::shared_mutex& storeMutex_;
+    Options options_;
+    size_t recovered_;                 // antes que wal_: la recuperación usa los archivos
+    WriteAheadLog wal_;
+
+    std::shared_mutex rotateMutex_;    // append() compartido; rotación del WAL exclusiva
+    mutable std::mutex mutex_;         // active_, staged_, immutable_, contadores
+    std::mutex flushMutex_;            // un volcado a la vez
+    std::condition_variable wake_;
+    std::vector<SensorReading> active_;      // lo que corresponde al WAL actual
+    std::vector<SensorReading> immutable_;   // volcándose (WAL rotado)
+    struct StagedWrite {
+        uint64_t ticket;               // posición en el WAL al terminar el registro
+        size_t count;
+    };
+    std::vector<SensorReading> staged_;      // de stage(), en el WAL sin fdatasync; no se consulta
+    std::vector<StagedWrite> stagedWrites_;  // en qué partes de staged_ está
+    bool retry_;                       // el último volcado falló a medias
+    bool stopping_;
+    uint64_t flushes_;
+    uint64_t flushedRecords_;
+    std::thread flusher_;
+
+    // false (y lo registra) si ya hay maxBuffered lecturas en memoria; mutex_ tomado
+    bool admit(size_t count) const;
+    static std::vector<uint8_t> encode(const SensorReading* readings, size_t count);
+    // Pasa a active_ lo de staged_ que está en disco hasta durable; el resto
+    // se descarta si discard o si no, se deja; mutex_ tomado
+    size_t publish(uint64_t durable, bool discard);
+    void run();
+    void scanMerged(bool oneSensor, uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                    const TimeSeriesStore::Visitor& visit);
+    static void visitBuffered(const std::vector<SensorReading>& readings, bool oneSensor,
+                              uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                              const TimeSeriesStore::Visitor& visit);
+    static size_t recover(TimeSeriesStore& store, const std::string& walPath);
+    // Guarda en el store solo las lecturas que no estén ya
+    static size_t persistMissing(TimeSeriesStore& store, const std::vector<SensorReading>& readings);
+
+    MemTable(const MemTable&) = delete;
+    MemTable& operator=(const MemTable&) = delete;
+};
+
+#endif // MEMTABLE_H
@@ -0,0 +1,129 @@
+#include "QueryCache.h"
+
+QueryCache::QueryCache(size_t budgetBytes)
+    : budget_(budgetBytes),
+      bytes_(0),
+      hits_(0),
+      misses_(0),
+      invalidations_(0),
+      evictions_(0)
+{
+}
+
+QueryCache::Lookup QueryCache::lookup(const Key& key, uint64_t generation, std::vector<SensorReading>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(key);
+    if (it == index_.end() || it->second->generation != generation) {
+        if (it != index_.end()) erase(it->second);
+        misses_++;
+
+        const auto large = tooLarge_.find(key);
+        if (large == tooLarge_.end()) return Lookup::MISS;
+        if (large->second == generation) return Lookup::TOO_LARGE;
+        tooLarge_.erase(large);
+        return Lookup::MISS;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    out.insert(out.end(), it->second->rows.begin(), it->second->rows.end());
+    hits_++;
+    return Lookup::HIT;
+}
+
+size_t QueryCache::maxRows() const {
+    // Un tramo que se lleva más de un octavo del presupuesto no vale lo que desplaza
+    const size_t bytes = budget_ / 8;
+    return bytes > sizeof(Entry) ? (bytes - sizeof(Entry)) / sizeof(SensorReading) : 0;
+}
+
+void QueryCache::beginFill(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Fill& fill = fills_[key];
+    if (fill.pending++ == 0) fill.dirty = false;
+}
+
+void QueryCache::abandonFill(const Key& key, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool dirty = false;
+    endFill(key, dirty);
+    if (tooLarge_.size() >= MAX_TOO_LARGE) tooLarge_.clear();
+    tooLarge_[key] = generation;
+}
+
+void QueryCache::finishFill(const Key& key, uint64_t generation, std::vector<SensorReading> rows) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool dirty = false;
+    if (!endFill(key, dirty)) return;
+
+    rows.shrink_to_fit();
+    const size_t bytes = sizeof(Entry) + rows.size() * sizeof(SensorReading);
+    if (dirty || bytes > budget_ / 8) return;
+
+    const auto existing = index_.find(key);
+    if (existing != index_.end()) erase(existing->second);
+    lru_.push_front(Entry{key, generation, bytes, std::move(rows)});
+    index_[key] = lru_.begin();
+    bytes_ += bytes;
+
+    while (bytes_ > budget_ && !lru_.empty()) {
+        erase(std::prev(lru_.end()));
+        evictions_++;
+    }
+}
+
+void QueryCache::invalidate(const SensorReading* readings, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index_.empty() && fills_.empty()) return;
+
+    // Un lote suele ser de un sensor y una hora: saltar lo repetido
+    Key sensor, all;
+    sensor.oneSensor = true;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t bucket = readings[i].timestampMs / BUCKET_MS;
+        if (i > 0 && bucket == sensor.bucket && readings[i].sensorId == sensor.sensorId) continue;
+        sensor.sensorId = readings[i].sensorId;
+        sensor.bucket = bucket;
+        invalidateKey(sensor);
+        if (i == 0 || bucket != all.bucket) {
+            all.bucket = bucket;
+            invalidateKey(all);
+        }
+    }
+}
+
+QueryCache::Stats QueryCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.invalidations = invalidations_;
+    stats.evictions = evictions_;
+    stats.entries = index_.size();
+    stats.bytes = bytes_;
+    stats.budget = budget_;
+    return stats;
+}
+
+bool QueryCache::endFill(const Key& key, bool& dirty) {
+    const auto fill = fills_.find(key);
+    if (fill == fills_.end()) return false;
+    dirty = fill->second.dirty;
+    if (--fill->second.pending == 0) fills_.erase(fill);
+    return true;
+}
+
+void QueryCache::invalidateKey(const Key& key) {
+    const auto it = index_.find(key);
+    if (it != index_.end()) {
+        erase(it->second);
+        invalidations_++;
+    }
+    const auto fill = fills_.find(key);
+    if (fill != fills_.end()) fill->second.dirty = true;
+}
+
+void QueryCache::erase(std::list<Entry>::iterator it) {
+    bytes_ -= it->bytes;
+    index_.erase(it->key);
+    lru_.erase(it);
+}
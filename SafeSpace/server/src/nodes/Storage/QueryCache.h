@@ -0,0 +1,136 @@
+#ifndef QUERYCACHE_H
+#define QUERYCACHE_H
+
+#include "../../model/structures/SensorBatch.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Caché LRU de resultados de consultas del StorageNode.
+ *
+ * No guarda consultas enteras sino tramos alineados: las lecturas de una
+ * hora (BUCKET_MS) de un sensor, o de todos los sensores. Una consulta
+ * arma su resultado con los tramos que cubre y filtra los bordes, así dos
+ * ventanas distintas ("la última hora" pedida cada pocos segundos)
+ * comparten casi todos los tramos.
+ *
+ * Invalidación incremental: una lectura guardada borra solo los dos tramos
+ * que la contienen (el de su sensor y el de todos). Un tramo que se está
+ * llenando cuando llega una escritura que lo toca no se guarda. Los
+ * borrados del mantenimiento (resúmenes, retención) cambian la generación
+ * del store y eso vacía los tramos anteriores al consultarlos.
+ *
+ * Un tramo de más de maxRows() lecturas no se guarda; queda marcado (hasta
+ * que cambie la generación) para que la próxima consulta no lo vuelva a
+ * leer entero solo para descartarlo.
+ *
+ * Thread-safe.
+ */
+class QueryCache {
+ public:
+    static constexpr uint64_t BUCKET_MS = 3600 * 1000;
+
+    struct Key {
+        bool oneSensor = false;     // false: todos los sensores (sensorId = 0)
+        uint16_t sensorId = 0;
+        uint64_t bucket = 0;        // inicioMs / BUCKET_MS
+
+        bool operator==(const Key& other) const {
+            return oneSensor == other.oneSensor && sensorId == other.sensorId && bucket == other.bucket;
+        }
+    };
+
+    enum class Lookup {
+        HIT,
+        MISS,
+        TOO_LARGE       // el tramo no entra en la caché: leer del store de a páginas
+    };
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t invalidations;     // tramos borrados por escrituras
+        uint64_t evictions;         // tramos sacados por el presupuesto
+        size_t entries;
+        size_t bytes;
+        size_t budget;
+
+        double hitRatio() const {
+            return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses);
+        }
+    };
+
+    /// @param budgetBytes memoria máxima de los tramos guardados.
+    explicit QueryCache(size_t budgetBytes);
+
+    /**
+     * Agrega a out las lecturas del tramo si está guardado y es de la
+     * generación actual del store.
+     */
+    Lookup lookup(const Key& key, uint64_t generation, std::vector<SensorReading>& out);
+
+    /// Lecturas que puede tener un tramo para que se guarde.
+    size_t maxRows() const;
+
+    /// Avisa que se va a leer el tramo del store para guardarlo con finishFill().
+    void beginFill(const Key& key);
+
+    /// Termina un beginFill() cuyo tramo pasó de maxRows(): no se guarda y queda marcado.
+    void abandonFill(const Key& key, uint64_t generation);
+
+    /**
+     * Guarda el tramo leído después de beginFill(), salvo que una escritura
+     * lo haya tocado mientras tanto o no entre en el presupuesto.
+     */
+    void finishFill(const Key& key, uint64_t generation, std::vector<SensorReading> rows);
+
+    /// Lecturas recién guardadas: borra los tramos que las contienen.
+    void invalidate(const SensorReading* readings, size_t count);
+
+    Stats stats() const;
+
+ private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<uint64_t>()((key.bucket << 17) ^ (uint64_t{key.sensorId} << 1) ^ key.oneSensor);
+        }
+    };
+
+    struct Entry {
+        Key key;
+        uint64_t generation;
+        size_t bytes;
+        std::vector<SensorReading> rows;
+    };
+
+    struct Fill {
+        unsigned pending = 0;
+        bool dirty = false;
+    };
+
+    size_t budget_;
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;                  // más reciente al frente
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    std::unordered_map<Key, Fill, KeyHash> fills_;
+    // Tramos que no entran -> generación en que se vio; las escrituras solo
+    // los agrandan, así que no se borran al invalidar
+    std::unordered_map<Key, uint64_t, KeyHash> tooLarge_;
+    static constexpr size_t MAX_TOO_LARGE = 1024;
+    size_t bytes_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t invalidations_;
+    uint64_t evictions_;
+
+    // mutex_ tomado
+    bool endFill(const Key& key, bool& dirty);   // false si no había beginFill()
+    void invalidateKey(const Key& key);
+    void erase(std::list<Entry>::iterator it);
+};
+
+#endif // QUERYCACHE_H
@@ -0,0 +1,124 @@
+#include "QueryCursor.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+bool older(const SensorReading& a, const SensorReading& b) {
+    return a.timestampMs < b.timestampMs;
+}
+}
+
+bool QueryCursor::byStart(const File& a, const File& b) {
+    return a.segment.startMs < b.segment.startMs;
+}
+
+QueryCursor::QueryCursor(TimeSeriesStore& store, std::shared_mutex& storeMutex,
+                         std::vector<SeriesIndex::Segment> files, std::vector<SensorReading> buffered,
+                         uint64_t startMs, uint64_t endMs, ScanPool* pool)
+    : sources_{Source{&store, &storeMutex}},
+      startMs_(startMs),
+      endMs_(endMs),
+      pool_(pool),
+      wave_(pool ? pool->parallelism() : 1),
+      nextFile_(0),
+      row_(0),
+      pending_(std::move(buffered)),
+      delivered_(0)
+{
+    files_.reserve(files.size());
+    for (auto& file : files) {
+        files_.push_back(File{std::move(file), 0});
+    }
+    std::stable_sort(files_.begin(), files_.end(), byStart);
+    if (!std::is_sorted(pending_.begin(), pending_.end(), older)) {
+        std::stable_sort(pending_.begin(), pending_.end(), older);
+    }
+}
+
+std::unique_ptr<QueryCursor> QueryCursor::merge(std::vector<std::unique_ptr<QueryCursor>> parts) {
+    if (parts.empty()) return nullptr;
+    std::unique_ptr<QueryCursor> merged = std::move(parts[0]);
+    for (size_t p = 1; p < parts.size(); ++p) {
+        QueryCursor& part = *parts[p];
+        const size_t offset = merged->sources_.size();
+        merged->sources_.insert(merged->sources_.end(), part.sources_.begin(), part.sources_.end());
+        for (auto& file : part.files_) {
+            merged->files_.push_back(File{std::move(file.segment), file.source + offset});
+        }
+
+        std::vector<SensorReading> pending;
+        pending.reserve(merged->pending_.size() + part.pending_.size());
+        std::merge(merged->pending_.begin(), merged->pending_.end(), part.pending_.begin(),
+                   part.pending_.end(), std::back_inserter(pending), older);
+        merged->pending_.swap(pending);
+    }
+    std::stable_sort(merged->files_.begin(), merged->files_.end(), byStart);
+    return merged;
+}
+
+size_t QueryCursor::next(SensorReading* out, size_t max) {
+    size_t n = 0;
+    while (n < max && (row_ < rows_.size() || refill())) {
+        const size_t take = std::min(max - n, rows_.size() - row_);
+        std::copy(rows_.begin() + static_cast<long>(row_),
+                  rows_.begin() + static_cast<long>(row_ + take), out + n);
+        row_ += take;
+        n += take;
+    }
+    delivered_ += n;
+    return n;
+}
+
+bool QueryCursor::done() {
+    return row_ >= rows_.size() && !refill();
+}
+
+bool QueryCursor::refill() {
+    rows_.clear();
+    row_ = 0;
+
+    while (true) {
+        // Lo anterior al inicio del próximo archivo ya no puede tener nada antes
+        auto ready = pending_.end();
+        if (nextFile_ < files_.size()) {
+            const uint64_t limit = files_[nextFile_].segment.startMs;
+            ready = std::lower_bound(pending_.begin(), pending_.end(), limit,
+                [](const SensorReading& r, uint64_t t) { return r.timestampMs < t; });
+        }
+        if (ready != pending_.begin()) {
+            rows_.assign(pending_.begin(), ready);
+            pending_.erase(pending_.begin(), ready);
+            return true;
+        }
+        if (nextFile_ >= files_.size()) return false;
+
+        // Siguiente tanda: un archivo por hilo, ya mezclados por timestamp.
+        // Cada tarea toma compartido el lock de su store mientras lee
+        const size_t first = nextFile_;
+        const size_t count = std::min(wave_, files_.size() - nextFile_);
+        nextFile_ += count;
+        std::vector<std::vector<SensorReading>> runs(count);
+        const auto read = [&](size_t i) {
+            const File& file = files_[first + i];
+            const Source& source = sources_[file.source];
+            {
+                std::shared_lock<std::shared_mutex> lock(*source.mutex);
+                source.store->readSegment(file.segment, startMs_, endMs_, runs[i]);
+            }
+            TimeSeriesStore::sortByTime(runs[i]);
+        };
+        if (pool_) {
+            pool_->run(count, read);
+        } else {
+            for (size_t i = 0; i < count; ++i) read(i);
+        }
+        TimeSeriesStore::mergeByTime(runs, loaded_);
+        if (loaded_.empty()) continue;
+
+        rows_.reserve(pending_.size() + loaded_.size());
+        std::merge(pending_.begin(), pending_.end(), loaded_.begin(), loaded_.end(),
+                   std::back_inserter(rows_), older);
+        pending_.swap(rows_);
+        rows_.clear();
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef QUERYCURSOR_H
+#define QUERYCURSOR_H
+
+#include "TimeSeriesStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+/**
+ * Consulta de lecturas que se entrega por partes.
+ *
+ * Al abrirse (MemTable::openCursor) guarda la lista de archivos candidatos
+ * con su tamaño de ese momento y una copia de lo que estaba en memoria sin
+ * volcar; las lecturas se producen recién al pedir cada página, leyendo
+ * una tanda de archivos (en paralelo si hay ScanPool). Lo que se guarde
+ * después de abrir el cursor no aparece, así que un volcado del MemTable
+ * entre páginas no duplica ni pierde filas.
+ *
+ * Las lecturas salen en orden de timestamp entre todos los archivos: se
+ * recorren por inicio y, como ningún registro es anterior al inicio de su
+ * archivo, lo leído antes del inicio del próximo archivo ya es definitivo.
+ *
+ * Una consulta que abarca varios discos (StorageShard) junta con merge()
+ * los cursores de cada uno: los archivos de todos se recorren en el mismo
+ * orden, cada uno con el lock de su store.
+ *
+ * No es thread-safe: cada cursor lo usa un solo hilo a la vez.
+ */
+class QueryCursor {
+ public:
+    /**
+     * @param storeMutex protege store; se toma compartido solo mientras se lee cada archivo.
+     * @param files archivos a recorrer, con la cantidad de registros a leer de cada uno.
+     * @param buffered lecturas en memoria que cumplen la consulta.
+     * @param pool hilos para leer una tanda de archivos a la vez; puede ser nulo.
+     */
+    QueryCursor(TimeSeriesStore& store, std::shared_mutex& storeMutex,
+                std::vector<SeriesIndex::Segment> files, std::vector<SensorReading> buffered,
+                uint64_t startMs, uint64_t endMs, ScanPool* pool = nullptr);
+
+    /**
+     * Junta en uno cursores recién abiertos (sin lecturas entregadas) sobre
+     * stores distintos con la misma consulta. Usa el pool del primero.
+     */
+    static std::unique_ptr<QueryCursor> merge(std::vector<std::unique_ptr<QueryCursor>> parts);
+
+    /**
+     * Escribe en out hasta max lecturas siguientes.
+     * @return cuántas escribió; menos que max solo si la consulta terminó.
+     */
+    size_t next(SensorReading* out, size_t max);
+
+    /// No quedan lecturas por entregar.
+    bool done();
+
+    /// Lecturas entregadas hasta ahora.
+    uint64_t delivered() const { return delivered_; }
+
+ private:
+    struct Source {
+        TimeSeriesStore* store;
+        std::shared_mutex* mutex;
+    };
+    struct File {
+        SeriesIndex::Segment segment;
+        size_t source;                   // índice en sources_
+    };
+
+    std::vector<Source> sources_;
+    std::vector<File> files_;            // ordenados por inicio
+    uint64_t startMs_;
+    uint64_t endMs_;
+    ScanPool* pool_;
+    size_t wave_;                        // archivos por tanda
+
+    size_t nextFile_;                    // próximo archivo a leer
+    std::vector<SensorReading> rows_;    // lecturas ya en orden listas para entregar
+    size_t row_;                         // próxima fila de rows_ a entregar
+    std::vector<SensorReading> pending_; // leídas, ordenadas, que pueden tener otras antes
+    std::vector<SensorReading> loaded_;  // última tanda ya mezclada
+    uint64_t delivered_;
+
+    static bool byStart(const File& a, const File& b);
+    // Deja en rows_ las próximas lecturas definitivas; false si no queda nada
+    bool refill();
+
+    QueryCursor(const QueryCursor&) = delete;
+    QueryCursor& operator=(const QueryCursor&) = delete;
+};
+
+#endif // QUERYCURSOR_H
@@ -0,0 +1,52 @@
+#include "ReplayFilter.h"
+#include <algorithm>
+
+bool ReplayFilter::seen(uint64_t peer, uint32_t seq) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = peers_.find(peer);
+    if (it == peers_.end()) return false;
+    const Window& window = it->second;
+    // Diferencias en uint32_t: el seq da la vuelta
+    const uint32_t behind = window.highest - seq;
+    if (behind >= WINDOW) return false;     // más nuevo o fuera de la ventana
+    return window.bits[seq % WINDOW];
+}
+
+void ReplayFilter::applied(uint64_t peer, uint32_t seq) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = peers_.find(peer);
+    if (it == peers_.end()) {
+        if (peers_.size() >= MAX_PEERS) {
+            // Lleno: sale el emisor usado hace más tiempo (MAX_PEERS es chico, se recorre)
+            peers_.erase(std::min_element(peers_.begin(), peers_.end(), [](const auto& a, const auto& b) {
+                return a.second.lastUse < b.second.lastUse;
+            }));
+        }
+        Window& window = peers_[peer];
+        window.highest = seq;
+        window.bits.set(seq % WINDOW);
+        window.lastUse = ++uses_;
+        return;
+    }
+
+    Window& window = it->second;
+    window.lastUse = ++uses_;
+    const uint32_t ahead = seq - window.highest;
+    if (ahead != 0 && ahead < UINT32_MAX / 2) {
+        // Avanza: lo que sale de la ventana se olvida
+        if (ahead >= WINDOW) {
+            window.bits.reset();
+        } else {
+            for (uint32_t s = window.highest + 1; s != seq; ++s) window.bits.reset(s % WINDOW);
+        }
+        window.highest = seq;
+        window.bits.set(seq % WINDOW);
+    } else if (window.highest - seq < WINDOW) {
+        window.bits.set(seq % WINDOW);
+    } else {
+        // Muy atrás: otro emisor en el mismo puerto (p. ej. reinició), su ventana empieza aquí
+        window.highest = seq;
+        window.bits.reset();
+        window.bits.set(seq % WINDOW);
+    }
+}
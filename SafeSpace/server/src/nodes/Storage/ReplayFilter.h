@@ -0,0 +1,47 @@
+#ifndef REPLAYFILTER_H
+#define REPLAYFILTER_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * Seq de replicación ya aplicados por cada emisor (MessageHeader::FLAG_REPLICATED).
+ *
+ * El SafeSpaceServer reenvía una escritura hasta que llega su ACK; si lo
+ * que se perdió fue el ACK, la escritura llega dos veces y no se debe
+ * guardar de nuevo. Por emisor (ip:puerto) se recuerda el seq más alto y
+ * cuáles de los WINDOW anteriores se aplicaron, como la ventana
+ * anti-replay de IPsec. Un seq más viejo que la ventana se aplica igual y
+ * la reinicia: nadie reenvía tan atrás, así que es de otro emisor que reusó
+ * el puerto. Por eso los emisores arrancan su seq al azar.
+ * Con MAX_PEERS emisores se olvida el que lleva más tiempo sin escribir.
+ *
+ * Thread-safe.
+ */
+class ReplayFilter {
+ public:
+    static constexpr uint32_t WINDOW = 1024;
+    static constexpr size_t MAX_PEERS = 64;
+
+    /// El emisor ya aplicó seq.
+    bool seen(uint64_t peer, uint32_t seq) const;
+
+    /// Marca seq como aplicado.
+    void applied(uint64_t peer, uint32_t seq);
+
+ private:
+    struct Window {
+        uint32_t highest = 0;
+        std::bitset<WINDOW> bits;   // bits[seq % WINDOW] para seq en (highest - WINDOW, highest]
+        uint64_t lastUse = 0;       // valor de uses_ en su último applied()
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, Window> peers_;
+    uint64_t uses_ = 0;
+};
+
+#endif // REPLAYFILTER_H
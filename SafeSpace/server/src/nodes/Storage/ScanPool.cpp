@@ -0,0 +1,77 @@
+#include "ScanPool.h"
+#include <algorithm>
+
+ScanPool::ScanPool(size_t threads)
+    : stopping_(false)
+{
+    if (threads == 0) {
+        const unsigned cores = std::thread::hardware_concurrency();
+        threads = cores > 1 ? cores - 1 : 0;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(&ScanPool::work, this);
+    }
+}
+
+ScanPool::~ScanPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ScanPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) return;
+    if (count == 1 || workers_.empty()) {
+        for (size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->task = &task;
+    job->count = count;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobs_.push_back(job);
+    if (count - 1 < workers_.size()) {
+        for (size_t i = 1; i < count; ++i) wake_.notify_one();
+    } else {
+        wake_.notify_all();
+    }
+
+    // El que llama también trabaja; después espera las que tomaron otros
+    drain(job, lock);
+    job->done.wait(lock, [&job] { return job->finished == job->count; });
+}
+
+void ScanPool::work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+        if (stopping_) return;
+        const std::shared_ptr<Job> job = jobs_.front();
+        drain(job, lock);
+    }
+}
+
+void ScanPool::drain(const std::shared_ptr<Job>& job, std::unique_lock<std::mutex>& lock) {
+    while (job->next < job->count) {
+        const size_t i = job->next++;
+        if (job->next == job->count) {
+            // Ya no quedan tareas sin tomar: nadie más debe verlo
+            jobs_.erase(std::find(jobs_.begin(), jobs_.end(), job));
+        }
+
+        lock.unlock();
+        (*job->task)(i);
+        lock.lock();
+
+        if (++job->finished == job->count) {
+            job->done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef SCANPOOL_H
+#define SCANPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Hilos para leer y decodificar varios archivos de una consulta a la vez.
+ *
+ * run() reparte count tareas (una por archivo) entre los hilos del pool y
+ * el hilo que llama, que también trabaja, y vuelve cuando terminaron todas.
+ * Las tareas solo leen: el lock del store lo tiene compartido el que llama
+ * mientras dura run(), o cada tarea mientras lee su archivo (QueryCursor,
+ * que puede leer de varios stores en la misma tanda).
+ *
+ * Thread-safe: varias consultas pueden llamar a run() a la vez.
+ */
+class ScanPool {
+ public:
+    /// @param threads hilos además del que llama; 0 = núcleos - 1.
+    explicit ScanPool(size_t threads);
+    ~ScanPool();
+
+    /// Hilos que trabajan en una consulta, contando al que llama.
+    size_t parallelism() const { return workers_.size() + 1; }
+
+    /// Corre task(0) .. task(count - 1) y espera a que terminen.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+ private:
+    struct Job {
+        const std::function<void(size_t)>* task;
+        size_t count;
+        size_t next = 0;        // próxima tarea sin tomar
+        size_t finished = 0;
+        std::condition_variable done;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::shared_ptr<Job>> jobs_;   // con tareas sin tomar
+    bool stopping_;
+    std::vector<std::thread> workers_;
+
+    void work();
+    // Toma y corre tareas de job hasta que no quede ninguna sin tomar; lock tomado
+    void drain(const std::shared_ptr<Job>& job, std::unique_lock<std::mutex>& lock);
+
+    ScanPool(const ScanPool&) = delete;
+    ScanPool& operator=(const ScanPool&) = delete;
+};
+
+#endif // SCANPOOL_H
@@ -0,0 +1,81 @@
+#ifndef SENSORCOLUMNS_H
+#define SENSORCOLUMNS_H
+
+#include "../../model/structures/SensorBatch.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Campos de una lectura en orden de SensorData
+constexpr size_t SENSOR_FIELDS = 6;
+
+/**
+ * Lecturas de un sensor en columnas: un arreglo de timestamps y uno por
+ * campo, todos de count elementos. Los punteros son de quien lo entrega y
+ * valen solo durante la visita.
+ */
+struct ColumnBlock {
+    uint16_t sensorId = 0;
+    size_t count = 0;
+    const uint64_t* timestampMs = nullptr;
+    const float* fields[SENSOR_FIELDS] = {};
+};
+
+/// Columnas propias, para armar un ColumnBlock a partir de filas.
+class ColumnBuffer {
+ public:
+    void clear() {
+        timestampMs_.clear();
+        for (auto& column : fields_) column.clear();
+    }
+
+    void push(const SensorReading& r) {
+        timestampMs_.push_back(r.timestampMs);
+        fields_[0].push_back(r.distance);
+        fields_[1].push_back(r.temperature);
+        fields_[2].push_back(r.pressure);
+        fields_[3].push_back(r.altitude);
+        fields_[4].push_back(r.sealevelPressure);
+        fields_[5].push_back(r.realAltitude);
+    }
+
+    size_t size() const { return timestampMs_.size(); }
+
+    /// Deja n elementos por columna; los nuevos quedan sin inicializar a efectos del llamador.
+    void resize(size_t n) {
+        timestampMs_.resize(n);
+        for (auto& column : fields_) column.resize(n);
+    }
+
+    uint64_t* timestampMs() { return timestampMs_.data(); }
+    float* field(size_t f) { return fields_[f].data(); }
+
+    ColumnBlock block(uint16_t sensorId) const {
+        ColumnBlock b;
+        b.sensorId = sensorId;
+        b.count = timestampMs_.size();
+        b.timestampMs = timestampMs_.data();
+        for (size_t f = 0; f < SENSOR_FIELDS; ++f) b.fields[f] = fields_[f].data();
+        return b;
+    }
+
+ private:
+    std::vector<uint64_t> timestampMs_;
+    std::vector<float> fields_[SENSOR_FIELDS];
+};
+
+/// Fila i de un bloque.
+inline SensorReading readingAt(const ColumnBlock& block, size_t i) {
+    SensorReading r;
+    r.sensorId = block.sensorId;
+    r.timestampMs = block.timestampMs[i];
+    r.distance = block.fields[0][i];
+    r.temperature = block.fields[1][i];
+    r.pressure = block.fields[2][i];
+    r.altitude = block.fields[3][i];
+    r.sealevelPressure = block.fields[4][i];
+    r.realAltitude = block.fields[5][i];
+    return r;
+}
+
+#endif // SENSORCOLUMNS_H
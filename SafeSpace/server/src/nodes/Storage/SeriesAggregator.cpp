@@ -0,0 +1,82 @@
+#include "SeriesAggregator.h"
+#include <algorithm>
+#include <limits>
+
+SeriesAggregator::SeriesAggregator(uint64_t startMs, uint64_t endMs, uint64_t bucketMs, uint8_t fields)
+    : startMs_(startMs),
+      endMs_(endMs),
+      bucketMs_(bucketMs),
+      firstBucket_(startMs / bucketMs),
+      fields_(static_cast<uint8_t>(fields & ALL_FIELDS)),
+      readings_(0),
+      kernels_(ColumnKernels::best())
+{
+    buckets_.resize(static_cast<size_t>(bucketCount(startMs, endMs, bucketMs)));
+    for (size_t b = 0; b < buckets_.size(); ++b) {
+        Bucket& bucket = buckets_[b];
+        bucket.startMs = (firstBucket_ + b) * bucketMs_;
+        for (size_t f = 0; f < FIELD_COUNT; ++f) {
+            bucket.min[f] = std::numeric_limits<float>::infinity();
+            bucket.max[f] = -std::numeric_limits<float>::infinity();
+            bucket.sum[f] = 0;
+        }
+    }
+}
+
+uint64_t SeriesAggregator::bucketCount(uint64_t startMs, uint64_t endMs, uint64_t bucketMs) {
+    if (bucketMs == 0 || endMs < startMs) return 0;
+    return endMs / bucketMs - startMs / bucketMs + 1;
+}
+
+void SeriesAggregator::add(const ColumnBlock& block) {
+    // Los segmentos guardan las lecturas casi en orden, así que el bloque
+    // se parte en pocos tramos largos del mismo intervalo
+    const uint64_t* ts = block.timestampMs;
+    size_t begin = 0;
+    while (begin < block.count) {
+        if (ts[begin] < startMs_ || ts[begin] > endMs_) {
+            ++begin;
+            continue;
+        }
+        const uint64_t bucketIndex = ts[begin] / bucketMs_;
+        const uint64_t lo = std::max(bucketIndex * bucketMs_, startMs_);
+        const uint64_t hi = std::min(bucketIndex * bucketMs_ + (bucketMs_ - 1), endMs_);
+        size_t end = begin + 1;
+        while (end < block.count && ts[end] >= lo && ts[end] <= hi) {
+            ++end;
+        }
+
+        Bucket& bucket = buckets_[static_cast<size_t>(bucketIndex - firstBucket_)];
+        bucket.count += static_cast<uint32_t>(end - begin);
+        for (size_t f = 0; f < FIELD_COUNT; ++f) {
+            if (fields_ & (1u << f)) {
+                kernels_.minMaxSum(block.fields[f] + begin, end - begin,
+                                   bucket.min[f], bucket.max[f], bucket.sum[f]);
+            }
+        }
+        readings_ += end - begin;
+        begin = end;
+    }
+}
+
+void SeriesAggregator::add(const Bucket& rollup) {
+    if (rollup.count == 0 || rollup.startMs < startMs_ || rollup.startMs > endMs_) return;
+    Bucket& bucket = buckets_[static_cast<size_t>(rollup.startMs / bucketMs_ - firstBucket_)];
+    bucket.count += rollup.count;
+    for (size_t f = 0; f < FIELD_COUNT; ++f) {
+        if (fields_ & (1u << f)) {
+            bucket.min[f] = rollup.min[f] < bucket.min[f] ? rollup.min[f] : bucket.min[f];
+            bucket.max[f] = rollup.max[f] > bucket.max[f] ? rollup.max[f] : bucket.max[f];
+            bucket.sum[f] += rollup.sum[f];
+        }
+    }
+    readings_ += rollup.count;
+}
+
+std::vector<SeriesAggregator::Bucket> SeriesAggregator::finish() const {
+    std::vector<Bucket> filled;
+    for (const auto& bucket : buckets_) {
+        if (bucket.count > 0) filled.push_back(bucket);
+    }
+    return filled;
+}
@@ -0,0 +1,77 @@
+#ifndef SERIESAGGREGATOR_H
+#define SERIESAGGREGATOR_H
+
+#include "ColumnKernels.h"
+#include "SensorColumns.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Agregación por intervalos (min / max / promedio / cantidad) de lecturas.
+ *
+ * Recibe bloques de columnas (TimeSeriesStore::scanSensorColumns) y los
+ * reduce por tramos del mismo intervalo con ColumnKernels, así cada campo
+ * pedido se recorre como un arreglo contiguo de floats. Los intervalos
+ * están alineados a múltiplos de bucketMs desde la época, de modo que uno
+ * de 60 s coincide con los minutos del reloj.
+ */
+class SeriesAggregator {
+ public:
+    // Campos que se pueden pedir; el orden es el de SensorData
+    enum Field : uint8_t {
+        DISTANCE = 0x01,
+        TEMPERATURE = 0x02,
+        PRESSURE = 0x04,
+        ALTITUDE = 0x08,
+        SEALEVEL_PRESSURE = 0x10,
+        REAL_ALTITUDE = 0x20,
+        ALL_FIELDS = 0x3F
+    };
+    static constexpr size_t FIELD_COUNT = SENSOR_FIELDS;
+
+    struct Bucket {
+        uint64_t startMs = 0;
+        uint32_t count = 0;
+        float min[FIELD_COUNT];
+        float max[FIELD_COUNT];
+        double sum[FIELD_COUNT];
+    };
+
+    /**
+     * @param bucketMs ancho de cada intervalo (> 0).
+     * @param fields máscara de Field; solo esos campos se calculan.
+     */
+    SeriesAggregator(uint64_t startMs, uint64_t endMs, uint64_t bucketMs, uint8_t fields);
+
+    /// Cantidad de intervalos que cubre [startMs, endMs].
+    static uint64_t bucketCount(uint64_t startMs, uint64_t endMs, uint64_t bucketMs);
+
+    /// Suma las lecturas del bloque; las que caen fuera de [startMs, endMs] se ignoran.
+    void add(const ColumnBlock& block);
+
+    /**
+     * Suma un intervalo ya resumido (TimeSeriesStore::scanSensorRollups)
+     * entero al intervalo donde empieza; se ignora si empieza fuera de
+     * [startMs, endMs]. Conviene que bucketMs sea múltiplo de su ancho.
+     */
+    void add(const Bucket& rollup);
+
+    /// Los intervalos con al menos una lectura.
+    std::vector<Bucket> finish() const;
+
+    uint64_t readings() const { return readings_; }
+    uint8_t fields() const { return fields_; }
+
+ private:
+    uint64_t startMs_;
+    uint64_t endMs_;
+    uint64_t bucketMs_;
+    uint64_t firstBucket_;                   // startMs_ / bucketMs_
+    uint8_t fields_;
+    std::vector<Bucket> buckets_;            // uno por intervalo del rango
+    uint64_t readings_;
+    const ColumnKernels& kernels_;
+};
+
+#endif // SERIESAGGREGATOR_H
@@ -0,0 +1,289 @@
+#include "SeriesCodec.h"
+#include <cstring>
+
+namespace {
+// Entero con signo en bits bits (complemento a dos) y de vuelta
+uint64_t packSigned(int64_t value, unsigned bits) {
+    return static_cast<uint64_t>(value) & ((1ull << bits) - 1);
+}
+
+int64_t unpackSigned(uint64_t value, unsigned bits) {
+    const uint64_t sign = 1ull << (bits - 1);
+    return static_cast<int64_t>((value ^ sign) - sign);
+}
+
+// Anchos de la delta-of-delta: prefijo '0', '10', '110', '1110', '1111'
+struct DodClass {
+    uint64_t prefix;
+    unsigned prefixBits;
+    unsigned bits;
+};
+constexpr DodClass DOD_CLASSES[] = {{0x2, 2, 7}, {0x6, 3, 9}, {0xE, 4, 12}};
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+}
+
+void BitWriter::write(uint64_t value, unsigned bits) {
+    while (bits > 0) {
+        if (used_ == 8) {
+            bytes_.push_back(0);
+            used_ = 0;
+        }
+        const unsigned room = 8 - used_;
+        const unsigned take = bits < room ? bits : room;
+        const uint64_t chunk = (value >> (bits - take)) & ((1u << take) - 1);
+        bytes_.back() |= static_cast<uint8_t>(chunk << (room - take));
+        used_ += take;
+        bits -= take;
+    }
+}
+
+bool BitReader::read(unsigned bits, uint64_t& out) {
+    if (bit_ + bits > size_ * 8) return false;
+    if (bits == 0) {
+        out = 0;
+        return true;
+    }
+
+    // Camino rápido: 8 bytes de una vez cuando quedan y el valor entra
+    const unsigned offset = static_cast<unsigned>(bit_ % 8);
+    if (bits + offset <= 64 && bit_ / 8 + sizeof(uint64_t) <= size_) {
+        uint64_t word;
+        std::memcpy(&word, data_ + bit_ / 8, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        out = (word << offset) >> (64 - bits);
+        bit_ += bits;
+        return true;
+    }
+
+    uint64_t value = 0;
+    while (bits > 0) {
+        const unsigned offset = static_cast<unsigned>(bit_ % 8);
+        const unsigned room = 8 - offset;
+        const unsigned take = bits < room ? bits : room;
+        const unsigned chunk = (data_[bit_ / 8] >> (room - take)) & ((1u << take) - 1);
+        value = (value << take) | chunk;
+        bit_ += take;
+        bits -= take;
+    }
+    out = value;
+    return true;
+}
+
+void TimestampEncoder::add(uint64_t timestampMs) {
+    if (count_++ == 0) {
+        out_.write(timestampMs, 64);
+        previous_ = timestampMs;
+        return;
+    }
+
+    // Aritmética sin signo: el desorden da deltas negativas sin desbordar
+    const int64_t delta = static_cast<int64_t>(timestampMs - previous_);
+    const int64_t dod = static_cast<int64_t>(static_cast<uint64_t>(delta) - static_cast<uint64_t>(delta_));
+    previous_ = timestampMs;
+    delta_ = delta;
+
+    if (dod == 0) {
+        out_.write(0, 1);
+        return;
+    }
+    for (const auto& c : DOD_CLASSES) {
+        const int64_t limit = 1ll << (c.bits - 1);
+        if (dod >= -limit && dod < limit) {
+            out_.write(c.prefix, c.prefixBits);
+            out_.write(packSigned(dod, c.bits), c.bits);
+            return;
+        }
+    }
+    out_.write(0xF, 4);
+    out_.write(static_cast<uint64_t>(dod), 64);
+}
+
+bool TimestampDecoder::next(uint64_t& timestampMs) {
+    uint64_t value;
+    if (count_++ == 0) {
+        if (!in_.read(64, value)) return false;
+        previous_ = timestampMs = value;
+        return true;
+    }
+
+    // Prefijo: cantidad de unos antes del primer cero, hasta cuatro
+    unsigned ones = 0;
+    uint64_t bit;
+    while (ones < 4) {
+        if (!in_.read(1, bit)) return false;
+        if (bit == 0) break;
+        ++ones;
+    }
+
+    int64_t dod = 0;
+    if (ones == 4) {
+        if (!in_.read(64, value)) return false;
+        dod = static_cast<int64_t>(value);
+    } else if (ones > 0) {
+        const unsigned bits = DOD_CLASSES[ones - 1].bits;
+        if (!in_.read(bits, value)) return false;
+        dod = unpackSigned(value, bits);
+    }
+
+    delta_ = static_cast<int64_t>(static_cast<uint64_t>(delta_) + static_cast<uint64_t>(dod));
+    previous_ += static_cast<uint64_t>(delta_);
+    timestampMs = previous_;
+    return true;
+}
+
+void FloatEncoder::add(float value) {
+    const uint32_t bits = floatBits(value);
+    if (count_++ == 0) {
+        out_.write(bits, 32);
+        previous_ = bits;
+        return;
+    }
+
+    const uint32_t x = bits ^ previous_;
+    previous_ = bits;
+    if (x == 0) {
+        out_.write(0, 1);
+        return;
+    }
+
+    const unsigned leading = static_cast<unsigned>(__builtin_clz(x));
+    const unsigned trailing = static_cast<unsigned>(__builtin_ctz(x));
+    if (window_ && leading >= leading_ && trailing >= trailing_) {
+        // '10': entra en la ventana del anterior
+        out_.write(0x2, 2);
+        out_.write(x >> trailing_, 32 - leading_ - trailing_);
+        return;
+    }
+
+    // '11' + ceros a la izquierda (5 bits) + largo - 1 (5 bits) + bits significativos
+    const unsigned length = 32 - leading - trailing;
+    out_.write(0x3, 2);
+    out_.write(leading, 5);
+    out_.write(length - 1, 5);
+    out_.write(x >> trailing, length);
+    leading_ = leading;
+    trailing_ = trailing;
+    window_ = true;
+}
+
+bool FloatDecoder::next(float& value) {
+    uint64_t bits;
+    if (count_++ == 0) {
+        if (!in_.read(32, bits)) return false;
+        previous_ = static_cast<uint32_t>(bits);
+        std::memcpy(&value, &previous_, sizeof(value));
+        return true;
+    }
+
+    if (!in_.read(1, bits)) return false;
+    if (bits == 1) {
+        if (!in_.read(1, bits)) return false;
+        if (bits == 1) {
+            uint64_t leading, length;
+            if (!in_.read(5, leading) || !in_.read(5, length)) return false;
+            ++length;
+            if (leading + length > 32) return false;
+            leading_ = static_cast<unsigned>(leading);
+            trailing_ = static_cast<unsigned>(32 - leading - length);
+            window_ = true;
+        } else if (!window_) {
+            return false;
+        }
+
+        uint64_t meaningful;
+        if (!in_.read(32 - leading_ - trailing_, meaningful)) return false;
+        previous_ ^= static_cast<uint32_t>(meaningful << trailing_);
+    }
+    std::memcpy(&value, &previous_, sizeof(value));
+    return true;
+}
+
+void SegmentEncoder::add(const SensorReading& reading) {
+    const float fields[SENSOR_FIELDS] = {reading.distance, reading.temperature, reading.pressure,
+                                         reading.altitude, reading.sealevelPressure, reading.realAltitude};
+    timestamps_.add(reading.timestampMs);
+    for (size_t f = 0; f < SENSOR_FIELDS; ++f) fields_[f].add(fields[f]);
+    ++count_;
+}
+
+std::string SegmentEncoder::finish() const {
+    uint32_t header[3 + SENSOR_FIELDS];
+    header[0] = SegmentDecoder::MAGIC;
+    header[1] = static_cast<uint32_t>(count_);
+    header[2] = static_cast<uint32_t>(timestamps_.bytes().size());
+    for (size_t f = 0; f < SENSOR_FIELDS; ++f) {
+        header[3 + f] = static_cast<uint32_t>(fields_[f].bytes().size());
+    }
+
+    std::string out(reinterpret_cast<const char*>(header), sizeof(header));
+    out.append(timestamps_.bytes().begin(), timestamps_.bytes().end());
+    for (const auto& field : fields_) {
+        out.append(field.bytes().begin(), field.bytes().end());
+    }
+    return out;
+}
+
+bool SegmentDecoder::open(const uint8_t* data, size_t size, uint16_t sensorId) {
+    uint32_t header[3 + SENSOR_FIELDS];
+    if (size < HEADER_SIZE) return false;
+    std::memcpy(header, data, sizeof(header));
+    if (header[0] != MAGIC) return false;
+
+    size_t offset = HEADER_SIZE;
+    for (size_t s = 0; s <= SENSOR_FIELDS; ++s) {
+        const size_t length = header[2 + s];
+        if (length > size - offset) return false;
+        if (s == 0) {
+            timestamps_ = TimestampDecoder(data + offset, length);
+        } else {
+            fields_[s - 1] = FloatDecoder(data + offset, length);
+        }
+        offset += length;
+    }
+    sensorId_ = sensorId;
+    count_ = header[1];
+    read_ = 0;
+    return true;
+}
+
+bool SegmentDecoder::next(SensorReading& reading) {
+    if (read_ >= count_) return false;
+    float fields[SENSOR_FIELDS];
+    if (!timestamps_.next(reading.timestampMs)) return false;
+    for (size_t f = 0; f < SENSOR_FIELDS; ++f) {
+        if (!fields_[f].next(fields[f])) return false;
+    }
+    ++read_;
+    reading.sensorId = sensorId_;
+    reading.distance = fields[0];
+    reading.temperature = fields[1];
+    reading.pressure = fields[2];
+    reading.altitude = fields[3];
+    reading.sealevelPressure = fields[4];
+    reading.realAltitude = fields[5];
+    return true;
+}
+
+bool SegmentDecoder::readColumns(size_t n, ColumnBuffer& columns) {
+    if (read_ != 0 || n > count_) return false;
+    columns.resize(n);
+    uint64_t* ts = columns.timestampMs();
+    for (size_t i = 0; i < n; ++i) {
+        if (!timestamps_.next(ts[i])) return false;
+    }
+    for (size_t f = 0; f < SENSOR_FIELDS; ++f) {
+        float* column = columns.field(f);
+        for (size_t i = 0; i < n; ++i) {
+            if (!fields_[f].next(column[i])) return false;
+        }
+    }
+    read_ = n;
+    return true;
+}
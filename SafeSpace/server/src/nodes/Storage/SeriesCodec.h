@@ -0,0 +1,161 @@
+#ifndef SERIESCODEC_H
+#define SERIESCODEC_H
+
+#include "SensorColumns.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Compresión por columnas al estilo Gorilla para segmentos sellados.
+ *
+ * Timestamps: el primero entero, después la diferencia de diferencias
+ * (delta-of-delta) con un prefijo que elige el ancho: lecturas a intervalo
+ * casi fijo cuestan 1 bit, o 9 si traen unos pocos ms de jitter.
+ *
+ * Floats: el primero entero, después el XOR con el anterior. Un valor
+ * repetido cuesta 1 bit; si no, se guardan solo los bits significativos del
+ * XOR, reusando la ventana (ceros a la izquierda / derecha) del anterior
+ * cuando entra en ella.
+ *
+ * Cada columna es un flujo de bits independiente; los decodificadores lo
+ * recorren de a un valor, sin descomprimir todo primero.
+ *
+ * SegmentEncoder / SegmentDecoder arman con eso el archivo sellado de un
+ * sensor: una cabecera con la cantidad de lecturas y el largo de cada flujo
+ * (timestamps y los seis campos en el orden de SensorData), y los flujos
+ * uno detrás de otro.
+ */
+
+/// Escritor de bits, del más significativo al menos significativo.
+class BitWriter {
+ public:
+    /// Agrega los bits bajos de value (bits <= 64).
+    void write(uint64_t value, unsigned bits);
+
+    /// Bytes escritos; el último se completa con ceros.
+    const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+ private:
+    std::vector<uint8_t> bytes_;
+    unsigned used_ = 8;   // bits ocupados del último byte
+};
+
+/// Lector de un flujo escrito con BitWriter.
+class BitReader {
+ public:
+    BitReader() = default;
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    /// Lee bits (<= 64); false si el flujo se termina antes.
+    bool read(unsigned bits, uint64_t& out);
+
+ private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t bit_ = 0;
+};
+
+class TimestampEncoder {
+ public:
+    void add(uint64_t timestampMs);
+    const std::vector<uint8_t>& bytes() const { return out_.bytes(); }
+
+ private:
+    BitWriter out_;
+    size_t count_ = 0;
+    uint64_t previous_ = 0;
+    int64_t delta_ = 0;
+};
+
+class TimestampDecoder {
+ public:
+    TimestampDecoder() = default;
+    TimestampDecoder(const uint8_t* data, size_t size) : in_(data, size) {}
+
+    /// Siguiente timestamp; false si el flujo está corrupto o se terminó.
+    bool next(uint64_t& timestampMs);
+
+ private:
+    BitReader in_;
+    size_t count_ = 0;
+    uint64_t previous_ = 0;
+    int64_t delta_ = 0;
+};
+
+class FloatEncoder {
+ public:
+    void add(float value);
+    const std::vector<uint8_t>& bytes() const { return out_.bytes(); }
+
+ private:
+    BitWriter out_;
+    size_t count_ = 0;
+    uint32_t previous_ = 0;
+    unsigned leading_ = 0;
+    unsigned trailing_ = 0;
+    bool window_ = false;   // hay una ventana para reusar
+};
+
+class FloatDecoder {
+ public:
+    FloatDecoder() = default;
+    FloatDecoder(const uint8_t* data, size_t size) : in_(data, size) {}
+
+    /// Siguiente valor; false si el flujo está corrupto o se terminó.
+    bool next(float& value);
+
+ private:
+    BitReader in_;
+    size_t count_ = 0;
+    uint32_t previous_ = 0;
+    unsigned leading_ = 0;
+    unsigned trailing_ = 0;
+    bool window_ = false;
+};
+
+/// Archivo sellado de las lecturas de un sensor.
+class SegmentEncoder {
+ public:
+    void add(const SensorReading& reading);
+    size_t size() const { return count_; }
+
+    /// Cabecera y flujos, listos para escribir.
+    std::string finish() const;
+
+ private:
+    size_t count_ = 0;
+    TimestampEncoder timestamps_;
+    FloatEncoder fields_[SENSOR_FIELDS];
+};
+
+class SegmentDecoder {
+ public:
+    // Cabecera: magic, lecturas y largo de los 1 + SENSOR_FIELDS flujos (u32 del host)
+    static constexpr uint32_t MAGIC = 0x31475353;   // "SSG1"
+    static constexpr size_t HEADER_SIZE = (3 + SENSOR_FIELDS) * sizeof(uint32_t);
+
+    /**
+     * Valida la cabecera de data, que debe seguir viva mientras se use.
+     * @return false si no es un archivo sellado o está truncado.
+     */
+    bool open(const uint8_t* data, size_t size, uint16_t sensorId);
+
+    size_t size() const { return count_; }
+
+    /// Siguiente lectura, en el orden en que se agregaron; false al terminar o si está corrupto.
+    bool next(SensorReading& reading);
+
+    /// Las primeras n lecturas en columnas, una columna entera por vez.
+    bool readColumns(size_t n, ColumnBuffer& columns);
+
+ private:
+    uint16_t sensorId_ = 0;
+    size_t count_ = 0;
+    size_t read_ = 0;
+    TimestampDecoder timestamps_;
+    FloatDecoder fields_[SENSOR_FIELDS];
+};
+
+#endif // SERIESCODEC_H
@@ -0,0 +1,155 @@
+#include "SeriesCompactor.h"
+#include <iostream>
+
+namespace {
+uint64_t olderThan(uint64_t nowMs, std::chrono::hours age) {
+    const uint64_t ageMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(age).count());
+    return nowMs > ageMs ? nowMs - ageMs : 0;
+}
+}
+
+SeriesCompactor::SeriesCompactor(TimeSeriesStore& store, std::shared_mutex& storeMutex,
+                                 std::function<bool()> busy, Options options)
+    : store_(store),
+      storeMutex_(storeMutex),
+      busy_(std::move(busy)),
+      options_(options),
+      stats_(),
+      stopping_(false)
+{
+    stats_.phase = "idle";
+    worker_ = std::thread(&SeriesCompactor::run, this);
+}
+
+SeriesCompactor::SeriesCompactor(TimeSeriesStore& store, std::shared_mutex& storeMutex,
+                                 std::function<bool()> busy)
+    : SeriesCompactor(store, storeMutex, std::move(busy), Options()) {}
+
+SeriesCompactor::~SeriesCompactor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+
+    const Stats s = stats();
+    std::cout << "[SeriesCompactor] Pasadas: " << s.passes << ", juntados: " << s.compactedFiles
+              << ", resumidos: " << s.rolledFiles << ", vencidos: " << s.expiredFiles
+              << ", bytes recuperados: " << s.reclaimedBytes << std::endl;
+}
+
+void SeriesCompactor::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        wake_.wait_for(lock, options_.interval, [this] { return stopping_; });
+        if (stopping_) break;
+
+        lock.unlock();
+        const uint64_t nowMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        runPass(nowMs);
+        lock.lock();
+    }
+}
+
+size_t SeriesCompactor::runPass(uint64_t nowMs) {
+    std::lock_guard<std::mutex> pass(passMutex_);
+    const auto started = std::chrono::steady_clock::now();
+    const Stats before = stats();
+
+    const uint64_t rawBefore = olderThan(nowMs, options_.rawRetention);
+    const uint64_t minuteBefore = olderThan(nowMs, options_.minuteRetention);
+    const uint64_t hourBefore = olderThan(nowMs, options_.hourRetention);
+    const size_t perStep = options_.filesPerStep;
+
+    // Fases en orden; cada una sigue mientras tenga trabajo y quede presupuesto
+    size_t steps = 0;
+    bool complete = true;
+    const auto phase = [&](const char* name, uint64_t Stats::*files, uint64_t Stats::*items,
+                           const std::function<bool(TimeSeriesStore::MaintenanceStep&)>& work) {
+        while (complete) {
+            if (steps >= options_.stepsPerPass || stopping() || (busy_ && busy_())) {
+                complete = false;
+                break;
+            }
+            if (!step(name, work, files, items)) break;
+            ++steps;
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_for(lock, options_.pause, [this] { return stopping_; });
+        }
+    };
+
+    phase("compact", &Stats::compactedFiles, nullptr, [&](TimeSeriesStore::MaintenanceStep& s) {
+        return store_.compactStep(perStep, s);
+    });
+    phase("rollup-minute", &Stats::rolledFiles, &Stats::rolledReadings, [&](TimeSeriesStore::MaintenanceStep& s) {
+        return store_.rollupStep(0, MINUTE_MS, rawBefore, perStep, s);
+    });
+    phase("rollup-hour", &Stats::rolledFiles, nullptr, [&](TimeSeriesStore::MaintenanceStep& s) {
+        return store_.rollupStep(MINUTE_MS, HOUR_MS, minuteBefore, perStep, s);
+    });
+    if (options_.hourRetention.count() > 0) {
+        phase("expire", &Stats::expiredFiles, nullptr, [&](TimeSeriesStore::MaintenanceStep& s) {
+            return store_.expireStep(HOUR_MS, hourBefore, perStep, s);
+        });
+    }
+
+    Stats after;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.passes++;
+        stats_.backlog = !complete;
+        stats_.phase = "idle";
+        stats_.lastPass = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started);
+        after = stats_;
+    }
+    if (steps > 0) {
+        std::cout << "[SeriesCompactor] Pasada: " << steps << " pasos, "
+                  << after.compactedFiles - before.compactedFiles << " juntados, "
+                  << after.rolledFiles - before.rolledFiles << " resumidos, "
+                  << after.expiredFiles - before.expiredFiles << " vencidos, "
+                  << after.reclaimedBytes - before.reclaimedBytes << " bytes recuperados"
+                  << (complete ? "" : " (continúa en la próxima)") << std::endl;
+    }
+    return steps;
+}
+
+bool SeriesCompactor::step(const char* phase,
+                           const std::function<bool(TimeSeriesStore::MaintenanceStep&)>& work,
+                           uint64_t Stats::*files, uint64_t Stats::*items) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.phase = phase;
+    }
+
+    TimeSeriesStore::MaintenanceStep done;
+    bool worked;
+    {
+        std::unique_lock<std::shared_mutex> store(storeMutex_);
+        worked = work(done);
+    }
+    if (!worked) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.steps++;
+    stats_.*files += done.filesRemoved;
+    if (items) stats_.*items += done.items;
+    stats_.writtenFiles += done.filesWritten;
+    stats_.reclaimedBytes += static_cast<int64_t>(done.bytesRemoved) - static_cast<int64_t>(done.bytesWritten);
+    return true;
+}
+
+bool SeriesCompactor::stopping() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stopping_;
+}
+
+SeriesCompactor::Stats SeriesCompactor::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,99 @@
+#ifndef SERIESCOMPACTOR_H
+#define SERIESCOMPACTOR_H
+
+#include "TimeSeriesStore.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+/**
+ * Mantenimiento de fondo de TimeSeriesStore.
+ *
+ * Un hilo hace una pasada cada interval: junta segmentos chicos, resume
+ * las lecturas más viejas que rawRetention en intervalos de un minuto, los
+ * minutos más viejos que minuteRetention en horas, y borra las horas más
+ * viejas que hourRetention. Cada paso toca a lo sumo filesPerStep archivos
+ * con storeMutex tomado y después lo suelta durante pause, así un volcado
+ * del MemTable nunca espera más que un paso. Una pasada hace como mucho
+ * stepsPerPass pasos; lo que quede sigue en la próxima.
+ *
+ * Mientras busy() devuelva true (p. ej. hay consultas paginadas abiertas
+ * que leen archivos por nombre) no se toca nada.
+ */
+class SeriesCompactor {
+ public:
+    static constexpr uint64_t MINUTE_MS = 60 * 1000;
+    static constexpr uint64_t HOUR_MS = 60 * MINUTE_MS;
+
+    struct Options {
+        std::chrono::seconds interval{60};
+        std::chrono::hours rawRetention{24 * 7};       // después, en minutos
+        std::chrono::hours minuteRetention{24 * 90};   // después, en horas
+        std::chrono::hours hourRetention{24 * 730};    // después se borra; 0 = nunca
+        size_t filesPerStep = 16;
+        size_t stepsPerPass = 64;
+        std::chrono::milliseconds pause{20};
+    };
+
+    struct Stats {
+        uint64_t passes;
+        uint64_t steps;
+        uint64_t compactedFiles;      // segmentos chicos juntados
+        uint64_t rolledFiles;         // archivos pasados a un nivel más grueso
+        uint64_t rolledReadings;
+        uint64_t expiredFiles;
+        uint64_t writtenFiles;
+        int64_t reclaimedBytes;       // bytes borrados menos escritos
+        bool backlog;                 // la última pasada se cortó antes de terminar
+        const char* phase;            // lo que está haciendo ahora ("idle" entre pasadas)
+        std::chrono::milliseconds lastPass;
+    };
+
+    /**
+     * @param storeMutex protege store; se toma exclusivo de a un paso.
+     * @param busy si devuelve true la pasada se posterga; puede ser vacío.
+     */
+    SeriesCompactor(TimeSeriesStore& store, std::shared_mutex& storeMutex, std::function<bool()> busy,
+                    Options options);
+    SeriesCompactor(TimeSeriesStore& store, std::shared_mutex& storeMutex, std::function<bool()> busy);
+    /// Detiene el hilo; un paso en curso termina primero.
+    ~SeriesCompactor();
+
+    /**
+     * Hace una pasada ya, en el hilo que llama, con nowMs como hora de
+     * referencia para las retenciones.
+     * @return cuántos pasos hizo.
+     */
+    size_t runPass(uint64_t nowMs);
+
+    Stats stats() const;
+
+ private:
+    TimeSeriesStore& store_;
+    std::shared_mutex& storeMutex_;
+    std::function<bool()> busy_;
+    Options options_;
+
+    std::mutex passMutex_;             // una pasada a la vez
+    mutable std::mutex mutex_;         // stats_ y stopping_
+    std::condition_variable wake_;
+    Stats stats_;
+    bool stopping_;
+    std::thread worker_;
+
+    void run();
+    // Un paso con storeMutex tomado; suma lo borrado a files y lo procesado a
+    // items (si no es nulo). false si no había nada que hacer
+    bool step(const char* phase, const std::function<bool(TimeSeriesStore::MaintenanceStep&)>& work,
+              uint64_t Stats::*files, uint64_t Stats::*items);
+    bool stopping() const;
+
+    SeriesCompactor(const SeriesCompactor&) = delete;
+    SeriesCompactor& operator=(const SeriesCompactor&) = delete;
+};
+
+#endif // SERIESCOMPACTOR_H
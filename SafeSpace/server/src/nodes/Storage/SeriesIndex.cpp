@@ -0,0 +1,80 @@
+#include "SeriesIndex.h"
+#include <tuple>
+
+namespace {
+bool keyLess(const SeriesIndex::Segment& a, const SeriesIndex::Segment& b) {
+    return std::tie(a.sensorId, a.startMs) < std::tie(b.sensorId, b.startMs);
+}
+}
+
+void SeriesIndex::rebuild(std::vector<Segment> segments) {
+    std::sort(segments.begin(), segments.end(), keyLess);
+    segments_ = std::move(segments);
+    reach_.assign(segments_.size(), 0);
+    for (size_t i = 0; i < segments_.size(); i = groupOf(segments_[i].sensorId).second) {
+        refreshReach(i);
+    }
+}
+
+void SeriesIndex::insert(Segment segment) {
+    // Lo normal es que sea el último del grupo: upper_bound evita mover casi nada
+    const auto pos = std::upper_bound(segments_.begin(), segments_.end(), segment, keyLess);
+    const size_t i = static_cast<size_t>(pos - segments_.begin());
+    segments_.insert(pos, std::move(segment));
+    reach_.insert(reach_.begin() + static_cast<std::ptrdiff_t>(i), 0);
+    refreshReach(i);
+}
+
+bool SeriesIndex::update(uint16_t sensorId, uint64_t startMs, const std::string& name,
+                         uint64_t maxMs, size_t records) {
+    const size_t i = locate(sensorId, startMs, name);
+    if (i == segments_.size()) return false;
+    segments_[i].records = records;
+    if (maxMs > segments_[i].maxMs) {
+        segments_[i].maxMs = maxMs;
+        refreshReach(i);
+    }
+    return true;
+}
+
+bool SeriesIndex::erase(uint16_t sensorId, uint64_t startMs, const std::string& name) {
+    const size_t i = locate(sensorId, startMs, name);
+    if (i == segments_.size()) return false;
+    segments_.erase(segments_.begin() + static_cast<std::ptrdiff_t>(i));
+    reach_.erase(reach_.begin() + static_cast<std::ptrdiff_t>(i));
+    refreshReach(i);
+    return true;
+}
+
+std::pair<size_t, size_t> SeriesIndex::groupOf(uint16_t sensorId) const {
+    const auto first = std::lower_bound(segments_.begin(), segments_.end(), sensorId,
+        [](const Segment& s, uint16_t id) { return s.sensorId < id; });
+    const auto last = std::upper_bound(first, segments_.end(), sensorId,
+        [](uint16_t id, const Segment& s) { return id < s.sensorId; });
+    return {static_cast<size_t>(first - segments_.begin()),
+            static_cast<size_t>(last - segments_.begin())};
+}
+
+size_t SeriesIndex::locate(uint16_t sensorId, uint64_t startMs, const std::string& name) const {
+    Segment key;
+    key.sensorId = sensorId;
+    key.startMs = startMs;
+    // Varios archivos pueden compartir inicio (sufijos): comparar nombre dentro del tramo
+    auto it = std::lower_bound(segments_.begin(), segments_.end(), key, keyLess);
+    for (; it != segments_.end() && it->sensorId == sensorId && it->startMs == startMs; ++it) {
+        if (it->name == name) return static_cast<size_t>(it - segments_.begin());
+    }
+    return segments_.size();
+}
+
+void SeriesIndex::refreshReach(size_t from) {
+    // Recalcula desde from hasta el fin de su grupo (en una escritura al
+    // segmento activo, que es el último del grupo, es un solo elemento)
+    for (size_t i = from; i < segments_.size(); ++i) {
+        const bool groupStart = i == 0 || segments_[i - 1].sensorId != segments_[i].sensorId;
+        const uint64_t reach = groupStart ? segments_[i].maxMs
+                                          : std::max(reach_[i - 1], segments_[i].maxMs);
+        if (i > from && groupStart) break;
+        reach_[i] = reach;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef SERIESINDEX_H
+#define SERIESINDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Índice en memoria de los archivos de lecturas del StorageNode.
+ *
+ * Un vector ordenado por (sensorId, startMs) con el timestamp máximo de
+ * cada archivo. Para cada sensor se mantiene además el máximo acumulado
+ * (reach), que no decrece dentro del grupo y permite ubicar con búsqueda
+ * binaria el primer archivo que puede tocar el rango: una consulta de un
+ * sensor cuesta O(log n + k). Se reconstruye al montar y TimeSeriesStore
+ * lo actualiza en cada escritura.
+ */
+class SeriesIndex {
+ public:
+    struct Segment {
+        uint16_t sensorId = 0;
+        uint64_t startMs = 0;      // todo registro es >= startMs
+        uint64_t maxMs = 0;        // timestamp más alto guardado
+        size_t records = 0;
+        bool legacy = false;       // CSV del formato anterior
+        bool columnar = false;     // segmento sellado, guardado por columnas
+        std::string name;
+    };
+
+    /// Reemplaza el contenido (montaje).
+    void rebuild(std::vector<Segment> segments);
+
+    void insert(Segment segment);
+
+    /**
+     * Registra una escritura en el archivo: maxMs solo crece.
+     * @return false si el archivo no está en el índice.
+     */
+    bool update(uint16_t sensorId, uint64_t startMs, const std::string& name,
+                uint64_t maxMs, size_t records);
+
+    bool erase(uint16_t sensorId, uint64_t startMs, const std::string& name);
+
+    /// Visita los archivos del sensor que pueden tener lecturas en [startMs, endMs].
+    template <typename Visit>
+    void forSensor(uint16_t sensorId, uint64_t startMs, uint64_t endMs, Visit&& visit) const {
+        const auto group = groupOf(sensorId);
+        visitGroup(group.first, group.second, startMs, endMs, visit);
+    }
+
+    /// Igual que forSensor() para todos los sensores: O(sensores · log n + k).
+    template <typename Visit>
+    void forRange(uint64_t startMs, uint64_t endMs, Visit&& visit) const {
+        size_t begin = 0;
+        while (begin < segments_.size()) {
+            const size_t end = groupOf(segments_[begin].sensorId).second;
+            visitGroup(begin, end, startMs, endMs, visit);
+            begin = end;
+        }
+    }
+
+    size_t size() const { return segments_.size(); }
+
+ private:
+    std::vector<Segment> segments_;    // ordenados por (sensorId, startMs)
+    std::vector<uint64_t> reach_;      // max(maxMs) desde el inicio del grupo hasta i
+
+    std::pair<size_t, size_t> groupOf(uint16_t sensorId) const;
+    size_t locate(uint16_t sensorId, uint64_t startMs, const std::string& name) const;
+    void refreshReach(size_t from);
+
+    template <typename Visit>
+    void visitGroup(size_t begin, size_t end, uint64_t startMs, uint64_t endMs, Visit& visit) const {
+        // Candidatos: startMs <= endMs y algún registro >= startMs
+        const auto last = std::upper_bound(segments_.begin() + begin, segments_.begin() + end, endMs,
+            [](uint64_t t, const Segment& s) { return t < s.startMs; }) - segments_.begin();
+        const auto first = std::lower_bound(reach_.begin() + begin, reach_.begin() + last, startMs)
+            - reach_.begin();
+        for (auto i = first; i < last; ++i) {
+            if (segments_[i].maxMs >= startMs) visit(segments_[i]);
+        }
+    }
+};
+
+#endif // SERIESINDEX_H
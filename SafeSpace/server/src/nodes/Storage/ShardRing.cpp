@@ -0,0 +1,51 @@
+#include "ShardRing.h"
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+namespace {
+// FNV-1a con la mezcla final de splitmix64: los nombres de disco se
+// parecen mucho entre sí ("/mnt/nvme0/...", "/mnt/nvme1/...")
+uint64_t hashBytes(const void* data, size_t len, uint64_t seed) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    uint64_t h = 0xcbf29ce484222325ull ^ seed;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+}
+
+ShardRing::ShardRing(const std::vector<std::string>& names)
+    : shards_(names.size())
+{
+    if (names.empty()) {
+        throw std::invalid_argument("ShardRing: no shards");
+    }
+    if (std::set<std::string>(names.begin(), names.end()).size() != names.size()) {
+        throw std::invalid_argument("ShardRing: repeated shard name");
+    }
+
+    points_.reserve(names.size() * VNODES);
+    for (uint32_t shard = 0; shard < names.size(); ++shard) {
+        for (uint64_t v = 0; v < VNODES; ++v) {
+            points_.emplace_back(hashBytes(names[shard].data(), names[shard].size(), v), shard);
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+size_t ShardRing::shardOf(uint16_t sensorId) const {
+    if (shards_ == 1) return 0;
+    const uint8_t id[2] = {static_cast<uint8_t>(sensorId >> 8), static_cast<uint8_t>(sensorId)};
+    const uint64_t h = hashBytes(id, sizeof(id), 0);
+    auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(h, uint32_t{0}));
+    if (it == points_.end()) it = points_.begin();
+    return it->second;
+}
@@ -0,0 +1,38 @@
+#ifndef SHARDRING_H
+#define SHARDRING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Anillo de hashing consistente que reparte los sensores entre discos.
+ *
+ * Cada shard pone VNODES puntos en el anillo, sacados del hash de su
+ * nombre (la ruta del disco); un sensor va al primer punto a partir del
+ * hash de su id. Así el reparto depende solo de los nombres y no del orden
+ * en que se pasan los discos, y agregar un disco mueve solo ~1/n de los
+ * sensores: los demás siguen escribiendo donde ya estaban sus lecturas.
+ *
+ * Inmutable después de construido; thread-safe.
+ */
+class ShardRing {
+ public:
+    static constexpr size_t VNODES = 64;
+
+    /// @throws std::invalid_argument si names está vacío o tiene repetidos.
+    explicit ShardRing(const std::vector<std::string>& names);
+
+    /// Índice en names del shard dueño del sensor.
+    size_t shardOf(uint16_t sensorId) const;
+
+    size_t size() const { return shards_; }
+
+ private:
+    std::vector<std::pair<uint64_t, uint32_t>> points_;   // (hash, shard), ordenados
+    size_t shards_;
+};
+
+#endif // SHARDRING_H
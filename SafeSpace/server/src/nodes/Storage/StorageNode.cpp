@@ -1,4 +1,5 @@
 #include "StorageNode.h"
+#include "../interfaces/ReplyFrame.h"
 #include <algorithm>
 #include <arpa/inet.h>
 #include <chrono>
@@ -6,10 +7,52 @@
 #include <iostream>
 #include <iomanip>
 #include <unistd.h>
-#include <regex>
 #include <sstream>
 
 const size_t BUFFER_SIZE = 65535;
+const size_t SENSOR_RECORD_BYTES = 24;  // 6 floats serializados
+
+// Páginas de RESPONSE_SENSOR_HISTORY: [token(4)][seq(2)][flags(1)][count(1)] + filas,
+// del tamaño justo para un datagrama enmarcado sin fragmentar
+const size_t PAGE_HEADER_BYTES = 8;
+const size_t PAGE_ROWS = (SensorBatch::MAX_DATAGRAM - MessageHeader::SIZE - 2 - PAGE_HEADER_BYTES)
+                         / SENSOR_RECORD_BYTES;
+const uint8_t PAGE_MORE = 0x01;         // quedan páginas: pedir con QUERY_NEXT
+
+// RESPONSE_AGGREGATE: [fields(1)][bucketSeconds(4)][buckets(2)] y por intervalo
+// [inicio en segundos(8)][count(4)] + min/max/promedio (3 floats) por campo pedido
+const size_t AGGREGATE_HEADER_BYTES = 7;
+const size_t AGGREGATE_BUCKET_BYTES = 12;
+const size_t MAX_AGGREGATE_BUCKETS = 720;   // 12 h por minuto, 30 días por hora
+static_assert(2 + AGGREGATE_HEADER_BYTES + MAX_AGGREGATE_BUCKETS *
+              (AGGREGATE_BUCKET_BYTES + SeriesAggregator::FIELD_COUNT * 12) <= UINT16_MAX,
+              "a full aggregate response must fit one framed datagram");
+
+// Escrituras de la ronda en curso del hilo servidor: quedan en el WAL sin
+// sincronizar y sus ACK se confirman (o se corrigen) en onBatchDispatched()
+struct StagedPart {
+    size_t shard;
+    uint64_t ticket;       // MemTable::stage(): durable cuando durableUpTo() lo alcanza
+};
+struct DeferredAck {
+    uint8_t* reply;        // msgId de la respuesta, dentro del buffer de envío; null si no salió
+    size_t records;
+    bool batch;            // el byte siguiente a status es la cantidad guardada
+    size_t partsEnd;       // sus partes y lecturas siguen a las del ACK anterior
+    size_t readingsEnd;
+    bool replicated;       // anotar (sender, seq) en replays si resulta durable
+    uint64_t sender;
+    uint32_t seq;
+    size_t follows;        // reenvío de un ACK anterior de la ronda: corre su suerte
+};
+const size_t NO_ACK = SIZE_MAX;
+struct DeferredWrites {
+    std::vector<StagedPart> parts;
+    std::vector<SensorReading> readings;   // para invalidar la caché si quedan
+    size_t unacked = 0;    // de la petición en curso, todavía sin DeferredAck
+    std::vector<DeferredAck> acks;
+};
+static thread_local DeferredWrites deferredWrites;
 
 // --- función auxiliar para decodificar texto hex a bytes ---
 static std::vector<uint8_t> hexToBytes(const std::string& hex) {
@@ -23,36 +66,17 @@ static std::vector<uint8_t> hexToBytes(const std::string& hex) {
     return bytes;
 }
 
-std::vector<uint8_t> StorageNode::sensorDataToBytes(const SensorData& data) const {
-    std::vector<uint8_t> bytes;
-    bytes.reserve(24); // 6 floats * 4 bytes = 24 bytes
-    
-    // Convertir cada float a bytes (network byte order)
-    uint32_t dist_net = htonl(*reinterpret_cast<const uint32_t*>(&data.distance));
-    bytes.insert(bytes.end(), reinterpret_cast<uint8_t*>(&dist_net), 
-                reinterpret_cast<uint8_t*>(&dist_net) + 4);
-    
-    uint32_t temp_net = htonl(*reinterpret_cast<const uint32_t*>(&data.temperature));
-    bytes.insert(bytes.end(), reinterpret_cast<uint8_t*>(&temp_net), 
-                reinterpret_cast<uint8_t*>(&temp_net) + 4);
-    
-    uint32_t press_net = htonl(*reinterpret_cast<const uint32_t*>(&data.pressure));
-    bytes.insert(bytes.end(), reinterpret_cast<uint8_t*>(&press_net), 
-                reinterpret_cast<uint8_t*>(&press_net) + 4);
-    
-    uint32_t alt_net = htonl(*reinterpret_cast<const uint32_t*>(&data.altitude));
-    bytes.insert(bytes.end(), reinterpret_cast<uint8_t*>(&alt_net), 
-                reinterpret_cast<uint8_t*>(&alt_net) + 4);
-    
-    uint32_t seal_net = htonl(*reinterpret_cast<const uint32_t*>(&data.sealevelPressure));
-    bytes.insert(bytes.end(), reinterpret_cast<uint8_t*>(&seal_net), 
-                reinterpret_cast<uint8_t*>(&seal_net) + 4);
-    
-    uint32_t real_net = htonl(*reinterpret_cast<const uint32_t*>(&data.realAltitude));
-    bytes.insert(bytes.end(), reinterpret_cast<uint8_t*>(&real_net), 
-                reinterpret_cast<uint8_t*>(&real_net) + 4);
-    
-    return bytes;
+void StorageNode::sensorDataToBytes(const SensorData& data, uint8_t* out) const {
+    // Convertir cada float a bytes (network byte order), 6 floats * 4 bytes = 24 bytes
+    const float fields[6] = {data.distance, data.temperature, data.pressure,
+                             data.altitude, data.sealevelPressure, data.realAltitude};
+    for (const float field : fields) {
+        uint32_t bits;
+        std::memcpy(&bits, &field, 4);
+        const uint32_t net = htonl(bits);
+        std::memcpy(out, &net, 4);
+        out += 4;
+    }
 }
 
 SensorData StorageNode::bytesToSensorData(const uint8_t* data, size_t len) const {
@@ -86,72 +110,33 @@ SensorData StorageNode::bytesToSensorData(const uint8_t* data, size_t len) const
     }
 }
 
-std::string StorageNode::sensorDataToString(const SensorData& data) const {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(6)
-        << data.distance << ","
-        << data.temperature << ","
-        << data.pressure << ","
-        << data.altitude << ","
-        << data.sealevelPressure << ","
-        << data.realAltitude;
-    return oss.str();
+bool Response::writeTo(ResponseBuffer& out) const {
+    return out.put(msgId) && out.put(status) && out.append(data.data(), data.size());
 }
 
-SensorData StorageNode::stringToSensorData(const std::string& str) const {
-    std::cout << "[StorageNode] stringToSensorData parsing: " << str << std::endl;
-    
-    // Si hay múltiples líneas, tomar solo la primera
-    std::string firstLine = str;
-    size_t newlinePos = str.find('\n');
-    if (newlinePos != std::string::npos) {
-        firstLine = str.substr(0, newlinePos);
-        std::cout << "[StorageNode] Multiple lines found, using first line: " << firstLine << std::endl;
-    }
-    
-    std::istringstream iss(firstLine);
-    std::string token;
-    std::vector<float> values;
-    
-    while (std::getline(iss, token, ',')) {
-        try {
-            float value = std::stof(token);
-            values.push_back(value);
-            std::cout << "[StorageNode] Parsed value: " << value << std::endl;
-        } catch (const std::exception& e) {
-            std::cerr << "[StorageNode] Error parsing token: " << token << " - " << e.what() << std::endl;
-            throw;
-        }
-    }
-    
-    if (values.size() != 6) {
-        std::cerr << "[StorageNode] Invalid sensor data string format. Expected 6 values, got " 
-                  << values.size() << std::endl;
-        throw std::runtime_error("Invalid sensor data string format");
-    }
-    
-    return SensorData(values[0], values[1], values[2], values[3], values[4], values[5]);
-}
-
-std::vector<uint8_t> Response::toBytes() const {
-    std::vector<uint8_t> bytes;
-    bytes.reserve(2 + data.size());
-    bytes.push_back(msgId);
-    bytes.push_back(status);
-    bytes.insert(bytes.end(), data.begin(), data.end());
-    return bytes;
+StorageNode::StorageNode(uint16_t storagePort, const std::string& masterServerIp,
+                         uint16_t masterServerPort, const std::string& nodeId,
+                         const std::string& diskPath, size_t bufsize,
+                         const SeriesCompactor::Options& retention, size_t diskCacheBytes)
+    : StorageNode(storagePort, masterServerIp, masterServerPort, nodeId,
+                  std::vector<std::string>{diskPath}, bufsize, retention, diskCacheBytes)
+{
 }
 
 StorageNode::StorageNode(uint16_t storagePort, const std::string& masterServerIp,
                          uint16_t masterServerPort, const std::string& nodeId,
-                         const std::string& diskPath, size_t bufsize)
+                         const std::vector<std::string>& diskPaths, size_t bufsize,
+                         const SeriesCompactor::Options& retention, size_t diskCacheBytes)
     : UDPServer("0.0.0.0", storagePort, bufsize),
       masterClient(nullptr),
       masterServerIp(masterServerIp),
       masterServerPort(masterServerPort),
       nodeId(nodeId),
-      diskPath(diskPath),
-      listening(false),
+      diskPaths(diskPaths),
+      cursorTokens(std::random_device{}()),
+      cursorTimer(-1),
+      queryCache(QUERY_CACHE_BYTES),
+      heartbeatTimer(-1),
       totalSensorRecords(0),
       totalQueries(0),
       errorsCount(0)
@@ -160,15 +145,28 @@ StorageNode::StorageNode(uint16_t storagePort, const std::string& masterServerIp
     std::cout << "[StorageNode] Storage port: " << storagePort << std::endl;
     std::cout << "[StorageNode] Master server: " << masterServerIp 
               << ":" << masterServerPort << std::endl;
-    std::cout << "[StorageNode] Disk path: " << diskPath << std::endl;
+    for (const auto& diskPath : diskPaths) {
+        std::cout << "[StorageNode] Disk path: " << diskPath << std::endl;
+    }
+    std::cout << "[StorageNode] Disk cache: " << diskCacheBytes / 1024 << " KiB per disk" << std::endl;
     
     try {
-        // Inicializar FileSystem
-        fs = new FileSystem(diskPath);
-        if (!fs->isValid()) {
-            throw std::runtime_error("FileSystem initialization failed");
+        // El reparto depende solo de las rutas, no de su orden
+        ring = std::make_unique<ShardRing>(diskPaths);
+
+        // Las consultas largas reparten sus archivos entre todos los núcleos
+        scanPool = std::make_unique<ScanPool>(0);
+        std::cout << "[StorageNode] Query threads: " << scanPool->parallelism() << std::endl;
+
+        // Un shard por disco; el mantenimiento de cada uno se posterga
+        // mientras haya consultas paginadas, que leen los archivos por nombre
+        for (const auto& diskPath : diskPaths) {
+            shards.push_back(std::make_unique<StorageShard>(diskPath, scanPool.get(), [this]() {
+                std::lock_guard<std::mutex> lock(cursorsMutex);
+                return !cursors.empty();
+            }, retention, diskCacheBytes));
         }
-        std::cout << "[StorageNode] FileSystem initialized successfully" << std::endl;
+        std::cout << "[StorageNode] Shards: " << shards.size() << std::endl;
         
         // Crear cliente para comunicarse con master
         masterClient = new UDPClient(masterServerIp, masterServerPort);
@@ -195,14 +193,24 @@ StorageNode::~StorageNode() {
             std::to_string(totalSensorRecords.load()) + 
             ", Consultas=" + std::to_string(totalQueries.load()) + 
             ", Errores=" + std::to_string(errorsCount.load()));
+    const QueryCache::Stats cache = queryCache.stats();
+    std::cout << "[StorageNode] Query cache: " << cache.hits << " hits, " << cache.misses << " misses ("
+              << static_cast<int>(cache.hitRatio() * 100) << "%), " << cache.invalidations
+              << " invalidated, " << cache.bytes << "/" << cache.budget << " bytes" << std::endl;
+    const BlockCache::Stats disk = getStats().diskCache;
+    std::cout << "[StorageNode] Disk cache: " << disk.hits << " hits, " << disk.misses << " misses ("
+              << static_cast<int>(disk.hitRatio() * 100) << "%), " << disk.readahead << " read ahead, "
+              << disk.evictions << " evicted, " << disk.writebacks << " written back" << std::endl;
     std::cout << "[StorageNode] Shutting down..." << std::endl;
     
-    // Detener thread de escucha
-    listening.store(false);
-    
-    if (listenerThread.joinable()) {
-        std::cout << "[StorageNode] Waiting for listener thread to finish..." << std::endl;
-        listenerThread.join();
+    // Cancelar el heartbeat; ya no hay hilo que esperar
+    if (heartbeatTimer >= 0) {
+        eventLoop().cancelTimer(heartbeatTimer);
+        heartbeatTimer = -1;
+    }
+    if (cursorTimer >= 0) {
+        eventLoop().cancelTimer(cursorTimer);
+        cursorTimer = -1;
     }
     
     // Liberar cliente
@@ -211,6 +219,12 @@ StorageNode::~StorageNode() {
         masterClient = nullptr;
         std::cout << "[StorageNode] Master client destroyed" << std::endl;
     }
+
+    // Los cursores apuntan a los stores de los shards, que se destruyen antes
+    {
+        std::lock_guard<std::mutex> lock(cursorsMutex);
+        cursors.clear();
+    }
     
     std::cout << "[StorageNode] Shutdown complete" << std::endl;
 }
@@ -225,96 +239,225 @@ void StorageNode::start() {
     // Registrarse con el master
     registerWithMaster();
     
-    // Iniciar thread para escuchar respuestas del master
-    listening.store(true);
-    listenerThread = std::thread(&StorageNode::listenMasterServerResponses, this);
+    // Heartbeat periódico en el mismo event loop que atiende los datagramas
+    scheduleHeartbeat();
+
+    // Cursores de consultas que el cliente abandonó sin cancelar
+    cursorTimer = eventLoop().addTimer(CURSOR_IDLE, [this]() { expireCursors(); });
     
-    std::cout << "[StorageNode] Listener thread started" << std::endl;
+    std::cout << "[StorageNode] Heartbeat timer armed" << std::endl;
     std::cout << "[StorageNode] Ready to receive sensor data" << std::endl;
     
     // Iniciar servidor UDP (bloqueante)
     serveBlocking();
 }
 
-void StorageNode::onReceive(const sockaddr_in& peer, const uint8_t* data,
-                           ssize_t len, std::string& out_response) {
+// Las rutas comparten los códigos de MessageType
+static_assert(static_cast<uint8_t>(MessageKind::QUERY_BY_DATE) == static_cast<uint8_t>(MessageType::QUERY_BY_DATE) &&
+              static_cast<uint8_t>(MessageKind::QUERY_BY_SENSOR) == static_cast<uint8_t>(MessageType::QUERY_BY_SENSOR) &&
+              static_cast<uint8_t>(MessageKind::QUERY_NEXT) == static_cast<uint8_t>(MessageType::QUERY_NEXT) &&
+              static_cast<uint8_t>(MessageKind::QUERY_CANCEL) == static_cast<uint8_t>(MessageType::QUERY_CANCEL) &&
+              static_cast<uint8_t>(MessageKind::QUERY_AGGREGATE) == static_cast<uint8_t>(MessageType::QUERY_AGGREGATE) &&
+              static_cast<uint8_t>(MessageKind::RESPONSE_AGGREGATE) == static_cast<uint8_t>(MessageType::RESPONSE_AGGREGATE) &&
+              static_cast<uint8_t>(MessageKind::STORE_SENSOR_DATA) == static_cast<uint8_t>(MessageType::STORE_SENSOR_DATA) &&
+              static_cast<uint8_t>(MessageKind::STORE_BITACORA) == static_cast<uint8_t>(MessageType::STORE_BITACORA),
+              "MessageKind and MessageType storage codes must match");
+
+const DispatchTable<StorageNode::MessageHandler> StorageNode::routes({
+    {MessageKind::QUERY_BY_DATE, &StorageNode::handleQueryByDate},
+    {MessageKind::QUERY_BY_SENSOR, &StorageNode::handleQueryBySensor},
+    {MessageKind::QUERY_NEXT, &StorageNode::handleQueryNext},
+    {MessageKind::QUERY_CANCEL, &StorageNode::handleQueryCancel},
+    {MessageKind::QUERY_AGGREGATE, &StorageNode::handleQueryAggregate},
+    {MessageKind::STORE_SENSOR_DATA, &StorageNode::handleStoreSensorData},
+    {MessageKind::SENSOR_DATA, &StorageNode::handleStoreSensorData},
+    {MessageKind::SENSOR_BATCH, &StorageNode::handleStoreSensorBatch},
+    {MessageKind::STORE_BITACORA, &StorageNode::handleStoreBitacora},
+});
+
+bool StorageNode::classifyLegacy(const uint8_t* data, size_t len, MessageView& msg) {
+    // Primero verificar por tipo de mensaje explícito
+    switch (static_cast<MessageType>(data[0])) {
+        case MessageType::QUERY_BY_DATE:
+        case MessageType::QUERY_BY_SENSOR:
+        case MessageType::STORE_SENSOR_DATA:
+        case MessageType::STORE_BITACORA:
+            msg = MessageView::legacy(static_cast<MessageKind>(data[0]), data, len);
+            return true;
+        case MessageType::QUERY_NEXT:
+            // Solo con su largo exacto: el primer byte de una lectura suelta puede valer 0x03/0x04
+            if (len != 7) break;
+            msg = MessageView::legacy(MessageKind::QUERY_NEXT, data, len);
+            return true;
+        case MessageType::QUERY_CANCEL:
+            if (len != 5) break;
+            msg = MessageView::legacy(MessageKind::QUERY_CANCEL, data, len);
+            return true;
+        default:
+            break;
+    }
+
+    // Si no es un tipo conocido, usar detección por longitud
+    if (len == 17) {  // Consulta por fecha: [msgType][startTime(8)][endTime(8)]
+        msg = MessageView::legacy(MessageKind::QUERY_BY_DATE, data, len);
+    } else if (len == 18) {  // Consulta por sensor: [msgType][sensorId][startTime(8)][endTime(8)]
+        msg = MessageView::legacy(MessageKind::QUERY_BY_SENSOR, data, len);
+    } else if (len >= 24 && len <= 100) {  // Guardar datos de sensores (25-100 bytes)
+        msg = MessageView::legacy(MessageKind::STORE_SENSOR_DATA, data, len);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void StorageNode::onDatagram(const sockaddr_in& peer, const uint8_t* data,
+                            size_t size, ResponseBuffer& out) {
     std::string peerStr = sockaddrToString(peer);
-    std::cout << "[StorageNode] Received " << len << " bytes from " 
+    std::cout << "[StorageNode] Received " << size << " bytes from " 
               << peerStr << std::endl;
     
-    if (len < 1) {
+    if (size < 1) {
         std::cerr << "[StorageNode] Invalid message: too short" << std::endl;
         errorsCount++;
         return;
     }
     
+    // Encabezado primero; sin él, detección heredada si está habilitada
+    MessageView msg;
+    const bool classified = MessageView::fromFramed(data, size, msg) ||
+                            (legacyFraming() && classifyLegacy(data, size, msg));
+    const MessageHandler handler = classified ? routes.find(msg.kind) : nullptr;
+    if (!handler) {
+        std::cout << "[StorageNode] Unknown message format (" << size
+                 << " bytes), using default behavior" << std::endl;
+        // Llamar al comportamiento por defecto de UDPServer (echo)
+        UDPServer::onDatagram(peer, data, size, out);
+        return;
+    }
+
+    std::cout << "[StorageNode] Message type 0x" << std::hex << static_cast<int>(msg.kind) << std::dec
+              << (msg.framed ? " (framed)" : " (legacy)") << std::endl;
+
+    // Escritura replicada que ya se aplicó (se perdió el ACK): confirmar sin guardar otra vez
+    const bool replicated = msg.framed && (msg.flags & MessageHeader::FLAG_REPLICATED);
+    const uint64_t sender = (uint64_t{peer.sin_addr.s_addr} << 16) | peer.sin_port;
+    // Reenvío de una escritura de esta misma ronda: su ACK es el del original
+    size_t follows = NO_ACK;
+    if (replicated) {
+        const auto& acks = deferredWrites.acks;
+        for (size_t i = 0; i < acks.size() && follows == NO_ACK; ++i) {
+            if (acks[i].replicated && acks[i].follows == NO_ACK &&
+                acks[i].sender == sender && acks[i].seq == msg.seq) {
+                follows = i;
+            }
+        }
+    }
     Response response;
-    MessageType msgType = static_cast<MessageType>(data[0]);
-    
-    try {
-        // Primero verificar por tipo de mensaje explícito
-        switch (msgType) {
-            case MessageType::QUERY_BY_DATE:
-                std::cout << "[StorageNode] Query by date" << std::endl;
-                response = handleQueryByDate(data, len);
-                break;
-                
-            case MessageType::QUERY_BY_SENSOR:
-                std::cout << "[StorageNode] Query by sensor" << std::endl;
-                response = handleQueryBySensor(data, len);
-                break;
-                
-            case MessageType::STORE_SENSOR_DATA:
-                std::cout << "[StorageNode] Store sensor data" << std::endl;
-                response = handleStoreSensorData(data, len);
-                break;
-                
-            case MessageType::STORE_BITACORA:
-                std::cout << "[StorageNode] Store bitácora" << std::endl;
-                response = handleStoreBitacora(data, len);
-                break;
-                
-            default:
-                // Si no es un tipo conocido, usar detección por longitud
-                if (len == 17) {  // Consulta por fecha: [msgType][startTime(8)][endTime(8)]
-                    std::cout << "[StorageNode] Detected QUERY_BY_DATE (legacy format)" << std::endl;
-                    response = handleQueryByDate(data, len);
-                    
-                } else if (len == 18) {  // Consulta por sensor: [msgType][sensorId][startTime(8)][endTime(8)]
-                    std::cout << "[StorageNode] Detected QUERY_BY_SENSOR (legacy format)" << std::endl;
-                    response = handleQueryBySensor(data, len);
-                    
-                } else if (len >= 24 && len <= 100) {  // Guardar datos de sensores (25-100 bytes)
-                    std::cout << "[StorageNode] Detected STORE_SENSOR_DATA" << std::endl;
-                    response = handleStoreSensorData(data, len);
-                    
-                } else {
-                    std::cout << "[StorageNode] Unknown message format (" << len 
-                             << " bytes), using default behavior" << std::endl;
-                    // Llamar al comportamiento por defecto de UDPServer (echo)
-                    UDPServer::onReceive(peer, data, len, out_response);
-                    return;
-                }
+    if (follows != NO_ACK || (replicated && replays.seen(sender, msg.seq))) {
+        std::cout << "[StorageNode] Replicated seq " << msg.seq
+                  << (follows != NO_ACK ? " already pending" : " already applied") << std::endl;
+        response.msgId = static_cast<uint8_t>(MessageType::RESPONSE_ACK);
+        response.status = 0;
+        if (msg.kind == MessageKind::SENSOR_BATCH) {
+            response.data.push_back(static_cast<uint8_t>(SensorBatchReader(msg.payload, msg.length).count()));
+        }
+    } else {
+        try {
+            response = (this->*handler)(msg.payload, static_cast<ssize_t>(msg.length));
+        } catch (const std::exception& e) {
+            std::cerr << "[StorageNode] Error processing message: " << e.what() << std::endl;
+            response.msgId = static_cast<uint8_t>(MessageType::RESPONSE_ERROR);
+            response.status = 1;
+            errorsCount++;
         }
-    } catch (const std::exception& e) {
-        std::cerr << "[StorageNode] Error processing message: " << e.what() << std::endl;
-        response.msgId = static_cast<uint8_t>(MessageType::RESPONSE_ERROR);
-        response.status = 1;
-        errorsCount++;
     }
     
-    // Convertir respuesta a string
-    auto responseBytes = response.toBytes();
-    out_response.assign(reinterpret_cast<const char*>(responseBytes.data()),
-                       responseBytes.size());
+    // Serializar la respuesta directamente en el buffer de envío
+    ReplyFrame frame(out, msg);
+    const size_t replyAt = out.size();
+    const size_t staged = deferredWrites.unacked;
+    deferredWrites.unacked = 0;
+    const bool written = response.writeTo(out);
+    if (!written) {
+        std::cerr << "[StorageNode] Response too large for send buffer ("
+                  << response.data.size() + 2 << " bytes)" << std::endl;
+        errorsCount++;
+    }
+
+    // Lo guardado recién es durable al final de la ronda; hasta entonces el ACK
+    // espera, y la seq replicada no cuenta como aplicada
+    if (staged > 0 || follows != NO_ACK) {
+        const bool batch = msg.kind == MessageKind::SENSOR_BATCH && !response.data.empty();
+        deferredWrites.acks.push_back(DeferredAck{
+            written ? out.data() + replyAt : nullptr, staged, batch,
+            deferredWrites.parts.size(), deferredWrites.readings.size(),
+            replicated && response.status == 0, sender, msg.seq, follows});
+    } else if (replicated && response.status == 0) {
+        replays.applied(sender, msg.seq);
+    }
+}
+
+void StorageNode::onBatchDispatched() {
+    DeferredWrites& round = deferredWrites;
+    if (round.acks.empty()) return;
+
+    // Un fdatasync por shard para todas las escrituras de la ronda; lo que no
+    // llegó a disco lo descarta el MemTable
+    std::vector<uint64_t> durableUpTo(shards.size());
+    for (size_t s = 0; s < shards.size(); ++s) {
+        shards[s]->memtable().commit();
+        durableUpTo[s] = shards[s]->memtable().durableUpTo();
+    }
+
+    // Recién ahora las lecturas se ven: invalidar la caché y anotar la seq
+    // replicada solo para las que quedaron; las demás se rechazan
+    std::vector<bool> durable(round.acks.size());
+    size_t partsFrom = 0;
+    size_t readingsFrom = 0;
+    size_t rejected = 0;
+    for (size_t i = 0; i < round.acks.size(); ++i) {
+        const DeferredAck& ack = round.acks[i];
+        if (ack.follows != NO_ACK) {
+            durable[i] = durable[ack.follows];
+        } else {
+            durable[i] = std::all_of(round.parts.begin() + partsFrom, round.parts.begin() + ack.partsEnd,
+                                     [&durableUpTo](const StagedPart& part) {
+                                         return part.ticket <= durableUpTo[part.shard];
+                                     });
+        }
+        if (durable[i]) {
+            if (ack.readingsEnd > readingsFrom) {
+                queryCache.invalidate(round.readings.data() + readingsFrom, ack.readingsEnd - readingsFrom);
+            }
+            if (ack.replicated && ack.follows == NO_ACK) {
+                replays.applied(ack.sender, ack.seq);
+            }
+        } else {
+            if (ack.reply) {
+                ack.reply[1] = 1;
+                if (ack.batch) ack.reply[2] = 0;
+            }
+            totalSensorRecords -= ack.records;
+            errorsCount++;
+            rejected++;
+        }
+        partsFrom = ack.partsEnd;
+        readingsFrom = ack.readingsEnd;
+    }
+    if (rejected > 0) {
+        std::cerr << "[StorageNode] WAL sync failed; rejecting " << rejected
+                  << " acknowledgements of this round" << std::endl;
+    }
+    round.parts.clear();
+    round.readings.clear();
+    round.acks.clear();
 }
 
 Response StorageNode::handleQueryByDate(const uint8_t* data, ssize_t len) {
-    Response resp;
-    resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_SENSOR_HISTORY);
-    
     // Formato: [msgType][startTime(8)][endTime(8)] = 17 bytes
     if (len < 17) {
+        Response resp;
+        resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_SENSOR_HISTORY);
         resp.status = 1;
         errorsCount++;
         return resp;
@@ -329,54 +472,26 @@ Response StorageNode::handleQueryByDate(const uint8_t* data, ssize_t len) {
     std::cout << "[StorageNode] Querying from " << timestampToString(startTime)
               << " to " << timestampToString(endTime) << std::endl;
     
-    std::lock_guard<std::mutex> lock(fsMutex);
-    auto results = querySensorDataByDate(startTime, endTime);
-    
-    std::cout << "[StorageNode] Found " << results.size() << " records" << std::endl;
-    
-    // Serializar resultados
-    for (const auto& record : results) {
-        auto bytes = sensorDataToBytes(record);
-        resp.data.insert(resp.data.end(), bytes.begin(), bytes.end());
-    }
-    
-    resp.status = 0;
-    totalQueries++;
-
-    // Imprimir tabla de resultados - usar hora actual como placeholder
-    auto currentTime = std::chrono::system_clock::now();
-    auto currentTimeT = std::chrono::system_clock::to_time_t(currentTime);
-    
-    // Imprimir tabla de resultados
-    std::cout << "[StorageNode] Fecha | Distancia | Temperatura | Presión | Altitud | Presión nivel mar | Altitud real" << std::endl;
-    for (const auto& record : results) {
-        std::cout << timestampToString(currentTimeT) << " | "
-                  << record.distance << " | "
-                  << record.temperature << " | "
-                  << record.pressure << " | "
-                  << record.altitude << " | "
-                  << record.sealevelPressure << " | "
-                  << record.realAltitude << std::endl;
-    }
-    
-    return resp;
+    return openQuery(false, 0, startTime, endTime);
 }
 
 Response StorageNode::handleQueryBySensor(const uint8_t* data, ssize_t len) {
-    Response resp;
-    resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_SENSOR_HISTORY);
-    
-    // Formato: [msgType][sensorId][startTime(8)][endTime(8)] = 18 bytes
+    // Formato: [msgType][sensorId(2)][startTime(8)][endTime(8)] = 19 bytes,
+    // como QUERY_AGGREGATE. Los 18 bytes de antes ([sensorId] de un byte)
+    // se siguen aceptando
     if (len < 18) {
+        Response resp;
+        resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_SENSOR_HISTORY);
         resp.status = 1;
         errorsCount++;
         return resp;
     }
     
-    uint8_t sensorId = data[1];
+    const size_t idBytes = len >= 19 ? 2 : 1;
+    const uint16_t sensorId = idBytes == 2 ? static_cast<uint16_t>((data[1] << 8) | data[2]) : data[1];
     uint64_t startTime, endTime;
-    std::memcpy(&startTime, data + 2, 8);
-    std::memcpy(&endTime, data + 10, 8);
+    std::memcpy(&startTime, data + 1 + idBytes, 8);
+    std::memcpy(&endTime, data + 9 + idBytes, 8);
     startTime = be64toh(startTime);
     endTime = be64toh(endTime);
     
@@ -384,47 +499,409 @@ Response StorageNode::handleQueryBySensor(const uint8_t* data, ssize_t len) {
               << " from " << timestampToString(startTime)
               << " to " << timestampToString(endTime) << std::endl;
     
-    std::lock_guard<std::mutex> lock(fsMutex);
-    auto results = querySensorDataById(sensorId, startTime, endTime);
-    
-    std::cout << "[StorageNode] Found " << results.size() << " records" << std::endl;
-    
-    // Serializar resultados
-    for (const auto& record : results) {
-        auto bytes = sensorDataToBytes(record);
-        resp.data.insert(resp.data.end(), bytes.begin(), bytes.end());
+    return openQuery(true, sensorId, startTime, endTime);
+}
+
+Response StorageNode::handleQueryNext(const uint8_t* data, ssize_t len) {
+    Response resp;
+    resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_SENSOR_HISTORY);
+
+    // Formato: [msgType][token(4)][seq(2)] = 7 bytes; seq es la página pedida
+    if (len < 7) {
+        resp.status = 1;
+        errorsCount++;
+        return resp;
     }
-    
-    resp.status = 0;
+    const uint32_t token = (static_cast<uint32_t>(data[1]) << 24) | (static_cast<uint32_t>(data[2]) << 16) |
+                           (static_cast<uint32_t>(data[3]) << 8) | data[4];
+    const uint16_t seq = static_cast<uint16_t>((data[5] << 8) | data[6]);
+
+    std::lock_guard<std::mutex> lock(cursorsMutex);
+    auto it = cursors.find(token);
+    if (it == cursors.end()) {
+        std::cerr << "[StorageNode] Unknown or expired query cursor " << token << std::endl;
+        resp.status = 1;
+        return resp;
+    }
+
+    OpenCursor& entry = it->second;
+    entry.lastUse = std::chrono::steady_clock::now();
+    if (seq == entry.seq) {
+        // La respuesta anterior se perdió: reenviar la misma página
+        resp.data.assign(entry.lastPage.begin(), entry.lastPage.end());
+        resp.status = 0;
+    } else if (seq == static_cast<uint16_t>(entry.seq + 1) && entry.cursor) {
+        entry.seq = seq;
+        writePage(token, entry, resp);
+    } else {
+        std::cerr << "[StorageNode] Cursor " << token << ": page " << seq
+                  << " requested after page " << entry.seq << std::endl;
+        resp.status = 1;
+    }
+    return resp;
+}
+
+Response StorageNode::handleQueryCancel(const uint8_t* data, ssize_t len) {
+    Response resp;
+    resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_ACK);
+
+    // Formato: [msgType][token(4)] = 5 bytes
+    if (len < 5) {
+        resp.status = 1;
+        errorsCount++;
+        return resp;
+    }
+    const uint32_t token = (static_cast<uint32_t>(data[1]) << 24) | (static_cast<uint32_t>(data[2]) << 16) |
+                           (static_cast<uint32_t>(data[3]) << 8) | data[4];
+
+    std::lock_guard<std::mutex> lock(cursorsMutex);
+    resp.status = cursors.erase(token) == 1 ? 0 : 1;
+    return resp;
+}
+
+Response StorageNode::handleQueryAggregate(const uint8_t* data, ssize_t len) {
+    Response resp;
+    resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_AGGREGATE);
+
+    // Formato: [msgType][sensorId(2)][startTime(8)][endTime(8)][bucketSeconds(4)][fields(1)] = 24 bytes
+    if (len < 24) {
+        resp.status = 1;
+        errorsCount++;
+        return resp;
+    }
+    const uint16_t sensorId = static_cast<uint16_t>((data[1] << 8) | data[2]);
+    uint64_t startTime, endTime;
+    std::memcpy(&startTime, data + 3, 8);
+    std::memcpy(&endTime, data + 11, 8);
+    startTime = be64toh(startTime);
+    endTime = be64toh(endTime);
+    const uint32_t bucketSeconds = (static_cast<uint32_t>(data[19]) << 24) | (static_cast<uint32_t>(data[20]) << 16) |
+                                   (static_cast<uint32_t>(data[21]) << 8) | data[22];
+    const uint8_t fields = data[23] & SeriesAggregator::ALL_FIELDS;
+
+    const uint64_t startMs = startTime * 1000;
+    const uint64_t endMs = endTime * 1000 + 999;
+    const uint64_t buckets = SeriesAggregator::bucketCount(startMs, endMs, uint64_t{bucketSeconds} * 1000);
+    if (fields == 0 || buckets == 0 || buckets > MAX_AGGREGATE_BUCKETS) {
+        std::cerr << "[StorageNode] Invalid aggregate query: " << buckets << " buckets of "
+                  << bucketSeconds << "s, fields 0x" << std::hex << static_cast<int>(fields)
+                  << std::dec << std::endl;
+        resp.status = 1;
+        errorsCount++;
+        return resp;
+    }
+
+    SeriesAggregator aggregator(startMs, endMs, uint64_t{bucketSeconds} * 1000, fields);
+    // Lo que ya se resumió (SeriesCompactor) entra por intervalo, el resto por lectura
+    // Un sensor vive en un shard, pero lo anterior a un cambio de discos
+    // puede haber quedado en otro: se recorren todos (el índice descarta rápido)
+    for (auto& shard : shards) {
+        shard->memtable().scanSensorColumns(sensorId, startMs, endMs,
+            [&aggregator](const ColumnBlock& block) { aggregator.add(block); },
+            [&aggregator](const SeriesAggregator::Bucket& rollup, uint64_t) { aggregator.add(rollup); });
+    }
+    const auto filled = aggregator.finish();
     totalQueries++;
 
-    // Imprimir tabla de resultados - usar hora actual como placeholder
-    auto currentTime = std::chrono::system_clock::now();
-    auto currentTimeT = std::chrono::system_clock::to_time_t(currentTime);
-    
-  // Imprimir tabla
-    std::cout << "[StorageNode] Fecha | Datos del sensor" << std::endl;
-    for (const auto& record : results) {
-        std::cout << timestampToString(currentTimeT) << " | "
-                  << "Dist:" << record.distance << "mm "
-                  << "Temp:" << record.temperature << "°C "
-                  << "Pres:" << record.pressure << "Pa "
-                  << "Alt:" << record.altitude << "m "
-                  << "PresMar:" << record.sealevelPressure << "Pa "
-                  << "AltReal:" << record.realAltitude << "m" << std::endl;
+    size_t fieldCount = 0;
+    for (size_t f = 0; f < SeriesAggregator::FIELD_COUNT; ++f) {
+        if (fields & (1u << f)) fieldCount++;
     }
-    
+    resp.data.resize(AGGREGATE_HEADER_BYTES + filled.size() * (AGGREGATE_BUCKET_BYTES + fieldCount * 12));
+    uint8_t* out = resp.data.data();
+    const auto put32 = [&out](uint32_t v) {
+        out[0] = static_cast<uint8_t>(v >> 24);
+        out[1] = static_cast<uint8_t>(v >> 16);
+        out[2] = static_cast<uint8_t>(v >> 8);
+        out[3] = static_cast<uint8_t>(v);
+        out += 4;
+    };
+    const auto putFloat = [&put32](float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, 4);
+        put32(bits);
+    };
+
+    *out++ = fields;
+    put32(bucketSeconds);
+    *out++ = static_cast<uint8_t>(filled.size() >> 8);
+    *out++ = static_cast<uint8_t>(filled.size());
+    for (const auto& bucket : filled) {
+        const uint64_t seconds = bucket.startMs / 1000;
+        put32(static_cast<uint32_t>(seconds >> 32));
+        put32(static_cast<uint32_t>(seconds));
+        put32(bucket.count);
+        for (size_t f = 0; f < SeriesAggregator::FIELD_COUNT; ++f) {
+            if (!(fields & (1u << f))) continue;
+            putFloat(bucket.min[f]);
+            putFloat(bucket.max[f]);
+            putFloat(static_cast<float>(bucket.sum[f] / bucket.count));
+        }
+    }
+    resp.status = 0;
+
+    std::cout << "[StorageNode] Aggregated " << aggregator.readings() << " readings of sensor "
+              << sensorId << " into " << filled.size() << " buckets of " << bucketSeconds << "s" << std::endl;
+    return resp;
+}
+
+Response StorageNode::openQuery(bool oneSensor, uint16_t sensorId, uint64_t startTime, uint64_t endTime) {
+    Response resp;
+    resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_SENSOR_HISTORY);
+
+    // Rango en segundos inclusivo -> milisegundos
+    const uint64_t startMs = startTime * 1000;
+    const uint64_t endMs = endTime * 1000 + 999;
+    const auto tooMany = [this, &resp]() {
+        std::cerr << "[StorageNode] Too many open query cursors (" << cursors.size() << ")" << std::endl;
+        resp.status = 1;
+        errorsCount++;
+    };
+
+    // Antes de leer nada: una consulta que se va a rechazar no paga la lectura
+    {
+        std::lock_guard<std::mutex> lock(cursorsMutex);
+        if (cursors.size() >= MAX_CURSORS) {
+            tooMany();
+            return resp;
+        }
+    }
+
+    std::unique_ptr<QueryCursor> cursor;
+    if (startMs <= endMs && endMs / QueryCache::BUCKET_MS - startMs / QueryCache::BUCKET_MS < MAX_CACHED_BUCKETS) {
+        cursor = openCachedQuery(oneSensor, sensorId, startMs, endMs);
+    }
+    if (!cursor) {
+        cursor = openCursor(oneSensor, sensorId, startMs, endMs);
+    }
+
+    std::lock_guard<std::mutex> lock(cursorsMutex);
+    // Otras consultas pudieron abrirse mientras tanto
+    if (cursors.size() >= MAX_CURSORS) {
+        tooMany();
+        return resp;
+    }
+
+    uint32_t token;
+    do {
+        token = cursorTokens();
+    } while (token == 0 || cursors.count(token) != 0);
+
+    OpenCursor& entry = cursors[token];
+    entry.cursor = std::move(cursor);
+    entry.lastUse = std::chrono::steady_clock::now();
+    totalQueries++;
+
+    writePage(token, entry, resp);
     return resp;
 }
 
+std::unique_ptr<QueryCursor> StorageNode::openCachedQuery(bool oneSensor, uint16_t sensorId,
+                                                          uint64_t startMs, uint64_t endMs) {
+    // La generación se toma antes de leer: si el mantenimiento borra algo
+    // mientras tanto, lo que se guarde ya nace vencido
+    const uint64_t generation = storeGeneration();
+    QueryCache::Key key;
+    key.oneSensor = oneSensor;
+    key.sensorId = oneSensor ? sensorId : 0;
+
+    // El cursor guarda en memoria todo el resultado, así que no puede pasar
+    // de lo que ocupa un tramo de la caché; si pasa (o un tramo no entra)
+    // devuelve nulo y la consulta va de a páginas con openCursor()
+    const size_t limit = queryCache.maxRows();
+    std::vector<SensorReading> rows;
+    for (uint64_t bucket = startMs / QueryCache::BUCKET_MS; bucket <= endMs / QueryCache::BUCKET_MS; ++bucket) {
+        key.bucket = bucket;
+        const QueryCache::Lookup found = queryCache.lookup(key, generation, rows);
+        if (found == QueryCache::Lookup::TOO_LARGE) return nullptr;
+        if (found == QueryCache::Lookup::HIT) {
+            if (rows.size() > limit) return nullptr;
+            continue;
+        }
+
+        const uint64_t bucketStart = bucket * QueryCache::BUCKET_MS;
+        const uint64_t bucketEnd = bucketStart + QueryCache::BUCKET_MS - 1;
+        std::vector<SensorReading> chunk;
+        bool overflow = false;
+        // Pasado el límite se deja de acumular: el recorrido sigue, pero sin memoria
+        const auto keep = [&chunk, &overflow, limit](const SensorReading& r) {
+            if (overflow) return;
+            if (chunk.size() >= limit) {
+                overflow = true;
+                std::vector<SensorReading>().swap(chunk);
+                return;
+            }
+            chunk.push_back(r);
+        };
+        queryCache.beginFill(key);
+        scanShards(oneSensor, sensorId, bucketStart, bucketEnd, keep);
+        if (overflow) {
+            queryCache.abandonFill(key, generation);
+            return nullptr;
+        }
+        const bool fits = rows.size() + chunk.size() <= limit;
+        if (fits) rows.insert(rows.end(), chunk.begin(), chunk.end());
+        queryCache.finishFill(key, generation, std::move(chunk));
+        if (!fits) return nullptr;
+    }
+
+    // Los tramos de los extremos pueden pasarse del rango pedido
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [startMs, endMs](const SensorReading& r) {
+        return r.timestampMs < startMs || r.timestampMs > endMs;
+    }), rows.end());
+    return std::make_unique<QueryCursor>(shards[0]->store(), shards[0]->mutex(),
+                                         std::vector<SeriesIndex::Segment>(), std::move(rows), startMs, endMs);
+}
+
+std::unique_ptr<QueryCursor> StorageNode::openCursor(bool oneSensor, uint16_t sensorId,
+                                                     uint64_t startMs, uint64_t endMs) {
+    std::vector<std::unique_ptr<QueryCursor>> parts;
+    parts.reserve(shards.size());
+    for (auto& shard : shards) {
+        parts.push_back(shard->memtable().openCursor(oneSensor, sensorId, startMs, endMs));
+    }
+    return QueryCursor::merge(std::move(parts));
+}
+
+void StorageNode::scanShards(bool oneSensor, uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                             const TimeSeriesStore::Visitor& visit) {
+    const auto scanShard = [&](StorageShard& shard, const TimeSeriesStore::Visitor& out) {
+        if (oneSensor) {
+            shard.memtable().scanSensor(sensorId, startMs, endMs, out);
+        } else {
+            shard.memtable().scan(startMs, endMs, out);
+        }
+    };
+    if (shards.size() == 1) {
+        scanShard(*shards[0], visit);
+        return;
+    }
+
+    // Cada shard se lee en su tarea (que a su vez reparte sus archivos) y
+    // los resultados, ya ordenados, se mezclan
+    std::vector<std::vector<SensorReading>> runs(shards.size());
+    scanPool->run(shards.size(), [&](size_t i) {
+        scanShard(*shards[i], [&runs, i](const SensorReading& r) { runs[i].push_back(r); });
+    });
+    std::vector<SensorReading> merged;
+    TimeSeriesStore::mergeByTime(runs, merged);
+    for (const auto& r : merged) visit(r);
+}
+
+uint64_t StorageNode::storeGeneration() const {
+    uint64_t generation = 0;
+    for (const auto& shard : shards) {
+        generation += shard->store().generation();
+    }
+    return generation;
+}
+
+size_t StorageNode::appendSharded(const SensorReading* readings, size_t count) {
+    const size_t stored = stageSharded(readings, count, deferredWrites.parts);
+    if (stored > 0) {
+        deferredWrites.readings.insert(deferredWrites.readings.end(), readings, readings + count);
+        deferredWrites.unacked += stored;
+    }
+    return stored;
+}
+
+bool StorageNode::stageShard(size_t shard, const SensorReading* readings, size_t count,
+                             std::vector<StagedPart>& parts) {
+    uint64_t ticket;
+    if (!shards[shard]->memtable().stage(readings, count, ticket)) return false;
+    parts.push_back(StagedPart{shard, ticket});
+    return true;
+}
+
+size_t StorageNode::stageSharded(const SensorReading* readings, size_t count,
+                                 std::vector<StagedPart>& parts) {
+    if (count == 0) return 0;
+    if (shards.size() == 1) {
+        return stageShard(0, readings, count, parts) ? count : 0;
+    }
+
+    // Un lote suele ser de un solo sensor: sin copiar si va entero a un shard
+    std::vector<size_t> owner(count);
+    for (size_t i = 0; i < count; ++i) {
+        owner[i] = i > 0 && readings[i].sensorId == readings[i - 1].sensorId
+                       ? owner[i - 1] : ring->shardOf(readings[i].sensorId);
+    }
+    if (std::all_of(owner.begin(), owner.end(), [&owner](size_t s) { return s == owner[0]; })) {
+        return stageShard(owner[0], readings, count, parts) ? count : 0;
+    }
+
+    size_t stored = 0;
+    ArenaVector<SensorReading> part;
+    part.reserve(count);
+    for (size_t s = 0; s < shards.size(); ++s) {
+        part.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (owner[i] == s) part.push_back(readings[i]);
+        }
+        if (!part.empty() && stageShard(s, part.data(), part.size(), parts)) {
+            stored += part.size();
+        }
+    }
+    return stored;
+}
+
+void StorageNode::writePage(uint32_t token, OpenCursor& entry, Response& resp) {
+    // Página: [token(4)][seq(2)][flags(1)][count(1)] + count * 24 bytes
+    ArenaVector<SensorReading> rows(PAGE_ROWS);
+    const size_t count = entry.cursor->next(rows.data(), rows.size());
+    const bool more = !entry.cursor->done();
+
+    resp.data.resize(PAGE_HEADER_BYTES + count * SENSOR_RECORD_BYTES);
+    uint8_t* out = resp.data.data();
+    out[0] = static_cast<uint8_t>(token >> 24);
+    out[1] = static_cast<uint8_t>(token >> 16);
+    out[2] = static_cast<uint8_t>(token >> 8);
+    out[3] = static_cast<uint8_t>(token);
+    out[4] = static_cast<uint8_t>(entry.seq >> 8);
+    out[5] = static_cast<uint8_t>(entry.seq);
+    out[6] = more ? PAGE_MORE : 0;
+    out[7] = static_cast<uint8_t>(count);
+    for (size_t i = 0; i < count; ++i) {
+        sensorDataToBytes(rows[i].toSensorData(), out + PAGE_HEADER_BYTES + i * SENSOR_RECORD_BYTES);
+    }
+    resp.status = 0;
+    entry.lastPage.assign(resp.data.begin(), resp.data.end());
+
+    std::cout << "[StorageNode] Cursor " << token << " page " << entry.seq << ": " << count
+              << " records" << (more ? "" : " (last)") << std::endl;
+    if (!more) {
+        // Ya no hace falta la consulta; la entrada queda para reenviar la última página
+        entry.cursor.reset();
+    }
+}
+
+void StorageNode::expireCursors() {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(cursorsMutex);
+    for (auto it = cursors.begin(); it != cursors.end();) {
+        if (now - it->second.lastUse >= CURSOR_IDLE) {
+            it = cursors.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 Response StorageNode::handleStoreSensorData(const uint8_t* data, ssize_t len) {
     Response resp;
     resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_ACK);
 
     std::cout << "[StorageNode] handleStoreSensorData - len: " << len << std::endl;
+
+    // Forma con tipo explícito: [STORE_SENSOR_DATA][24 bytes]
+    if (len == static_cast<ssize_t>(sizeof(SensorData)) + 1 &&
+        data[0] == static_cast<uint8_t>(MessageType::STORE_SENSOR_DATA)) {
+        data++;
+        len--;
+    }
     
-    // Parsear datos del sensor (mínimo 24 bytes para 6 floats)
-    if (len != sizeof(SensorData)) {  // 1 byte tipo + 24 bytes datos (6 floats)
+    // Parsear datos del sensor (24 bytes para 6 floats)
+    if (len != sizeof(SensorData)) {
         resp.status = 1;
         errorsCount++;
         std::cerr << "[StorageNode] Invalid sensor data length: " << len << std::endl;
@@ -437,8 +914,7 @@ Response StorageNode::handleStoreSensorData(const uint8_t* data, ssize_t len) {
 
 
         std::cout << "[StorageNode] Storing SensorData to FS..." << std::endl;
-        std::lock_guard<std::mutex> lock(fsMutex);
-        bool success = storeSensorDataToFS(sensorData);
+        bool success = storeSensorData(sensorData);
         
         if (success) {
             resp.status = 0;
@@ -465,6 +941,28 @@ Response StorageNode::handleStoreSensorData(const uint8_t* data, ssize_t len) {
     return resp;
 }
 
+Response StorageNode::handleStoreSensorBatch(const uint8_t* data, ssize_t len) {
+    Response resp;
+    resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_ACK);
+
+    const SensorBatchReader batch(data, static_cast<size_t>(len));
+    if (!batch.valid()) {
+        resp.status = 1;
+        errorsCount++;
+        std::cerr << "[StorageNode] Invalid sensor batch (" << len << " bytes)" << std::endl;
+        return resp;
+    }
+
+    const size_t stored = storeSensorBatch(batch);
+    totalSensorRecords += stored;
+
+    // status 0 solo si se guardó el lote completo; data = lecturas guardadas
+    resp.status = stored == batch.count() ? 0 : 1;
+    if (stored != batch.count()) errorsCount++;
+    resp.data.push_back(static_cast<uint8_t>(stored));
+    return resp;
+}
+
 Response StorageNode::handleStoreBitacora(const uint8_t* data, ssize_t len) {
     Response resp;
     resp.msgId = static_cast<uint8_t>(MessageType::RESPONSE_ACK);
@@ -479,7 +977,9 @@ Response StorageNode::handleStoreBitacora(const uint8_t* data, ssize_t len) {
         // Extraer mensaje de bitácora
         std::string message(reinterpret_cast<const char*>(data + 1), len - 1);
         
-        std::lock_guard<std::mutex> lock(fsMutex);
+        // La bitácora vive en el primer disco
+        FileSystem* fs = &shards[0]->fs();
+        std::unique_lock<std::shared_mutex> lock(shards[0]->mutex());
         
         // Archivo de bitácora
         std::string bitacoraFile = "bitacora.log";
@@ -521,223 +1021,35 @@ Response StorageNode::handleStoreBitacora(const uint8_t* data, ssize_t len) {
     return resp;
 }
 
-bool StorageNode::storeSensorDataToFS(const SensorData& data) {
-    // Usar segundos consistentemente
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-        now.time_since_epoch()).count();
-    
-    // Usar sensorId 0 por defecto
-    uint8_t sensorId = 0;
-    std::string filename = generateSensorFilename(timestamp, sensorId);
-    
-    std::cout << "[StorageNode] Creating file: " << filename 
-              << " with timestamp: " << timestampToString(timestamp) << std::endl;
-    
-    // Crear archivo si no existe
-    if (fs->find(filename) < 0) {
-        if (fs->create(filename) < 0) {
-            std::cerr << "[StorageNode] Failed to create file: " << filename << std::endl;
-            auto& logger = LogManager::instance();
-            try{
-                logger.error("Failed to create file: " + filename);
-            } catch (const std::exception& ex) {
-                std::cerr << "[StorageNode] Logging error: " << ex.what() << std::endl;
-            }
-            return false;
-        }
-    } else {
-        std::cout << "[StorageNode] File already exists: " << filename 
-                  << ", data will be appended" << std::endl;
-    }
-    
-    // Abrir archivo
-    if (fs->openFile(filename) != 0) {
-        std::cerr << "[StorageNode] Failed to open file: " << filename << std::endl;
-        auto& logger = LogManager::instance();
-        try{
-            logger.error("Failed to open file: " + filename);
-        } catch (const std::exception& ex) {
-            std::cerr << "[StorageNode] Logging error: " << ex.what() << std::endl;
-        }
-        
-        return false;
-    }
-    
-    // Leer contenido existente (si hay)
-    std::string existingContent = fs->read(filename);
-    
-    // Convertir SensorData a string para almacenar
-    std::string dataString = sensorDataToString(data);
-    
-    // Si ya hay contenido, agregar nueva línea
-    std::string contentToWrite;
-    if (!existingContent.empty()) {
-        contentToWrite = existingContent + "\n" + dataString;
-        std::cout << "[StorageNode] Appending to existing file content" << std::endl;
-    } else {
-        contentToWrite = dataString;
-        std::cout << "[StorageNode] Writing new file content" << std::endl;
-    }
-    
-    // Escribir
-    bool success = fs->write(filename, contentToWrite);
-    
-    // Cerrar
-    fs->closeFile(filename);
-    
-    if (success) {
-        std::cout << "[StorageNode] Successfully stored data in: " << filename << std::endl;
-    }
-    
-    return success;
-}
-
-std::vector<SensorData> StorageNode::querySensorDataByDate(uint64_t startTime, uint64_t endTime) {
-    std::vector<SensorData> results;
-
-    std::cout << "[StorageNode] Searching files from " << timestampToString(startTime) 
-              << " to " << timestampToString(endTime) << std::endl;
-
-    // Recorremos las entradas del directorio virtual
-    for (const auto& entry : fs->getDirectory()) {
-        if (entry.inode_id == 0) continue; // entrada vacía
+bool StorageNode::storeSensorData(const SensorData& data) {
+    // Lectura suelta: sin id de sensor (0) y con la hora de llegada
+    SensorReading reading;
+    reading.sensorId = 0;
+    reading.timestampMs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    reading.distance = data.distance;
+    reading.temperature = data.temperature;
+    reading.pressure = data.pressure;
+    reading.altitude = data.altitude;
+    reading.sealevelPressure = data.sealevelPressure;
+    reading.realAltitude = data.realAltitude;
 
-        std::string filename(entry.name);
-        std::cout << "[StorageNode] Checking file: " << filename << std::endl;
-
-        // Coincide con formato sensor_<id>_<timestamp>.dat
-        std::smatch match;
-        std::regex pattern(R"(sensor_(\d+)_(\d+)\.dat)");
-        if (!std::regex_match(filename, match, pattern)) {
-            continue;
-        }
-
-        uint64_t timestamp = std::stoull(match[2].str());
-        std::cout << "[StorageNode] File " << filename << " has timestamp: " << timestampToString(timestamp) << std::endl;
-        
-        if (timestamp < startTime || timestamp > endTime) {
-            std::cout << "[StorageNode] File " << filename << " outside time range, skipping" << std::endl;
-            continue;
-        }
-
-        if (fs->openFile(filename) != 0) {
-            std::cout << "[StorageNode] Failed to open file: " << filename << std::endl;
-            continue;
-        }
-        
-        std::string raw = fs->read(filename);
-        fs->closeFile(filename);
-
-        std::cout << "[StorageNode] Raw data from " << filename << ": " << raw << std::endl;
-
-        // Procesar múltiples líneas si existen
-        std::istringstream rawStream(raw);
-        std::string line;
-        int lineCount = 0;
-        
-        while (std::getline(rawStream, line)) {
-            if (line.empty()) continue;
-            
-            lineCount++;
-            std::cout << "[StorageNode] Processing line " << lineCount << ": " << line << std::endl;
-            
-            try {
-                SensorData sd = stringToSensorData(line);
-                results.push_back(sd);
-                std::cout << "[StorageNode] Successfully parsed line " << lineCount 
-                          << ": Dist=" << sd.distance << " Temp=" << sd.temperature << std::endl;
-                          
-            } catch (const std::exception& e) {
-                std::cerr << "[StorageNode] Error parsing line " << lineCount 
-                          << " in file " << filename << ": " << e.what() << "\n";
-            }
-        }
-        
-        std::cout << "[StorageNode] Processed " << lineCount << " lines from " << filename << std::endl;
-    }
-
-    std::cout << "[StorageNode] " << results.size() << " registers found within date range.\n";
-    return results;
+    return appendSharded(&reading, 1) > 0;
 }
 
-std::vector<SensorData> StorageNode::querySensorDataById(uint8_t sensorId, uint64_t startTime, uint64_t endTime) {
-    std::vector<SensorData> results;
-
-    std::cout << "[StorageNode] Searching for sensor " << static_cast<int>(sensorId)
-              << " from " << timestampToString(startTime) 
-              << " to " << timestampToString(endTime) << std::endl;
-
-    for (const auto& entry : fs->getDirectory()) {
-        if (entry.inode_id == 0) continue;
-
-        std::string filename(entry.name);
-        std::cout << "[StorageNode] Checking file: " << filename << std::endl;
-
-        std::smatch match;
-        std::regex pattern(R"(sensor_(\d+)_(\d+)\.dat)");
-        if (!std::regex_match(filename, match, pattern)) {
-            std::cout << "[StorageNode] File " << filename << " doesn't match pattern, skipping" << std::endl;
-            continue;
-        }
-
-        uint8_t fileId = static_cast<uint8_t>(std::stoi(match[1].str()));
-        uint64_t timestamp = std::stoull(match[2].str());
-
-        std::cout << "[StorageNode] File " << filename << " has sensorId: " << static_cast<int>(fileId)
-                  << " and timestamp: " << timestampToString(timestamp) << std::endl;
-
-        // Filtramos por ID y rango de tiempo
-        if (fileId != sensorId) {
-            std::cout << "[StorageNode] Sensor ID mismatch (expected " << static_cast<int>(sensorId)
-                      << ", got " << static_cast<int>(fileId) << "), skipping" << std::endl;
-            continue;
-        }
-        if (timestamp < startTime || timestamp > endTime) {
-            std::cout << "[StorageNode] File " << filename << " outside time range, skipping" << std::endl;
-            continue;
-        }
-
-        if (fs->openFile(filename) != 0) {
-            std::cout << "[StorageNode] Failed to open file: " << filename << std::endl;
-            continue;
-        }
-        
-        std::string raw = fs->read(filename);
-        fs->closeFile(filename);
-
-        std::cout << "[StorageNode] Raw data from " << filename << ": " << raw << std::endl;
-
-        // Procesar múltiples líneas si existen
-        std::istringstream rawStream(raw);
-        std::string line;
-        int lineCount = 0;
-        
-        while (std::getline(rawStream, line)) {
-            if (line.empty()) continue;
-            
-            lineCount++;
-            std::cout << "[StorageNode] Processing line " << lineCount << ": " << line << std::endl;
-            
-            try {
-                SensorData sd = stringToSensorData(line);
-                results.push_back(sd);
-                std::cout << "[StorageNode] Successfully parsed line " << lineCount 
-                          << ": Dist=" << sd.distance << " Temp=" << sd.temperature << std::endl;
-                          
-            } catch (const std::exception& e) {
-                std::cerr << "[StorageNode] Error parsing line " << lineCount 
-                          << " in file " << filename << ": " << e.what() << "\n";
-            }
-        }
-        
-        std::cout << "[StorageNode] Processed " << lineCount << " lines from " << filename << std::endl;
+size_t StorageNode::storeSensorBatch(const SensorBatchReader& batch) {
+    ArenaVector<SensorReading> readings;
+    readings.reserve(batch.count());
+    for (size_t i = 0; i < batch.count(); ++i) {
+        readings.push_back(batch.at(i));
     }
 
-    std::cout << "[StorageNode] " << results.size()
-              << " registers found for the sensor " << (int)sensorId << ".\n";
-
-    return results;
+    // El WAL de cada shard guarda su parte del lote entera o nada
+    const size_t stored = appendSharded(readings.data(), readings.size());
+    std::cout << "[StorageNode] Batch of " << batch.count() << " readings, "
+              << stored << " stored" << std::endl;
+    return stored;
 }
 
 void StorageNode::registerWithMaster() {
@@ -772,36 +1084,22 @@ void StorageNode::sendHeartbeat() {
     }
 }
 
-void StorageNode::listenMasterServerResponses() {
-    std::cout << "[StorageNode] Listener thread running" << std::endl;
-    
-    auto& logger = LogManager::instance();
-    try {
-        logger.info("Listener thread started - monitoring every 30s");
-    } catch (const std::exception& ex) {
-        std::cerr << "[StorageNode] Logging error: " << ex.what() << std::endl;
-    }
-    
-    while (listening.load()) {
-        std::this_thread::sleep_for(std::chrono::seconds(30));
-        sendHeartbeat();
+void StorageNode::scheduleHeartbeat() {
+    if (heartbeatTimer >= 0) {
+        return;
     }
-    
-    std::cout << "[StorageNode] Listener thread stopped" << std::endl;
+
+    heartbeatTimer = eventLoop().addTimer(HEARTBEAT_INTERVAL, [this]() { sendHeartbeat(); });
+
+    auto& logger = LogManager::instance();
     try {
-        logger.info("Listener thread stopped");
+        logger.info("Heartbeat timer armed - every " +
+                    std::to_string(HEARTBEAT_INTERVAL.count()) + "s");
     } catch (const std::exception& ex) {
         std::cerr << "[StorageNode] Logging error: " << ex.what() << std::endl;
     }
 }
 
-std::string StorageNode::generateSensorFilename(uint64_t timestamp, uint8_t sensorId) const {
-    std::ostringstream oss;
-    oss << "sensor_" << static_cast<int>(sensorId) 
-        << "_" << timestamp << ".dat";
-    return oss.str();
-}
-
 std::string StorageNode::generateDateIndexFilename(uint64_t timestamp) const {
     std::ostringstream oss;
     oss << "index_" << (timestamp / 86400) << ".idx";
@@ -823,10 +1121,42 @@ std::string StorageNode::sockaddrToString(const sockaddr_in& addr) const {
 }
 
 StorageNode::Stats StorageNode::getStats() const {
-    std::lock_guard<std::mutex> lock(fsMutex);
     Stats stats;
     stats.totalSensorRecords = totalSensorRecords.load();
     stats.totalQueries = totalQueries.load();
     stats.errorsCount = errorsCount.load();
+    stats.filesStored = 0;
+    stats.shards = shards.size();
+    stats.diskCache = BlockCache::Stats{};
+    for (size_t i = 0; i < shards.size(); ++i) {
+        const BlockCache::Stats cache = shards[i]->fs().cacheStats();
+        stats.diskCache.hits += cache.hits;
+        stats.diskCache.misses += cache.misses;
+        stats.diskCache.readahead += cache.readahead;
+        stats.diskCache.evictions += cache.evictions;
+        stats.diskCache.writebacks += cache.writebacks;
+        stats.diskCache.pages += cache.pages;
+        stats.diskCache.capacity += cache.capacity;
+        stats.diskCache.dirty += cache.dirty;
+
+        const SeriesCompactor::Stats shard = shards[i]->compactor().stats();
+        if (i == 0) {
+            stats.compaction = shard;
+        } else {
+            stats.compaction.passes += shard.passes;
+            stats.compaction.steps += shard.steps;
+            stats.compaction.compactedFiles += shard.compactedFiles;
+            stats.compaction.rolledFiles += shard.rolledFiles;
+            stats.compaction.rolledReadings += shard.rolledReadings;
+            stats.compaction.expiredFiles += shard.expiredFiles;
+            stats.compaction.writtenFiles += shard.writtenFiles;
+            stats.compaction.reclaimedBytes += shard.reclaimedBytes;
+            stats.compaction.backlog = stats.compaction.backlog || shard.backlog;
+            stats.compaction.lastPass = std::max(stats.compaction.lastPass, shard.lastPass);
+        }
+        std::shared_lock<std::shared_mutex> lock(shards[i]->mutex());
+        stats.filesStored += shards[i]->store().fileCount() + shards[i]->store().rollupFileCount();
+    }
+    stats.queryCache = queryCache.stats();
     return stats;
 }
\ No newline at end of file
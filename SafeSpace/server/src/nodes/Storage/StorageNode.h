@@ -6,20 +6,37 @@
 #include "../../model/filesystem/FileSystem.h"
 #include "../../common/LogManager.h"
 #include "../../model/structures/sensordata.h"
+#include "../../model/structures/SensorBatch.h"
+#include "TimeSeriesStore.h"
+#include "MemTable.h"
+#include "QueryCache.h"
+#include "QueryCursor.h"
+#include "ReplayFilter.h"
+#include "SeriesAggregator.h"
+#include "ScanPool.h"
+#include "SeriesCompactor.h"
+#include "ShardRing.h"
+#include "StorageShard.h"
 #include <string>
 #include <map>
 #include <vector>
 #include <mutex>
+#include <shared_mutex>
 #include <memory>
-#include <thread>
+#include <chrono>
 #include <cstdint>
 #include <atomic>
+#include <random>
+#include <unordered_map>
 
 // Tipos de mensajes del protocolo
 enum class MessageType : uint8_t {
     // Consultas
     QUERY_BY_DATE = 0x01,           // Consultar por fecha (2 bytes)
-    QUERY_BY_SENSOR = 0x02,         // Consultar por sensor ID (15 bytes)
+    QUERY_BY_SENSOR = 0x02,         // Consultar por sensor ID (19 bytes; 18 con ID de 1 byte)
+    QUERY_NEXT = 0x03,              // Siguiente página de una consulta
+    QUERY_CANCEL = 0x04,            // Cerrar una consulta paginada
+    QUERY_AGGREGATE = 0x05,         // Min/max/promedio por intervalo (solo enmarcado)
 
     // Almacenamiento
     STORE_SENSOR_DATA = 0x10,       // Guardar datos de sensores (50 bytes)
@@ -30,6 +47,7 @@ enum class MessageType : uint8_t {
     RESPONSE_SENSOR_HISTORY = 0x21, // Respuesta con histórico
     RESPONSE_ACK = 0x22,            // Confirmación
     RESPONSE_ERROR = 0x23,          // Error
+    RESPONSE_AGGREGATE = 0x24,      // Respuesta con intervalos agregados
 
     // Registro y descubrimiento
     REGISTER_NODE = 0x30,           // Registrar nodo en master
@@ -40,16 +58,36 @@ enum class MessageType : uint8_t {
 struct Response {
     uint8_t msgId;
     uint8_t status;
-    std::vector<uint8_t> data;
+    ArenaVector<uint8_t> data;   // vive en la arena de la petición
 
-    std::vector<uint8_t> toBytes() const;
+    // Serializa directo en el buffer de envío; false si no cabe
+    bool writeTo(ResponseBuffer& out) const;
 };
 
+// Lo que un MemTable::stage() dejó en un shard (definido en StorageNode.cpp)
+struct StagedPart;
+
 class StorageNode: public UDPServer {
  public:
+    // Caché de bloques por disco si no se indica otra
+    static constexpr size_t DISK_CACHE_BYTES = 16 * 1024 * 1024;
+
     StorageNode(uint16_t storagePort, const std::string& masterServerIp,
                 uint16_t masterServerPort, const std::string& nodeId,
-                const std::string& diskPath, size_t bufsize = 65536);
+                const std::string& diskPath, size_t bufsize = 65536,
+                const SeriesCompactor::Options& retention = SeriesCompactor::Options(),
+                size_t diskCacheBytes = DISK_CACHE_BYTES);
+    /**
+     * Un shard por disco: cada sensor se guarda en el disco que le toca en
+     * un ShardRing, con su propio WAL, hilo de volcado y mantenimiento; las
+     * consultas leen de todos y mezclan por timestamp. diskCacheBytes es la
+     * caché de bloques de cada disco (0 sin caché).
+     */
+    StorageNode(uint16_t storagePort, const std::string& masterServerIp,
+                uint16_t masterServerPort, const std::string& nodeId,
+                const std::vector<std::string>& diskPaths, size_t bufsize = 65536,
+                const SeriesCompactor::Options& retention = SeriesCompactor::Options(),
+                size_t diskCacheBytes = DISK_CACHE_BYTES);
     ~StorageNode() override;
 
     void start();
@@ -60,6 +98,10 @@ class StorageNode: public UDPServer {
       size_t totalQueries;
       size_t errorsCount;
       size_t filesStored;
+      size_t shards;
+      SeriesCompactor::Stats compaction;   // sumado entre shards
+      BlockCache::Stats diskCache;         // sumado entre shards
+      QueryCache::Stats queryCache;
    };
 
    Stats getStats() const;
@@ -67,7 +109,12 @@ class StorageNode: public UDPServer {
        // Método público para pruebas
     void testReceive(const uint8_t* data, ssize_t len, std::string& out_response) {
         sockaddr_in testPeer{};
-        onReceive(testPeer, data, len, out_response);
+        RequestArena::Scope scope(RequestArena::local());
+        std::vector<uint8_t> buffer(bufsize_);
+        ResponseBuffer response(buffer.data(), buffer.size());
+        onDatagram(testPeer, data, static_cast<size_t>(len), response);
+        onBatchDispatched();
+        out_response.assign(reinterpret_cast<const char*>(response.data()), response.size());
     }
 
 
@@ -77,14 +124,40 @@ class StorageNode: public UDPServer {
     std::string masterServerIp;
     uint16_t masterServerPort;
     std::string nodeId;
-    std::string diskPath;
-
-    FileSystem* fs;
-    mutable std::mutex fsMutex;
-
-    // Thread para escuchar respuestas del master
-    std::thread listenerThread;
-    std::atomic<bool> listening;
+    std::vector<std::string> diskPaths;
+
+    // Consultas paginadas abiertas, por token
+    struct OpenCursor {
+        std::unique_ptr<QueryCursor> cursor;   // nulo cuando ya se entregó la última página
+        uint16_t seq = 0;                      // última página enviada
+        std::vector<uint8_t> lastPage;         // se reenvía si el cliente la vuelve a pedir
+        std::chrono::steady_clock::time_point lastUse;
+    };
+    std::unordered_map<uint32_t, OpenCursor> cursors;
+    std::mutex cursorsMutex;
+    std::mt19937 cursorTokens;
+    int cursorTimer;
+    static constexpr std::chrono::seconds CURSOR_IDLE{30};
+    static constexpr size_t MAX_CURSORS = 256;
+
+    // Tramos de una hora de las consultas recientes; una escritura borra los suyos
+    QueryCache queryCache;
+    static constexpr size_t QUERY_CACHE_BYTES = 16 * 1024 * 1024;
+    // Consultas más largas (o más grandes que un tramo) van directo al store, de a una página
+    static constexpr uint64_t MAX_CACHED_BUCKETS = 6;
+
+    std::unique_ptr<ScanPool> scanPool;       // lee en paralelo los archivos de una consulta
+    // Un disco por shard, cada uno con store, WAL + MemTable y compactación
+    // de fondo (que consulta cursors, así que se destruyen antes)
+    std::vector<std::unique_ptr<StorageShard>> shards;
+    std::unique_ptr<ShardRing> ring;          // a qué shard va cada sensor
+
+    // Seq de escrituras replicadas ya aplicadas, para no guardar dos veces un reenvío
+    ReplayFilter replays;
+
+    // Timer del heartbeat en el event loop del servidor (-1 si no está armado)
+    int heartbeatTimer;
+    static constexpr std::chrono::seconds HEARTBEAT_INTERVAL{30};
 
     // Estadísticas
     std::atomic<size_t> totalSensorRecords;
@@ -92,37 +165,78 @@ class StorageNode: public UDPServer {
     std::atomic<size_t> errorsCount;
 
     // Métodos privados
-    void listenMasterServerResponses();
+    void scheduleHeartbeat();
     void registerWithMaster();
     void sendHeartbeat();
+    void expireCursors();
+
+    // Manejadores de mensajes; data/len es el payload del mensaje
+    using MessageHandler = Response (StorageNode::*)(const uint8_t* data, ssize_t len);
+    static const DispatchTable<MessageHandler> routes;
+
+    // Detección por tipo/longitud para datagramas sin encabezado
+    static bool classifyLegacy(const uint8_t* data, size_t len, MessageView& msg);
 
-    // Manejadores de mensajes
     Response handleQueryByDate(const uint8_t* data, ssize_t len);
     Response handleQueryBySensor(const uint8_t* data, ssize_t len);
+    Response handleQueryNext(const uint8_t* data, ssize_t len);
+    Response handleQueryCancel(const uint8_t* data, ssize_t len);
+    Response handleQueryAggregate(const uint8_t* data, ssize_t len);
     Response handleStoreSensorData(const uint8_t* data, ssize_t len);
+    Response handleStoreSensorBatch(const uint8_t* data, ssize_t len);
     Response handleStoreBitacora(const uint8_t* data, ssize_t len);
 
     // Utilidades
     std::string sockaddrToString(const sockaddr_in& addr) const;
-    std::string generateSensorFilename(uint64_t timestamp, uint8_t sensorId) const;
     std::string generateDateIndexFilename(uint64_t timestamp) const;
     std::string timestampToString(uint64_t timestamp) const;
 
     // Almacenamiento y consulta
-    bool storeSensorDataToFS(const SensorData& data);
-    std::vector<SensorData> querySensorDataByDate(uint64_t startTime, uint64_t endTime);
-    std::vector<SensorData> querySensorDataById(uint8_t sensorId, uint64_t startTime, uint64_t endTime);
-
-    std::vector<uint8_t> sensorDataToBytes(const SensorData& data) const;
+    bool storeSensorData(const SensorData& data);
+    // Guarda todo el lote; devuelve cuántas lecturas quedaron almacenadas
+    size_t storeSensorBatch(const SensorBatchReader& batch);
+    // Abre el cursor de la consulta y responde con su primera página
+    Response openQuery(bool oneSensor, uint16_t sensorId, uint64_t startTime, uint64_t endTime);
+    // Arma la consulta con los tramos de queryCache y lee del store los que
+    // falten; nulo si el resultado no entra en un tramo de la caché
+    std::unique_ptr<QueryCursor> openCachedQuery(bool oneSensor, uint16_t sensorId,
+                                                 uint64_t startMs, uint64_t endMs);
+    // Cursor sobre todos los shards, mezclado por timestamp
+    std::unique_ptr<QueryCursor> openCursor(bool oneSensor, uint16_t sensorId,
+                                            uint64_t startMs, uint64_t endMs);
+    // MemTable::scan()/scanSensor() de todos los shards (en paralelo), en orden de timestamp
+    void scanShards(bool oneSensor, uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                    const TimeSeriesStore::Visitor& visit);
+    // Suma de TimeSeriesStore::generation() de los shards
+    uint64_t storeGeneration() const;
+    // Guarda cada lectura en el MemTable de su shard; devuelve cuántas quedaron
+    // guardadas (la parte de cada shard entra entera o nada). Son durables,
+    // visibles y su ACK sale cuando onBatchDispatched() sincroniza los WAL
+    size_t appendSharded(const SensorReading* readings, size_t count);
+    // El reparto de appendSharded(): anota en parts el ticket de cada shard
+    size_t stageSharded(const SensorReading* readings, size_t count, std::vector<StagedPart>& parts);
+    bool stageShard(size_t shard, const SensorReading* readings, size_t count,
+                    std::vector<StagedPart>& parts);
+    // Llena resp con la siguiente página de entry; cursorsMutex tomado
+    void writePage(uint32_t token, OpenCursor& entry, Response& resp);
+
+    // Escribe los 24 bytes (network byte order) de data en out
+    void sensorDataToBytes(const SensorData& data, uint8_t* out) const;
     SensorData bytesToSensorData(const uint8_t* data, size_t len) const;
-    std::string sensorDataToString(const SensorData& data) const;
-    SensorData stringToSensorData(const std::string& str) const;
 
  protected:
     /**
-     * Maneja mensajes recibidos del master.
+     * Maneja mensajes recibidos del master; la respuesta se escribe
+     * directamente en el buffer de envío del servidor.
+     */
+   void onDatagram(const sockaddr_in& peer, const uint8_t* data,
+                   size_t len, ResponseBuffer& response) override;
+    /**
+     * Fin de la ronda: un fdatasync por shard cubre todas las escrituras
+     * recibidas en ella. Las que quedaron en disco se hacen visibles, invalidan
+     * la caché y su seq replicada cuenta como aplicada; las demás se descartan
+     * y sus ACK pasan a status 1 antes de salir.
      */
-   void onReceive(const sockaddr_in& peer, const uint8_t* data,
-                   ssize_t len, std::string& out_response) override;
+   void onBatchDispatched() override;
 };
 #endif // STORAGENODE_H
\ No newline at end of file
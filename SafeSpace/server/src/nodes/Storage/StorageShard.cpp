@@ -0,0 +1,28 @@
+#include "StorageShard.h"
+#include <iostream>
+#include <stdexcept>
+
+StorageShard::StorageShard(const std::string& diskPath, ScanPool* scanPool, std::function<bool()> busy,
+                           const SeriesCompactor::Options& retention, size_t cacheBytes)
+    : diskPath_(diskPath)
+{
+    // Lo que la caché retiene lo cubre el WAL hasta el sync() de cada volcado
+    fs_ = std::make_unique<FileSystem>(diskPath, cacheBytes);
+    if (!fs_->isValid()) {
+        throw std::runtime_error("FileSystem initialization failed: " + diskPath);
+    }
+    std::cout << "[StorageShard] FileSystem initialized: " << diskPath << std::endl;
+
+    // Motor de series de tiempo; los CSV del formato anterior pasan a segmentos
+    store_ = std::make_unique<TimeSeriesStore>(*fs_);
+    store_->migrateLegacy();
+
+    // Ingesta con WAL en el host junto a la imagen; las lecturas se
+    // confirman al quedar en el WAL y se vuelcan al store en lotes
+    MemTable::Options ingest;
+    ingest.scanPool = scanPool;
+    memtable_ = std::make_unique<MemTable>(*store_, mutex_, diskPath + ".wal", ingest);
+
+    // Mantenimiento de fondo; se posterga mientras busy() diga que sí
+    compactor_ = std::make_unique<SeriesCompactor>(*store_, mutex_, std::move(busy), retention);
+}
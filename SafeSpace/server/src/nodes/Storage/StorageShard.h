@@ -0,0 +1,55 @@
+#ifndef STORAGESHARD_H
+#define STORAGESHARD_H
+
+#include "../../model/filesystem/FileSystem.h"
+#include "MemTable.h"
+#include "ScanPool.h"
+#include "SeriesCompactor.h"
+#include "TimeSeriesStore.h"
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+
+/**
+ * Un disco del StorageNode con todo lo que trabaja sobre él: FileSystem,
+ * TimeSeriesStore, su lock, el MemTable (WAL en "<disco>.wal" y un hilo
+ * que vuelca solo a este disco) y el SeriesCompactor.
+ *
+ * Cada shard tiene su propio lock, así el volcado o el mantenimiento de un
+ * disco no frena a los demás. Los miembros se destruyen en orden inverso:
+ * compactor y memtable (que vuelca lo pendiente) antes que store y fs.
+ */
+class StorageShard {
+ public:
+    /**
+     * @param scanPool hilos de consulta compartidos por todos los shards.
+     * @param busy se le pasa al SeriesCompactor.
+     * @param cacheBytes caché de bloques del FileSystem; 0 sin caché.
+     * @throws std::runtime_error si el disco o su WAL no se pueden abrir.
+     */
+    StorageShard(const std::string& diskPath, ScanPool* scanPool, std::function<bool()> busy,
+                 const SeriesCompactor::Options& retention, size_t cacheBytes);
+
+    const std::string& diskPath() const { return diskPath_; }
+    FileSystem& fs() { return *fs_; }
+    TimeSeriesStore& store() { return *store_; }
+    const TimeSeriesStore& store() const { return *store_; }
+    // Exclusivo para escribir en fs; compartido para las consultas
+    std::shared_mutex& mutex() const { return mutex_; }
+    MemTable& memtable() { return *memtable_; }
+    const SeriesCompactor& compactor() const { return *compactor_; }
+
+ private:
+    std::string diskPath_;
+    std::unique_ptr<FileSystem> fs_;
+    std::unique_ptr<TimeSeriesStore> store_;
+    mutable std::shared_mutex mutex_;
+    std::unique_ptr<MemTable> memtable_;
+    std::unique_ptr<SeriesCompactor> compactor_;
+
+    StorageShard(const StorageShard&) = delete;
+    StorageShard& operator=(const StorageShard&) = delete;
+};
+
+#endif // STORAGESHARD_H
@@ -0,0 +1,1122 @@
+#include "TimeSeriesStore.h"
+#include "ColumnKernels.h"
+#include "SeriesCodec.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <sstream>
+
+namespace {
+constexpr uint64_t TIMESTAMP_MASK = (1ull << 48) - 1;
+constexpr uint64_t ALL_TIME = ~0ull;
+const char* const JOURNAL = "compaction.journal";
+
+// Lee un entero decimal desde p; deja p en el primer carácter que no es dígito
+bool parseNumber(const char*& p, uint64_t& out) {
+    if (*p < '0' || *p > '9') return false;
+    char* end;
+    out = std::strtoull(p, &end, 10);
+    p = end;
+    return true;
+}
+
+// Campo f (orden de SensorData) de la fila i de un .col sin comprimir de n registros
+float columnField(const uint8_t* data, size_t n, size_t f, size_t i) {
+    float v;
+    std::memcpy(&v, data + n * sizeof(uint64_t) + (f * n + i) * sizeof(float), sizeof(v));
+    return v;
+}
+
+uint64_t columnTimestamp(const uint8_t* data, size_t i) {
+    uint64_t ts;
+    std::memcpy(&ts, data + i * sizeof(uint64_t), sizeof(ts));
+    return ts;
+}
+
+// Intervalos de un ancho fijo armados de lecturas o de intervalos más finos;
+// solo existen los que reciben algo
+class RollupBuilder {
+ public:
+    explicit RollupBuilder(uint64_t widthMs) : widthMs_(widthMs), readings_(0) {}
+
+    void add(const ColumnBlock& block) {
+        for (size_t i = 0; i < block.count; ++i) {
+            SeriesAggregator::Bucket& bucket = at(block.timestampMs[i]);
+            ++bucket.count;
+            for (size_t f = 0; f < SENSOR_FIELDS; ++f) {
+                const float v = block.fields[f][i];
+                bucket.min[f] = v < bucket.min[f] ? v : bucket.min[f];
+                bucket.max[f] = v > bucket.max[f] ? v : bucket.max[f];
+                bucket.sum[f] += v;
+            }
+        }
+        readings_ += block.count;
+    }
+
+    void add(const SeriesAggregator::Bucket& finer) {
+        SeriesAggregator::Bucket& bucket = at(finer.startMs);
+        bucket.count += finer.count;
+        for (size_t f = 0; f < SENSOR_FIELDS; ++f) {
+            bucket.min[f] = finer.min[f] < bucket.min[f] ? finer.min[f] : bucket.min[f];
+            bucket.max[f] = finer.max[f] > bucket.max[f] ? finer.max[f] : bucket.max[f];
+            bucket.sum[f] += finer.sum[f];
+        }
+        readings_ += finer.count;
+    }
+
+    uint64_t readings() const { return readings_; }
+
+    std::vector<SeriesAggregator::Bucket> finish() const {
+        std::vector<SeriesAggregator::Bucket> out;
+        out.reserve(buckets_.size());
+        for (const auto& entry : buckets_) out.push_back(entry.second);
+        return out;
+    }
+
+ private:
+    uint64_t widthMs_;
+    uint64_t readings_;
+    std::map<uint64_t, SeriesAggregator::Bucket> buckets_;
+
+    SeriesAggregator::Bucket& at(uint64_t timestampMs) {
+        const uint64_t startMs = timestampMs - timestampMs % widthMs_;
+        auto it = buckets_.find(startMs);
+        if (it == buckets_.end()) {
+            SeriesAggregator::Bucket bucket;
+            bucket.startMs = startMs;
+            std::fill(bucket.min, bucket.min + SENSOR_FIELDS, std::numeric_limits<float>::infinity());
+            std::fill(bucket.max, bucket.max + SENSOR_FIELDS, -std::numeric_limits<float>::infinity());
+            std::fill(bucket.sum, bucket.sum + SENSOR_FIELDS, 0.0);
+            it = buckets_.emplace(startMs, bucket).first;
+        }
+        return it->second;
+    }
+};
+}
+
+TimeSeriesStore::TimeSeriesStore(FileSystem& fs) : fs_(fs) {
+    recoverJournal();
+
+    // Armar el índice: el máximo de cada segmento sale de leerlo una vez
+    std::vector<SeriesIndex::Segment> files;
+    std::map<uint64_t, std::vector<SeriesIndex::Segment>> rollups;
+    std::vector<SeriesIndex::Segment> full;    // .seg llenos que quedaron sin sellar
+    std::vector<SeriesIndex::Segment> plain;   // .col sin comprimir de versiones anteriores
+    std::string raw;
+    for (const auto& entry : fs_.getDirectory()) {
+        if (entry.inode_id == 0) continue;
+
+        SeriesIndex::Segment file;
+        if (parseSegmentName(entry.name, file.sensorId, file.startMs, file.columnar)) {
+            file.name = entry.name;
+            file.maxMs = file.startMs;
+            if (readFile(file.name, raw)) {
+                const auto* data = reinterpret_cast<const uint8_t*>(raw.data());
+                SegmentDecoder decoder;
+                SensorReading r;
+                if (file.columnar && decoder.open(data, raw.size(), file.sensorId)) {
+                    file.records = decoder.size();
+                    while (decoder.next(r)) file.maxMs = std::max(file.maxMs, r.timestampMs);
+                } else {
+                    file.records = raw.size() / RECORD_SIZE;
+                    for (size_t i = 0; i < file.records; ++i) {
+                        const uint64_t ts = file.columnar ? columnTimestamp(data, i)
+                                                          : decode(data + i * RECORD_SIZE).timestampMs;
+                        file.maxMs = std::max(file.maxMs, ts);
+                    }
+                    if (file.columnar && file.records > 0) plain.push_back(file);
+                }
+            }
+
+            if (!file.columnar) {
+                if (file.records >= RECORDS_PER_SEGMENT) full.push_back(file);
+
+                // El segmento activo de cada sensor es el de inicio más reciente
+                ActiveSegment& seg = active_[file.sensorId];
+                if (seg.name.empty() || seg.startMs <= file.startMs) {
+                    seg.name = file.name;
+                    seg.startMs = file.startMs;
+                    seg.records = file.records;
+                }
+            }
+            files.push_back(std::move(file));
+            continue;
+        }
+
+        uint64_t seconds;
+        if (parseLegacyName(entry.name, file.sensorId, seconds)) {
+            file.name = entry.name;
+            file.startMs = seconds * 1000;
+            file.maxMs = file.startMs;
+            file.legacy = true;
+            files.push_back(std::move(file));
+            continue;
+        }
+
+        uint64_t widthMs;
+        if (parseRollupName(entry.name, file.sensorId, widthMs, file.startMs)) {
+            file.name = entry.name;
+            file.maxMs = file.startMs;
+            if (readFile(file.name, raw)) {
+                file.records = raw.size() / ROLLUP_SIZE;
+                for (size_t i = 0; i < file.records; ++i) {
+                    const auto* record = reinterpret_cast<const uint8_t*>(raw.data()) + i * ROLLUP_SIZE;
+                    file.maxMs = std::max(file.maxMs, decodeRollup(record).startMs);
+                }
+            }
+            rollups[widthMs].push_back(std::move(file));
+        }
+    }
+    index_.rebuild(std::move(files));
+    for (auto& tier : rollups) {
+        rollups_[tier.first].rebuild(std::move(tier.second));
+    }
+
+    for (const auto& file : full) {
+        if (sealSegment(file.sensorId, file.startMs, file.name)) {
+            ActiveSegment& seg = active_[file.sensorId];
+            if (seg.name == file.name) seg.name.clear();
+        }
+    }
+    for (const auto& file : plain) {
+        compressColumns(file);
+    }
+    std::cout << "[TimeSeriesStore] " << active_.size() << " series activas, "
+              << index_.size() << " archivos indexados, " << rollupFileCount()
+              << " de resúmenes" << std::endl;
+}
+
+void TimeSeriesStore::encode(const SensorReading& reading, uint8_t* out) {
+    const uint64_t key = ((reading.timestampMs & TIMESTAMP_MASK) << 16) | reading.sensorId;
+    const float fields[6] = {reading.distance, reading.temperature, reading.pressure,
+                             reading.altitude, reading.sealevelPressure, reading.realAltitude};
+    std::memcpy(out, &key, sizeof(key));
+    std::memcpy(out + sizeof(key), fields, sizeof(fields));
+}
+
+SensorReading TimeSeriesStore::decode(const uint8_t* in) {
+    uint64_t key;
+    float fields[6];
+    std::memcpy(&key, in, sizeof(key));
+    std::memcpy(fields, in + sizeof(key), sizeof(fields));
+
+    SensorReading r;
+    r.timestampMs = key >> 16;
+    r.sensorId = static_cast<uint16_t>(key & 0xFFFF);
+    r.distance = fields[0];
+    r.temperature = fields[1];
+    r.pressure = fields[2];
+    r.altitude = fields[3];
+    r.sealevelPressure = fields[4];
+    r.realAltitude = fields[5];
+    return r;
+}
+
+bool TimeSeriesStore::append(const SensorReading& reading) {
+    return appendSeries(reading.sensorId, &reading, 1) == 1;
+}
+
+size_t TimeSeriesStore::append(const SensorReading* readings, size_t count) {
+    // Agrupar por sensor conservando el orden de llegada
+    std::unordered_map<uint16_t, std::vector<SensorReading>> series;
+    for (size_t i = 0; i < count; ++i) {
+        series[readings[i].sensorId].push_back(readings[i]);
+    }
+
+    size_t stored = 0;
+    for (const auto& entry : series) {
+        stored += appendSeries(entry.first, entry.second.data(), entry.second.size());
+    }
+    return stored;
+}
+
+size_t TimeSeriesStore::appendSeries(uint16_t sensorId, const SensorReading* readings, size_t count) {
+    ActiveSegment& seg = active_[sensorId];
+    std::vector<uint8_t> buffer;
+    size_t stored = 0;
+
+    while (stored < count) {
+        const SensorReading& first = readings[stored];
+        if (seg.name.empty() || seg.records >= RECORDS_PER_SEGMENT || first.timestampMs < seg.startMs) {
+            if (!openSegment(sensorId, first.timestampMs, seg)) break;
+        }
+
+        // Tramo que entra en este segmento sin romper el orden por inicio
+        size_t end = stored;
+        while (end < count && seg.records + (end - stored) < RECORDS_PER_SEGMENT &&
+               readings[end].timestampMs >= seg.startMs) {
+            ++end;
+        }
+
+        const size_t n = end - stored;
+        buffer.resize(n * RECORD_SIZE);
+        for (size_t i = 0; i < n; ++i) {
+            encode(readings[stored + i], buffer.data() + i * RECORD_SIZE);
+        }
+
+        if (fs_.openFile(seg.name) != 0) {
+            std::cerr << "[TimeSeriesStore] No se pudo abrir " << seg.name << std::endl;
+            break;
+        }
+        const bool ok = fs_.append(seg.name, buffer.data(), buffer.size());
+        fs_.closeFile(seg.name);
+        if (!ok) {
+            std::cerr << "[TimeSeriesStore] Error agregando a " << seg.name << std::endl;
+            break;
+        }
+
+        seg.records += n;
+        uint64_t maxMs = 0;
+        for (size_t i = stored; i < end; ++i) {
+            maxMs = std::max(maxMs, readings[i].timestampMs);
+        }
+        index_.update(sensorId, seg.startMs, seg.name, maxMs, seg.records);
+        stored = end;
+
+        // Lleno: pasa a columnas; si falla queda como .seg, que también se lee
+        if (seg.records >= RECORDS_PER_SEGMENT && sealSegment(sensorId, seg.startMs, seg.name)) {
+            seg.name.clear();
+        }
+    }
+    return stored;
+}
+
+bool TimeSeriesStore::openSegment(uint16_t sensorId, uint64_t startMs, ActiveSegment& seg) {
+    // Otro segmento puede tener el mismo inicio: reusar si tiene espacio, si no sufijo
+    for (unsigned suffix = 0; suffix < 1000; ++suffix) {
+        const std::string name = segmentName(sensorId, startMs, suffix);
+        if (fs_.fileSize(sealedName(name)) >= 0) continue;   // ya se usó y se selló
+        const int64_t size = fs_.fileSize(name);
+        if (size < 0) {
+            if (fs_.create(name) < 0) {
+                std::cerr << "[TimeSeriesStore] No se pudo crear " << name << std::endl;
+                return false;
+            }
+            seg.name = name;
+            seg.startMs = startMs;
+            seg.records = 0;
+
+            SeriesIndex::Segment file;
+            file.sensorId = sensorId;
+            file.startMs = startMs;
+            file.maxMs = startMs;
+            file.name = name;
+            index_.insert(std::move(file));
+            return true;
+        }
+        if (static_cast<size_t>(size) / RECORD_SIZE < RECORDS_PER_SEGMENT) {
+            seg.name = name;
+            seg.startMs = startMs;
+            seg.records = static_cast<size_t>(size) / RECORD_SIZE;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TimeSeriesStore::scan(uint64_t startMs, uint64_t endMs, const Visitor& visit) {
+    std::string raw;
+    std::vector<SensorReading> scratch;
+    index_.forRange(startMs, endMs, [&](const SeriesIndex::Segment& file) {
+        scanFile(file, startMs, endMs, raw, scratch, visit);
+    });
+}
+
+void TimeSeriesStore::scanSensor(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                                 const Visitor& visit) {
+    std::string raw;
+    std::vector<SensorReading> scratch;
+    index_.forSensor(sensorId, startMs, endMs, [&](const SeriesIndex::Segment& file) {
+        scanFile(file, startMs, endMs, raw, scratch, visit);
+    });
+}
+
+bool TimeSeriesStore::sealSegment(uint16_t sensorId, uint64_t startMs, const std::string& name) {
+    std::string raw;
+    if (!readFile(name, raw)) return false;
+
+    // Filas -> columnas comprimidas, en el orden en que llegaron
+    const size_t n = raw.size() / RECORD_SIZE;
+    SegmentEncoder encoder;
+    uint64_t maxMs = startMs;
+    for (size_t i = 0; i < n; ++i) {
+        const SensorReading r = decode(reinterpret_cast<const uint8_t*>(raw.data()) + i * RECORD_SIZE);
+        encoder.add(r);
+        maxMs = std::max(maxMs, r.timestampMs);
+    }
+    const std::string columns = encoder.finish();
+
+    // Un .col de una caída anterior sirve solo si quedó completo
+    const std::string sealed = sealedName(name);
+    std::string previous;
+    const bool done = fs_.fileSize(sealed) == static_cast<int64_t>(columns.size()) &&
+                      readFile(sealed, previous) && previous == columns;
+    if (!done) {
+        if (fs_.fileSize(sealed) >= 0) {
+            fs_.remove(sealed);
+        }
+        bool ok = fs_.create(sealed) >= 0 && fs_.openFile(sealed) == 0;
+        if (ok) {
+            ok = fs_.append(sealed, columns.data(), columns.size());
+            fs_.closeFile(sealed);
+        }
+        if (!ok) {
+            std::cerr << "[TimeSeriesStore] No se pudo sellar " << name << std::endl;
+            fs_.remove(sealed);
+            return false;
+        }
+    }
+
+    if (!fs_.remove(name)) {
+        std::cerr << "[TimeSeriesStore] No se pudo borrar " << name << " tras sellarlo" << std::endl;
+    }
+    index_.erase(sensorId, startMs, name);
+    index_.erase(sensorId, startMs, sealed);
+
+    SeriesIndex::Segment file;
+    file.sensorId = sensorId;
+    file.startMs = startMs;
+    file.maxMs = maxMs;
+    file.records = n;
+    file.columnar = true;
+    file.name = sealed;
+    index_.insert(std::move(file));
+    return true;
+}
+
+bool TimeSeriesStore::compressColumns(const SeriesIndex::Segment& file) {
+    // Se vuelve a armar el .seg y se sella de nuevo: si se corta a la mitad,
+    // al montar queda un .seg lleno que se sella como cualquier otro
+    const std::string name = file.name.substr(0, file.name.size() - 4) + ".seg";
+    std::string raw;
+    if (fs_.fileSize(name) >= 0 || !readFile(file.name, raw)) return false;
+
+    const auto* data = reinterpret_cast<const uint8_t*>(raw.data());
+    const size_t n = raw.size() / RECORD_SIZE;
+    std::string rows(n * RECORD_SIZE, '\0');
+    for (size_t i = 0; i < n; ++i) {
+        SensorReading r;
+        r.sensorId = file.sensorId;
+        r.timestampMs = columnTimestamp(data, i);
+        r.distance = columnField(data, n, 0, i);
+        r.temperature = columnField(data, n, 1, i);
+        r.pressure = columnField(data, n, 2, i);
+        r.altitude = columnField(data, n, 3, i);
+        r.sealevelPressure = columnField(data, n, 4, i);
+        r.realAltitude = columnField(data, n, 5, i);
+        encode(r, reinterpret_cast<uint8_t*>(&rows[i * RECORD_SIZE]));
+    }
+
+    bool ok = fs_.create(name) >= 0 && fs_.openFile(name) == 0;
+    if (ok) {
+        ok = fs_.append(name, rows.data(), rows.size());
+        fs_.closeFile(name);
+    }
+    if (!ok) {
+        std::cerr << "[TimeSeriesStore] No se pudo comprimir " << file.name << std::endl;
+        fs_.remove(name);
+        return false;
+    }
+    return sealSegment(file.sensorId, file.startMs, name);
+}
+
+void TimeSeriesStore::scanSensorColumns(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                                        const ColumnVisitor& visit) {
+    std::string raw;
+    ColumnBuffer columns;
+    std::vector<uint32_t> selection;
+    index_.forSensor(sensorId, startMs, endMs, [&](const SeriesIndex::Segment& file) {
+        if (loadColumns(file, startMs, endMs, raw, columns, selection)) {
+            visit(columns.block(file.sensorId));
+        }
+    });
+}
+
+void TimeSeriesStore::scanSensorColumns(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                                        const ColumnVisitor& visit, ScanPool* pool) {
+    if (!pool || pool->parallelism() == 1) {
+        scanSensorColumns(sensorId, startMs, endMs, visit);
+        return;
+    }
+
+    // Tandas de unos pocos archivos por hilo: se descomprimen en paralelo y
+    // se visitan en orden; la memoria queda acotada a una tanda
+    const std::vector<SeriesIndex::Segment> files = sensorSegments(sensorId, startMs, endMs);
+    const size_t wave = 4 * pool->parallelism();
+    struct Slot {
+        std::string raw;
+        ColumnBuffer columns;
+        std::vector<uint32_t> selection;
+        bool loaded = false;
+    };
+    std::vector<Slot> slots(std::min(wave, files.size()));
+    for (size_t first = 0; first < files.size(); first += wave) {
+        const size_t count = std::min(wave, files.size() - first);
+        pool->run(count, [&](size_t i) {
+            Slot& slot = slots[i];
+            slot.loaded = loadColumns(files[first + i], startMs, endMs, slot.raw, slot.columns,
+                                      slot.selection);
+        });
+        for (size_t i = 0; i < count; ++i) {
+            if (slots[i].loaded) visit(slots[i].columns.block(files[first + i].sensorId));
+        }
+    }
+}
+
+std::vector<SeriesIndex::Segment> TimeSeriesStore::segments(uint64_t startMs, uint64_t endMs) const {
+    std::vector<SeriesIndex::Segment> files;
+    index_.forRange(startMs, endMs, [&files](const SeriesIndex::Segment& file) {
+        files.push_back(file);
+    });
+    return files;
+}
+
+std::vector<SeriesIndex::Segment> TimeSeriesStore::sensorSegments(uint16_t sensorId, uint64_t startMs,
+                                                                  uint64_t endMs) const {
+    std::vector<SeriesIndex::Segment> files;
+    index_.forSensor(sensorId, startMs, endMs, [&files](const SeriesIndex::Segment& file) {
+        files.push_back(file);
+    });
+    return files;
+}
+
+void TimeSeriesStore::readSegment(const SeriesIndex::Segment& file, uint64_t startMs, uint64_t endMs,
+                                  std::vector<SensorReading>& out) {
+    std::string raw;
+    std::vector<SensorReading> scratch;
+    scanFile(file, startMs, endMs, raw, scratch, [&out](const SensorReading& r) { out.push_back(r); });
+}
+
+void TimeSeriesStore::readSegments(const std::vector<SeriesIndex::Segment>& files, uint64_t startMs,
+                                   uint64_t endMs, ScanPool* pool, std::vector<SensorReading>& out) {
+    std::vector<std::vector<SensorReading>> runs(files.size());
+    const auto read = [&](size_t i) {
+        readSegment(files[i], startMs, endMs, runs[i]);
+        sortByTime(runs[i]);
+    };
+    if (pool) {
+        pool->run(files.size(), read);
+    } else {
+        for (size_t i = 0; i < files.size(); ++i) read(i);
+    }
+    mergeByTime(runs, out);
+}
+
+void TimeSeriesStore::sortByTime(std::vector<SensorReading>& rows) {
+    const auto older = [](const SensorReading& a, const SensorReading& b) {
+        return a.timestampMs < b.timestampMs;
+    };
+    // Un segmento casi siempre ya viene en orden
+    if (!std::is_sorted(rows.begin(), rows.end(), older)) {
+        std::stable_sort(rows.begin(), rows.end(), older);
+    }
+}
+
+void TimeSeriesStore::mergeByTime(std::vector<std::vector<SensorReading>>& runs,
+                                  std::vector<SensorReading>& out) {
+    out.clear();
+    size_t total = 0;
+    for (const auto& run : runs) total += run.size();
+    out.reserve(total);
+    if (runs.size() == 1) {
+        out.swap(runs[0]);
+        runs.clear();
+        return;
+    }
+
+    // k-way merge: el heap tiene la próxima lectura de cada run; a igual
+    // timestamp sale primero el run anterior, como en scan()
+    using Head = std::pair<uint64_t, size_t>;   // (timestamp, run)
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    std::vector<size_t> next(runs.size(), 0);
+    for (size_t i = 0; i < runs.size(); ++i) {
+        if (!runs[i].empty()) heads.emplace(runs[i][0].timestampMs, i);
+    }
+    while (!heads.empty()) {
+        const size_t i = heads.top().second;
+        heads.pop();
+        out.push_back(runs[i][next[i]++]);
+        if (next[i] < runs[i].size()) heads.emplace(runs[i][next[i]].timestampMs, i);
+    }
+    runs.clear();
+}
+
+void TimeSeriesStore::scanFile(const SeriesIndex::Segment& file, uint64_t startMs, uint64_t endMs,
+                               std::string& raw, std::vector<SensorReading>& scratch,
+                               const Visitor& visit) {
+    bool columnar;
+    if (readSegmentFile(file, raw, columnar)) {
+        scanRaw(file, columnar, raw, startMs, endMs, scratch, visit);
+    }
+}
+
+void TimeSeriesStore::scanRaw(const SeriesIndex::Segment& file, bool columnar, const std::string& raw,
+                              uint64_t startMs, uint64_t endMs, std::vector<SensorReading>& scratch,
+                              const Visitor& visit) {
+    if (file.legacy) {
+        scratch.clear();
+        parseLegacyCsv(raw, file.sensorId, file.startMs, scratch);
+        for (const auto& r : scratch) visit(r);
+        return;
+    }
+
+    const auto* data = reinterpret_cast<const uint8_t*>(raw.data());
+    if (columnar) {
+        // Sellado: se descomprime de a una lectura mientras se visita
+        SegmentDecoder decoder;
+        if (!decoder.open(data, raw.size(), file.sensorId)) {
+            std::cerr << "[TimeSeriesStore] Segmento sellado inválido: " << file.name << std::endl;
+            return;
+        }
+        SensorReading r;
+        for (size_t i = 0; i < file.records && decoder.next(r); ++i) {
+            if (r.timestampMs >= startMs && r.timestampMs <= endMs) visit(r);
+        }
+        return;
+    }
+
+    // Solo lo que el índice registra: lo escrito después no es de esta consulta
+    const size_t records = std::min(raw.size() / RECORD_SIZE, file.records);
+    for (size_t i = 0; i < records; ++i) {
+        const SensorReading r = decode(data + i * RECORD_SIZE);
+        if (r.timestampMs >= startMs && r.timestampMs <= endMs) visit(r);
+    }
+}
+
+bool TimeSeriesStore::loadColumns(const SeriesIndex::Segment& file, uint64_t startMs, uint64_t endMs,
+                                  std::string& raw, ColumnBuffer& columns,
+                                  std::vector<uint32_t>& selection) {
+    columns.clear();
+    bool columnar;
+    if (!readSegmentFile(file, raw, columnar)) return false;
+
+    if (!columnar) {
+        // Filas (segmento activo o CSV anterior): transponer lo que está en rango
+        std::vector<SensorReading> scratch;
+        scanRaw(file, false, raw, startMs, endMs, scratch, [&columns](const SensorReading& r) {
+            columns.push(r);
+        });
+        return columns.size() > 0;
+    }
+
+    // Sellado: descomprimir columna por columna y filtrar solo si el archivo sale del rango
+    SegmentDecoder decoder;
+    const bool valid = decoder.open(reinterpret_cast<const uint8_t*>(raw.data()), raw.size(), file.sensorId);
+    const size_t n = valid ? std::min(decoder.size(), file.records) : 0;
+    if (!valid || !decoder.readColumns(n, columns)) {
+        std::cerr << "[TimeSeriesStore] Segmento sellado inválido: " << file.name << std::endl;
+        columns.clear();
+        return false;
+    }
+
+    if (file.startMs < startMs || file.maxMs > endMs) {
+        selection.resize(n);
+        const size_t kept = ColumnKernels::best().selectRange(columns.timestampMs(), n, startMs, endMs,
+                                                              selection.data());
+        if (kept < n) {
+            uint64_t* ts = columns.timestampMs();
+            for (size_t k = 0; k < kept; ++k) ts[k] = ts[selection[k]];
+            for (size_t f = 0; f < SENSOR_FIELDS; ++f) {
+                float* column = columns.field(f);
+                for (size_t k = 0; k < kept; ++k) column[k] = column[selection[k]];
+            }
+            columns.resize(kept);
+        }
+    }
+    return columns.size() > 0;
+}
+
+bool TimeSeriesStore::readSegmentFile(const SeriesIndex::Segment& file, std::string& raw, bool& columnar) {
+    columnar = file.columnar;
+    if (!file.legacy && !columnar && fs_.fileSize(file.name) < 0) {
+        // Se selló mientras un QueryCursor lo tenía en su lista
+        columnar = true;
+        return readFile(sealedName(file.name), raw);
+    }
+    return readFile(file.name, raw);
+}
+
+void TimeSeriesStore::scanSensorRollups(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                                        const RollupVisitor& visit) {
+    std::vector<SeriesAggregator::Bucket> buckets;
+    for (const auto& tier : rollups_) {
+        tier.second.forSensor(sensorId, startMs, endMs, [&](const SeriesIndex::Segment& file) {
+            buckets.clear();
+            if (!readRollups(file, buckets)) return;
+            for (const auto& bucket : buckets) {
+                if (bucket.startMs >= startMs && bucket.startMs <= endMs) visit(bucket, tier.first);
+            }
+        });
+    }
+}
+
+size_t TimeSeriesStore::rollupFileCount() const {
+    size_t count = 0;
+    for (const auto& tier : rollups_) count += tier.second.size();
+    return count;
+}
+
+bool TimeSeriesStore::compactStep(size_t maxFiles, MaintenanceStep& step) {
+    // Primer sensor con al menos dos archivos chicos
+    std::vector<SeriesIndex::Segment> inputs;
+    for (const auto& file : closedFiles(0, ALL_TIME, false)) {
+        if (!file.legacy && file.records >= RECORDS_PER_SEGMENT / 2) continue;
+        if (!inputs.empty() && inputs.front().sensorId != file.sensorId) {
+            if (inputs.size() >= 2) break;
+            inputs.clear();
+        }
+        if (inputs.size() < maxFiles) inputs.push_back(file);
+    }
+    if (inputs.size() < 2) return false;
+
+    std::vector<SensorReading> readings;
+    for (const auto& file : inputs) {
+        readSegment(file, 0, ALL_TIME, readings);
+    }
+    const size_t outputs = (readings.size() + RECORDS_PER_SEGMENT - 1) / RECORDS_PER_SEGMENT;
+    if (outputs >= inputs.size()) return false;
+    std::stable_sort(readings.begin(), readings.end(), [](const SensorReading& a, const SensorReading& b) {
+        return a.timestampMs < b.timestampMs;
+    });
+
+    // Nombres libres para cada tramo de un segmento lleno, ya sellados
+    const uint16_t sensorId = inputs.front().sensorId;
+    std::vector<std::string> names;
+    for (size_t first = 0; first < readings.size(); first += RECORDS_PER_SEGMENT) {
+        for (unsigned suffix = 0; suffix < 1000; ++suffix) {
+            const std::string name = segmentName(sensorId, readings[first].timestampMs, suffix);
+            const std::string sealed = sealedName(name);
+            if (fs_.fileSize(name) < 0 && fs_.fileSize(sealed) < 0 &&
+                std::find(names.begin(), names.end(), sealed) == names.end()) {
+                names.push_back(sealed);
+                break;
+            }
+        }
+    }
+    if (names.size() != outputs || !beginJournal(inputs, names)) return false;
+
+    std::vector<SeriesIndex::Segment> written;
+    for (size_t k = 0; k < outputs; ++k) {
+        const size_t first = k * RECORDS_PER_SEGMENT;
+        const size_t end = std::min(first + RECORDS_PER_SEGMENT, readings.size());
+        SegmentEncoder encoder;
+        for (size_t i = first; i < end; ++i) encoder.add(readings[i]);
+        const std::string data = encoder.finish();
+        if (!writeFile(names[k], data)) {
+            endJournal();
+            for (const auto& file : written) fs_.remove(file.name);
+            return false;
+        }
+
+        SeriesIndex::Segment file;
+        file.sensorId = sensorId;
+        file.startMs = readings[first].timestampMs;
+        file.maxMs = readings[end - 1].timestampMs;
+        file.records = end - first;
+        file.columnar = true;
+        file.name = names[k];
+        written.push_back(std::move(file));
+        step.bytesWritten += data.size();
+    }
+    if (!commitJournal()) {
+        for (const auto& file : written) fs_.remove(file.name);
+        endJournal();
+        return false;
+    }
+
+    removeFiles(inputs, index_, step);
+    for (auto& file : written) index_.insert(std::move(file));
+    endJournal();
+    step.filesWritten += outputs;
+    step.items += readings.size();
+    return true;
+}
+
+bool TimeSeriesStore::rollupStep(uint64_t fromWidthMs, uint64_t toWidthMs, uint64_t beforeMs,
+                                 size_t maxFiles, MaintenanceStep& step) {
+    if (toWidthMs == 0 || (fromWidthMs != 0 && toWidthMs % fromWidthMs != 0)) return false;
+
+    // Hasta maxFiles archivos del primer sensor que tenga algo vencido
+    std::vector<SeriesIndex::Segment> inputs;
+    for (const auto& file : closedFiles(fromWidthMs, beforeMs, true)) {
+        if (!inputs.empty() && (file.sensorId != inputs.front().sensorId || inputs.size() >= maxFiles)) break;
+        inputs.push_back(file);
+    }
+    if (inputs.empty()) return false;
+
+    // Intervalos solo donde hay datos: un segmento puede abarcar meses
+    const uint16_t sensorId = inputs.front().sensorId;
+    RollupBuilder builder(toWidthMs);
+    std::string raw;
+    ColumnBuffer columns;
+    std::vector<uint32_t> selection;
+    std::vector<SeriesAggregator::Bucket> buckets;
+    for (const auto& file : inputs) {
+        if (fromWidthMs == 0) {
+            if (loadColumns(file, 0, ALL_TIME, raw, columns, selection)) {
+                builder.add(columns.block(sensorId));
+            }
+            continue;
+        }
+        buckets.clear();
+        readRollups(file, buckets);
+        for (const auto& bucket : buckets) builder.add(bucket);
+    }
+    step.items += builder.readings();
+    buckets = builder.finish();
+
+    // Un archivo por cada ROLLUPS_PER_FILE intervalos
+    std::vector<std::string> names;
+    for (size_t first = 0; first < buckets.size(); first += ROLLUPS_PER_FILE) {
+        for (unsigned suffix = 0; suffix < 1000; ++suffix) {
+            const std::string name = rollupName(sensorId, toWidthMs, buckets[first].startMs, suffix);
+            if (fs_.fileSize(name) < 0 && std::find(names.begin(), names.end(), name) == names.end()) {
+                names.push_back(name);
+                break;
+            }
+        }
+    }
+    const size_t outputs = (buckets.size() + ROLLUPS_PER_FILE - 1) / ROLLUPS_PER_FILE;
+    if (names.size() != outputs || !beginJournal(inputs, names)) return false;
+
+    std::vector<SeriesIndex::Segment> written;
+    for (size_t k = 0; k < outputs; ++k) {
+        const size_t first = k * ROLLUPS_PER_FILE;
+        const size_t end = std::min(first + ROLLUPS_PER_FILE, buckets.size());
+        std::string data((end - first) * ROLLUP_SIZE, '\0');
+        for (size_t i = first; i < end; ++i) {
+            encodeRollup(buckets[i], reinterpret_cast<uint8_t*>(&data[(i - first) * ROLLUP_SIZE]));
+        }
+        if (!writeFile(names[k], data)) {
+            endJournal();
+            for (const auto& file : written) fs_.remove(file.name);
+            return false;
+        }
+
+        SeriesIndex::Segment file;
+        file.sensorId = sensorId;
+        file.startMs = buckets[first].startMs;
+        file.maxMs = buckets[end - 1].startMs;
+        file.records = end - first;
+        file.name = names[k];
+        written.push_back(std::move(file));
+        step.bytesWritten += data.size();
+    }
+    if (!commitJournal()) {
+        for (const auto& file : written) fs_.remove(file.name);
+        endJournal();
+        return false;
+    }
+
+    removeFiles(inputs, fromWidthMs == 0 ? index_ : rollups_[fromWidthMs], step);
+    if (fromWidthMs == 0) generation_.fetch_add(1, std::memory_order_release);
+    SeriesIndex& target = rollups_[toWidthMs];
+    for (auto& file : written) target.insert(std::move(file));
+    endJournal();
+    step.filesWritten += outputs;
+    return true;
+}
+
+bool TimeSeriesStore::expireStep(uint64_t widthMs, uint64_t beforeMs, size_t maxFiles,
+                                 MaintenanceStep& step) {
+    std::vector<SeriesIndex::Segment> expired = closedFiles(widthMs, beforeMs, true);
+    if (expired.empty()) return false;
+    if (expired.size() > maxFiles) expired.resize(maxFiles);
+    for (const auto& file : expired) step.items += file.records;
+    removeFiles(expired, widthMs == 0 ? index_ : rollups_[widthMs], step);
+    if (widthMs == 0) generation_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+std::vector<SeriesIndex::Segment> TimeSeriesStore::closedFiles(uint64_t widthMs, uint64_t beforeMs,
+                                                               bool withActive) const {
+    std::vector<SeriesIndex::Segment> files;
+    const SeriesIndex* index = &index_;
+    if (widthMs != 0) {
+        const auto tier = rollups_.find(widthMs);
+        if (tier == rollups_.end()) return files;
+        index = &tier->second;
+    }
+    index->forRange(0, ALL_TIME, [&](const SeriesIndex::Segment& file) {
+        if (file.maxMs < beforeMs && (withActive || widthMs != 0 || !isActive(file))) files.push_back(file);
+    });
+    return files;
+}
+
+bool TimeSeriesStore::isActive(const SeriesIndex::Segment& file) const {
+    const auto it = active_.find(file.sensorId);
+    return it != active_.end() && it->second.name == file.name;
+}
+
+void TimeSeriesStore::removeFiles(const std::vector<SeriesIndex::Segment>& files, SeriesIndex& index,
+                                  MaintenanceStep& step) {
+    for (const auto& file : files) {
+        const int64_t size = fs_.fileSize(file.name);
+        if (size >= 0 && !fs_.remove(file.name)) {
+            std::cerr << "[TimeSeriesStore] No se pudo borrar " << file.name << std::endl;
+            continue;
+        }
+        index.erase(file.sensorId, file.startMs, file.name);
+        if (isActive(file)) {
+            active_[file.sensorId].name.clear();   // la próxima lectura abre otro
+        }
+        if (size >= 0) {
+            step.bytesRemoved += static_cast<uint64_t>(size);
+            step.filesRemoved += 1;
+        }
+    }
+}
+
+bool TimeSeriesStore::readRollups(const SeriesIndex::Segment& file, std::vector<SeriesAggregator::Bucket>& out) {
+    std::string raw;
+    if (!readFile(file.name, raw)) return false;
+    const size_t records = std::min(raw.size() / ROLLUP_SIZE, file.records);
+    for (size_t i = 0; i < records; ++i) {
+        out.push_back(decodeRollup(reinterpret_cast<const uint8_t*>(raw.data()) + i * ROLLUP_SIZE));
+    }
+    return true;
+}
+
+bool TimeSeriesStore::beginJournal(const std::vector<SeriesIndex::Segment>& inputs,
+                                   const std::vector<std::string>& outputs) {
+    std::string journal;
+    for (const auto& file : inputs) journal += "in " + file.name + "\n";
+    for (const auto& name : outputs) journal += "out " + name + "\n";
+    if (fs_.fileSize(JOURNAL) >= 0) fs_.remove(JOURNAL);
+    return writeFile(JOURNAL, journal);
+}
+
+bool TimeSeriesStore::commitJournal() {
+    // Desde aquí las salidas están completas: al montar se terminan de borrar las entradas
+    static const char COMMIT[] = "commit\n";
+    // Las salidas llegan al disco antes que la marca; con la caché de
+    // bloques el orden de escritura ya no lo garantiza nadie más
+    if (!fs_.sync()) return false;
+    if (fs_.openFile(JOURNAL) != 0) return false;
+    const bool ok = fs_.append(JOURNAL, COMMIT, sizeof(COMMIT) - 1);
+    fs_.closeFile(JOURNAL);
+    return ok && fs_.sync();
+}
+
+void TimeSeriesStore::endJournal() {
+    fs_.remove(JOURNAL);
+}
+
+void TimeSeriesStore::recoverJournal() {
+    if (fs_.fileSize(JOURNAL) < 0) return;
+    std::string raw;
+    if (!readFile(JOURNAL, raw)) return;
+
+    std::vector<std::string> inputs, outputs;
+    bool committed = false;
+    std::istringstream stream(raw);
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.compare(0, 3, "in ") == 0) {
+            inputs.push_back(line.substr(3));
+        } else if (line.compare(0, 4, "out ") == 0) {
+            outputs.push_back(line.substr(4));
+        } else if (line == "commit") {
+            committed = true;
+        }
+    }
+
+    // Con commit se completa el paso; sin él se descarta lo que haya escrito
+    const auto& stale = committed ? inputs : outputs;
+    for (const auto& name : stale) {
+        if (fs_.fileSize(name) >= 0) fs_.remove(name);
+    }
+    fs_.remove(JOURNAL);
+    std::cout << "[TimeSeriesStore] Compactación interrumpida " << (committed ? "completada" : "deshecha")
+              << " (" << stale.size() << " archivos borrados)" << std::endl;
+}
+
+size_t TimeSeriesStore::migrateLegacy() {
+    // Juntar nombres primero (remove() modifica el directorio) y ordenarlos
+    // por sensor y tiempo para llenar los segmentos en orden
+    struct LegacyFile {
+        uint16_t sensorId;
+        uint64_t seconds;
+        std::string name;
+    };
+    std::vector<LegacyFile> files;
+    for (const auto& entry : fs_.getDirectory()) {
+        LegacyFile file;
+        if (entry.inode_id != 0 && parseLegacyName(entry.name, file.sensorId, file.seconds)) {
+            file.name = entry.name;
+            files.push_back(std::move(file));
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const LegacyFile& a, const LegacyFile& b) {
+        return a.sensorId != b.sensorId ? a.sensorId < b.sensorId : a.seconds < b.seconds;
+    });
+
+    size_t migrated = 0;
+    std::string raw;
+    std::vector<SensorReading> readings;
+    for (const auto& file : files) {
+        const std::string& name = file.name;
+        if (!readFile(name, raw)) continue;
+
+        readings.clear();
+        parseLegacyCsv(raw, file.sensorId, file.seconds * 1000, readings);
+        if (append(readings.data(), readings.size()) != readings.size()) {
+            std::cerr << "[TimeSeriesStore] No se pudo migrar " << name << std::endl;
+            continue;
+        }
+        if (fs_.remove(name)) {
+            index_.erase(file.sensorId, file.seconds * 1000, name);
+        }
+        ++migrated;
+    }
+
+    if (migrated > 0) {
+        std::cout << "[TimeSeriesStore] " << migrated << " archivos CSV migrados a segmentos" << std::endl;
+    }
+    return migrated;
+}
+
+bool TimeSeriesStore::readFile(const std::string& name, std::string& out) {
+    // Sin openFile(): no cambia el i-nodo, así que varias consultas pueden leer a la vez
+    if (!fs_.readShared(name, out)) {
+        std::cerr << "[TimeSeriesStore] No se pudo abrir " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TimeSeriesStore::writeFile(const std::string& name, const std::string& data) {
+    bool ok = fs_.create(name) >= 0 && fs_.openFile(name) == 0;
+    if (ok) {
+        ok = fs_.append(name, data.data(), data.size());
+        fs_.closeFile(name);
+    }
+    if (!ok) {
+        std::cerr << "[TimeSeriesStore] No se pudo escribir " << name << std::endl;
+        fs_.remove(name);
+    }
+    return ok;
+}
+
+std::string TimeSeriesStore::segmentName(uint16_t sensorId, uint64_t startMs, unsigned suffix) {
+    std::string name = "ts_" + std::to_string(sensorId) + "_" + std::to_string(startMs);
+    if (suffix > 0) name += "-" + std::to_string(suffix);
+    return name + ".seg";
+}
+
+std::string TimeSeriesStore::sealedName(const std::string& segmentName) {
+    return segmentName.substr(0, segmentName.size() - 4) + ".col";
+}
+
+std::string TimeSeriesStore::rollupName(uint16_t sensorId, uint64_t widthMs, uint64_t startMs,
+                                        unsigned suffix) {
+    std::string name = "ru_" + std::to_string(sensorId) + "_" + std::to_string(widthMs / 1000) + "_" +
+                       std::to_string(startMs);
+    if (suffix > 0) name += "-" + std::to_string(suffix);
+    return name + ".rol";
+}
+
+bool TimeSeriesStore::parseSegmentName(const char* name, uint16_t& sensorId, uint64_t& startMs,
+                                       bool& columnar) {
+    // ts_<id>_<inicioMs>[-<sufijo>].seg o .col
+    if (std::strncmp(name, "ts_", 3) != 0) return false;
+    const char* p = name + 3;
+    uint64_t id, suffix;
+    if (!parseNumber(p, id) || id > 0xFFFF || *p++ != '_') return false;
+    if (!parseNumber(p, startMs)) return false;
+    if (*p == '-' && !parseNumber(++p, suffix)) return false;
+    if (std::strcmp(p, ".seg") == 0) {
+        columnar = false;
+    } else if (std::strcmp(p, ".col") == 0) {
+        columnar = true;
+    } else {
+        return false;
+    }
+    sensorId = static_cast<uint16_t>(id);
+    return true;
+}
+
+bool TimeSeriesStore::parseLegacyName(const char* name, uint16_t& sensorId, uint64_t& seconds) {
+    // sensor_<id>_<segundos>.dat
+    if (std::strncmp(name, "sensor_", 7) != 0) return false;
+    const char* p = name + 7;
+    uint64_t id;
+    if (!parseNumber(p, id) || id > 0xFFFF || *p++ != '_') return false;
+    if (!parseNumber(p, seconds)) return false;
+    if (std::strcmp(p, ".dat") != 0) return false;
+    sensorId = static_cast<uint16_t>(id);
+    return true;
+}
+
+bool TimeSeriesStore::parseRollupName(const char* name, uint16_t& sensorId, uint64_t& widthMs,
+                                      uint64_t& startMs) {
+    // ru_<id>_<anchoSeg>_<inicioMs>[-<sufijo>].rol
+    if (std::strncmp(name, "ru_", 3) != 0) return false;
+    const char* p = name + 3;
+    uint64_t id, seconds, suffix;
+    if (!parseNumber(p, id) || id > 0xFFFF || *p++ != '_') return false;
+    if (!parseNumber(p, seconds) || seconds == 0 || *p++ != '_') return false;
+    if (!parseNumber(p, startMs)) return false;
+    if (*p == '-' && !parseNumber(++p, suffix)) return false;
+    if (std::strcmp(p, ".rol") != 0) return false;
+    sensorId = static_cast<uint16_t>(id);
+    widthMs = seconds * 1000;
+    return true;
+}
+
+void TimeSeriesStore::encodeRollup(const SeriesAggregator::Bucket& bucket, uint8_t* out) {
+    std::memcpy(out, &bucket.startMs, sizeof(uint64_t));
+    std::memcpy(out + 8, &bucket.count, sizeof(uint32_t));
+    std::memcpy(out + 12, bucket.min, sizeof(bucket.min));
+    std::memcpy(out + 12 + sizeof(bucket.min), bucket.max, sizeof(bucket.max));
+    std::memcpy(out + 12 + sizeof(bucket.min) + sizeof(bucket.max), bucket.sum, sizeof(bucket.sum));
+}
+
+SeriesAggregator::Bucket TimeSeriesStore::decodeRollup(const uint8_t* in) {
+    SeriesAggregator::Bucket bucket;
+    std::memcpy(&bucket.startMs, in, sizeof(uint64_t));
+    std::memcpy(&bucket.count, in + 8, sizeof(uint32_t));
+    std::memcpy(bucket.min, in + 12, sizeof(bucket.min));
+    std::memcpy(bucket.max, in + 12 + sizeof(bucket.min), sizeof(bucket.max));
+    std::memcpy(bucket.sum, in + 12 + sizeof(bucket.min) + sizeof(bucket.max), sizeof(bucket.sum));
+    return bucket;
+}
+
+void TimeSeriesStore::parseLegacyCsv(const std::string& raw, uint16_t sensorId, uint64_t timestampMs,
+                                     std::vector<SensorReading>& out) {
+    std::istringstream stream(raw);
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.empty()) continue;
+
+        float values[6];
+        size_t parsed = 0;
+        const char* p = line.c_str();
+        while (parsed < 6) {
+            char* end;
+            values[parsed] = std::strtof(p, &end);
+            if (end == p) break;
+            ++parsed;
+            p = end;
+            if (*p == ',') ++p;
+        }
+        if (parsed != 6) {
+            std::cerr << "[TimeSeriesStore] Línea CSV inválida: " << line << std::endl;
+            continue;
+        }
+
+        SensorReading r;
+        r.sensorId = sensorId;
+        r.timestampMs = timestampMs;
+        r.distance = values[0];
+        r.temperature = values[1];
+        r.pressure = values[2];
+        r.altitude = values[3];
+        r.sealevelPressure = values[4];
+        r.realAltitude = values[5];
+        out.push_back(r);
+    }
+}
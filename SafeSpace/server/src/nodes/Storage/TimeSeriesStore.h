@@ -0,0 +1,272 @@
+#ifndef TIMESERIESSTORE_H
+#define TIMESERIESSTORE_H
+
+#include "../../model/filesystem/FileSystem.h"
+#include "../../model/structures/SensorBatch.h"
+#include "SensorColumns.h"
+#include "SeriesAggregator.h"
+#include "ScanPool.h"
+#include "SeriesIndex.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Motor de series de tiempo del StorageNode sobre FileSystem.
+ *
+ * Cada lectura se guarda como un registro binario de ancho fijo
+ * (RECORD_SIZE bytes) agregado al final del segmento activo de su sensor,
+ * así que guardar cuesta O(1) sin importar cuánto haya en el archivo.
+ *
+ * Segmentos: "ts_<sensorId>_<inicioMs>.seg". Un segmento se cierra cuando
+ * llega a MAX_FILE_SIZE y todo registro dentro tiene timestamp >= inicioMs
+ * (una lectura más vieja que el segmento activo abre uno nuevo). Las
+ * consultas no recorren el directorio: van por un SeriesIndex que se arma
+ * al montar y se actualiza en cada escritura.
+ *
+ * Un segmento lleno se sella: se reescribe como "<mismo nombre>.col" con
+ * las mismas lecturas por columnas, comprimidas con SeriesCodec
+ * (delta-of-delta para los timestamps, XOR para los floats), y se borra el
+ * .seg. Las consultas lo descomprimen al vuelo: scan() de a una lectura y
+ * scanSensorColumns() de a una columna entera. Si una caída deja el .seg y
+ * el .col, al montar se conserva el .col si está completo y si no se
+ * vuelve a sellar. Los .col sin comprimir de versiones anteriores se
+ * comprimen al montar.
+ *
+ * Los archivos CSV del formato anterior ("sensor_<id>_<segundos>.dat", una
+ * lectura por línea) se siguen leyendo en las consultas y se pueden
+ * convertir con migrateLegacy().
+ *
+ * Mantenimiento (lo usa SeriesCompactor, de a un paso acotado por vez):
+ * compactStep() junta segmentos chicos ya cerrados de un sensor en
+ * segmentos sellados llenos; rollupStep() resume lecturas (o resúmenes
+ * más finos) viejos en intervalos de un ancho fijo, guardados en
+ * "ru_<sensorId>_<anchoSeg>_<inicioMs>.rol", y borra la fuente;
+ * expireStep() borra lo que pasó la retención. Cada nivel cubre un
+ * período distinto, así que una agregación suma lecturas y resúmenes sin
+ * contar nada dos veces. Los pasos que reemplazan archivos dejan un
+ * journal ("compaction.journal") y al montar se completa o se deshace el
+ * que haya quedado a medias.
+ *
+ * No es thread-safe por sí solo: el llamador toma un std::shared_mutex
+ * (el de su StorageShard), exclusivo para todo lo que escribe y
+ * compartido para las consultas (scan*, segments, readSegment*), que no
+ * cambian nada y pueden correr a la vez entre sí. Las variantes con
+ * ScanPool reparten los archivos de una consulta entre sus hilos.
+ */
+class TimeSeriesStore {
+ public:
+    // Registro: [timestampMs(48 bits) | sensorId(16 bits)](8) + 6 floats(24),
+    // en el orden de bytes del host como el resto de estructuras del disco
+    static constexpr size_t RECORD_SIZE = 32;
+    static constexpr size_t SEGMENT_BYTES =
+        Layout::MAX_FILE_SIZE - Layout::MAX_FILE_SIZE % RECORD_SIZE;
+    static constexpr size_t RECORDS_PER_SEGMENT = SEGMENT_BYTES / RECORD_SIZE;
+
+    // Resumen: [inicioMs(8)][cantidad(4)] + min, max (floats) y suma (double) por campo
+    static constexpr size_t ROLLUP_SIZE = 12 + SENSOR_FIELDS * 16;
+    static constexpr size_t ROLLUPS_PER_FILE = Layout::MAX_FILE_SIZE / ROLLUP_SIZE;
+
+    using Visitor = std::function<void(const SensorReading&)>;
+    using ColumnVisitor = std::function<void(const ColumnBlock&)>;
+    using RollupVisitor = std::function<void(const SeriesAggregator::Bucket&, uint64_t widthMs)>;
+
+    /// Lo que hizo un paso de mantenimiento.
+    struct MaintenanceStep {
+        size_t filesRemoved = 0;
+        size_t filesWritten = 0;
+        uint64_t bytesRemoved = 0;
+        uint64_t bytesWritten = 0;
+        size_t items = 0;        // lecturas o intervalos procesados
+    };
+
+    /// Registra los segmentos existentes; fs debe estar montado.
+    explicit TimeSeriesStore(FileSystem& fs);
+
+    /// Guarda una lectura; false si no se pudo escribir.
+    bool append(const SensorReading& reading);
+
+    /**
+     * Guarda count lecturas con una escritura por segmento tocado.
+     * @return cuántas quedaron guardadas.
+     */
+    size_t append(const SensorReading* readings, size_t count);
+
+    /// Visita las lecturas con timestamp en [startMs, endMs] de todos los sensores.
+    void scan(uint64_t startMs, uint64_t endMs, const Visitor& visit);
+
+    /// Igual que scan() pero solo para un sensor.
+    void scanSensor(uint16_t sensorId, uint64_t startMs, uint64_t endMs, const Visitor& visit);
+
+    /**
+     * Igual que scanSensor() pero entrega un bloque de columnas por archivo,
+     * ya filtrado a [startMs, endMs]; los bloques vacíos no se visitan.
+     */
+    void scanSensorColumns(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                           const ColumnVisitor& visit);
+    /**
+     * Igual, pero los archivos se leen y descomprimen de a tandas en los
+     * hilos de pool; visit se llama en el hilo que consulta, en el mismo
+     * orden. pool puede ser nulo.
+     */
+    void scanSensorColumns(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                           const ColumnVisitor& visit, ScanPool* pool);
+
+    /**
+     * Archivos que pueden tener lecturas en [startMs, endMs], en el orden de
+     * scan(), con la cantidad de registros que tienen ahora. Junto con
+     * readSegment() permite recorrer una consulta por partes (QueryCursor)
+     * sin ver lo que se agregue después.
+     */
+    std::vector<SeriesIndex::Segment> segments(uint64_t startMs, uint64_t endMs) const;
+    std::vector<SeriesIndex::Segment> sensorSegments(uint16_t sensorId, uint64_t startMs,
+                                                     uint64_t endMs) const;
+
+    /// Agrega a out las lecturas en rango de los primeros file.records registros de file.
+    void readSegment(const SeriesIndex::Segment& file, uint64_t startMs, uint64_t endMs,
+                     std::vector<SensorReading>& out);
+
+    /**
+     * Lee files (una tarea por archivo en pool, que puede ser nulo) y deja
+     * en out sus lecturas en rango ordenadas por timestamp: cada archivo se
+     * ordena por separado y se mezclan con un k-way merge.
+     */
+    void readSegments(const std::vector<SeriesIndex::Segment>& files, uint64_t startMs,
+                      uint64_t endMs, ScanPool* pool, std::vector<SensorReading>& out);
+
+    /// Ordena rows por timestamp si hace falta (estable).
+    static void sortByTime(std::vector<SensorReading>& rows);
+
+    /**
+     * Deja en out las lecturas de runs, cada uno ya ordenado, en orden de
+     * timestamp; a igual timestamp sale primero el run anterior. Vacía runs.
+     */
+    static void mergeByTime(std::vector<std::vector<SensorReading>>& runs, std::vector<SensorReading>& out);
+
+    /**
+     * Visita los resúmenes del sensor cuyo inicio cae en [startMs, endMs],
+     * de todos los anchos guardados.
+     */
+    void scanSensorRollups(uint16_t sensorId, uint64_t startMs, uint64_t endMs,
+                           const RollupVisitor& visit);
+
+    /**
+     * Junta hasta maxFiles segmentos cerrados de un sensor con menos de
+     * medio segmento cada uno (y CSV anteriores) en segmentos sellados.
+     * @return false si no había nada que juntar o falló.
+     */
+    bool compactStep(size_t maxFiles, MaintenanceStep& step);
+
+    /**
+     * Resume en intervalos de toWidthMs hasta maxFiles archivos de un
+     * sensor con todo anterior a beforeMs: segmentos si fromWidthMs es 0,
+     * si no resúmenes de ese ancho. toWidthMs debe ser múltiplo de fromWidthMs.
+     * @return false si no había nada que resumir o falló.
+     */
+    bool rollupStep(uint64_t fromWidthMs, uint64_t toWidthMs, uint64_t beforeMs, size_t maxFiles,
+                    MaintenanceStep& step);
+
+    /**
+     * Borra hasta maxFiles archivos con todo anterior a beforeMs: segmentos
+     * si widthMs es 0, si no resúmenes de ese ancho.
+     * @return false si no había nada vencido.
+     */
+    bool expireStep(uint64_t widthMs, uint64_t beforeMs, size_t maxFiles, MaintenanceStep& step);
+
+    /**
+     * Convierte los archivos CSV del formato anterior a segmentos y los borra.
+     * Los que no se puedan leer se dejan como están.
+     * @return cuántos archivos se migraron.
+     */
+    size_t migrateLegacy();
+
+    /// Espera a que lo guardado llegue al disco.
+    bool sync() { return fs_.sync(); }
+
+    /// Archivos de lecturas indexados (segmentos y CSV anteriores).
+    size_t fileCount() const { return index_.size(); }
+
+    /// Archivos de resúmenes, de todos los anchos.
+    size_t rollupFileCount() const;
+
+    /**
+     * Cambia cada vez que el mantenimiento saca lecturas crudas (al
+     * resumirlas o vencerlas); lo cacheado de antes ya no vale. Se puede
+     * leer sin el lock del store.
+     */
+    uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+    static void encode(const SensorReading& reading, uint8_t* out);
+    static SensorReading decode(const uint8_t* in);
+
+ private:
+    struct ActiveSegment {
+        std::string name;
+        uint64_t startMs = 0;
+        size_t records = 0;
+    };
+
+    FileSystem& fs_;
+    std::unordered_map<uint16_t, ActiveSegment> active_;   // segmento abierto a escritura por sensor
+    SeriesIndex index_;
+    std::map<uint64_t, SeriesIndex> rollups_;              // resúmenes por ancho del intervalo
+    std::atomic<uint64_t> generation_{0};
+
+    size_t appendSeries(uint16_t sensorId, const SensorReading* readings, size_t count);
+    bool openSegment(uint16_t sensorId, uint64_t startMs, ActiveSegment& seg);
+    // Reescribe un .seg lleno como .col y actualiza el índice
+    bool sealSegment(uint16_t sensorId, uint64_t startMs, const std::string& name);
+    // Reescribe un .col sin comprimir en el formato actual
+    bool compressColumns(const SeriesIndex::Segment& file);
+    void scanFile(const SeriesIndex::Segment& file, uint64_t startMs, uint64_t endMs,
+                  std::string& raw, std::vector<SensorReading>& scratch, const Visitor& visit);
+    // Visita lo que está en rango del contenido ya leído de file
+    void scanRaw(const SeriesIndex::Segment& file, bool columnar, const std::string& raw,
+                 uint64_t startMs, uint64_t endMs, std::vector<SensorReading>& scratch,
+                 const Visitor& visit);
+    // Lecturas en rango de file en columnas; false si no hay ninguna
+    bool loadColumns(const SeriesIndex::Segment& file, uint64_t startMs, uint64_t endMs,
+                     std::string& raw, ColumnBuffer& columns, std::vector<uint32_t>& selection);
+    // Lee file; si era un .seg que se selló después de indexarlo, lee su .col
+    bool readSegmentFile(const SeriesIndex::Segment& file, std::string& raw, bool& columnar);
+    bool readFile(const std::string& name, std::string& out);
+    // Crea name con data; si falla no deja el archivo
+    bool writeFile(const std::string& name, const std::string& data);
+
+    // Archivos de un nivel (0 = segmentos) con todo anterior a beforeMs; el
+    // segmento activo solo si withActive (ya nadie le agrega algo tan viejo)
+    std::vector<SeriesIndex::Segment> closedFiles(uint64_t widthMs, uint64_t beforeMs,
+                                                  bool withActive) const;
+    bool isActive(const SeriesIndex::Segment& file) const;
+    // Borra las fuentes de un paso y las saca de su índice
+    void removeFiles(const std::vector<SeriesIndex::Segment>& files, SeriesIndex& index,
+                     MaintenanceStep& step);
+    bool readRollups(const SeriesIndex::Segment& file, std::vector<SeriesAggregator::Bucket>& out);
+
+    // Journal de los pasos que reemplazan archivos: entradas, salidas y "commit"
+    bool beginJournal(const std::vector<SeriesIndex::Segment>& inputs,
+                      const std::vector<std::string>& outputs);
+    bool commitJournal();
+    void endJournal();
+    void recoverJournal();
+
+    static std::string segmentName(uint16_t sensorId, uint64_t startMs, unsigned suffix);
+    static std::string sealedName(const std::string& segmentName);
+    static std::string rollupName(uint16_t sensorId, uint64_t widthMs, uint64_t startMs, unsigned suffix);
+    static bool parseSegmentName(const char* name, uint16_t& sensorId, uint64_t& startMs,
+                                 bool& columnar);
+    static bool parseLegacyName(const char* name, uint16_t& sensorId, uint64_t& seconds);
+    static bool parseRollupName(const char* name, uint16_t& sensorId, uint64_t& widthMs, uint64_t& startMs);
+    static void encodeRollup(const SeriesAggregator::Bucket& bucket, uint8_t* out);
+    static SeriesAggregator::Bucket decodeRollup(const uint8_t* in);
+    // Lector del formato CSV anterior: una línea "d,t,p,a,sp,ra" por lectura
+    static void parseLegacyCsv(const std::string& raw, uint16_t sensorId, uint64_t timestampMs,
+                               std::vector<SensorReading>& out);
+};
+
+#endif // TIMESERIESSTORE_H
@@ -0,0 +1,202 @@
+#include "WriteAheadLog.h"
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+constexpr uint32_t WAL_MAGIC = 0x57414C31;   // "WAL1"
+constexpr size_t WAL_HEADER = 12;
+
+uint32_t crc32(const uint8_t* data, size_t len) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool writeAll(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        const ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& path)
+    : path_(path), fd_(-1), submitted_(0), durable_(0), leader_(false), failed_(false), stats_{} {
+    if (!openLog()) {
+        throw std::runtime_error("No se pudo abrir el WAL " + path_ + ": " + std::strerror(errno));
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool WriteAheadLog::openLog() {
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    return fd_ >= 0 && syncDirectory(path_);
+}
+
+bool WriteAheadLog::append(const void* data, size_t len) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (failed_) return false;
+    return commit(lock, push(data, len));
+}
+
+bool WriteAheadLog::enqueue(const void* data, size_t len, uint64_t& ticket) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_) return false;
+    ticket = push(data, len);
+    return true;
+}
+
+bool WriteAheadLog::sync() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return commit(lock, submitted_);
+}
+
+uint64_t WriteAheadLog::durable() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return durable_;
+}
+
+uint64_t WriteAheadLog::push(const void* data, size_t len) {
+    // Encolar el registro; el líder de turno lo escribe junto con los demás
+    uint8_t header[WAL_HEADER];
+    const uint32_t fields[3] = {WAL_MAGIC, static_cast<uint32_t>(len),
+                                crc32(static_cast<const uint8_t*>(data), len)};
+    std::memcpy(header, fields, sizeof(fields));
+    pending_.insert(pending_.end(), header, header + WAL_HEADER);
+    pending_.insert(pending_.end(), static_cast<const uint8_t*>(data),
+                    static_cast<const uint8_t*>(data) + len);
+    submitted_ += WAL_HEADER + len;
+    stats_.appends++;
+    return submitted_;
+}
+
+bool WriteAheadLog::commit(std::unique_lock<std::mutex>& lock, uint64_t upTo) {
+    while (durable_ < upTo && !failed_) {
+        if (leader_) {
+            committed_.wait(lock);
+            continue;
+        }
+
+        // Este hilo es el líder: escribe todo lo pendiente con un solo fdatasync
+        leader_ = true;
+        writing_.swap(pending_);
+        const uint64_t target = submitted_;
+        lock.unlock();
+
+        const bool ok = writeAll(fd_, writing_.data(), writing_.size()) && ::fdatasync(fd_) == 0;
+        const int err = errno;
+
+        lock.lock();
+        leader_ = false;
+        if (ok) {
+            durable_ = target;
+            stats_.syncs++;
+            stats_.bytes += writing_.size();
+        } else {
+            failed_ = true;
+            std::cerr << "[WAL] Error escribiendo " << path_ << ": " << std::strerror(err) << std::endl;
+        }
+        writing_.clear();
+        committed_.notify_all();
+    }
+    return durable_ >= upTo;
+}
+
+bool WriteAheadLog::rotate() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    committed_.wait(lock, [this] { return !leader_; });
+    // Lo encolado con enqueue() pertenece al log que se rota
+    if (!commit(lock, submitted_)) return false;
+
+    ::close(fd_);
+    fd_ = -1;
+    if (std::rename(path_.c_str(), rotatedPath().c_str()) != 0 || !openLog()) {
+        failed_ = true;
+        std::cerr << "[WAL] Error rotando " << path_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void WriteAheadLog::dropRotated() {
+    ::unlink(rotatedPath().c_str());
+}
+
+WriteAheadLog::Stats WriteAheadLog::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool WriteAheadLog::replay(const std::string& path,
+                           const std::function<void(const uint8_t*, size_t)>& record) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[65536];
+    for (;;) {
+        const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    ::close(fd);
+
+    size_t pos = 0;
+    while (pos + WAL_HEADER <= data.size()) {
+        uint32_t fields[3];
+        std::memcpy(fields, data.data() + pos, sizeof(fields));
+        const size_t len = fields[1];
+        if (fields[0] != WAL_MAGIC || pos + WAL_HEADER + len > data.size() ||
+            crc32(data.data() + pos + WAL_HEADER, len) != fields[2]) {
+            std::cerr << "[WAL] " << path << ": registro incompleto en el byte " << pos
+                      << ", se ignora el resto" << std::endl;
+            break;
+        }
+        record(data.data() + pos + WAL_HEADER, len);
+        pos += WAL_HEADER + len;
+    }
+    return true;
+}
+
+bool WriteAheadLog::syncDirectory(const std::string& path) {
+    // El archivo nuevo (o renombrado) no es durable hasta sincronizar el directorio
+    const size_t slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
@@ -0,0 +1,108 @@
+#ifndef WRITEAHEADLOG_H
+#define WRITEAHEADLOG_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Log secuencial de escritura anticipada en un archivo del host.
+ *
+ * append() vuelve cuando los bytes están en disco (fdatasync). Con varios
+ * hilos escribiendo a la vez se hace group commit: el primero que llega
+ * escribe y sincroniza todo lo acumulado hasta ese momento y los demás
+ * esperan a que su parte quede cubierta, así que N escrituras concurrentes
+ * cuestan un solo fdatasync.
+ *
+ * enqueue() deja un registro en la cola sin esperar, y sync() escribe y
+ * sincroniza todo lo encolado hasta ese momento: así un hilo solo puede
+ * juntar varios registros en un fdatasync.
+ *
+ * Cada append() es un registro [magic(4) | len(4) | crc32(4) | datos]; al
+ * leer, un registro truncado o con CRC inválido marca el final del log.
+ *
+ * rotate() deja el log actual como "<path>.1" (el que se está volcando al
+ * FileSystem) y empieza uno vacío; dropRotated() lo borra cuando ya no hace
+ * falta.
+ */
+class WriteAheadLog {
+ public:
+    struct Stats {
+        uint64_t appends;     // llamadas a append()
+        uint64_t syncs;       // fdatasync hechos; appends / syncs = tamaño del grupo
+        uint64_t bytes;       // bytes escritos desde la apertura
+    };
+
+    /// Abre (o crea) el log en path; lanza std::runtime_error si no puede.
+    explicit WriteAheadLog(const std::string& path);
+    ~WriteAheadLog();
+
+    /**
+     * Agrega un registro y espera a que sea durable.
+     * @return false si la escritura o el fdatasync fallaron; el log queda
+     *         inutilizable a partir de ahí.
+     */
+    bool append(const void* data, size_t len);
+
+    /**
+     * Encola un registro sin esperar; es durable cuando vuelve el próximo
+     * sync() (o append()) de cualquier hilo.
+     * @param ticket recibe la posición del final del registro, para compararla con durable().
+     * @return false si el log ya falló.
+     */
+    bool enqueue(const void* data, size_t len, uint64_t& ticket);
+    /// Espera a que todo lo encolado esté en disco; false si falló.
+    bool sync();
+    /// Hasta qué ticket está todo en disco.
+    uint64_t durable() const;
+
+    /**
+     * Renombra el log actual a rotatedPath() y abre uno nuevo; lo encolado
+     * se escribe antes en el log actual.
+     * El llamador se asegura de que no haya append() ni enqueue() en curso.
+     */
+    bool rotate();
+    void dropRotated();
+
+    const std::string& path() const { return path_; }
+    std::string rotatedPath() const { return rotatedPath(path_); }
+    static std::string rotatedPath(const std::string& path) { return path + ".1"; }
+    Stats stats() const;
+
+    /**
+     * Recorre los registros válidos de un log.
+     * @return false si el archivo no existe.
+     */
+    static bool replay(const std::string& path,
+                       const std::function<void(const uint8_t*, size_t)>& record);
+
+ private:
+    std::string path_;
+    int fd_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable committed_;
+    std::vector<uint8_t> pending_;    // registros esperando al próximo líder
+    std::vector<uint8_t> writing_;    // lo que el líder está escribiendo
+    uint64_t submitted_;              // bytes encolados en total
+    uint64_t durable_;                // bytes ya sincronizados
+    bool leader_;                     // hay un hilo escribiendo
+    bool failed_;
+    Stats stats_;
+
+    bool openLog();
+    // Encola el registro; mutex_ tomado. Devuelve hasta qué byte llega
+    uint64_t push(const void* data, size_t len);
+    // Espera (o escribe, si no hay líder) hasta que durable_ llegue a upTo
+    bool commit(std::unique_lock<std::mutex>& lock, uint64_t upTo);
+    static bool syncDirectory(const std::string& path);
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+};
+
+#endif // WRITEAHEADLOG_H
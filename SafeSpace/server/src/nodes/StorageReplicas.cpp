@@ -0,0 +1,435 @@
+#include "StorageReplicas.h"
+#include <algorithm>
+#include <array>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint8_t kResponseAck = static_cast<uint8_t>(MessageKind::RESPONSE_ACK);
+constexpr size_t kAckBatch = 32;  ///< ACK datagrams pulled per recvmmsg().
+}
+
+StorageReplicas::StorageReplicas(EventLoop& loop, const std::vector<Endpoint>& replicas)
+  : StorageReplicas(loop, replicas, Options()) {}
+
+StorageReplicas::StorageReplicas(EventLoop& loop, const std::vector<Endpoint>& replicas,
+                                 const Options& options)
+  : loop_(loop)
+  , options_(options)
+  , quorum_(options.quorum == 0 ? replicas.size() / 2 + 1 : options.quorum)
+  , fd_(-1)
+  , timer_(-1)
+  , nextSeq_(std::random_device{}())
+  , failed_(0)
+  , behind_(0)
+  , divergent_(0)
+  , stats_{} {
+  if (replicas.empty() || replicas.size() > MAX_REPLICAS) {
+    throw std::invalid_argument("StorageReplicas: need 1 to " + std::to_string(MAX_REPLICAS) + " replicas");
+  }
+  if (quorum_ > replicas.size()) {
+    throw std::invalid_argument("StorageReplicas: quorum " + std::to_string(quorum_) + " above " +
+                                std::to_string(replicas.size()) + " replicas");
+  }
+  for (const auto& replica : replicas) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(replica.port);
+    if (::inet_aton(replica.ip.c_str(), &addr.sin_addr) == 0) {
+      throw std::invalid_argument("Invalid IPv4 address: " + replica.ip);
+    }
+    replicas_.push_back(addr);
+  }
+  options_.maxInFlight = std::max<size_t>(1, options_.maxInFlight);
+  // a replica falling behind takes the whole window into its backlog
+  options_.maxBacklog = std::max(options_.maxBacklog, options_.maxInFlight);
+  backlogs_.resize(replicas_.size());
+
+  // one unconnected socket for every replica; ACKs come back to it
+  fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    throw std::runtime_error(std::string("StorageReplicas: socket() failed: ") + std::strerror(errno));
+  }
+  try {
+    loop_.addReader(fd_, [this](uint32_t) { onReadable(); });
+    timer_ = loop_.addTimer(std::max(std::chrono::milliseconds(1), options_.retransmitAfter / 2),
+                            [this]() { retransmit(); });
+  } catch (...) {
+    loop_.removeFd(fd_);
+    ::close(fd_);
+    throw;
+  }
+
+  std::cout << "[StorageReplicas] " << replicas_.size() << " storage replicas, quorum "
+            << quorum_ << std::endl;
+}
+
+StorageReplicas::~StorageReplicas() {
+  loop_.cancelTimer(timer_);
+  loop_.removeFd(fd_);
+  ::close(fd_);
+  if (!inFlight_.empty()) {
+    std::cerr << "[StorageReplicas] " << inFlight_.size()
+              << " sequences not acknowledged by every replica at shutdown" << std::endl;
+  }
+  for (size_t i = 0; i < backlogs_.size(); ++i) {
+    if (!backlogs_[i].missed.empty()) {
+      std::cerr << "[StorageReplicas] replica " << i << " still misses " << backlogs_[i].missed.size()
+                << " writes at shutdown" << std::endl;
+    }
+  }
+}
+
+void StorageReplicas::setCommitHandler(CommitHandler handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  onCommit_ = std::move(handler);
+}
+
+bool StorageReplicas::send(MessageKind kind, const uint8_t* payload, size_t length, uint32_t* seq) {
+  if (length > UINT16_MAX - MessageHeader::SIZE) return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // the oldest sequence leaves only once every live replica has it
+  if (inFlight_.size() >= options_.maxInFlight) {
+    stats_.rejected++;
+    return false;
+  }
+
+  Pending pending;
+  pending.seq = nextSeq_++;
+  pending.datagram.resize(MessageHeader::SIZE + length);
+  MessageHeader header;
+  header.type = kind;
+  header.flags = MessageHeader::FLAG_REPLICATED;
+  header.length = static_cast<uint16_t>(length);
+  header.seq = pending.seq;
+  header.encode(pending.datagram.data());
+  std::memcpy(pending.datagram.data() + MessageHeader::SIZE, payload, length);
+  pending.missing = replicas_.size() == MAX_REPLICAS ? ~uint64_t{0} : (uint64_t{1} << replicas_.size()) - 1;
+  pending.acks = 0;
+  pending.backoff = options_.retransmitAfter;
+  pending.sent = std::chrono::steady_clock::now();
+  pending.due = pending.sent + pending.backoff;
+  if (seq) *seq = pending.seq;
+  inFlight_.push_back(std::move(pending));
+  stats_.sent++;
+
+  // a replica catching up gets it after its backlog, in order
+  const Pending& sent = inFlight_.back();
+  Datagrams datagrams;
+  datagrams.reserve(replicas_.size());
+  for (size_t i = 0; i < replicas_.size(); ++i) {
+    if (behind_ & (uint64_t{1} << i)) {
+      queueMissed(i, sent.seq, sent.datagram);
+    } else {
+      datagrams.emplace_back(&sent.datagram, i);
+    }
+  }
+  transmit(datagrams);
+  return true;
+}
+
+StorageReplicas::Stats StorageReplicas::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.inFlight = inFlight_.size();
+  stats.backlog = 0;
+  for (const auto& backlog : backlogs_) stats.backlog += backlog.missed.size();
+  stats.divergent = static_cast<size_t>(__builtin_popcountll(divergent_));
+  return stats;
+}
+
+void StorageReplicas::onReadable() {
+  std::array<std::array<uint8_t, 64>, kAckBatch> buffers;
+  std::array<sockaddr_in, kAckBatch> peers;
+  std::array<iovec, kAckBatch> iov;
+  std::array<mmsghdr, kAckBatch> msgs;
+  for (size_t i = 0; i < kAckBatch; ++i) {
+    iov[i].iov_base = buffers[i].data();
+    iov[i].iov_len = buffers[i].size();
+    msgs[i] = mmsghdr{};
+    msgs[i].msg_hdr.msg_name = &peers[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  const int received = ::recvmmsg(fd_, msgs.data(), kAckBatch, MSG_DONTWAIT, nullptr);
+  if (received < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      std::cerr << "[StorageReplicas] recvmmsg() error: " << std::strerror(errno) << std::endl;
+    }
+    return;
+  }
+
+  std::vector<uint32_t> committed;
+  CommitHandler onCommit;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    uint64_t replaying = 0;
+    for (int m = 0; m < received; ++m) {
+      // Reply: header (REPLY | REPLICATED, same seq) + [RESPONSE_ACK][status]...
+      MessageHeader header;
+      const uint8_t* data = buffers[m].data();
+      if (!MessageHeader::decode(data, msgs[m].msg_len, header) ||
+          !(header.flags & MessageHeader::FLAG_REPLY) || !(header.flags & MessageHeader::FLAG_REPLICATED) ||
+          header.length < 2 || data[MessageHeader::SIZE] != kResponseAck) {
+        continue;
+      }
+      const auto replica = std::find_if(replicas_.begin(), replicas_.end(), [&](const sockaddr_in& r) {
+        return r.sin_addr.s_addr == peers[m].sin_addr.s_addr && r.sin_port == peers[m].sin_port;
+      });
+      if (replica == replicas_.end()) continue;
+      const size_t index = static_cast<size_t>(replica - replicas_.begin());
+      const uint64_t bit = uint64_t{1} << index;
+      if (data[MessageHeader::SIZE + 1] != 0) {
+        // the replica could not store it; the retransmission tries again
+        std::cerr << "[StorageReplicas] replica " << index << " failed seq " << header.seq << std::endl;
+        continue;
+      }
+      if (failed_ & bit) {
+        failed_ &= ~bit;
+        std::cerr << "[StorageReplicas] replica " << index << " is back at seq " << header.seq;
+        if (behind_ & bit) {
+          std::cerr << "; replaying " << backlogs_[index].missed.size() << " missed writes";
+        } else if (divergent_ & bit) {
+          std::cerr << "; it lost writes and needs a resync";
+        }
+        std::cerr << std::endl;
+      }
+      if (acknowledge(index, header.seq)) committed.push_back(header.seq);
+      if (behind_ & bit) {
+        replayed(index, header.seq, now);
+        replaying |= bit;
+      }
+    }
+    trim();
+
+    // keep the replays that moved going without waiting for the timer
+    Datagrams datagrams;
+    for (size_t i = 0; i < replicas_.size(); ++i) {
+      if (replaying & behind_ & (uint64_t{1} << i)) replay(i, datagrams);
+    }
+    transmit(datagrams);
+    onCommit = onCommit_;
+  }
+
+  // outside mutex_: the handler may send again
+  if (onCommit) {
+    for (const uint32_t seq : committed) onCommit(seq);
+  }
+}
+
+void StorageReplicas::retransmit() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto now = std::chrono::steady_clock::now();
+  detectFailures(now);
+  Datagrams datagrams;
+  for (auto& pending : inFlight_) {
+    // replicas catching up get it from their backlog
+    const uint64_t missing = pending.missing & ~behind_;
+    if (missing == 0 || pending.due > now) continue;
+    for (size_t i = 0; i < replicas_.size(); ++i) {
+      if (missing & (uint64_t{1} << i)) datagrams.emplace_back(&pending.datagram, i);
+    }
+    pending.backoff = std::min(pending.backoff * 2, options_.maxBackoff);
+    pending.due = now + pending.backoff;
+  }
+
+  for (size_t i = 0; i < replicas_.size(); ++i) {
+    const uint64_t bit = uint64_t{1} << i;
+    Backlog& backlog = backlogs_[i];
+    if (!(behind_ & bit) || backlog.due > now) continue;
+    // a failed replica is only probed with its oldest missing write
+    for (size_t k = 0; k < backlog.sent; ++k) {
+      if (backlog.missed[k].acked) continue;
+      datagrams.emplace_back(&backlog.missed[k].datagram, i);
+      if (failed_ & bit) break;
+    }
+    backlog.backoff = std::min(backlog.backoff * 2, options_.maxBackoff);
+    backlog.due = now + backlog.backoff;
+  }
+  stats_.retransmits += datagrams.size();
+  for (size_t i = 0; i < replicas_.size(); ++i) {
+    if (behind_ & (uint64_t{1} << i)) replay(i, datagrams);
+  }
+  if (datagrams.empty()) return;
+  transmit(datagrams);
+}
+
+bool StorageReplicas::acknowledge(size_t replica, uint32_t seq) {
+  if (inFlight_.empty()) return false;
+  // seqs in the window are consecutive; wrap-around is fine in uint32_t
+  const uint32_t index = seq - inFlight_.front().seq;
+  if (index >= inFlight_.size()) return false;  // already acknowledged by all, or not ours
+  Pending& pending = inFlight_[index];
+  const uint64_t bit = uint64_t{1} << replica;
+  if (!(pending.missing & bit)) return false;   // duplicate ACK
+
+  pending.missing &= ~bit;
+  const bool reached = ++pending.acks == quorum_;
+  if (reached) {
+    stats_.committed++;
+    // committed: lagging replicas get it from their backlog; divergent failed ones not at all
+    stats_.abandoned += static_cast<uint64_t>(__builtin_popcountll(pending.missing & failed_ & ~behind_));
+    pending.missing &= ~(failed_ | behind_);
+  }
+  if (pending.missing == 0) {
+    if (pending.acks == replicas_.size()) stats_.replicated++;
+    std::vector<uint8_t>().swap(pending.datagram);
+  }
+  return reached;
+}
+
+void StorageReplicas::detectFailures(std::chrono::steady_clock::time_point now) {
+  uint64_t lagging = 0;
+  for (const auto& pending : inFlight_) {
+    if (now - pending.sent < options_.failAfter) break;  // oldest first
+    if (pending.acks >= quorum_) lagging |= pending.missing;
+  }
+  for (size_t i = 0; i < replicas_.size(); ++i) {
+    // catching up, but no longer acknowledging its backlog
+    if ((behind_ & (uint64_t{1} << i)) && now - backlogs_[i].progress >= options_.failAfter) {
+      lagging |= uint64_t{1} << i;
+    }
+  }
+  lagging &= ~failed_;
+  if (lagging == 0) return;
+
+  failed_ |= lagging;
+  for (size_t i = 0; i < replicas_.size(); ++i) {
+    const uint64_t bit = uint64_t{1} << i;
+    if (!(lagging & bit)) continue;
+    stats_.failures++;
+    std::cerr << "[StorageReplicas] replica " << i << " declared failed: no ACK in "
+              << options_.failAfter.count() << " ms" << std::endl;
+    if (behind_ & bit) continue;  // its backlog is probed from now on
+    if (divergent_ & bit) {
+      // it already lacks writes: committed sequences stop waiting for it
+      for (auto& pending : inFlight_) {
+        if (pending.acks < quorum_ || !(pending.missing & bit)) continue;
+        stats_.abandoned++;
+        pending.missing &= ~bit;
+        if (pending.missing == 0) std::vector<uint8_t>().swap(pending.datagram);
+      }
+      continue;
+    }
+    fallBehind(i, now);
+  }
+  trim();
+}
+
+void StorageReplicas::fallBehind(size_t replica, std::chrono::steady_clock::time_point now) {
+  const uint64_t bit = uint64_t{1} << replica;
+  Backlog& backlog = backlogs_[replica];
+  behind_ |= bit;
+  backlog.sent = 0;
+  backlog.backoff = options_.retransmitAfter;
+  backlog.due = now + backlog.backoff;
+  backlog.progress = now;
+  // the backlog holds at least the whole window, so this cannot overflow
+  for (auto& pending : inFlight_) {
+    if (!(pending.missing & bit)) continue;
+    queueMissed(replica, pending.seq, pending.datagram);
+    // uncommitted ones still count its ACK toward quorum
+    if (pending.acks >= quorum_) {
+      pending.missing &= ~bit;
+      if (pending.missing == 0) std::vector<uint8_t>().swap(pending.datagram);
+    }
+  }
+}
+
+void StorageReplicas::queueMissed(size_t replica, uint32_t seq, const std::vector<uint8_t>& datagram) {
+  Backlog& backlog = backlogs_[replica];
+  if (backlog.missed.size() < options_.maxBacklog) {
+    backlog.missed.push_back(Backlog::Missed{seq, datagram, false});
+    return;
+  }
+
+  // too far behind to replay: what is no longer in the window is lost to it
+  for (const auto& missed : backlog.missed) {
+    const bool inWindow = !inFlight_.empty() && missed.seq - inFlight_.front().seq < inFlight_.size();
+    if (!missed.acked && !inWindow) stats_.abandoned++;
+  }
+  std::cerr << "[StorageReplicas] replica " << replica << " missed more than " << options_.maxBacklog
+            << " writes; it diverged and needs a resync from a healthy replica" << std::endl;
+  backlog.missed.clear();
+  backlog.sent = 0;
+  behind_ &= ~(uint64_t{1} << replica);
+  divergent_ |= uint64_t{1} << replica;
+}
+
+void StorageReplicas::replayed(size_t replica, uint32_t seq, std::chrono::steady_clock::time_point now) {
+  Backlog& backlog = backlogs_[replica];
+  for (auto& missed : backlog.missed) {
+    if (static_cast<int32_t>(missed.seq - seq) > 0) break;  // oldest first
+    if (missed.seq == seq) {
+      if (!missed.acked) stats_.replayed++;
+      missed.acked = true;
+      break;
+    }
+  }
+  backlog.progress = now;
+  backlog.backoff = options_.retransmitAfter;
+  backlog.due = now + backlog.backoff;
+  while (!backlog.missed.empty() && backlog.missed.front().acked) {
+    backlog.missed.pop_front();
+    if (backlog.sent > 0) --backlog.sent;
+  }
+  if (backlog.missed.empty()) {
+    behind_ &= ~(uint64_t{1} << replica);
+    std::cerr << "[StorageReplicas] replica " << replica << " caught up" << std::endl;
+  }
+}
+
+void StorageReplicas::replay(size_t replica, Datagrams& datagrams) {
+  Backlog& backlog = backlogs_[replica];
+  const size_t limit = std::min(backlog.missed.size(),
+                                (failed_ & (uint64_t{1} << replica)) ? size_t{1} : options_.maxInFlight);
+  for (; backlog.sent < limit; ++backlog.sent) {
+    datagrams.emplace_back(&backlog.missed[backlog.sent].datagram, replica);
+  }
+}
+
+void StorageReplicas::trim() {
+  while (!inFlight_.empty() && inFlight_.front().missing == 0) {
+    inFlight_.pop_front();
+  }
+}
+
+void StorageReplicas::transmit(const Datagrams& datagrams) {
+  std::vector<iovec> iov(datagrams.size());
+  std::vector<mmsghdr> msgs(datagrams.size());
+  for (size_t i = 0; i < datagrams.size(); ++i) {
+    const std::vector<uint8_t>& datagram = *datagrams[i].first;
+    iov[i].iov_base = const_cast<uint8_t*>(datagram.data());
+    iov[i].iov_len = datagram.size();
+    msgs[i] = mmsghdr{};
+    msgs[i].msg_hdr.msg_name = &replicas_[datagrams[i].second];
+    msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // sendmmsg() may stop early; a datagram that fails is left to the retransmission
+  size_t flushed = 0;
+  while (flushed < msgs.size()) {
+    const int sent = ::sendmmsg(fd_, msgs.data() + flushed, static_cast<unsigned int>(msgs.size() - flushed), 0);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        std::cerr << "[StorageReplicas] sendmmsg() error: " << std::strerror(errno) << std::endl;
+      }
+      ++flushed;
+      continue;
+    }
+    flushed += static_cast<size_t>(sent);
+  }
+}
@@ -0,0 +1,185 @@
+#ifndef SERVER_STORAGEREPLICAS_H
+#define SERVER_STORAGEREPLICAS_H
+
+#include "interfaces/EventLoop.h"
+#include "../model/structures/MessageHeader.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Replicates sensor writes to every storage node with ACK tracking.
+ *
+ * Each write is framed with a replication sequence number
+ * (MessageHeader::FLAG_REPLICATED) and sent to all replicas with one
+ * sendmmsg(). Replicas ACK with the same seq; a sequence is committed once
+ * quorum replicas have acknowledged it. Replicas still missing a sequence
+ * get it again after retransmitAfter, backing off up to maxBackoff, so a
+ * replica that drops packets catches up. StorageNode discards repeated
+ * sequence numbers, which makes the retransmissions safe.
+ *
+ * The CommitHandler is told each sequence that reaches quorum, so the
+ * caller acknowledges a write only once it is stored.
+ *
+ * At most maxInFlight sequences are kept for retransmission; when the
+ * window is full send() refuses the write, so a slow quorum pushes back on
+ * ingest instead of growing memory. A committed sequence stays in the
+ * window until every replica ACKs it.
+ *
+ * A replica that still misses a committed sequence failAfter after it was
+ * sent is declared failed. Everything it misses moves to its own backlog,
+ * which stops holding up the window, and new writes queue there too. The
+ * backlog is probed until the replica ACKs again, then replayed in
+ * sequence order, up to maxInFlight datagrams outstanding. The replica
+ * takes live writes again once the backlog is empty. If the backlog
+ * exceeds maxBacklog it is dropped instead. The replica is then logged
+ * and counted as divergent: it serves live writes again when it comes
+ * back, but lacks the dropped ones until it is resynced from a healthy
+ * replica.
+ *
+ * Threading: send() and stats() may be called from any thread. ACKs,
+ * retransmissions and the CommitHandler run on the EventLoop passed at
+ * construction.
+ */
+class StorageReplicas {
+ public:
+  struct Endpoint {
+    std::string ip;
+    uint16_t port;
+  };
+
+  struct Options {
+    size_t quorum = 0;                               ///< ACKs that commit a sequence; 0 = majority.
+    size_t maxInFlight = 512;                        ///< Sequences kept for retransmission.
+    std::chrono::milliseconds retransmitAfter{200};  ///< First retransmission delay.
+    std::chrono::milliseconds maxBackoff{3200};      ///< Retransmission delay cap.
+    std::chrono::milliseconds failAfter{10000};      ///< Unacknowledged this long: replica failed.
+    size_t maxBacklog = 8192;                        ///< Writes kept per failed replica for replay.
+  };
+
+  struct Stats {
+    uint64_t sent;          ///< Sequences accepted by send().
+    uint64_t committed;     ///< Sequences that reached quorum.
+    uint64_t replicated;    ///< Sequences acknowledged by every replica.
+    uint64_t retransmits;   ///< Datagrams sent again to a replica.
+    uint64_t abandoned;     ///< (sequence, replica) pairs a divergent replica never got.
+    uint64_t rejected;      ///< Writes refused because the window was full.
+    uint64_t failures;      ///< Times a replica was declared failed.
+    uint64_t replayed;      ///< Backlog writes a recovering replica acknowledged.
+    size_t inFlight;
+    size_t backlog;         ///< Writes waiting in the backlogs of lagging replicas.
+    size_t divergent;       ///< Replicas that lost writes and need a resync.
+  };
+
+  /// Receives the sequence number of each write that reached quorum.
+  using CommitHandler = std::function<void(uint32_t seq)>;
+
+  /// Most replicas a set can hold (one bit each per sequence).
+  static constexpr size_t MAX_REPLICAS = 64;
+
+  /**
+   * @brief Opens the replication socket and registers it and the
+   * retransmission timer on loop.
+   * @throws std::invalid_argument for an empty set, too many replicas, a
+   *         quorum above the replica count or a malformed address.
+   * @throws std::runtime_error if the socket cannot be created.
+   */
+  StorageReplicas(EventLoop& loop, const std::vector<Endpoint>& replicas, const Options& options);
+  StorageReplicas(EventLoop& loop, const std::vector<Endpoint>& replicas);
+  ~StorageReplicas();
+
+  /**
+   * @brief Sets the handler told of committed sequences; call before the first send().
+   *
+   * It runs on the EventLoop thread without internal locks held, so it may
+   * call send() or stats().
+   */
+  void setCommitHandler(CommitHandler handler);
+
+  /**
+   * @brief Frames payload as kind with the next sequence number and sends it to every replica.
+   * @param seq if not null, receives the sequence number the CommitHandler will report.
+   * @return false if the window is full or the payload does not fit a
+   *         datagram; nothing was sent then.
+   */
+  bool send(MessageKind kind, const uint8_t* payload, size_t length, uint32_t* seq = nullptr);
+
+  size_t size() const { return replicas_.size(); }
+  size_t quorum() const { return quorum_; }
+  Stats stats() const;
+
+ private:
+  struct Pending {
+    uint32_t seq;
+    std::vector<uint8_t> datagram;         ///< Released once every replica ACKed.
+    uint64_t missing;                      ///< Bit i set: replica i has not ACKed.
+    size_t acks;
+    std::chrono::steady_clock::time_point sent;
+    std::chrono::steady_clock::time_point due;
+    std::chrono::milliseconds backoff;
+  };
+
+  /** Writes a lagging replica still needs, oldest first. */
+  struct Backlog {
+    struct Missed {
+      uint32_t seq;
+      std::vector<uint8_t> datagram;
+      bool acked;
+    };
+    std::deque<Missed> missed;
+    size_t sent = 0;                       ///< Front entries transmitted at least once.
+    std::chrono::steady_clock::time_point due;       ///< Next resend of the unacknowledged ones.
+    std::chrono::milliseconds backoff{0};
+    std::chrono::steady_clock::time_point progress;  ///< Last ACK from the replica.
+  };
+  using Datagrams = std::vector<std::pair<const std::vector<uint8_t>*, size_t>>;
+
+  EventLoop& loop_;
+  std::vector<sockaddr_in> replicas_;
+  Options options_;
+  size_t quorum_;
+  int fd_;
+  int timer_;
+
+  mutable std::mutex mutex_;  ///< Guards everything below.
+  std::deque<Pending> inFlight_;           ///< Consecutive seqs, oldest first.
+  uint32_t nextSeq_;
+  uint64_t failed_;                        ///< Bit i set: replica i declared failed.
+  uint64_t behind_;                        ///< Bit i set: replica i is fed from backlogs_[i].
+  uint64_t divergent_;                     ///< Bit i set: replica i lost writes.
+  std::vector<Backlog> backlogs_;
+  Stats stats_;
+  CommitHandler onCommit_;
+
+  /** Reads replica ACKs from the socket. */
+  void onReadable();
+  /** Resends due sequences to the replicas still missing them. */
+  void retransmit();
+  /** Records an ACK of seq from replica; true if it brought seq to quorum. mutex_ held. */
+  bool acknowledge(size_t replica, uint32_t seq);
+  /** Declares failed the replicas lagging failAfter behind a committed sequence; mutex_ held. */
+  void detectFailures(std::chrono::steady_clock::time_point now);
+  /** Moves what replica misses in the window to its backlog; mutex_ held. */
+  void fallBehind(size_t replica, std::chrono::steady_clock::time_point now);
+  /** Queues a write for a lagging replica, dropping the backlog if it overflows; mutex_ held. */
+  void queueMissed(size_t replica, uint32_t seq, const std::vector<uint8_t>& datagram);
+  /** Records an ACK of a backlog write; mutex_ held. */
+  void replayed(size_t replica, uint32_t seq, std::chrono::steady_clock::time_point now);
+  /** Adds the backlog writes replica is due (a probe while failed); mutex_ held. */
+  void replay(size_t replica, Datagrams& datagrams);
+  /** Drops fully acknowledged sequences from the front; mutex_ held. */
+  void trim();
+  /** Sends each (datagram, replica) pair with sendmmsg(); mutex_ held. */
+  void transmit(const Datagrams& datagrams);
+
+  StorageReplicas(const StorageReplicas&) = delete;
+  StorageReplicas& operator=(const StorageReplicas&) = delete;
+};
+
+#endif //SERVER_STORAGEREPLICAS_H
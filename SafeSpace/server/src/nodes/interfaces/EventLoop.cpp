@@ -0,0 +1,181 @@
+#include "EventLoop.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr int kMaxEventsPerWait = 64;
+}
+
+EventLoop::EventLoop()
+  : epollfd_(-1),
+    wakefd_(-1),
+    stopRequested_(false)
+{
+  epollfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epollfd_ < 0) {
+    throw std::runtime_error(std::string("epoll_create1() failed: ") + std::strerror(errno));
+  }
+
+  wakefd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakefd_ < 0) {
+    ::close(epollfd_);
+    throw std::runtime_error(std::string("eventfd() failed: ") + std::strerror(errno));
+  }
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = wakefd_;
+  if (::epoll_ctl(epollfd_, EPOLL_CTL_ADD, wakefd_, &ev) < 0) {
+    ::close(wakefd_);
+    ::close(epollfd_);
+    throw std::runtime_error(std::string("epoll_ctl(eventfd) failed: ") + std::strerror(errno));
+  }
+}
+
+EventLoop::~EventLoop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& timer : timers_) {
+    ::close(timer.first);
+  }
+  timers_.clear();
+  handlers_.clear();
+  ::close(wakefd_);
+  ::close(epollfd_);
+}
+
+void EventLoop::addReader(int fd, IoCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  const bool known = handlers_.count(fd) != 0;
+  if (::epoll_ctl(epollfd_, known ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) < 0) {
+    throw std::runtime_error(std::string("epoll_ctl(add) failed: ") + std::strerror(errno));
+  }
+  handlers_[fd] = std::make_shared<IoCallback>(std::move(callback));
+}
+
+void EventLoop::removeFd(int fd) noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (handlers_.erase(fd) != 0) {
+    ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, fd, nullptr);
+  }
+}
+
+int EventLoop::addTimer(std::chrono::milliseconds interval, TimerCallback callback, bool repeat) {
+  int tfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (tfd < 0) {
+    throw std::runtime_error(std::string("timerfd_create() failed: ") + std::strerror(errno));
+  }
+
+  // a zero it_value would disarm the timer, so clamp to 1 ns
+  const long long ns = std::max<long long>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count(), 1);
+  itimerspec spec{};
+  spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000LL);
+  spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000LL);
+  if (repeat) {
+    spec.it_interval = spec.it_value;
+  }
+  if (::timerfd_settime(tfd, 0, &spec, nullptr) < 0) {
+    ::close(tfd);
+    throw std::runtime_error(std::string("timerfd_settime() failed: ") + std::strerror(errno));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timers_[tfd] = repeat;
+  }
+
+  try {
+    addReader(tfd, [this, tfd, repeat, cb = std::move(callback)](uint32_t) {
+      uint64_t expirations = 0;
+      if (::read(tfd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return;
+      }
+      if (!repeat) {
+        cancelTimer(tfd);
+      }
+      // missed expirations are coalesced into one call
+      cb();
+    });
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timers_.erase(tfd);
+    ::close(tfd);
+    throw;
+  }
+  return tfd;
+}
+
+void EventLoop::cancelTimer(int timerId) noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (timers_.erase(timerId) == 0) {
+    return;
+  }
+  handlers_.erase(timerId);
+  ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, timerId, nullptr);
+  ::close(timerId);
+}
+
+void EventLoop::run() {
+  epoll_event events[kMaxEventsPerWait];
+
+  while (!stopRequested_.load()) {
+    int ready = ::epoll_wait(epollfd_, events, kMaxEventsPerWait, -1);
+    if (ready < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "EventLoop: epoll_wait() error: " << std::strerror(errno) << std::endl;
+      break;
+    }
+
+    for (int i = 0; i < ready && !stopRequested_.load(); ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == wakefd_) {
+        consumeWakeup();
+        continue;
+      }
+
+      // copy the handler out so callbacks may (un)register fds freely
+      std::shared_ptr<IoCallback> handler;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = handlers_.find(fd);
+        if (it == handlers_.end()) continue;  // removed earlier in this batch
+        handler = it->second;
+      }
+
+      try {
+        (*handler)(events[i].events);
+      } catch (const std::exception& ex) {
+        std::cerr << "EventLoop: exception in callback for fd " << fd << ": " << ex.what() << std::endl;
+      }
+    }
+  }
+
+  // consume the stop request so the loop can be run again
+  stopRequested_.store(false);
+  consumeWakeup();
+}
+
+void EventLoop::stop() noexcept {
+  stopRequested_.store(true);
+  const uint64_t one = 1;
+  ssize_t ignored = ::write(wakefd_, &one, sizeof(one));
+  (void)ignored;
+}
+
+void EventLoop::consumeWakeup() noexcept {
+  uint64_t counter = 0;
+  ssize_t ignored = ::read(wakefd_, &counter, sizeof(counter));
+  (void)ignored;
+}
@@ -0,0 +1,102 @@
+#ifndef SERVER_EVENTLOOP_H
+#define SERVER_EVENTLOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * @brief Single-threaded reactor built on epoll, timerfd and eventfd.
+ *
+ * Nodes register the sockets they read from and the periodic tasks they
+ * run (heartbeats, flushes) on one loop, so a single thread can service a
+ * server socket, its upstream client sockets and its timers together while
+ * burning no CPU when idle.
+ *
+ * Threading model:
+ *  - run() dispatches every callback on the thread that called it.
+ *  - addReader(), removeFd(), addTimer(), cancelTimer() and stop() are safe
+ *    to call from any thread, including from inside a callback.
+ *  - stop() wakes the loop immediately through an eventfd; run() returns
+ *    after the callback in progress (if any) finishes.
+ */
+class EventLoop {
+ public:
+  /// Invoked with the epoll event mask when a registered fd is ready.
+  using IoCallback = std::function<void(uint32_t events)>;
+  /// Invoked on every timer expiration.
+  using TimerCallback = std::function<void()>;
+
+  /**
+   * @brief Creates the epoll instance and the wake-up eventfd.
+   * @throws std::runtime_error if either descriptor cannot be created.
+   */
+  EventLoop();
+
+  /**
+   * @brief Closes the epoll instance, the eventfd and every timer fd.
+   * Registered socket fds are not closed; they belong to the caller.
+   */
+  ~EventLoop();
+
+  /**
+   * @brief Watches fd for readability (level triggered).
+   *
+   * The callback must drain or read what it needs; level triggering calls
+   * it again while data remains queued.
+   * @throws std::runtime_error if epoll_ctl() fails.
+   */
+  void addReader(int fd, IoCallback callback);
+
+  /**
+   * @brief Stops watching fd. Unknown fds are ignored.
+   */
+  void removeFd(int fd) noexcept;
+
+  /**
+   * @brief Schedules callback every interval (or once when repeat is false).
+   * @return Timer id to pass to cancelTimer().
+   * @throws std::runtime_error if the timerfd cannot be created.
+   */
+  int addTimer(std::chrono::milliseconds interval, TimerCallback callback, bool repeat = true);
+
+  /**
+   * @brief Cancels a timer created with addTimer(). Unknown ids are ignored.
+   */
+  void cancelTimer(int timerId) noexcept;
+
+  /**
+   * @brief Dispatches events on the calling thread until stop() is called.
+   *
+   * A stop() issued before run() makes it return immediately; the request is
+   * consumed, so the loop can be run again afterwards.
+   */
+  void run();
+
+  /**
+   * @brief Wakes run() and makes it return. Safe from any thread.
+   */
+  void stop() noexcept;
+
+ private:
+  int epollfd_;
+  int wakefd_;
+  std::atomic<bool> stopRequested_;
+
+  std::mutex mutex_;  ///< Guards handlers_ and timers_.
+  std::unordered_map<int, std::shared_ptr<IoCallback>> handlers_;
+  std::unordered_map<int, bool> timers_;  ///< timerfd -> repeat flag.
+
+  /** Drains the eventfd counter. */
+  void consumeWakeup() noexcept;
+
+  // Non-copyable
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+};
+
+#endif //SERVER_EVENTLOOP_H
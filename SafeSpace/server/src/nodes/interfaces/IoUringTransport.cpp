@@ -0,0 +1,420 @@
+#include "IoUringTransport.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+// user_data tags; the low 16 bits of a send carry its fixed buffer index
+constexpr uint64_t kRecvTag = 1ULL << 62;
+constexpr uint64_t kSendTag = 1ULL << 61;
+constexpr uint64_t kCancelTag = 1ULL << 60;
+
+constexpr uint16_t kBufferGroup = 0;
+// bounds one process() call so timers and other fds of the loop are not starved
+constexpr int kMaxReapRounds = 4;
+
+int ringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ringRegister(int fd, unsigned opcode, void* arg, unsigned nrArgs) {
+  return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+std::runtime_error sysError(const char* what) {
+  return std::runtime_error(std::string(what) + " failed: " + std::strerror(errno));
+}
+
+unsigned roundUpPow2(unsigned v) {
+  unsigned p = 1;
+  while (p < v) p <<= 1;
+  return p;
+}
+
+}  // namespace
+
+IoUringTransport::IoUringTransport(int sockfd, size_t bufsize, unsigned depth)
+  : sockfd_(sockfd),
+    ringfd_(-1),
+    bufsize_(bufsize),
+    depth_(roundUpPow2(std::clamp(depth, 8u, 4096u))),
+    ring_(MAP_FAILED),
+    ringSize_(0),
+    sqes_(nullptr),
+    sqesSize_(0),
+    sqHead_(nullptr),
+    sqTail_(nullptr),
+    sqFlags_(nullptr),
+    sqMask_(0),
+    sqEntries_(0),
+    sqLocalTail_(0),
+    toSubmit_(0),
+    cqHead_(nullptr),
+    cqTail_(nullptr),
+    cqMask_(0),
+    cqes_(nullptr),
+    bufRing_(nullptr),
+    bufRingSize_(0),
+    rxEntries_(depth_),
+    rxTail_(0),
+    rxSlotSize_(sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + bufsize),
+    rxMsg_{},
+    bufRingRegistered_(false),
+    rxArmed_(false),
+    closing_(false),
+    txRegistered_(false),
+    sendFallbacks_(0)
+{
+  if (!supported()) {
+    throw std::runtime_error("io_uring lacks RECVMSG/SEND_ZC support");
+  }
+
+  try {
+    // multishot receives post many completions per submission, so the CQ is oversized
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = depth_ * 8;
+    ringfd_ = ringSetup(depth_, &params);
+    if (ringfd_ < 0) throw sysError("io_uring_setup()");
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+      throw std::runtime_error("io_uring_setup(): kernel too old");
+    }
+
+    ringSize_ = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                 params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ring_ = ::mmap(nullptr, ringSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringfd_, IORING_OFF_SQ_RING);
+    if (ring_ == MAP_FAILED) throw sysError("mmap(ring)");
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringfd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) throw sysError("mmap(sqes)");
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* base = static_cast<uint8_t*>(ring_);
+    sqHead_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sqFlags_ = reinterpret_cast<unsigned*>(base + params.sq_off.flags);
+    sqMask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqLocalTail_ = *sqTail_;
+    cqHead_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+    // SQE slots are used in ring order, so the indirection array is the identity
+    auto* sqArray = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries_; ++i) sqArray[i] = i;
+
+    // provided-buffer ring: each slot holds recvmsg_out header, peer address and payload
+    rxPool_.resize(rxEntries_ * rxSlotSize_);
+    bufRingSize_ = rxEntries_ * sizeof(io_uring_buf);
+    void* bufRing = ::mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufRing == MAP_FAILED) throw sysError("mmap(buffer ring)");
+    bufRing_ = static_cast<io_uring_buf_ring*>(bufRing);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufRing_);
+    reg.ring_entries = rxEntries_;
+    reg.bgid = kBufferGroup;
+    if (ringRegister(ringfd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+      throw sysError("io_uring_register(PBUF_RING)");
+    }
+    bufRingRegistered_ = true;
+    for (unsigned i = 0; i < rxEntries_; ++i) {
+      recycleRxBuffer(static_cast<uint16_t>(i));
+    }
+
+    // fixed send buffers, one per in-flight response
+    txPool_.resize(static_cast<size_t>(depth_) * bufsize_);
+    txScratch_.resize(bufsize_);
+    txPeers_.resize(depth_);
+    std::vector<iovec> iov(depth_);
+    for (unsigned i = 0; i < depth_; ++i) {
+      iov[i].iov_base = txPool_.data() + static_cast<size_t>(i) * bufsize_;
+      iov[i].iov_len = bufsize_;
+      txFree_.push_back(static_cast<uint16_t>(depth_ - 1 - i));
+    }
+    if (ringRegister(ringfd_, IORING_REGISTER_BUFFERS, iov.data(), depth_) < 0) {
+      throw sysError("io_uring_register(BUFFERS)");
+    }
+    txRegistered_ = true;
+
+    rxMsg_.msg_namelen = sizeof(sockaddr_in);
+    armReceive();
+    submit();
+    if (!rxArmed_ || toSubmit_ != 0) {
+      throw std::runtime_error("io_uring: could not arm multishot receive");
+    }
+  } catch (...) {
+    releaseAll();
+    throw;
+  }
+}
+
+IoUringTransport::~IoUringTransport() {
+  cancelReceive();
+  releaseAll();
+}
+
+bool IoUringTransport::supported() noexcept {
+  static const bool ok = [] {
+    io_uring_params params{};
+    int fd = ringSetup(4, &params);
+    if (fd < 0) return false;
+
+    constexpr unsigned kOps = 256;
+    std::vector<uint8_t> mem(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(mem.data());
+    const int ret = ringRegister(fd, IORING_REGISTER_PROBE, probe, kOps);
+    ::close(fd);
+    if (ret < 0) return false;
+
+    auto has = [probe](unsigned op) {
+      return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    };
+    return has(IORING_OP_RECVMSG) && has(IORING_OP_SEND_ZC) && has(IORING_OP_ASYNC_CANCEL);
+  }();
+  return ok;
+}
+
+bool IoUringTransport::process(const Handler& handler) {
+  bool keepGoing = true;
+  unsigned head = *cqHead_;
+
+  for (int round = 0; round < kMaxReapRounds; ++round) {
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    if (head == tail) break;
+
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = cqes_[head & cqMask_];
+
+      if (cqe.user_data & kSendTag) {
+        const auto slot = static_cast<uint16_t>(cqe.user_data & 0xFFFF);
+        if (cqe.flags & IORING_CQE_F_NOTIF) {
+          // the kernel is done with the fixed buffer
+          txFree_.push_back(slot);
+          continue;
+        }
+        if (cqe.res < 0) {
+          std::cerr << "IoUringTransport: send error: " << std::strerror(-cqe.res) << std::endl;
+        }
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+          txFree_.push_back(slot);
+        }
+        continue;
+      }
+
+      if (cqe.user_data != kRecvTag) continue;  // cancel completions
+
+      if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        rxArmed_ = false;
+      }
+      if (cqe.res < 0) {
+        // ENOBUFS: every buffer was in use; re-armed below once they are recycled
+        if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+          std::cerr << "IoUringTransport: recvmsg error: " << std::strerror(-cqe.res) << std::endl;
+        }
+        continue;
+      }
+      if (!(cqe.flags & IORING_CQE_F_BUFFER)) continue;
+
+      const auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+      const uint8_t* slot = rxPool_.data() + static_cast<size_t>(bid) * rxSlotSize_;
+      io_uring_recvmsg_out out;
+      std::memcpy(&out, slot, sizeof(out));
+
+      if (keepGoing && handler) {
+        if (out.flags & MSG_TRUNC) {
+          std::cerr << "IoUringTransport: dropped datagram larger than " << bufsize_ << " bytes" << std::endl;
+        } else {
+          sockaddr_in peer{};
+          std::memcpy(&peer, slot + sizeof(out), std::min<size_t>(out.namelen, sizeof(peer)));
+          const uint8_t* payload = slot + sizeof(out) + rxMsg_.msg_namelen + rxMsg_.msg_controllen;
+
+          // the reply is serialized straight into a registered send buffer
+          const bool pooled = !txFree_.empty();
+          const uint16_t txSlot = pooled ? txFree_.back() : 0;
+          if (pooled) txFree_.pop_back();
+          uint8_t* txBuf = pooled ? txPool_.data() + static_cast<size_t>(txSlot) * bufsize_
+                                  : txScratch_.data();
+          ResponseBuffer response(txBuf, bufsize_);
+
+          keepGoing = handler(peer, payload, out.payloadlen, response);
+
+          if (response.empty() || response.overflowed()) {
+            if (pooled) txFree_.push_back(txSlot);
+          } else if (pooled) {
+            queueSend(txSlot, peer, response.size());
+          } else {
+            sendNow(peer, txBuf, response.size());
+          }
+        }
+      }
+      recycleRxBuffer(bid);
+    }
+
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    // one submission for every response produced by this batch
+    submit();
+  }
+
+  if (!rxArmed_ && !closing_) {
+    armReceive();
+  }
+  // completions the CQ could not hold are parked in the kernel until we ask for them
+  if (__atomic_load_n(sqFlags_, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) {
+    ringEnter(ringfd_, 0, 0, IORING_ENTER_GETEVENTS);
+  }
+  submit();
+  return keepGoing;
+}
+
+io_uring_sqe* IoUringTransport::nextSqe() {
+  if (sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+    submit();
+    if (sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+      return nullptr;
+    }
+  }
+  io_uring_sqe* sqe = &sqes_[sqLocalTail_ & sqMask_];
+  std::memset(sqe, 0, sizeof(*sqe));
+  ++sqLocalTail_;
+  ++toSubmit_;
+  return sqe;
+}
+
+void IoUringTransport::submit() {
+  if (toSubmit_ == 0) return;
+  __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+
+  while (toSubmit_ > 0) {
+    int ret = ringEnter(ringfd_, toSubmit_, 0, 0);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      // EBUSY/EAGAIN: CQ backlog; the SQEs stay queued and go out on the next call
+      if (errno != EBUSY && errno != EAGAIN) {
+        std::cerr << "IoUringTransport: io_uring_enter() error: " << std::strerror(errno) << std::endl;
+      }
+      return;
+    }
+    if (ret == 0) return;
+    toSubmit_ -= std::min<unsigned>(toSubmit_, static_cast<unsigned>(ret));
+  }
+}
+
+void IoUringTransport::armReceive() {
+  io_uring_sqe* sqe = nextSqe();
+  if (!sqe) return;  // retried on the next process()
+
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = sockfd_;
+  sqe->addr = reinterpret_cast<uint64_t>(&rxMsg_);
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = kRecvTag;
+  rxArmed_ = true;
+}
+
+void IoUringTransport::recycleRxBuffer(uint16_t bid) {
+  // index from the ring base: in C++ the uapi flex-array wrapper shifts bufs[] by 8 bytes
+  io_uring_buf& buf = reinterpret_cast<io_uring_buf*>(bufRing_)[rxTail_ & (rxEntries_ - 1)];
+  buf.addr = reinterpret_cast<uint64_t>(rxPool_.data() + static_cast<size_t>(bid) * rxSlotSize_);
+  buf.len = static_cast<uint32_t>(rxSlotSize_);
+  buf.bid = bid;
+  ++rxTail_;
+  __atomic_store_n(&bufRing_->tail, rxTail_, __ATOMIC_RELEASE);
+}
+
+void IoUringTransport::queueSend(uint16_t slot, const sockaddr_in& peer, size_t len) {
+  uint8_t* buf = txPool_.data() + static_cast<size_t>(slot) * bufsize_;
+  io_uring_sqe* sqe = nextSqe();
+  if (!sqe) {
+    sendNow(peer, buf, len);
+    txFree_.push_back(slot);
+    return;
+  }
+
+  txPeers_[slot] = peer;
+  sqe->fd = sockfd_;
+  sqe->addr = reinterpret_cast<uint64_t>(buf);
+  sqe->len = static_cast<uint32_t>(len);
+  if (len >= kZeroCopyMin) {
+    sqe->opcode = IORING_OP_SEND_ZC;
+    sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+    sqe->buf_index = slot;
+  } else {
+    // small datagrams: a copy is cheaper than pinning plus the extra notification CQE
+    sqe->opcode = IORING_OP_SEND;
+  }
+  sqe->addr2 = reinterpret_cast<uint64_t>(&txPeers_[slot]);
+  sqe->addr_len = sizeof(sockaddr_in);
+  sqe->user_data = kSendTag | slot;
+}
+
+void IoUringTransport::sendNow(const sockaddr_in& peer, const uint8_t* data, size_t len) {
+  // no fixed buffer or SQE was free; a synchronous send keeps the reply
+  ++sendFallbacks_;
+  if (::sendto(sockfd_, data, len, 0, reinterpret_cast<const sockaddr*>(&peer), sizeof(peer)) < 0) {
+    std::cerr << "IoUringTransport: sendto() error: " << std::strerror(errno) << std::endl;
+  }
+}
+
+void IoUringTransport::cancelReceive() noexcept {
+  if (ringfd_ < 0 || !rxArmed_) return;
+  closing_ = true;
+
+  io_uring_sqe* sqe = nextSqe();
+  if (!sqe) return;
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->addr = kRecvTag;
+  sqe->user_data = kCancelTag;
+  submit();
+
+  // the cancel and the final receive completion arrive together; a few
+  // bounded waits cover a receive that was mid-completion
+  for (int attempt = 0; attempt < 4 && rxArmed_; ++attempt) {
+    if (ringEnter(ringfd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) break;
+    process(Handler());
+  }
+}
+
+void IoUringTransport::releaseAll() noexcept {
+  if (ringfd_ >= 0) {
+    if (txRegistered_) {
+      ringRegister(ringfd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    }
+    if (bufRingRegistered_) {
+      io_uring_buf_reg reg{};
+      reg.bgid = kBufferGroup;
+      ringRegister(ringfd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+  }
+  if (bufRing_) ::munmap(bufRing_, bufRingSize_);
+  if (sqes_) ::munmap(sqes_, sqesSize_);
+  if (ring_ != MAP_FAILED) ::munmap(ring_, ringSize_);
+  if (ringfd_ >= 0) ::close(ringfd_);
+
+  bufRing_ = nullptr;
+  sqes_ = nullptr;
+  ring_ = MAP_FAILED;
+  ringfd_ = -1;
+  txRegistered_ = false;
+  bufRingRegistered_ = false;
+}
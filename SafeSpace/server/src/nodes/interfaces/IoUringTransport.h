@@ -0,0 +1,147 @@
+#ifndef SERVER_IOURINGTRANSPORT_H
+#define SERVER_IOURINGTRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "ResponseBuffer.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+/**
+ * @brief io_uring datagram backend for one bound UDP socket.
+ *
+ * Receives with a single multishot IORING_OP_RECVMSG that picks its buffers
+ * from a provided-buffer ring, so the socket is never re-armed per datagram
+ * and no receive buffer is copied. Handlers write their responses straight
+ * into registered (fixed) send buffers; those of at least kZeroCopyMin bytes are submitted
+ * as IORING_OP_SEND_ZC straight from the fixed buffer, smaller ones as a
+ * plain IORING_OP_SEND (zero-copy only pays off for large payloads and its
+ * pinned pages inflate the receiver's socket accounting). Every send queued
+ * while a batch of completions is processed goes to the kernel in one
+ * io_uring_enter() call.
+ *
+ * The ring fd is pollable: it becomes readable when completions are
+ * pending, so the transport plugs into an EventLoop like any socket.
+ *
+ * The ring is driven by raw syscalls (no liburing dependency). Construction
+ * throws when the kernel lacks any required feature; callers are expected
+ * to fall back to the recvfrom()/recvmmsg() path. Not thread-safe: one
+ * transport per serving thread.
+ */
+class IoUringTransport {
+ public:
+  /**
+   * @brief Invoked once per received datagram.
+   * @param response view over a free send buffer; sent back to peer when non-empty.
+   * @return false to stop dispatching the current batch (shutdown request).
+   */
+  using Handler = std::function<bool(const sockaddr_in& peer,
+                                     const uint8_t* data,
+                                     size_t len,
+                                     ResponseBuffer& response)>;
+
+  /// Submission queue depth.
+  static constexpr unsigned kDefaultDepth = 256;
+  /// Smallest response sent with IORING_OP_SEND_ZC.
+  static constexpr size_t kZeroCopyMin = 2048;
+
+  /**
+   * @brief Sets up the ring, the provided-buffer ring and the fixed send buffers.
+   * @param sockfd bound UDP socket; not owned.
+   * @param bufsize largest datagram payload accepted and sent.
+   * @param depth submission queue entries; also the number of receive and send buffers.
+   * @throws std::runtime_error if io_uring or a required feature is unavailable.
+   */
+  IoUringTransport(int sockfd, size_t bufsize, unsigned depth = kDefaultDepth);
+  ~IoUringTransport();
+
+  /**
+   * @brief Cheap probe for the opcodes this backend needs; cached after the first call.
+   */
+  static bool supported() noexcept;
+
+  /// Fd to register on an EventLoop; readable while completions are pending.
+  int ringFd() const noexcept { return ringfd_; }
+
+  /**
+   * @brief Reaps every pending completion, dispatching datagrams to handler.
+   *
+   * Responses are queued and flushed with one submission at the end.
+   * @return false when handler requested a shutdown.
+   */
+  bool process(const Handler& handler);
+
+  /// Responses sent with a plain sendto() because no fixed buffer or SQE was free.
+  uint64_t sendFallbacks() const noexcept { return sendFallbacks_; }
+
+ private:
+  int sockfd_;
+  int ringfd_;
+  size_t bufsize_;
+  unsigned depth_;
+
+  // rings shared with the kernel (one mapping for SQ and CQ)
+  void* ring_;
+  size_t ringSize_;
+  io_uring_sqe* sqes_;
+  size_t sqesSize_;
+
+  unsigned* sqHead_;
+  unsigned* sqTail_;
+  unsigned* sqFlags_;
+  unsigned sqMask_;
+  unsigned sqEntries_;
+  unsigned sqLocalTail_;
+  unsigned toSubmit_;
+
+  unsigned* cqHead_;
+  unsigned* cqTail_;
+  unsigned cqMask_;
+  io_uring_cqe* cqes_;
+
+  // provided-buffer ring for the multishot receive
+  io_uring_buf_ring* bufRing_;
+  size_t bufRingSize_;
+  unsigned rxEntries_;
+  uint16_t rxTail_;
+  size_t rxSlotSize_;
+  std::vector<uint8_t> rxPool_;
+  msghdr rxMsg_;
+  bool bufRingRegistered_;
+  bool rxArmed_;
+  bool closing_;   ///< Set by cancelReceive(); stops process() from re-arming.
+
+  // registered send buffers
+  std::vector<uint8_t> txPool_;
+  std::vector<uint8_t> txScratch_;   ///< Response target when every fixed buffer is in flight.
+  std::vector<sockaddr_in> txPeers_;
+  std::vector<uint16_t> txFree_;
+  bool txRegistered_;
+
+  uint64_t sendFallbacks_;
+
+  /** Next free SQE, submitting first when the queue is full; nullptr if still full. */
+  io_uring_sqe* nextSqe();
+  /** Publishes queued SQEs and hands them to the kernel in one io_uring_enter(). */
+  void submit();
+  void armReceive();
+  void recycleRxBuffer(uint16_t bid);
+  /** Queues the len bytes already written to fixed buffer slot. */
+  void queueSend(uint16_t slot, const sockaddr_in& peer, size_t len);
+  void sendNow(const sockaddr_in& peer, const uint8_t* data, size_t len);
+  /** Cancels the multishot receive and waits for it, so rxPool_ can be freed. */
+  void cancelReceive() noexcept;
+  void releaseAll() noexcept;
+
+  // Non-copyable
+  IoUringTransport(const IoUringTransport&) = delete;
+  IoUringTransport& operator=(const IoUringTransport&) = delete;
+};
+
+#endif //SERVER_IOURINGTRANSPORT_H
@@ -0,0 +1,80 @@
+#include "PacketPool.h"
+#include <stdexcept>
+
+namespace {
+constexpr uint64_t pack(uint32_t tag, uint32_t index) noexcept {
+  return (static_cast<uint64_t>(tag) << 32) | index;
+}
+constexpr uint32_t indexOf(uint64_t head) noexcept { return static_cast<uint32_t>(head); }
+constexpr uint32_t tagOf(uint64_t head) noexcept { return static_cast<uint32_t>(head >> 32); }
+}
+
+PacketPool::PacketPool(size_t bufferSize, size_t count)
+  : bufferSize_(bufferSize),
+    count_(count),
+    head_(pack(0, kEmpty)),
+    hits_(0),
+    misses_(0),
+    released_(0)
+{
+  if (bufferSize == 0 || count == 0) {
+    throw std::invalid_argument("PacketPool: buffer size and count must be non-zero");
+  }
+  if (count >= kHeap) {
+    throw std::invalid_argument("PacketPool: too many buffers");
+  }
+
+  slab_.reset(new uint8_t[bufferSize * count]);
+  next_.reset(new std::atomic<uint32_t>[count]);
+
+  // chain every buffer in index order; nothing else can see the pool yet
+  for (size_t i = 0; i < count; ++i) {
+    next_[i].store(i + 1 < count ? static_cast<uint32_t>(i + 1) : kEmpty,
+                   std::memory_order_relaxed);
+  }
+  head_.store(pack(0, 0), std::memory_order_release);
+}
+
+PacketPool::Buffer PacketPool::acquire() {
+  uint64_t head = head_.load(std::memory_order_acquire);
+  while (indexOf(head) != kEmpty) {
+    const uint32_t index = indexOf(head);
+    // next_[index] may be stale if another thread popped it meanwhile; the
+    // tag makes that CAS fail, and the slot itself is never freed
+    const uint32_t next = next_[index].load(std::memory_order_relaxed);
+    if (head_.compare_exchange_weak(head, pack(tagOf(head) + 1, next),
+                                    std::memory_order_acquire,
+                                    std::memory_order_acquire)) {
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return Buffer(this, index, slab_.get() + static_cast<size_t>(index) * bufferSize_);
+    }
+  }
+
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return Buffer(this, kHeap, new uint8_t[bufferSize_]);
+}
+
+void PacketPool::release(uint32_t index, uint8_t* data) noexcept {
+  if (index == kHeap) {
+    delete[] data;
+    return;
+  }
+
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  do {
+    next_[index].store(indexOf(head), std::memory_order_relaxed);
+  } while (!head_.compare_exchange_weak(head, pack(tagOf(head) + 1, index),
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed));
+  released_.fetch_add(1, std::memory_order_relaxed);
+}
+
+PacketPool::Stats PacketPool::stats() const noexcept {
+  Stats s{};
+  s.hits = hits_.load(std::memory_order_relaxed);
+  s.misses = misses_.load(std::memory_order_relaxed);
+  s.released = released_.load(std::memory_order_relaxed);
+  s.capacity = count_;
+  s.bufferSize = bufferSize_;
+  return s;
+}
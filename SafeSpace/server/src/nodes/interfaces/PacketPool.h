@@ -0,0 +1,138 @@
+#ifndef SERVER_PACKETPOOL_H
+#define SERVER_PACKETPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief Lock-free pool of fixed-size packet buffers.
+ *
+ * All buffers are carved out of one slab allocated at construction. Free
+ * buffers sit on a Treiber stack whose head packs a 32-bit index with a
+ * 32-bit version tag, so acquire() and release are a single CAS each and
+ * immune to ABA. Any thread may acquire a buffer and any other thread may
+ * release it, which lets a serving thread hand a datagram to another
+ * thread without touching malloc.
+ *
+ * When the slab is exhausted acquire() falls back to a heap allocation of
+ * the same size instead of failing; hits and misses are counted so the
+ * pool can be sized from production numbers.
+ *
+ * The pool must outlive every Buffer taken from it.
+ */
+class PacketPool {
+ public:
+  /// Pool hit/miss counters; a snapshot, not a consistent cut.
+  struct Stats {
+    uint64_t hits;       ///< acquire() served from the slab.
+    uint64_t misses;     ///< acquire() fell back to the heap.
+    uint64_t released;   ///< Slab buffers returned.
+    size_t capacity;     ///< Buffers in the slab.
+    size_t bufferSize;   ///< Bytes per buffer.
+  };
+
+  /**
+   * @brief Movable owning handle to one buffer; returns it to its pool on destruction.
+   */
+  class Buffer {
+   public:
+    Buffer() noexcept = default;
+    ~Buffer() { reset(); }
+
+    Buffer(Buffer&& other) noexcept
+      : pool_(other.pool_), index_(other.index_), data_(other.data_), size_(other.size_) {
+      other.pool_ = nullptr;
+      other.data_ = nullptr;
+      other.size_ = 0;
+    }
+
+    Buffer& operator=(Buffer&& other) noexcept {
+      if (this != &other) {
+        reset();
+        pool_ = other.pool_;
+        index_ = other.index_;
+        data_ = other.data_;
+        size_ = other.size_;
+        other.pool_ = nullptr;
+        other.data_ = nullptr;
+        other.size_ = 0;
+      }
+      return *this;
+    }
+
+    uint8_t* data() noexcept { return data_; }
+    const uint8_t* data() const noexcept { return data_; }
+    size_t capacity() const noexcept { return pool_ ? pool_->bufferSize_ : 0; }
+
+    /// Bytes in use; set by the producer, e.g. after a recvfrom().
+    size_t size() const noexcept { return size_; }
+    void setSize(size_t n) noexcept { size_ = n < capacity() ? n : capacity(); }
+
+    explicit operator bool() const noexcept { return data_ != nullptr; }
+
+    /// True when the buffer came from the heap fallback rather than the slab.
+    bool pooled() const noexcept { return pool_ && index_ != kHeap; }
+
+    /// Gives the buffer back now; the handle becomes empty.
+    void reset() noexcept {
+      if (pool_) pool_->release(index_, data_);
+      pool_ = nullptr;
+      data_ = nullptr;
+      size_ = 0;
+    }
+
+   private:
+    friend class PacketPool;
+    Buffer(PacketPool* pool, uint32_t index, uint8_t* data) noexcept
+      : pool_(pool), index_(index), data_(data), size_(0) {}
+
+    PacketPool* pool_ = nullptr;
+    uint32_t index_ = 0;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+  };
+
+  /**
+   * @param bufferSize bytes per buffer.
+   * @param count buffers in the slab.
+   * @throws std::invalid_argument if either is zero or count does not fit the index.
+   */
+  PacketPool(size_t bufferSize, size_t count);
+
+  /**
+   * @brief Takes a free buffer; never fails short of std::bad_alloc.
+   */
+  Buffer acquire();
+
+  size_t bufferSize() const noexcept { return bufferSize_; }
+  size_t capacity() const noexcept { return count_; }
+
+  Stats stats() const noexcept;
+
+ private:
+  static constexpr uint32_t kEmpty = UINT32_MAX;     ///< Free list terminator.
+  static constexpr uint32_t kHeap = UINT32_MAX - 1;  ///< Index of heap fallback buffers.
+
+  size_t bufferSize_;
+  size_t count_;
+  std::unique_ptr<uint8_t[]> slab_;
+  std::unique_ptr<std::atomic<uint32_t>[]> next_;   ///< Free list links, by index.
+  std::atomic<uint64_t> head_;                     ///< (tag << 32) | index of the top free buffer.
+
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> released_;
+
+  void release(uint32_t index, uint8_t* data) noexcept;
+
+  // Non-copyable
+  PacketPool(const PacketPool&) = delete;
+  PacketPool& operator=(const PacketPool&) = delete;
+};
+
+#endif //SERVER_PACKETPOOL_H
@@ -0,0 +1,54 @@
+#ifndef SERVER_REPLYFRAME_H
+#define SERVER_REPLYFRAME_H
+
+#include "../../model/structures/MessageHeader.h"
+#include "ResponseBuffer.h"
+
+/**
+ * @brief Frames the reply to a framed request in place.
+ *
+ * Construct before the handler writes its reply: for a framed request the
+ * header bytes are reserved up front, and on destruction they are filled in
+ * (request type and seq, FLAG_REPLY, final length). A handler that writes
+ * nothing leaves the response empty. Replies to legacy datagrams are left
+ * untouched.
+ */
+class ReplyFrame {
+ public:
+  ReplyFrame(ResponseBuffer& response, const MessageView& request) noexcept
+    : response_(response), request_(request), header_(nullptr) {
+    if (request_.framed) {
+      header_ = response_.reserve(MessageHeader::SIZE);
+    }
+  }
+
+  ~ReplyFrame() {
+    if (!header_ || response_.overflowed()) return;
+    const size_t payload = response_.size() - MessageHeader::SIZE;
+    if (payload == 0) {
+      response_.clear();
+      return;
+    }
+    if (payload > UINT16_MAX) {
+      // does not fit the length field; the server drops it
+      response_.markOverflow();
+      return;
+    }
+    MessageHeader header;
+    header.type = request_.kind;
+    header.flags = static_cast<uint8_t>(request_.flags | MessageHeader::FLAG_REPLY);
+    header.length = static_cast<uint16_t>(payload);
+    header.seq = request_.seq;
+    header.encode(header_);
+  }
+
+ private:
+  ResponseBuffer& response_;
+  const MessageView& request_;
+  uint8_t* header_;
+
+  ReplyFrame(const ReplyFrame&) = delete;
+  ReplyFrame& operator=(const ReplyFrame&) = delete;
+};
+
+#endif //SERVER_REPLYFRAME_H
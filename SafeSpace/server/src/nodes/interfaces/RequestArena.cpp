@@ -0,0 +1,105 @@
+#include "RequestArena.h"
+#include <algorithm>
+
+RequestArena::Scope::Scope(RequestArena& arena) noexcept
+  : arena_(arena),
+    chunk_(arena.current_),
+    offset_(arena.offset_)
+{
+  ++arena_.depth_;
+}
+
+RequestArena::Scope::~Scope() {
+  --arena_.depth_;
+  arena_.rewind(chunk_, offset_);
+}
+
+RequestArena::RequestArena(size_t chunkSize)
+  : chunkSize_(std::max<size_t>(chunkSize, 64)),
+    current_(0),
+    offset_(0),
+    depth_(0),
+    spilled_(0),
+    highWater_(0),
+    spills_(0)
+{
+  chunks_.push_back(Chunk{std::unique_ptr<uint8_t[]>(new uint8_t[chunkSize_]), chunkSize_, 0});
+}
+
+RequestArena& RequestArena::local() {
+  thread_local RequestArena arena;
+  return arena;
+}
+
+void* RequestArena::allocate(size_t n, size_t align) {
+  for (;;) {
+    Chunk& chunk = chunks_[current_];
+    const auto base = reinterpret_cast<uintptr_t>(chunk.data.get());
+    const uintptr_t start = (base + offset_ + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    const size_t end = static_cast<size_t>(start - base) + n;
+    if (end <= chunk.size) {
+      offset_ = end;
+      highWater_ = std::max(highWater_, spilled_ + offset_);
+      return reinterpret_cast<void*>(start);
+    }
+
+    // spill: reuse the next chunk if it is big enough, otherwise insert one
+    ++spills_;
+    chunk.used = offset_;
+    spilled_ += offset_;
+    const size_t need = n + align;
+    if (current_ + 1 >= chunks_.size() || chunks_[current_ + 1].size < need) {
+      const size_t size = std::max(chunkSize_, need);
+      chunks_.insert(chunks_.begin() + static_cast<std::ptrdiff_t>(current_ + 1),
+                     Chunk{std::unique_ptr<uint8_t[]>(new uint8_t[size]), size, 0});
+    }
+    ++current_;
+    offset_ = 0;
+  }
+}
+
+void RequestArena::deallocate(void* p, size_t n) noexcept {
+  uint8_t* base = chunks_[current_].data.get();
+  if (static_cast<uint8_t*>(p) + n == base + offset_) {
+    offset_ = static_cast<size_t>(static_cast<uint8_t*>(p) - base);
+  }
+}
+
+size_t RequestArena::used() const noexcept {
+  return spilled_ + offset_;
+}
+
+RequestArena::Stats RequestArena::stats() const noexcept {
+  Stats s{};
+  for (const auto& chunk : chunks_) {
+    s.capacity += chunk.size;
+  }
+  s.highWater = highWater_;
+  s.spills = spills_;
+  return s;
+}
+
+void RequestArena::rewind(size_t chunk, size_t offset) noexcept {
+  current_ = chunk;
+  offset_ = offset;
+  spilled_ = 0;
+  for (size_t i = 0; i < current_; ++i) {
+    spilled_ += chunks_[i].used;
+  }
+
+  // the arena is empty again: fold spill chunks into one so the next
+  // request of this size is served from a single chunk
+  if (depth_ == 0 && current_ == 0 && offset_ == 0 && chunks_.size() > 1) {
+    size_t total = 0;
+    for (const auto& c : chunks_) {
+      total += c.size;
+    }
+    try {
+      Chunk merged{std::unique_ptr<uint8_t[]>(new uint8_t[total]), total, 0};
+      chunks_.clear();
+      chunks_.push_back(std::move(merged));
+    } catch (const std::bad_alloc&) {
+      // keep the spill chunks; they still work, just less compactly
+    }
+  }
+}
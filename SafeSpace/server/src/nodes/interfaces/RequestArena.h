@@ -0,0 +1,135 @@
+#ifndef SERVER_REQUESTARENA_H
+#define SERVER_REQUESTARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Per-thread bump allocator for request-scoped memory.
+ *
+ * Handlers build their temporaries (response payloads, scratch vectors)
+ * here instead of on the heap. Allocation is a pointer bump inside a chunk;
+ * nothing is freed individually. UDPServer opens a Scope around every
+ * dispatched datagram, and leaving the scope rewinds the arena, so memory
+ * obtained from it is only valid until the handler returns.
+ *
+ * A request that outgrows the current chunk spills into another one; when
+ * the outermost scope closes, spilled chunks are merged into a single
+ * larger chunk so the next request of that size fits without spilling.
+ *
+ * Not thread-safe by design: use local() to get the calling thread's arena.
+ */
+class RequestArena {
+ public:
+  /// Size of the first chunk of every thread's arena.
+  static constexpr size_t kDefaultChunkSize = 64 * 1024;
+
+  /// Usage counters, for sizing kDefaultChunkSize.
+  struct Stats {
+    size_t capacity;    ///< Bytes currently reserved in chunks.
+    size_t highWater;   ///< Most bytes in use at once.
+    uint64_t spills;    ///< Allocations that did not fit the current chunk.
+  };
+
+  /**
+   * @brief Rewinds the arena to where it stood at construction.
+   */
+  class Scope {
+   public:
+    explicit Scope(RequestArena& arena) noexcept;
+    ~Scope();
+
+   private:
+    RequestArena& arena_;
+    size_t chunk_;
+    size_t offset_;
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+
+  explicit RequestArena(size_t chunkSize = kDefaultChunkSize);
+
+  /// Arena of the calling thread.
+  static RequestArena& local();
+
+  /**
+   * @brief Returns n bytes aligned to align (a power of two).
+   * @throws std::bad_alloc if a new chunk cannot be allocated.
+   */
+  void* allocate(size_t n, size_t align = alignof(std::max_align_t));
+
+  /**
+   * @brief Gives back p if it is the most recent allocation; otherwise a no-op.
+   *
+   * Lets a growing vector reuse the space of the buffer it just outgrew.
+   */
+  void deallocate(void* p, size_t n) noexcept;
+
+  /// Bytes handed out in the current scope chain.
+  size_t used() const noexcept;
+
+  Stats stats() const noexcept;
+
+ private:
+  struct Chunk {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size;
+    size_t used;      ///< Bytes in use when the arena moved past this chunk.
+  };
+
+  size_t chunkSize_;
+  std::vector<Chunk> chunks_;
+  size_t current_;    ///< Chunk being bumped.
+  size_t offset_;     ///< Next free byte in chunks_[current_].
+  size_t depth_;      ///< Open scopes.
+  size_t spilled_;    ///< Bytes used in chunks before current_.
+  size_t highWater_;
+  uint64_t spills_;
+
+  void rewind(size_t chunk, size_t offset) noexcept;
+
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+};
+
+/**
+ * @brief Standard allocator over the calling thread's RequestArena.
+ *
+ * Containers using it must not outlive the current RequestArena::Scope nor
+ * be handed to another thread.
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  ArenaAllocator() noexcept : arena_(&RequestArena::local()) {}
+  explicit ArenaAllocator(RequestArena& arena) noexcept : arena_(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) noexcept { arena_->deallocate(p, n * sizeof(T)); }
+
+  RequestArena* arena() const noexcept { return arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena_ == other.arena(); }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const noexcept { return arena_ != other.arena(); }
+
+ private:
+  RequestArena* arena_;
+};
+
+/// Request-scoped vector; see ArenaAllocator for its lifetime rules.
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif //SERVER_REQUESTARENA_H
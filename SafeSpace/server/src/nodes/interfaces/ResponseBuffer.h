@@ -0,0 +1,92 @@
+#ifndef SERVER_RESPONSEBUFFER_H
+#define SERVER_RESPONSEBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/**
+ * @brief Writable, fixed-capacity view over a server-owned send buffer.
+ *
+ * UDPServer hands one of these to onDatagram() for every received datagram.
+ * It points straight into the memory the transport sends from (a sendmmsg
+ * batch slot, a registered io_uring buffer), so a handler that serializes
+ * its reply here causes no heap allocation and no further copy.
+ *
+ * The view never grows. A write that does not fit is rejected and marks the
+ * response as overflowed; the server then drops it rather than sending a
+ * truncated datagram. Multi-byte put helpers write network byte order.
+ */
+class ResponseBuffer {
+ public:
+  ResponseBuffer(uint8_t* data, size_t capacity) noexcept
+    : data_(data), capacity_(capacity), size_(0), overflow_(false) {}
+
+  uint8_t* data() noexcept { return data_; }
+  const uint8_t* data() const noexcept { return data_; }
+  size_t size() const noexcept { return size_; }
+  size_t capacity() const noexcept { return capacity_; }
+  size_t remaining() const noexcept { return capacity_ - size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  /// True once a write did not fit; the response will not be sent.
+  bool overflowed() const noexcept { return overflow_; }
+
+  /// Flags the response as unsendable, e.g. when a framing limit is exceeded.
+  void markOverflow() noexcept { overflow_ = true; }
+
+  /// Discards everything written so far, including the overflow mark.
+  void clear() noexcept {
+    size_ = 0;
+    overflow_ = false;
+  }
+
+  /**
+   * @brief Claims n bytes at the end of the response for in-place writing.
+   * @return Pointer to the claimed bytes, or nullptr (and overflowed()) if they do not fit.
+   */
+  uint8_t* reserve(size_t n) noexcept {
+    if (n > remaining()) {
+      overflow_ = true;
+      return nullptr;
+    }
+    uint8_t* p = data_ + size_;
+    size_ += n;
+    return p;
+  }
+
+  bool append(const void* src, size_t n) noexcept {
+    uint8_t* p = reserve(n);
+    if (!p) return false;
+    if (n != 0) std::memcpy(p, src, n);
+    return true;
+  }
+
+  bool append(std::string_view s) noexcept { return append(s.data(), s.size()); }
+
+  bool put(uint8_t v) noexcept { return append(&v, 1); }
+
+  bool putBE16(uint16_t v) noexcept {
+    const uint8_t b[2] = {static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v)};
+    return append(b, sizeof(b));
+  }
+
+  bool putBE32(uint32_t v) noexcept {
+    const uint8_t b[4] = {static_cast<uint8_t>(v >> 24), static_cast<uint8_t>(v >> 16),
+                          static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v)};
+    return append(b, sizeof(b));
+  }
+
+  bool putBE64(uint64_t v) noexcept {
+    return putBE32(static_cast<uint32_t>(v >> 32)) && putBE32(static_cast<uint32_t>(v));
+  }
+
+ private:
+  uint8_t* data_;
+  size_t capacity_;
+  size_t size_;
+  bool overflow_;
+};
+
+#endif //SERVER_RESPONSEBUFFER_H
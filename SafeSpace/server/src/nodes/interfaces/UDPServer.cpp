@@ -3,6 +3,7 @@
 //
 
 #include "UDPServer.h"
+#include "IoUringTransport.h"
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -12,28 +13,65 @@
 #include <errno.h>
 #include <utility>
 #include <vector>
+#include <algorithm>
 
-UDPServer::UDPServer(std::string ip, uint16_t port, size_t bufsize)
+namespace {
+/// Pool of the server the calling thread is serving, if any.
+struct ServingContext {
+  const UDPServer* server;
+  PacketPool* pool;
+};
+thread_local ServingContext tlsServing{nullptr, nullptr};
+}
+
+UDPServer::UDPServer(std::string ip, uint16_t port, size_t bufsize, size_t batchSize,
+                     size_t workers, Transport transport)
   : sockfd_(-1),
     port_(port),
     ip_(std::move(ip)),
     bufsize_(bufsize),
+    batchSize_(std::clamp<size_t>(batchSize, 1, kMaxBatchSize)),
+    workers_(std::clamp<size_t>(workers, 1, kMaxWorkers)),
+    legacyFraming_(true),
+    transport_(transport),
     handler_{},
-    running_(false)
+    running_(false),
+    loop_(std::make_unique<EventLoop>())
 {
+  sockfd_ = openBoundSocket(workers_.load() > 1);
+  pools_.push_back(std::make_unique<PacketPool>(bufsize_, kPoolBuffersPerWorker));
+  std::cout << "UDPServer: bound to " << ip_ << ":" << port_ << std::endl;
+}
+
+UDPServer::~UDPServer() {
+  stop();
+  joinWorkers();
+  if (sockfd_ >= 0) {
+    ::close(sockfd_);
+    sockfd_ = -1;
+  }
+}
+
+int UDPServer::openBoundSocket(bool reusePort) const {
   // create UDP socket
-  sockfd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
-  if (sockfd_ < 0) {
+  int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
     throw std::runtime_error(std::string("socket() failed: ") + std::strerror(errno));
   }
 
   // allow of address reuse
   int opt = 1;
-  if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-    ::close(sockfd_);
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+    ::close(fd);
     throw std::runtime_error(std::string("setsockopt(SO_REUSEADDR) failed: ") + std::strerror(errno));
   }
 
+  // only a worker pool shares the port; a lone server keeps it to itself
+  if (reusePort && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+    ::close(fd);
+    throw std::runtime_error(std::string("setsockopt(SO_REUSEPORT) failed: ") + std::strerror(errno));
+  }
+
   // bind to all interfaces on the provided port
   sockaddr_in addr{};
   addr.sin_family = AF_INET;
@@ -42,99 +80,400 @@ UDPServer::UDPServer(std::string ip, uint16_t port, size_t bufsize)
 
   // Convert IP from string to binary
   if (::inet_pton(AF_INET, ip_.c_str(), &addr.sin_addr) <= 0) {
-    ::close(sockfd_);
+    ::close(fd);
     throw std::runtime_error(std::string("Invalid IP address: ") + ip_);
   }
 
   // Bind socket to given IP and port
-  if (::bind(sockfd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
-    ::close(sockfd_);
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    ::close(fd);
     throw std::runtime_error(std::string("bind() failed: ") + std::strerror(errno));
   }
+  return fd;
+}
 
-  std::cout << "UDPServer: bound to " << ip_ << ":" << port_ << std::endl;
+void UDPServer::setHandler(Handler h) {
+  handler_ = std::move(h);
 }
 
-UDPServer::~UDPServer() {
-  stop();
-  if (sockfd_ >= 0) {
-    ::close(sockfd_);
-    sockfd_ = -1;
+void UDPServer::setDatagramHandler(DatagramHandler h) {
+  datagramHandler_ = std::move(h);
+}
+
+void UDPServer::setBatchSize(size_t batchSize) noexcept {
+  batchSize_.store(std::clamp<size_t>(batchSize, 1, kMaxBatchSize));
+}
+
+void UDPServer::BatchState::resize(size_t batch, size_t bufsize) {
+  buffers.resize(batch * bufsize);
+  peers.resize(batch);
+  rxIov.resize(batch);
+  rxMsgs.resize(batch);
+  txBuffers.resize(batch * bufsize);
+  txIov.resize(batch);
+  txMsgs.resize(batch);
+
+  // Receive descriptors point at fixed slots, so they only change on resize
+  for (size_t i = 0; i < batch; ++i) {
+    rxIov[i].iov_base = buffers.data() + i * bufsize;
+    rxIov[i].iov_len = bufsize;
   }
 }
 
-void UDPServer::setHandler(Handler h) {
-  handler_ = std::move(h);
+bool UDPServer::classify(const uint8_t* data, size_t len, MessageView& view) const noexcept {
+  if (MessageView::fromFramed(data, len, view)) {
+    return true;
+  }
+  return legacyFraming_.load() && MessageView::fromLegacy(data, len, view);
+}
+
+PacketPool& UDPServer::packetPool() noexcept {
+  if (tlsServing.server == this) {
+    return *tlsServing.pool;
+  }
+  std::lock_guard<std::mutex> lock(workersMutex_);
+  return *pools_.front();
+}
+
+PacketPool::Stats UDPServer::packetPoolStats() const {
+  PacketPool::Stats total{};
+  total.bufferSize = bufsize_;
+  std::lock_guard<std::mutex> lock(workersMutex_);
+  for (const auto& pool : pools_) {
+    const PacketPool::Stats s = pool->stats();
+    total.hits += s.hits;
+    total.misses += s.misses;
+    total.released += s.released;
+    total.capacity += s.capacity;
+  }
+  return total;
+}
+
+void UDPServer::setWorkerCount(size_t workers) noexcept {
+  workers_.store(std::clamp<size_t>(workers, 1, kMaxWorkers));
 }
 
 void UDPServer::serveBlocking() {
   running_.store(true);
-  std::vector<uint8_t> buffer(bufsize_);
+  const size_t workers = workers_.load();
 
-  std::cout << "UDPServer: entering blocking serve loop..." << std::endl;
+  std::cout << "UDPServer: entering blocking serve loop (batch size "
+            << batchSize_.load() << ", " << workers << " worker(s))..." << std::endl;
 
-  while (running_.load()) {
-    sockaddr_in peer{};
-    socklen_t peerlen = sizeof(peer);
+  {
+    std::lock_guard<std::mutex> lock(workersMutex_);
+    // the primary was bound alone if the pool grew after construction; the
+    // kernel builds the group when the first worker binds next to it
+    size_t spawn = workers;
+    int opt = 1;
+    if (workers > 1 && setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+      std::cerr << "UDPServer: setsockopt(SO_REUSEPORT) failed on the primary socket: "
+                << std::strerror(errno) << ", serving with 1 worker" << std::endl;
+      spawn = 1;
+    }
+    for (size_t i = 1; i < spawn; ++i) {
+      int fd = -1;
+      try {
+        fd = openBoundSocket(true);
+        if (pools_.size() <= i) {
+          pools_.push_back(std::make_unique<PacketPool>(bufsize_, kPoolBuffersPerWorker));
+        }
+        workerLoops_.push_back(std::make_unique<EventLoop>());
+      } catch (const std::exception& ex) {
+        std::cerr << "UDPServer: worker " << i << " setup failed: " << ex.what() << std::endl;
+        if (fd >= 0) ::close(fd);
+        break;
+      }
+      workerSockets_.push_back(fd);
+      workerThreads_.emplace_back(&UDPServer::serveSocket, this, fd,
+                                  std::ref(*workerLoops_.back()), std::ref(*pools_[i]));
+    }
+  }
 
-    ssize_t received = ::recvfrom(sockfd_, buffer.data(),
-      static_cast<socklen_t>(buffer.size()), 0,
-      reinterpret_cast<sockaddr*>(&peer), &peerlen
-      );
+  serveSocket(sockfd_, *loop_, *pools_.front());
+
+  // a shutdown payload on any socket ends the whole pool; the primary loop
+  // has already returned, so only the workers are told to stop
+  running_.store(false);
+  stopWorkers();
+  joinWorkers();
+
+  const PacketPool::Stats pool = packetPoolStats();
+  std::cout << "UDPServer: packet pool hits " << pool.hits << ", misses " << pool.misses
+            << " (" << pool.capacity << " buffers of " << pool.bufferSize << " bytes)" << std::endl;
+  std::cout << "UDPServer: leaving serve loop." << std::endl;
+}
+
+void UDPServer::serveSocket(int fd, EventLoop& loop, PacketPool& pool) {
+  const ServingContext previous = tlsServing;
+  tlsServing = ServingContext{this, &pool};
 
-    if (received < 0) {
-      if (errno == EINTR) {
-        // interrupted by signal; check running_ flag and continue or exit
-        continue;
+  if (transport_ == Transport::IoUring && serveIoUring(fd, loop)) {
+    tlsServing = previous;
+    return;
+  }
+
+  PacketPool::Buffer buffer = pool.acquire();
+  PacketPool::Buffer txBuffer = pool.acquire();
+  BatchState state;
+
+  loop.addReader(fd, [this, fd, &buffer, &txBuffer, &state](uint32_t) {
+    // drain what is queued, bounded so timers and other fds are not starved
+    for (int round = 0; round < kMaxRoundsPerWakeup; ++round) {
+      const size_t batch = batchSize_.load();
+      const Round r = batch > 1 ? serveBatched(fd, state, batch)
+                                : serveSingle(fd, buffer, txBuffer);
+      if (r == Round::Shutdown) {
+        stop();
+        return;
       }
+      if (r == Round::Drained) return;
+    }
+  });
+
+  loop.run();
+  loop.removeFd(fd);
+  tlsServing = previous;
+}
+
+bool UDPServer::serveIoUring(int fd, EventLoop& loop) {
+  std::unique_ptr<IoUringTransport> ring;
+  try {
+    ring = std::make_unique<IoUringTransport>(fd, bufsize_);
+  } catch (const std::exception& ex) {
+    std::cerr << "UDPServer: io_uring unavailable (" << ex.what()
+              << "), falling back to the classic transport" << std::endl;
+    return false;
+  }
+
+  auto handler = [this](const sockaddr_in& peer, const uint8_t* data, size_t len,
+                        ResponseBuffer& response) {
+    // shutdown payload check: datagrams completed after it are dropped
+    if (len > 0 && data[0] == static_cast<uint8_t>('#')) {
+      char ipstr[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &peer.sin_addr, ipstr, sizeof(ipstr));
+      std::cout << "UDPServer: shutdown payload received from " << ipstr << ":"
+                << ntohs(peer.sin_port) << std::endl;
+      response.append("Server shutting down");
+      return false;
+    }
+    dispatch(peer, data, len, response);
+    // the transport sends each reply as soon as the handler returns
+    onBatchDispatched();
+    return true;
+  };
+
+  loop.addReader(ring->ringFd(), [this, &ring, &handler](uint32_t) {
+    if (!ring->process(handler)) {
+      stop();
+    }
+  });
+
+  loop.run();
+  loop.removeFd(ring->ringFd());
+  if (ring->sendFallbacks() > 0) {
+    std::cout << "UDPServer: io_uring sent " << ring->sendFallbacks()
+              << " responses through sendto() (fixed buffers exhausted)" << std::endl;
+  }
+  return true;
+}
+
+void UDPServer::joinWorkers() {
+  std::vector<std::thread> threads;
+  std::vector<int> sockets;
+  {
+    std::lock_guard<std::mutex> lock(workersMutex_);
+    threads.swap(workerThreads_);
+    sockets.swap(workerSockets_);
+  }
+  for (auto& t : threads) {
+    if (t.joinable()) t.join();
+  }
+  for (int fd : sockets) {
+    ::close(fd);
+  }
+  std::lock_guard<std::mutex> lock(workersMutex_);
+  workerLoops_.clear();
+}
+
+bool UDPServer::dispatch(const sockaddr_in& peer, const uint8_t* data, size_t len,
+                         ResponseBuffer& response) {
+  // request-scoped temporaries of the handler are released on return
+  RequestArena::Scope scope(RequestArena::local());
+  try {
+    onDatagram(peer, data, len, response);
+  } catch (const std::exception& ex) {
+    std::cerr << "Exception in onDatagram(): " << ex.what() << std::endl;
+    response.clear();
+    return false;
+  }
+  if (response.overflowed()) {
+    std::cerr << "UDPServer: response larger than " << response.capacity()
+              << " bytes dropped" << std::endl;
+    response.clear();
+    return false;
+  }
+  return true;
+}
+
+UDPServer::Round UDPServer::serveSingle(int fd, PacketPool::Buffer& buffer,
+                                        PacketPool::Buffer& txBuffer) {
+  sockaddr_in peer{};
+  socklen_t peerlen = sizeof(peer);
+
+  ssize_t received = ::recvfrom(fd, buffer.data(),
+    static_cast<socklen_t>(buffer.capacity()), MSG_DONTWAIT,
+    reinterpret_cast<sockaddr*>(&peer), &peerlen
+    );
+
+  if (received < 0) {
+    if (errno == EINTR) return Round::Received;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
       std::cerr << "recvfrom() error: " << std::strerror(errno) << std::endl;
-      continue;
     }
+    return Round::Drained;
+  }
 
-    // log short info
-    char ipstr[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &peer.sin_addr, ipstr, sizeof(ipstr));
-    uint16_t peerPort = ntohs(peer.sin_port);
-    std::cout << "UDPServer: received " << received << " bytes from " << ipstr << ":" << peerPort << std::endl;
-
-    // shutdown payload check
-    if (received > 0 && buffer[0] == static_cast<uint8_t>('#')) {
-      std::cout << "UDPServer: shutdown payload received from " << ipstr << ":" << peerPort << std::endl;
-      // optional ack
-      const char ack[] = "Server shutting down";
-      ::sendto(sockfd_, ack, sizeof(ack) - 1, 0, reinterpret_cast<sockaddr*>(&peer), peerlen);
-      break;
+  // log short info
+  char ipstr[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &peer.sin_addr, ipstr, sizeof(ipstr));
+  uint16_t peerPort = ntohs(peer.sin_port);
+  std::cout << "UDPServer: received " << received << " bytes from " << ipstr << ":" << peerPort << std::endl;
+
+  // shutdown payload check
+  if (received > 0 && buffer.data()[0] == static_cast<uint8_t>('#')) {
+    std::cout << "UDPServer: shutdown payload received from " << ipstr << ":" << peerPort << std::endl;
+    // optional ack
+    const char ack[] = "Server shutting down";
+    ::sendto(fd, ack, sizeof(ack) - 1, 0, reinterpret_cast<sockaddr*>(&peer), peerlen);
+    return Round::Shutdown;
+  }
+
+  // call virtual hook; the reply is written straight into txBuffer
+  ResponseBuffer response(txBuffer.data(), txBuffer.capacity());
+  const bool dispatched = dispatch(peer, buffer.data(), static_cast<size_t>(received), response);
+  onBatchDispatched();
+  if (!dispatched) {
+    return Round::Received;
+  }
+
+  // send response if present
+  if (!response.empty()) {
+    ssize_t sent = ::sendto(fd, response.data(),
+      static_cast<socklen_t>(response.size()), 0,
+      reinterpret_cast<sockaddr*>(&peer), peerlen
+      );
+    if (sent < 0) {
+      std::cerr << "sendto() error: " << std::strerror(errno) << std::endl;
+    } else {
+      std::cout << "UDPServer: sent " << sent << " bytes to " << ipstr << ":" << peerPort << std::endl;
     }
+  }
+  return Round::Received;
+}
 
-    std::string response;
-    // call virtual hook
-    try {
-      onReceive(peer, buffer.data(), received, response);
-    } catch (const std::exception& ex) {
-      std::cerr << "Exception in onReceive(): " << ex.what() << std::endl;
-      continue;
+UDPServer::Round UDPServer::serveBatched(int fd, BatchState& state, size_t batch) {
+  if (state.rxMsgs.size() < batch || state.buffers.size() != state.rxMsgs.size() * bufsize_) {
+    state.resize(batch, bufsize_);
+  }
+
+  // msg_namelen is overwritten by the kernel, so the headers are re-armed per round
+  for (size_t i = 0; i < batch; ++i) {
+    msghdr& h = state.rxMsgs[i].msg_hdr;
+    h = msghdr{};
+    h.msg_name = &state.peers[i];
+    h.msg_namelen = sizeof(sockaddr_in);
+    h.msg_iov = &state.rxIov[i];
+    h.msg_iovlen = 1;
+  }
+
+  // the loop reported readability, so take whatever is queued without blocking
+  int received = ::recvmmsg(fd, state.rxMsgs.data(),
+                            static_cast<unsigned int>(batch), MSG_DONTWAIT, nullptr);
+  if (received < 0) {
+    if (errno == EINTR) return Round::Received;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      std::cerr << "recvmmsg() error: " << std::strerror(errno) << std::endl;
+    }
+    return Round::Drained;
+  }
+
+  bool keepGoing = true;
+  size_t pending = 0;
+  size_t dispatched = 0;
+
+  for (int i = 0; i < received; ++i) {
+    const uint8_t* data = state.buffers.data() + static_cast<size_t>(i) * bufsize_;
+    const size_t len = state.rxMsgs[i].msg_len;
+    const sockaddr_in& peer = state.peers[i];
+    // each slot replies from its own region of txBuffers, so sendmmsg() needs no copy
+    ResponseBuffer response(state.txBuffers.data() + static_cast<size_t>(i) * bufsize_, bufsize_);
+
+    // shutdown payload check: datagrams queued after it are dropped
+    if (len > 0 && data[0] == static_cast<uint8_t>('#')) {
+      char ipstr[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &peer.sin_addr, ipstr, sizeof(ipstr));
+      std::cout << "UDPServer: shutdown payload received from " << ipstr << ":"
+                << ntohs(peer.sin_port) << std::endl;
+      response.append("Server shutting down");
+      keepGoing = false;
+    } else {
+      dispatch(peer, data, len, response);
+      ++dispatched;
     }
 
-    // send response if present
     if (!response.empty()) {
-      ssize_t sent = ::sendto(sockfd_, response.data(),
-        static_cast<socklen_t>(response.size()), 0,
-        reinterpret_cast<sockaddr*>(&peer), peerlen
-        );
-      if (sent < 0) {
-        std::cerr << "sendto() error: " << std::strerror(errno) << std::endl;
-      } else {
-        std::cout << "UDPServer: sent " << sent << " bytes to " << ipstr << ":" << peerPort << std::endl;
-      }
+      state.txIov[pending].iov_base = response.data();
+      state.txIov[pending].iov_len = response.size();
+      msghdr& h = state.txMsgs[pending].msg_hdr;
+      h = msghdr{};
+      h.msg_name = const_cast<sockaddr_in*>(&peer);
+      h.msg_namelen = sizeof(sockaddr_in);
+      h.msg_iov = &state.txIov[pending];
+      h.msg_iovlen = 1;
+      ++pending;
     }
+
+    if (!keepGoing) break;
   }
 
-  running_.store(false);
-  std::cout << "UDPServer: leaving serve loop." << std::endl;
+  onBatchDispatched();
+
+  // flush all responses; sendmmsg() may stop early, so resume from the first unsent
+  size_t flushed = 0;
+  while (flushed < pending) {
+    int sent = ::sendmmsg(fd, state.txMsgs.data() + flushed,
+                          static_cast<unsigned int>(pending - flushed), 0);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "sendmmsg() error: " << std::strerror(errno) << std::endl;
+      // skip the failing datagram so the rest of the batch still goes out
+      ++flushed;
+      continue;
+    }
+    flushed += static_cast<size_t>(sent);
+  }
+
+  if (received > 1) {
+    std::cout << "UDPServer: batch of " << received << " datagrams, "
+              << dispatched << " dispatched, " << pending << " responses sent" << std::endl;
+  }
+  if (!keepGoing) return Round::Shutdown;
+  // a short batch means the socket queue is empty
+  return static_cast<size_t>(received) < batch ? Round::Drained : Round::Received;
 }
 
 void UDPServer::stop() noexcept {
   running_.store(false);
+  loop_->stop();
+  stopWorkers();
+}
+
+void UDPServer::stopWorkers() noexcept {
+  std::lock_guard<std::mutex> lock(workersMutex_);
+  for (auto& loop : workerLoops_) {
+    loop->stop();
+  }
 }
 
 void UDPServer::sendTo(const sockaddr_in& peer, const uint8_t* data, size_t len) const {
@@ -152,6 +491,22 @@ void UDPServer::sendTo(const sockaddr_in& peer, const uint8_t* data, size_t len)
 
 }
 
+void UDPServer::onDatagram(const sockaddr_in& peer, const uint8_t* data, size_t len,
+                           ResponseBuffer& response) {
+  if (datagramHandler_) {
+    datagramHandler_(peer, data, len, response);
+    return;
+  }
+
+  // compatibility shim: the string keeps its capacity, so steady state is one copy
+  thread_local std::string scratch;
+  scratch.clear();
+  onReceive(peer, data, static_cast<ssize_t>(len), scratch);
+  response.append(scratch);
+}
+
+void UDPServer::onBatchDispatched() {}
+
 void UDPServer::onReceive(const sockaddr_in& peer, const uint8_t* data, ssize_t len, std::string& out_response) {
   // Default implementation
   if (handler_) {
@@ -7,10 +7,21 @@
 
 #include <cstdint>
 #include "../../common/LogManager.h"
+#include "../../model/structures/MessageHeader.h"
+#include "EventLoop.h"
+#include "PacketPool.h"
+#include "RequestArena.h"
+#include "ResponseBuffer.h"
 #include <functional>
+#include <memory>
 #include <string>
 #include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 /**
  * @brief Simple blocking UDP server.
@@ -22,10 +33,82 @@
  *  - All public methods are callable from any thread, but serveBlocking() runs
  *    in the caller thread and is blocking until stop() is called or a special
  *    shutdown payload (leading '#') is received.
+ *  - serveBlocking() runs the server's EventLoop on the caller thread. The
+ *    socket is watched with epoll, so stop() wakes it instantly, and derived
+ *    nodes can register their upstream client sockets and periodic tasks on
+ *    the same loop through eventLoop() instead of spawning polling threads.
+ *  - With a worker count K > 1, serveBlocking() spawns K - 1 extra threads,
+ *    each owning its own SO_REUSEPORT socket and EventLoop bound to the same
+ *    ip_/port_, so the kernel spreads flows across cores. The caller thread
+ *    serves the primary socket (plus anything registered on eventLoop()) and
+ *    joins the workers before returning. With K == 1 no socket sets
+ *    SO_REUSEPORT, so a second server on the same port cannot join the
+ *    group and take a share of the traffic.
+ *
+ * Thread-safety contract for derived classes:
+ *  - With K > 1, onReceive() (and the Handler) is invoked concurrently from
+ *    up to K threads. Any state shared between datagrams must be guarded by
+ *    the derived class (atomics or its own mutexes); only the peer, data and
+ *    out_response arguments are private to the call.
+ *  - Datagrams of one flow (same source ip:port) are hashed to the same
+ *    worker, so per-flow ordering is preserved; there is no ordering between
+ *    flows.
+ *  - sendTo() is safe to call from any worker.
+ *
+ * Responses:
+ *  - Every datagram is dispatched to onDatagram() with a ResponseBuffer
+ *    that points into the transport's send memory; handlers serialize
+ *    their reply there, so no allocation or extra copy happens per
+ *    datagram. A response may hold at most bufsize bytes; one that
+ *    overflows is dropped.
+ *  - The default onDatagram() is a compatibility shim: it calls the
+ *    std::string based onReceive()/Handler and copies the result once.
+ *
+ * Memory:
+ *  - Each dispatched datagram runs inside a RequestArena::Scope of the
+ *    serving thread, so handlers can build temporaries with ArenaVector /
+ *    ArenaAllocator and have them released wholesale on return.
+ *  - Each serving thread owns a lock-free PacketPool of bufsize-byte
+ *    buffers (packetPool()). A handler that must keep a datagram past its
+ *    return, e.g. to queue it for another thread, copies it into a pooled
+ *    buffer; the buffer may be released from any thread. packetPoolStats()
+ *    reports hits and misses for sizing kPoolBuffersPerWorker.
+ *
+ * Batching:
+ *  - With a batch size greater than one the serve loop pulls up to that many
+ *    datagrams per recvmmsg() call, dispatches each one to onReceive() in
+ *    arrival order and flushes every non-empty response with one sendmmsg().
+ *    A batch size of one keeps the classic recvfrom()/sendto() loop.
+ *  - onBatchDispatched() runs once per round after the last dispatch and
+ *    before anything is sent, so a node can make the round's writes
+ *    durable together and still patch the replies (one datagram per round
+ *    on the classic and io_uring paths).
+ *
+ * Transport:
+ *  - Transport::IoUring serves each socket through an IoUringTransport
+ *    (multishot recvmsg into a provided-buffer ring, responses sent from
+ *    registered buffers). The batch size is ignored in that mode. When the
+ *    kernel lacks io_uring support the server logs it and falls back to the
+ *    classic path, so the choice is always safe to make.
  */
 class UDPServer {
 
 public:
+  /// Default number of datagrams pulled per recvmmsg() call.
+  static constexpr size_t kDefaultBatchSize = 32;
+  /// Upper bound accepted by setBatchSize() (kernel UIO_MAXIOV).
+  static constexpr size_t kMaxBatchSize = 1024;
+  /// Upper bound accepted by setWorkerCount().
+  static constexpr size_t kMaxWorkers = 64;
+  /// Buffers in each serving thread's PacketPool.
+  static constexpr size_t kPoolBuffersPerWorker = 256;
+
+  /// Datagram I/O backend, chosen at construction.
+  enum class Transport {
+    Classic,  ///< recvfrom()/recvmmsg() on readiness.
+    IoUring   ///< IoUringTransport, falling back to Classic when unsupported.
+  };
+
   /**
    * @brief Handler type invoked for each received datagram.
    *
@@ -40,15 +123,54 @@ public:
                                      ssize_t len,
                                      std::string& out_response)>;
 
+  /**
+   * @brief Allocation-free handler type; writes the reply into response.
+   */
+  using DatagramHandler = std::function<void(const sockaddr_in& peer,
+                                             const uint8_t* data,
+                                             size_t len,
+                                             ResponseBuffer& response)>;
+
  protected:
   int sockfd_;
   uint16_t port_;
   std::string ip_;             ///< IP address bound to the server.
   size_t bufsize_;
+  std::atomic<size_t> batchSize_;  ///< Max datagrams per recvmmsg() (1 = classic loop).
+  std::atomic<size_t> workers_;    ///< Serving threads, caller included (1 = single-threaded).
+  std::atomic<bool> legacyFraming_;  ///< Accept datagrams without a MessageHeader.
+  const Transport transport_;
   Handler handler_;
+  DatagramHandler datagramHandler_;
   std::atomic<bool> running_;
+  std::unique_ptr<EventLoop> loop_;  ///< Primary loop, run by serveBlocking().
   LogManager& logger = LogManager::instance();
 
+  /**
+   * @brief Primary event loop of this server.
+   *
+   * Fds and timers registered here are serviced by the thread inside
+   * serveBlocking(), alongside the primary socket.
+   */
+  EventLoop& eventLoop() noexcept { return *loop_; }
+
+  /**
+   * @brief Classifies a datagram for a node's dispatch table.
+   *
+   * A valid MessageHeader wins; otherwise, while legacyFraming() is on, the
+   * shared size rules of MessageView::fromLegacy() apply.
+   * @return false if the datagram is neither framed nor a known legacy size.
+   */
+  bool classify(const uint8_t* data, size_t len, MessageView& view) const noexcept;
+
+  /**
+   * @brief Packet buffer pool of the calling serving thread.
+   *
+   * Outside a serving thread this is the primary thread's pool. Buffers
+   * stay valid for the lifetime of the server.
+   */
+  PacketPool& packetPool() noexcept;
+
  public:
   /**
    * @brief Constructs and binds a UDP socket to the given IP and port.
@@ -56,9 +178,19 @@ public:
    * @param ip IPv4 address as string (e.g. "127.0.0.1" or "0.0.0.0").
    * @param port Host-order port number (e.g. 5000).
    * @param bufsize Internal receive buffer size (default 1024 bytes).
+   * @param batchSize Max datagrams received per syscall (default kDefaultBatchSize).
+   * @param workers Number of serving threads, caller thread included (default 1).
+   * @param transport Datagram I/O backend (default Transport::Classic).
    * @throws std::runtime_error on socket creation, invalid IP, or bind failure.
    */
-  explicit UDPServer(std::string  ip, uint16_t port, size_t bufsize = 1024);
+  explicit UDPServer(std::string  ip, uint16_t port, size_t bufsize = 1024,
+                     size_t batchSize = kDefaultBatchSize, size_t workers = 1,
+                     Transport transport = Transport::Classic);
+
+  /**
+   * @brief Returns the transport requested at construction.
+   */
+  Transport transport() const noexcept { return transport_; }
 
   /**
    * @brief Destructor. Closes socket and releases resources.
@@ -84,21 +216,102 @@ public:
                          ssize_t len,
                          std::string& out_response);
 
+  /**
+   * @brief Zero-copy hook invoked on each received datagram.
+   *
+   * Default implementation:
+   *  - If a DatagramHandler is set, calls it.
+   *  - Otherwise falls back to onReceive() and copies its string output
+   *    into response (compatibility shim for existing overrides).
+   *
+   * Derived classes on the hot path should override this instead of
+   * onReceive(). Leave response empty to send nothing.
+   *
+   * @param peer sender address
+   * @param data received bytes
+   * @param len number of bytes received
+   * @param response view over the send buffer; capacity is bufsize bytes
+   */
+  virtual void onDatagram(const sockaddr_in& peer,
+                          const uint8_t* data,
+                          size_t len,
+                          ResponseBuffer& response);
+
+  /**
+   * @brief Hook invoked once per serve round, after every datagram of the
+   *        round went through onDatagram() and before any response is sent.
+   *
+   * The bytes written to this round's responses are still in the send
+   * buffers and may be patched in place (not resized). Runs on the serving
+   * thread; the default does nothing.
+   */
+  virtual void onBatchDispatched();
+
   /**
    * @brief Set an optional receive handler.
    * If no handler is set the server will echo received payloads.
    */
   void setHandler(Handler h);
 
+  /**
+   * @brief Set an optional allocation-free handler; takes precedence over setHandler().
+   */
+  void setDatagramHandler(DatagramHandler h);
+
+
+  /**
+   * @brief Set how many datagrams the serve loop pulls per syscall.
+   *
+   * Can be changed while serving; the new value applies to the next batch.
+   * Values are clamped to [1, kMaxBatchSize]; 1 selects the classic loop.
+   */
+  void setBatchSize(size_t batchSize) noexcept;
+
+  /**
+   * @brief Returns the current batch size.
+   */
+  size_t batchSize() const noexcept { return batchSize_.load(); }
+
+  /**
+   * @brief Enables or disables legacy length-based message detection.
+   *
+   * Derived nodes route framed datagrams (see MessageHeader) through their
+   * dispatch table; while this is on (the default) unframed datagrams are
+   * still classified by size, as before framing existed. Turn it off once
+   * every sender frames its messages so stray sizes are rejected.
+   */
+  void setLegacyFraming(bool enabled) noexcept { legacyFraming_.store(enabled); }
+
+  /**
+   * @brief Whether unframed datagrams are still accepted.
+   */
+  bool legacyFraming() const noexcept { return legacyFraming_.load(); }
+
+  /**
+   * @brief Set how many threads serve the port, caller thread included.
+   *
+   * Takes effect on the next serveBlocking() call. Values are clamped to
+   * [1, kMaxWorkers]. See the class comment for the thread-safety contract.
+   */
+  void setWorkerCount(size_t workers) noexcept;
 
   /**
-   * @brief Blocking serve loop. Caller thread will block on recvfrom().
+   * @brief Returns the configured worker count.
+   */
+  size_t workerCount() const noexcept { return workers_.load(); }
+
+  /**
+   * @brief Blocking serve loop. Caller thread will block on recvfrom() or
+   * recvmmsg() depending on the batch size.
    * The loop exits when stop() is called or when a shutdown payload ('#') is received.
    */
   void serveBlocking();
 
   /**
    * @brief Request a graceful stop from another thread.
+   *
+   * Wakes every serving thread's event loop; the thread inside
+   * serveBlocking() joins the workers before returning.
    */
   void stop() noexcept;
 
@@ -117,7 +330,82 @@ public:
    */
   const std::string& ip() const noexcept { return ip_; }
 
+  /**
+   * @brief Hit/miss counters summed over every serving thread's pool.
+   */
+  PacketPool::Stats packetPoolStats() const;
+
  private:
+  /** Scratch state reused across batched rounds, one per serving thread. */
+  struct BatchState {
+    std::vector<uint8_t> buffers;       ///< batch * bufsize_ receive bytes.
+    std::vector<sockaddr_in> peers;     ///< Sender of each slot.
+    std::vector<struct iovec> rxIov;    ///< One iovec per receive slot.
+    std::vector<struct mmsghdr> rxMsgs; ///< recvmmsg() descriptors.
+    std::vector<uint8_t> txBuffers;     ///< batch * bufsize_ response bytes.
+    std::vector<struct iovec> txIov;    ///< Non-empty responses only.
+    std::vector<struct mmsghdr> txMsgs; ///< sendmmsg() descriptors.
+
+    void resize(size_t batch, size_t bufsize);
+  };
+
+  /// Outcome of one receive round on a socket.
+  enum class Round { Received, Drained, Shutdown };
+
+  /// Rounds served per readiness event before yielding to other fds of the loop.
+  static constexpr int kMaxRoundsPerWakeup = 16;
+
+  mutable std::mutex workersMutex_;       ///< Guards the worker vectors below.
+  std::vector<int> workerSockets_;        ///< SO_REUSEPORT sockets owned by workers.
+  std::vector<std::unique_ptr<EventLoop>> workerLoops_;
+  std::vector<std::thread> workerThreads_;
+  /// One per serving slot, primary first; never shrinks, so handed-off buffers stay valid.
+  std::vector<std::unique_ptr<PacketPool>> pools_;
+
+  /**
+   * @brief Creates a UDP socket with SO_REUSEADDR bound to ip_/port_.
+   * @param reusePort Also set SO_REUSEPORT so worker sockets can share the port.
+   * @throws std::runtime_error on failure.
+   */
+  int openBoundSocket(bool reusePort) const;
+
+  /**
+   * @brief Registers fd on loop and runs it until stop() or a '#' payload.
+   * @param pool packet pool of the serving thread (see packetPool()).
+   */
+  void serveSocket(int fd, EventLoop& loop, PacketPool& pool);
+
+  /**
+   * @brief Non-blocking classic round: one recvfrom() and at most one sendto().
+   */
+  Round serveSingle(int fd, PacketPool::Buffer& buffer, PacketPool::Buffer& txBuffer);
+
+  /**
+   * @brief Runs onDatagram() for one datagram inside a RequestArena scope, containing exceptions.
+   * @return false (and an empty response) when the handler threw or overflowed.
+   */
+  bool dispatch(const sockaddr_in& peer, const uint8_t* data, size_t len,
+                ResponseBuffer& response);
+
+  /**
+   * @brief Non-blocking batched round: one recvmmsg() and at most one sendmmsg() flush.
+   */
+  Round serveBatched(int fd, BatchState& state, size_t batch);
+
+  /**
+   * @brief Serves fd through io_uring on loop until stop() or a '#' payload.
+   * @return false if the transport could not be set up (nothing was served).
+   */
+  bool serveIoUring(int fd, EventLoop& loop);
+
+  /**
+   * @brief Stops, joins and closes all worker threads and sockets.
+   */
+  void joinWorkers();
+
+  /** @brief Wakes the worker loops without touching the primary loop. */
+  void stopWorkers() noexcept;
+
   // Non-copyable
   UDPServer(const UDPServer&) = delete;
   UDPServer& operator=(const UDPServer&) = delete;